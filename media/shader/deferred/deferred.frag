@@ -0,0 +1,105 @@
+#version 430 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// the gbuffer of gbufferGen, world position, diffuse color and normal, and its depth for the background
+uniform sampler2D gPosition;
+uniform sampler2D gDiffuse;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+// the gbuffer keeps no specular color nor shininess, every surface gets these
+const float kAmbient = 0.1;
+const float kSpecular = 0.5;
+const float kShininess = 32.0;
+
+// DirectionalLight, Material and the FrameBlock, ViewBlock and DrawBlock uniform blocks, see uniform_blocks.h
+#include "uniform_blocks.glsl"
+
+// point and spot lights binned per cluster on the CPU, see LightClusters
+struct ClusterLight {
+    vec4 positionRange;
+    vec4 directionCosine;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+layout (std430, binding = 5) readonly buffer ClusterLights { ClusterLight clusterLights[]; };
+layout (std430, binding = 6) readonly buffer Clusters { uvec2 clusters[]; };
+layout (std430, binding = 7) readonly buffer ClusterIndices { uint clusterIndices[]; };
+
+uniform ivec2 clusterTiles;
+uniform int clusterSlices;
+uniform vec2 clusterScreenSize;
+uniform float clusterScale;
+uniform float clusterBias;
+
+// offset and count of the lights of the cluster of a fragment
+uvec2 GetCluster(vec2 fragCoord, float viewDepth)
+{
+    ivec2 tile = clamp(ivec2(fragCoord / clusterScreenSize * vec2(clusterTiles)), ivec2(0), clusterTiles - 1);
+    int slice = clamp(int(floor(log(max(viewDepth, 1e-4)) * clusterScale + clusterBias)), 0, clusterSlices - 1);
+    return clusters[(slice * clusterTiles.y + tile.y) * clusterTiles.x + tile.x];
+}
+
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 kd)
+{
+    vec3 lightDir = normalize(light.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), kShininess);
+    vec3 ambient = light.ambient * kAmbient * kd;
+    vec3 diffuse = light.diffuse * diff * kd;
+    vec3 specular = light.specular * spec * kSpecular;
+    return light.intensity * (ambient + diffuse + specular);
+}
+
+// the attenuation of PointLight, faded out toward the range the light was binned with
+vec3 CalcClusterLight(ClusterLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 kd)
+{
+    vec3 toLight = light.positionRange.xyz - fragPos;
+    float distance = length(toLight);
+    if (distance >= light.positionRange.w)
+        return vec3(0.0);
+    vec3 lightDir = toLight / distance;
+    float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * distance * distance);
+    float fade = clamp(1.0 - pow(distance / light.positionRange.w, 4.0), 0.0, 1.0);
+    attenuation *= fade * fade;
+    // spot lights, soft over the outer tenth of the cone
+    float cosOuter = light.directionCosine.w;
+    if (cosOuter >= -1.0)
+        attenuation *= smoothstep(cosOuter, mix(cosOuter, 1.0, 0.1), dot(-lightDir, light.directionCosine.xyz));
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), kShininess);
+    vec3 ambient = light.ambient.rgb * kAmbient * kd;
+    vec3 diffuse = light.diffuse.rgb * diff * kd;
+    vec3 specular = light.specular.rgb * spec * kSpecular;
+    return attenuation * (ambient + diffuse + specular);
+}
+
+void main()
+{
+    // nothing was drawn there, the clear color of the forward pass
+    if (texture(gDepth, TexCoords).r >= 1.0)
+    {
+        FragColor = vec4(0.1, 0.1, 0.1, 1.0);
+        return;
+    }
+    vec3 fragPos = texture(gPosition, TexCoords).xyz;
+    vec3 normal = normalize(texture(gNormal, TexCoords).xyz);
+    vec3 kd = texture(gDiffuse, TexCoords).rgb;
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    vec3 result = CalcDirectionalLight(dLight, normal, viewDir, kd);
+    uvec2 cluster = GetCluster(gl_FragCoord.xy, -(view * vec4(fragPos, 1.0)).z);
+    for (uint i = 0u; i < cluster.y; ++i)
+    {
+        result += CalcClusterLight(clusterLights[clusterIndices[cluster.x + i]], normal, fragPos, viewDir, kd);
+    }
+    FragColor = vec4(result, 1.0);
+}
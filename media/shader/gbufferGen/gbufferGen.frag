@@ -17,18 +17,8 @@ uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_normal1;
 uniform sampler2D texture_specular1;
 
-uniform bool use_texture_kd;
-uniform bool use_texture_normal;
-uniform bool use_texture_ks;
-
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-}; 
-
-uniform Material material;
+// DirectionalLight, Material and the FrameBlock, ViewBlock and DrawBlock uniform blocks, see uniform_blocks.h
+#include "uniform_blocks.glsl"
 
 void main() 
 { 
@@ -38,8 +28,9 @@ void main()
         DiffuseOut.rgb = material.diffuse;
     }
     if(use_texture_normal) {
-        vec3 norm = texture(texture_normal1, fs_in.TexCoords).xyz;
-        norm = normalize(norm * 2.0 - 1.0);   
+        // normal maps may be stored as two channel BC5, rebuild z from xy
+        vec2 xy = texture(texture_normal1, fs_in.TexCoords).xy * 2.0 - 1.0;
+        vec3 norm = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
         NormalOut = normalize(fs_in.TBN * norm);
     }
     else NormalOut = normalize(fs_in.Normal); 
@@ -1,13 +1,26 @@
- #version 330 
+ #version 430 
 layout (location = 0) in vec3 Position; 
-layout (location = 1) in vec2 TexCoord; 
-layout (location = 2) in vec3 Normal; 
-layout (location = 3) in vec3 tangent;
+layout (location = 1) in vec3 Normal; 
+layout (location = 2) in vec2 TexCoord; 
+layout (location = 3) in vec4 tangent;
 layout (location = 4) in vec3 bitangent;
+layout (location = 7) in uint drawRecord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// world matrices of the draws culled on the GPU, indexed by the draw record, see GpuCulling
+layout (std430, binding = 0) readonly buffer DrawMatrices { mat4 drawMatrices[]; };
+uniform bool gpuDriven;
+
+// DirectionalLight, Material and the FrameBlock, ViewBlock and DrawBlock uniform blocks, see uniform_blocks.h
+#include "uniform_blocks.glsl"
+
+// inverse of the octahedral encoding in vertex_format.cpp
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
 
 out VS_OUT {
     vec3 FragPos;
@@ -18,16 +31,28 @@ out VS_OUT {
 
 void main()
 { 
-    gl_Position = projection * view * model * vec4(Position, 1.0);
+    mat4 modelMatrix = gpuDriven ? drawMatrices[drawRecord] : model;
+    //unpack normal, tangent and bitangent, packed layouts only carry the bitangent sign
+    vec3 normal = Normal;
+    vec3 tangentDir = tangent.xyz;
+    vec3 bitangentDir = bitangent;
+    if (packedVertex)
+    {
+        normal = octDecode(Normal.xy);
+        tangentDir = octDecode(tangent.xy);
+        bitangentDir = cross(normal, tangentDir) * tangent.z;
+    }
+
+    gl_Position = projection * view * modelMatrix * vec4(Position, 1.0);
     vs_out.TexCoords = TexCoord; 
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
-    vs_out.Normal = normalMatrix * Normal; 
-    vs_out.FragPos = (model * vec4(Position, 1.0)).xyz;
+    mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
+    vs_out.Normal = normalMatrix * normal; 
+    vs_out.FragPos = (modelMatrix * vec4(Position, 1.0)).xyz;
 
     //calculate TBN matrix
-    vec3 N = normalize(normalMatrix * Normal);
-    vec3 T = normalize(normalMatrix * tangent);
-    vec3 B = normalize(normalMatrix * bitangent);
+    vec3 N = normalize(normalMatrix * normal);
+    vec3 T = normalize(normalMatrix * tangentDir);
+    vec3 B = normalize(normalMatrix * bitangentDir);
     vs_out.TBN = mat3(T, B, N);
 }
 
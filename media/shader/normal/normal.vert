@@ -8,10 +8,21 @@ out VS_OUT {
 
 uniform mat4 view;
 uniform mat4 model;
+uniform bool packedVertex;
+
+// inverse of the octahedral encoding in vertex_format.cpp
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
 
 void main()
 {
+    vec3 normal = packedVertex ? octDecode(aNormal.xy) : aNormal;
     mat3 normalMatrix = mat3(transpose(inverse(view * model)));
-    vs_out.normal = vec3(vec4(normalMatrix * aNormal, 0.0));
+    vs_out.normal = vec3(vec4(normalMatrix * normal, 0.0));
     gl_Position = view * model * vec4(aPos, 1.0); 
 }
\ No newline at end of file
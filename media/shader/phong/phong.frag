@@ -16,35 +16,10 @@ uniform sampler2D texture_specular1;
 uniform sampler2D texture_normal1;
 uniform sampler2D texture_height1;
 
-uniform bool use_texture_kd;
-uniform bool use_texture_ks;
-uniform bool use_texture_normal;
 uniform bool use_texture_height;
 
-uniform bool use_shadow;
-
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-}; 
-
-uniform Material material;
-
-struct DirectionalLight {
-    vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    float intensity;
-};
-
-uniform DirectionalLight dLight;
-
-uniform vec3 viewPos; 
+// DirectionalLight, Material and the FrameBlock, ViewBlock and DrawBlock uniform blocks, see uniform_blocks.h
+#include "uniform_blocks.glsl"
 
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
@@ -132,8 +107,9 @@ void main()
     //normal map
     if(use_texture_normal)
     {
-        norm = texture(texture_normal1, fs_in.TexCoords).rgb;
-        norm = normalize(norm * 2.0 - 1.0);   
+        // normal maps may be stored as two channel BC5, rebuild z from xy
+        vec2 xy = texture(texture_normal1, fs_in.TexCoords).rg * 2.0 - 1.0;
+        norm = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
         norm = normalize(fs_in.TBN * norm);
     }
 
@@ -1,9 +1,14 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 tangent;
+layout (location = 3) in vec4 tangent;
 layout (location = 4) in vec3 bitangent;
+layout (location = 7) in uint drawRecord;
+
+// world matrices of the draws culled on the GPU, indexed by the draw record, see GpuCulling
+layout (std430, binding = 0) readonly buffer DrawMatrices { mat4 drawMatrices[]; };
+uniform bool gpuDriven;
 
 out VS_OUT {
     vec3 FragPos;
@@ -13,27 +18,46 @@ out VS_OUT {
     mat3 TBN;
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+// DirectionalLight, Material and the FrameBlock, ViewBlock and DrawBlock uniform blocks, see uniform_blocks.h
+#include "uniform_blocks.glsl"
+
+// inverse of the octahedral encoding in vertex_format.cpp
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
 
 void main()
 {    
+    mat4 modelMatrix = gpuDriven ? drawMatrices[drawRecord] : model;
+    //unpack normal, tangent and bitangent, packed layouts only carry the bitangent sign
+    vec3 normal = aNormal;
+    vec3 tangentDir = tangent.xyz;
+    vec3 bitangentDir = bitangent;
+    if (packedVertex)
+    {
+        normal = octDecode(aNormal.xy);
+        tangentDir = octDecode(tangent.xy);
+        bitangentDir = cross(normal, tangentDir) * tangent.z;
+    }
+
     //calculate TBN matrix
-    mat3 normalMatrix = transpose(inverse(mat3(model))); // correct normal transform as learned in previous tutorials here
-    vec3 N = normalize(normalMatrix * aNormal);
-    vec3 T = normalize(normalMatrix * tangent);
-    vec3 B = normalize(normalMatrix * bitangent);
+    mat3 normalMatrix = transpose(inverse(mat3(modelMatrix))); // correct normal transform as learned in previous tutorials here
+    vec3 N = normalize(normalMatrix * normal);
+    vec3 T = normalize(normalMatrix * tangentDir);
+    vec3 B = normalize(normalMatrix * bitangentDir);
     vs_out.TBN = mat3(T, B, N);
 
 
     //set ouput value
-    vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
-    vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;  
+    vs_out.FragPos = vec3(modelMatrix * vec4(aPos, 1.0));
+    vs_out.Normal = mat3(transpose(inverse(modelMatrix))) * normal;  
     vs_out.TexCoords = aTexCoords;
     vs_out.FragPosLightSpace = lightSpaceMatrix * vec4(vs_out.FragPos, 1.0);
     vs_out.TBN = mat3(T, B, N);
 
-    gl_Position = projection * view * model * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+    gl_Position = projection * view * modelMatrix * vec4(aPos.x, aPos.y, aPos.z, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,221 @@
+#version 430 core
+out vec4 FragColor;
+
+in VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 TexCoords;
+    vec4 FragPosLightSpace;
+    mat3 TBN;
+} fs_in;
+
+uniform sampler2D shadowMap;
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+uniform sampler2D texture_normal1;
+uniform sampler2D texture_height1;
+
+uniform bool use_texture_height;
+
+// DirectionalLight, Material and the FrameBlock, ViewBlock and DrawBlock uniform blocks, see uniform_blocks.h
+#include "uniform_blocks.glsl"
+
+// point and spot lights binned per cluster on the CPU, see LightClusters
+struct ClusterLight {
+    vec4 positionRange;
+    vec4 directionCosine;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    vec4 attenuation;
+};
+
+layout (std430, binding = 5) readonly buffer ClusterLights { ClusterLight clusterLights[]; };
+layout (std430, binding = 6) readonly buffer Clusters { uvec2 clusters[]; };
+layout (std430, binding = 7) readonly buffer ClusterIndices { uint clusterIndices[]; };
+
+uniform ivec2 clusterTiles;
+uniform int clusterSlices;
+uniform vec2 clusterScreenSize;
+uniform float clusterScale;
+uniform float clusterBias;
+
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcClusterLights(vec3 normal, vec3 fragPos, vec3 viewDir);
+
+float ShadowCalculation(vec4 fragPosLightSpace, vec3 lightDir, vec3 normal)
+{
+    if(!use_shadow) return 0.0; 
+    // perform perspective divide
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    // transform to [0,1] range
+    projCoords = projCoords * 0.5 + 0.5;
+    // get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
+    float closestDepth = texture(shadowMap, projCoords.xy).r; //d(blocker)
+    // get depth of current fragment from light's perspective
+    float currentDepth = projCoords.z; //d(receiver)
+    // calculate bias (based on depth map resolution and slope)
+    //vec3 normal = normalize(fs_in.Normal);
+    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+    // check whether current frag pos is in shadow
+    // float shadow = currentDepth - bias > closestDepth  ? 1.0 : 0.0;
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    // PCF PCSS
+    bool use_PCF = true;    
+    bool use_PCSS = true;
+    int pcss_kernel_size = 5;
+    int pcf_kernel_size = 5;
+    int max_pcf_kernel_size = 15;
+    if(use_PCF && use_PCSS){
+        //in shadow
+        float avg_blocker_distance = 0;
+        int cnt = 0;
+        for(int x = -pcss_kernel_size/2; x <= pcss_kernel_size/2; ++x)
+        {
+            for(int y = -pcss_kernel_size/2; y <= pcss_kernel_size/2; ++y)
+            {
+                float current_blocker_depth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
+                if(currentDepth - bias > current_blocker_depth){
+                    avg_blocker_distance += current_blocker_depth;
+                    cnt++;    
+                }
+     
+            }    
+        }
+        if(cnt > 0){
+            avg_blocker_distance /= cnt;
+            pcf_kernel_size += int(pcf_kernel_size * (currentDepth - bias - avg_blocker_distance) / avg_blocker_distance); 
+            if(pcf_kernel_size > max_pcf_kernel_size) pcf_kernel_size = max_pcf_kernel_size;
+        }
+        if(pcf_kernel_size % 2 == 0) pcf_kernel_size += 1;
+    }
+    // PCF
+    if(use_PCF)
+    {    
+        for(int x = -pcf_kernel_size/2; x <= pcf_kernel_size/2; ++x)
+        {
+            for(int y = -pcf_kernel_size/2; y <= pcf_kernel_size/2; ++y)
+            {
+                float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
+                shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
+            }    
+        }
+        shadow /= (pcf_kernel_size * pcf_kernel_size);
+    }
+    else
+    {
+        //float depth = texture(shadowMap, projCoords.xy).r;
+        //shadow = currentDepth - bias > depth  ? 1.0 : 0.0;   
+    }
+
+    
+    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if(projCoords.z > 1.0)
+        shadow = 0.0;
+        
+    return shadow;
+
+}
+
+void main()
+{   
+    // properties
+    vec3 norm = normalize(fs_in.Normal);
+    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+    
+    //normal map
+    if(use_texture_normal)
+    {
+        // normal maps may be stored as two channel BC5, rebuild z from xy
+        vec2 xy = texture(texture_normal1, fs_in.TexCoords).rg * 2.0 - 1.0;
+        norm = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+        norm = normalize(fs_in.TBN * norm);
+    }
+
+
+    // directional lighting
+    vec3 result = vec3(0.0f,0.0f,0.0f);
+    result += CalcDirectionalLight(dLight, norm, fs_in.FragPos, viewDir);    
+    result += CalcClusterLights(norm, fs_in.FragPos, viewDir);
+
+    FragColor = vec4(result,1.0);
+}
+
+// calculates the color when using a point light.
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+
+    vec3 lightDir = normalize(light.direction);
+    //float shadow = 0.0;
+    float shadow = ShadowCalculation(fs_in.FragPosLightSpace, lightDir, normal);  
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess); 
+    // combine results
+    vec3 ambient = light.ambient * material.ambient;
+    vec3 diffuse = light.diffuse * diff * material.diffuse;
+    vec3 specular = light.specular * spec * material.specular;
+    if(use_texture_kd)
+    {
+        diffuse = light.diffuse * diff * texture(texture_diffuse1,fs_in.TexCoords).rgb;
+    }
+    if(use_texture_ks)
+    {
+        specular = light.specular * spec * texture(texture_specular1,fs_in.TexCoords).rgb;
+    }
+    ambient *= light.intensity;
+    diffuse *= light.intensity;
+    specular *= light.intensity;
+
+    return (ambient + (1.0 - shadow) * (diffuse + specular));
+}
+
+// offset and count of the lights of the cluster of a fragment
+uvec2 GetCluster(vec2 fragCoord, float viewDepth)
+{
+    ivec2 tile = clamp(ivec2(fragCoord / clusterScreenSize * vec2(clusterTiles)), ivec2(0), clusterTiles - 1);
+    int slice = clamp(int(floor(log(max(viewDepth, 1e-4)) * clusterScale + clusterBias)), 0, clusterSlices - 1);
+    return clusters[(slice * clusterTiles.y + tile.y) * clusterTiles.x + tile.x];
+}
+
+// the attenuation of PointLight, faded out toward the range the light was binned with
+vec3 CalcClusterLight(ClusterLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 kd, vec3 ks)
+{
+    vec3 toLight = light.positionRange.xyz - fragPos;
+    float distance = length(toLight);
+    if (distance >= light.positionRange.w)
+        return vec3(0.0);
+    vec3 lightDir = toLight / distance;
+    float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * distance * distance);
+    float fade = clamp(1.0 - pow(distance / light.positionRange.w, 4.0), 0.0, 1.0);
+    attenuation *= fade * fade;
+    // spot lights, soft over the outer tenth of the cone
+    float cosOuter = light.directionCosine.w;
+    if (cosOuter >= -1.0)
+        attenuation *= smoothstep(cosOuter, mix(cosOuter, 1.0, 0.1), dot(-lightDir, light.directionCosine.xyz));
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 ambient = light.ambient.rgb * material.ambient;
+    vec3 diffuse = light.diffuse.rgb * diff * kd;
+    vec3 specular = light.specular.rgb * spec * ks;
+    return attenuation * (ambient + diffuse + specular);
+}
+
+vec3 CalcClusterLights(vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 kd = use_texture_kd ? texture(texture_diffuse1, fs_in.TexCoords).rgb : material.diffuse;
+    vec3 ks = use_texture_ks ? texture(texture_specular1, fs_in.TexCoords).rgb : material.specular;
+    uvec2 cluster = GetCluster(gl_FragCoord.xy, -(view * vec4(fragPos, 1.0)).z);
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < cluster.y; ++i)
+    {
+        result += CalcClusterLight(clusterLights[clusterIndices[cluster.x + i]], normal, fragPos, viewDir, kd, ks);
+    }
+    return result;
+}
@@ -1,10 +1,17 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
+layout (location = 7) in uint drawRecord;
 
-uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
+// world matrices of the draws culled on the GPU, indexed by the draw record, see GpuCulling
+layout (std430, binding = 0) readonly buffer DrawMatrices { mat4 drawMatrices[]; };
+uniform bool gpuDriven;
+
+// DirectionalLight, Material and the FrameBlock, ViewBlock and DrawBlock uniform blocks, see uniform_blocks.h
+#include "uniform_blocks.glsl"
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    mat4 modelMatrix = gpuDriven ? drawMatrices[drawRecord] : model;
+    // the view block of a shadow map holds its light space matrix as projection, the view is the identity
+    gl_Position = projection * view * modelMatrix * vec4(aPos, 1.0);
 }
\ No newline at end of file
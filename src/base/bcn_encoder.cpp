@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cstring>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include "bcn_encoder.h"
+
+namespace {
+// stb_dxt fills its lookup tables lazily on the first block without any locking,
+// so the first block is compressed once here before any parallel encoding starts
+void initEncoder() {
+    static const bool initialized = []() {
+        uint8_t src[16 * 4] = {};
+        uint8_t dst[16];
+        stb_compress_dxt_block(dst, src, 0, STB_DXT_NORMAL);
+        return true;
+    }();
+    (void)initialized;
+}
+
+// expands any 1 to 4 channel image to rgba8, the mip chain is built on this
+std::vector<uint8_t> toRGBA(const uint8_t* pixels, int width, int height, int channels) {
+    const size_t count = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> rgba(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* src = pixels + i * channels;
+        uint8_t* dst = rgba.data() + i * 4;
+        switch (channels) {
+        case 1: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255; break;
+        case 2: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1]; break;
+        case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255; break;
+        default: std::memcpy(dst, src, 4); break;
+        }
+    }
+    return rgba;
+}
+
+// 2x2 box filter, odd edges reuse the last row / column
+std::vector<uint8_t> downsample(const std::vector<uint8_t>& rgba, int width, int height) {
+    const int w = std::max(width / 2, 1);
+    const int h = std::max(height / 2, 1);
+    std::vector<uint8_t> result(static_cast<size_t>(w) * h * 4);
+    for (int y = 0; y < h; ++y) {
+        const int y0 = std::min(y * 2, height - 1);
+        const int y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < w; ++x) {
+            const int x0 = std::min(x * 2, width - 1);
+            const int x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < 4; ++c) {
+                const int sum = rgba[(static_cast<size_t>(y0) * width + x0) * 4 + c] +
+                                rgba[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                                rgba[(static_cast<size_t>(y1) * width + x0) * 4 + c] +
+                                rgba[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                result[(static_cast<size_t>(y) * w + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+// compresses the 4x4 block at (bx, by), texels outside the image clamp to the edge
+void encodeBlock(
+    const uint8_t* rgba, int width, int height, int bx, int by, BCnFormat format, uint8_t* dst) {
+    uint8_t block[16 * 4];
+    for (int y = 0; y < 4; ++y) {
+        const int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x) {
+            const int sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+        }
+    }
+
+    switch (format) {
+    case BCnFormat::BC1: stb_compress_dxt_block(dst, block, 0, STB_DXT_HIGHQUAL); break;
+    case BCnFormat::BC3: stb_compress_dxt_block(dst, block, 1, STB_DXT_HIGHQUAL); break;
+    case BCnFormat::BC4: {
+        uint8_t r[16];
+        for (int i = 0; i < 16; ++i) {
+            r[i] = block[i * 4];
+        }
+        stb_compress_bc4_block(dst, r);
+        break;
+    }
+    case BCnFormat::BC5: {
+        uint8_t rg[32];
+        for (int i = 0; i < 16; ++i) {
+            rg[i * 2 + 0] = block[i * 4 + 0];
+            rg[i * 2 + 1] = block[i * 4 + 1];
+        }
+        stb_compress_bc5_block(dst, rg);
+        break;
+    }
+    }
+}
+} // namespace
+
+size_t getBlockSize(BCnFormat format) {
+    return (format == BCnFormat::BC1 || format == BCnFormat::BC4) ? 8 : 16;
+}
+
+const char* getFormatName(BCnFormat format) {
+    switch (format) {
+    case BCnFormat::BC1: return "bc1";
+    case BCnFormat::BC3: return "bc3";
+    case BCnFormat::BC4: return "bc4";
+    case BCnFormat::BC5: return "bc5";
+    }
+    return "bcn";
+}
+
+CompressedImage compressImage(
+    const uint8_t* pixels, int width, int height, int channels, BCnFormat format, ThreadPool& pool) {
+    CompressedImage image;
+    image.format = format;
+    if (pixels == nullptr || width <= 0 || height <= 0) {
+        return image;
+    }
+
+    // the mip chain is cheap next to the encoding, build it serially
+    std::vector<std::vector<uint8_t>> mips;
+    mips.push_back(toRGBA(pixels, width, height, channels));
+    image.levels.push_back({width, height, {}});
+    while (image.levels.back().width > 1 || image.levels.back().height > 1) {
+        const auto& last = image.levels.back();
+        mips.push_back(downsample(mips.back(), last.width, last.height));
+        image.levels.push_back({std::max(last.width / 2, 1), std::max(last.height / 2, 1), {}});
+    }
+
+    initEncoder();
+
+    // one job per block row of any level, so small levels do not serialize the tail
+    struct Row {
+        size_t level;
+        int by;
+    };
+    std::vector<Row> rows;
+    const size_t blockSize = getBlockSize(format);
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        auto& level = image.levels[i];
+        const int blocksX = (level.width + 3) / 4;
+        const int blocksY = (level.height + 3) / 4;
+        level.data.resize(static_cast<size_t>(blocksX) * blocksY * blockSize);
+        for (int by = 0; by < blocksY; ++by) {
+            rows.push_back({i, by});
+        }
+    }
+
+    pool.parallelFor(rows.size(), [&](size_t r) {
+        const Row& row = rows[r];
+        auto& level = image.levels[row.level];
+        const int blocksX = (level.width + 3) / 4;
+        uint8_t* dst = level.data.data() + static_cast<size_t>(row.by) * blocksX * blockSize;
+        for (int bx = 0; bx < blocksX; ++bx) {
+            encodeBlock(
+                mips[row.level].data(), level.width, level.height, bx, row.by, format,
+                dst + bx * blockSize);
+        }
+    });
+
+    return image;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "thread_pool.h"
+
+// block compressed formats the encoder produces, all of them use 4x4 texel blocks
+enum class BCnFormat : uint32_t {
+    BC1 = 0,  // rgb, 8 bytes per block
+    BC3 = 1,  // rgba, 16 bytes per block
+    BC4 = 2,  // r, 8 bytes per block
+    BC5 = 3,  // rg, 16 bytes per block
+};
+
+// a block compressed image with its full mip chain, level 0 first
+struct CompressedImage {
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> data;
+    };
+
+    BCnFormat format = BCnFormat::BC1;
+    std::vector<Level> levels;
+
+    bool empty() const {
+        return levels.empty();
+    }
+
+    size_t getByteSize() const {
+        size_t bytes = 0;
+        for (const auto& level : levels) {
+            bytes += level.data.size();
+        }
+        return bytes;
+    }
+};
+
+size_t getBlockSize(BCnFormat format);
+
+// lower case name of the format, "bc1" to "bc5"
+const char* getFormatName(BCnFormat format);
+
+// builds the mip chain of an 8 bit image with a box filter and compresses every level.
+// the blocks are encoded in parallel on pool.
+CompressedImage compressImage(
+    const uint8_t* pixels, int width, int height, int channels, BCnFormat format, ThreadPool& pool);
@@ -0,0 +1,85 @@
+#include "block_layout.h"
+
+#include <algorithm>
+
+#include "glsl_program.h"
+
+namespace {
+void declareMembers(const GlslType& type, std::string& code) {
+    for (size_t i = 0; i < type.memberCount; ++i) {
+        const GlslMember& member = type.members[i];
+        code += "    " + std::string(member.type->name) + " " + member.name;
+        code += member.arraySize > 0 ? "[" + std::to_string(member.arraySize) + "];\n" : ";\n";
+    }
+    code += "};\n\n";
+}
+
+void declareStructs(const GlslType& type, std::vector<const GlslType*>& declared, std::string& code) {
+    for (size_t i = 0; i < type.memberCount; ++i) {
+        const GlslType* memberType = type.members[i].type;
+        if (memberType->rows != 0 || std::find(declared.begin(), declared.end(), memberType) != declared.end()) {
+            continue;
+        }
+        declareStructs(*memberType, declared, code);
+        declared.push_back(memberType);
+        code += "struct " + std::string(memberType->name) + " {\n";
+        declareMembers(*memberType, code);
+    }
+}
+
+// compares the offsets of the members of type, at offset in the block and named from prefix
+std::string checkMembers(const GLSLProgram& program, const GlslType& type, BlockLayout layout, size_t offset,
+                         const std::string& prefix) {
+    for (size_t i = 0; i < type.memberCount; ++i) {
+        const GlslMember& member = type.members[i];
+        const size_t memberOffset = offset + getMemberOffset(type, i, layout);
+        // arrays are checked at their first element
+        const std::string name = prefix + member.name + (member.arraySize > 0 ? "[0]" : "");
+        if (member.type->rows == 0) {
+            std::string error = checkMembers(program, *member.type, layout, memberOffset, name + ".");
+            if (!error.empty()) {
+                return error;
+            }
+            continue;
+        }
+
+        const int reported = program.getUniformBlockVariableOffset(name);
+        if (reported != -1 && static_cast<size_t>(reported) != memberOffset) {
+            return name + " at " + std::to_string(reported) + ", expected " + std::to_string(memberOffset);
+        }
+    }
+    return {};
+}
+} // namespace
+
+std::string declareGlslBlocks(const std::vector<const GlslType*>& blocks, BlockLayout layout, const char* storage) {
+    const char* layoutName = layout == BlockLayout::Std140 ? "std140" : "std430";
+    std::vector<const GlslType*> declared;
+    std::string code;
+    for (const GlslType* block : blocks) {
+        declareStructs(*block, declared, code);
+    }
+
+    for (const GlslType* block : blocks) {
+        code += "layout (" + std::string(layoutName) + ") " + storage + " " + block->name + " {\n";
+        declareMembers(*block, code);
+    }
+    return code;
+}
+
+std::string checkUniformBlock(const GLSLProgram& program, const GlslType& type, BlockLayout layout) {
+    const int size = program.getUniformBlockSize(type.name);
+    if (size == -1) {
+        return {};
+    }
+
+    // the size may or may not include the padding after the last member
+    const size_t end = getMemberOffset(type, type.memberCount, layout);
+    if (static_cast<size_t>(size) < end || static_cast<size_t>(size) > getLayoutSize(type, layout)) {
+        return std::string(type.name) + " of " + std::to_string(size) + " bytes, expected " + std::to_string(end) +
+               " to " + std::to_string(getLayoutSize(type, layout));
+    }
+
+    std::string error = checkMembers(program, type, layout, 0, "");
+    return error.empty() ? error : std::string(type.name) + ": " + error;
+}
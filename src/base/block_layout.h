@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GLSLProgram;
+
+// packing rules of an interface block. std140 rounds the alignment of arrays and structs up to 16 bytes,
+// std430, the rule of shader storage blocks, keeps the alignment of their elements
+enum class BlockLayout { Std140, Std430 };
+
+struct GlslMember;
+
+// type of a block member: a scalar, vector or matrix of 4 byte components, or a struct of members
+struct GlslType {
+    const char* name;
+    // components of a vector or of a matrix column, 0 for a struct
+    uint32_t rows;
+    uint32_t columns;
+    const GlslMember* members = nullptr;
+    size_t memberCount = 0;
+};
+
+// member of a struct or block, with the place of its mirror in the C++ struct
+struct GlslMember {
+    const GlslType* type;
+    const char* name;
+    // elements of an array, 0 if the member is none
+    uint32_t arraySize;
+    // offsetof and sizeof of the C++ member
+    size_t offset;
+    size_t size;
+};
+
+inline constexpr GlslType kGlslFloat{"float", 1, 1};
+inline constexpr GlslType kGlslInt{"int", 1, 1};
+inline constexpr GlslType kGlslUint{"uint", 1, 1};
+// 4 bytes in a block, a uint32_t in C++
+inline constexpr GlslType kGlslBool{"bool", 1, 1};
+inline constexpr GlslType kGlslVec2{"vec2", 2, 1};
+inline constexpr GlslType kGlslVec3{"vec3", 3, 1};
+inline constexpr GlslType kGlslVec4{"vec4", 4, 1};
+inline constexpr GlslType kGlslUvec4{"uvec4", 4, 1};
+inline constexpr GlslType kGlslMat4{"mat4", 4, 4};
+
+// a struct, or a block, named name with members
+template <size_t N>
+constexpr GlslType makeGlslStruct(const char* name, const GlslMember (&members)[N]) {
+    return {name, 0, 0, members, N};
+}
+
+constexpr size_t roundUpLayout(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr size_t getLayoutAlignment(const GlslType& type, BlockLayout layout);
+
+constexpr size_t getLayoutSize(const GlslType& type, BlockLayout layout);
+
+// alignment of a vector of rows components, the columns of a matrix are such vectors
+constexpr size_t getVectorAlignment(uint32_t rows) {
+    return rows == 1 ? 4 : (rows == 2 ? 8 : 16);
+}
+
+// alignment of a member, arrays and matrices take the one of their elements or columns, rounded up to 16 in std140
+constexpr size_t getMemberAlignment(const GlslMember& member, BlockLayout layout) {
+    const size_t alignment = getLayoutAlignment(*member.type, layout);
+    return member.arraySize > 0 && layout == BlockLayout::Std140 ? roundUpLayout(alignment, 16) : alignment;
+}
+
+constexpr size_t getArrayStride(const GlslMember& member, BlockLayout layout) {
+    return roundUpLayout(getLayoutSize(*member.type, layout), getMemberAlignment(member, layout));
+}
+
+constexpr size_t getMemberSize(const GlslMember& member, BlockLayout layout) {
+    return member.arraySize > 0 ? getArrayStride(member, layout) * member.arraySize : getLayoutSize(*member.type, layout);
+}
+
+// offset of member index of a struct or block, from its start
+constexpr size_t getMemberOffset(const GlslType& type, size_t index, BlockLayout layout) {
+    size_t offset = 0;
+    for (size_t i = 0; i < type.memberCount; ++i) {
+        offset = roundUpLayout(offset, getMemberAlignment(type.members[i], layout));
+        if (i == index) {
+            return offset;
+        }
+        offset += getMemberSize(type.members[i], layout);
+    }
+    return offset;
+}
+
+constexpr size_t getLayoutAlignment(const GlslType& type, BlockLayout layout) {
+    if (type.rows == 0) {
+        size_t alignment = 4;
+        for (size_t i = 0; i < type.memberCount; ++i) {
+            const size_t memberAlignment = getMemberAlignment(type.members[i], layout);
+            alignment = memberAlignment > alignment ? memberAlignment : alignment;
+        }
+        return layout == BlockLayout::Std140 ? roundUpLayout(alignment, 16) : alignment;
+    }
+
+    const size_t alignment = getVectorAlignment(type.rows);
+    return type.columns > 1 && layout == BlockLayout::Std140 ? roundUpLayout(alignment, 16) : alignment;
+}
+
+constexpr size_t getLayoutSize(const GlslType& type, BlockLayout layout) {
+    if (type.rows == 0) {
+        return roundUpLayout(getMemberOffset(type, type.memberCount, layout), getLayoutAlignment(type, layout));
+    }
+    if (type.columns == 1) {
+        return 4 * type.rows;
+    }
+    return type.columns * getLayoutAlignment(type, layout);
+}
+
+// returned by findLayoutMismatch when the C++ struct follows the layout
+inline constexpr ptrdiff_t kLayoutMatches = -1;
+
+// index of the first member of type whose C++ offset or size differs from layout, members of nested structs
+// included, kLayoutMatches if none
+constexpr ptrdiff_t findLayoutMismatch(const GlslType& type, BlockLayout layout) {
+    for (size_t i = 0; i < type.memberCount; ++i) {
+        const GlslMember& member = type.members[i];
+        if (member.offset != getMemberOffset(type, i, layout) || member.size != getMemberSize(member, layout)) {
+            return static_cast<ptrdiff_t>(i);
+        }
+        if (member.type->rows == 0 && findLayoutMismatch(*member.type, layout) != kLayoutMatches) {
+            return static_cast<ptrdiff_t>(i);
+        }
+    }
+    return kLayoutMatches;
+}
+
+// whether the C++ struct T, of the members of type, is laid out by layout, padding at the end included
+template <typename T>
+constexpr bool matchesLayout(const GlslType& type, BlockLayout layout) {
+    return findLayoutMismatch(type, layout) == kLayoutMatches && sizeof(T) == getLayoutSize(type, layout);
+}
+
+// GLSL declarations of the structs the blocks use, each once, then of the blocks, with layout and storage
+// "uniform" or "buffer" and without instance names
+std::string declareGlslBlocks(const std::vector<const GlslType*>& blocks, BlockLayout layout, const char* storage);
+
+// compares the size and the member offsets program reports for the uniform block type with layout. returns
+// the first difference, empty if they agree or the program has no such block. inactive members are skipped
+std::string checkUniformBlock(const GLSLProgram& program, const GlslType& type, BlockLayout layout);
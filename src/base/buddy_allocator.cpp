@@ -0,0 +1,125 @@
+#include "buddy_allocator.h"
+
+#include <algorithm>
+
+namespace {
+uint32_t roundUpPowerOfTwo(uint32_t value) {
+    uint32_t power = 1;
+    while (power < value) {
+        power <<= 1;
+    }
+    return power;
+}
+
+uint32_t getLowestBit(uint32_t value) {
+    return value & (~value + 1);
+}
+
+uint32_t getHighestBit(uint32_t value) {
+    uint32_t bit = 1;
+    while (bit <= value / 2) {
+        bit <<= 1;
+    }
+    return bit;
+}
+} // namespace
+
+BuddyAllocator::BuddyAllocator(uint32_t capacity, uint32_t minBlock) {
+    _minBlock = roundUpPowerOfTwo(std::max(minBlock, 1u));
+    _capacity = roundUpPowerOfTwo(std::max(capacity, _minBlock));
+    _freeBlocks.resize(getOrder(_capacity) + 1);
+    _freeBlocks.back().insert(0);
+}
+
+uint32_t BuddyAllocator::allocate(uint32_t size) {
+    if (size == 0 || size > _capacity) {
+        return kInvalid;
+    }
+
+    const uint32_t rounded = roundUp(size);
+    const uint32_t order = getOrder(roundUpPowerOfTwo(rounded));
+    uint32_t freeOrder = order;
+    while (freeOrder < _freeBlocks.size() && _freeBlocks[freeOrder].empty()) {
+        ++freeOrder;
+    }
+    if (freeOrder == _freeBlocks.size()) {
+        return kInvalid;
+    }
+
+    // the lowest free block keeps the ranges packed at the start of the space
+    const uint32_t offset = *_freeBlocks[freeOrder].begin();
+    _freeBlocks[freeOrder].erase(_freeBlocks[freeOrder].begin());
+    while (freeOrder > order) {
+        --freeOrder;
+        _freeBlocks[freeOrder].insert(offset + (_minBlock << freeOrder));
+    }
+
+    // the rest of the block goes back in blocks of growing size, each aligned to its size
+    const uint32_t blockSize = _minBlock << order;
+    for (uint32_t position = rounded; position < blockSize;) {
+        const uint32_t piece = getLowestBit(position);
+        freeBlock(offset + position, getOrder(piece));
+        position += piece;
+    }
+
+    _used += rounded;
+    return offset;
+}
+
+void BuddyAllocator::free(uint32_t offset, uint32_t size) {
+    if (size == 0 || offset == kInvalid) {
+        return;
+    }
+
+    // the range is the blocks of the binary digits of its size, largest first, as allocate left it
+    const uint32_t rounded = roundUp(size);
+    for (uint32_t rest = rounded; rest > 0;) {
+        const uint32_t piece = getHighestBit(rest);
+        freeBlock(offset, getOrder(piece));
+        offset += piece;
+        rest -= piece;
+    }
+    _used -= rounded;
+}
+
+void BuddyAllocator::grow() {
+    const uint32_t oldCapacity = _capacity;
+    _capacity *= 2;
+    _freeBlocks.resize(getOrder(_capacity) + 1);
+    freeBlock(oldCapacity, getOrder(oldCapacity));
+}
+
+uint32_t BuddyAllocator::getLargestFree() const {
+    for (size_t order = _freeBlocks.size(); order > 0; --order) {
+        if (!_freeBlocks[order - 1].empty()) {
+            return _minBlock << (order - 1);
+        }
+    }
+    return 0;
+}
+
+uint32_t BuddyAllocator::roundUp(uint32_t size) const {
+    return (size + _minBlock - 1) & ~(_minBlock - 1);
+}
+
+uint32_t BuddyAllocator::getOrder(uint32_t blockSize) const {
+    uint32_t order = 0;
+    while ((_minBlock << order) < blockSize) {
+        ++order;
+    }
+    return order;
+}
+
+void BuddyAllocator::freeBlock(uint32_t offset, uint32_t order) {
+    while ((_minBlock << order) < _capacity) {
+        const uint32_t buddy = offset ^ (_minBlock << order);
+        auto it = _freeBlocks[order].find(buddy);
+        if (it == _freeBlocks[order].end()) {
+            break;
+        }
+        _freeBlocks[order].erase(it);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    _freeBlocks[order].insert(offset);
+}
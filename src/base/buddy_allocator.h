@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+// buddy allocator of ranges of units in a space of a power of two units. a range is carved from the smallest
+// free block that holds it and the part of the block past its end is given back at once, as the blocks of
+// the binary digits of the rest, so a range wastes nothing beyond the rounding to the minimum block. freed
+// blocks merge with their free buddies again. the allocator only keeps the books, the caller owns the memory
+class BuddyAllocator {
+public:
+    static constexpr uint32_t kInvalid = ~0u;
+
+    // capacity is rounded up to a power of two of at least minBlock units, minBlock to a power of two
+    explicit BuddyAllocator(uint32_t capacity, uint32_t minBlock = 1);
+
+    // offset of size units, kInvalid if no free block holds them
+    uint32_t allocate(uint32_t size);
+
+    // frees the range at offset, size has to be the one it was allocated with
+    void free(uint32_t offset, uint32_t size);
+
+    // doubles the space, the ranges keep their offsets
+    void grow();
+
+    uint32_t getCapacity() const {
+        return _capacity;
+    }
+
+    // units taken by ranges, minimum block rounding included
+    uint32_t getUsed() const {
+        return _used;
+    }
+
+    // size of the largest range allocate can return
+    uint32_t getLargestFree() const;
+
+private:
+    uint32_t _capacity = 0;
+    uint32_t _minBlock = 1;
+    uint32_t _used = 0;
+    // free blocks of minBlock << order units, by offset
+    std::vector<std::set<uint32_t>> _freeBlocks;
+
+    uint32_t roundUp(uint32_t size) const;
+
+    uint32_t getOrder(uint32_t blockSize) const;
+
+    // frees the block at offset of minBlock << order units and merges it with its free buddies
+    void freeBlock(uint32_t offset, uint32_t order);
+};
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "bvh.h"
+
+namespace {
+constexpr int kBinCount = 16;
+// cost of traversing an inner node relative to testing one primitive
+constexpr float kTraversalCost = 1.0f;
+
+struct Bin {
+    BoundingBox box;
+    uint32_t count = 0;
+};
+} // namespace
+
+void Bvh::build(const BoundingBox* boxes, size_t count) {
+    clear();
+    if (count == 0) {
+        return;
+    }
+
+    _boxes.assign(boxes, boxes + count);
+    _primitives.resize(count);
+    std::iota(_primitives.begin(), _primitives.end(), 0u);
+    std::vector<glm::vec3> centers(count);
+    for (size_t i = 0; i < count; ++i) {
+        centers[i] = 0.5f * (boxes[i].min + boxes[i].max);
+    }
+
+    _nodes.reserve(2 * count);
+    _nodes.emplace_back();
+    _nodes[0].first = 0;
+    _nodes[0].count = static_cast<uint32_t>(count);
+    split(centers);
+
+    _parents.assign(_nodes.size(), 0);
+    _leaves.assign(count, 0);
+    for (uint32_t i = 0; i < _nodes.size(); ++i) {
+        const Node& node = _nodes[i];
+        if (node.isLeaf()) {
+            for (uint32_t k = node.first; k < node.first + node.count; ++k) {
+                _leaves[_primitives[k]] = i;
+            }
+        } else {
+            _parents[node.first] = _parents[node.first + 1] = i;
+        }
+    }
+    _buildCost = getCost();
+}
+
+void Bvh::split(const std::vector<glm::vec3>& centers) {
+    struct Entry {
+        uint32_t node;
+        uint32_t depth;
+    };
+    std::vector<Entry> stack = { { 0, 0 } };
+
+    while (!stack.empty()) {
+        const Entry entry = stack.back();
+        stack.pop_back();
+
+        // _nodes grows below, so the node is accessed by index only
+        const uint32_t first = _nodes[entry.node].first;
+        const uint32_t count = _nodes[entry.node].count;
+        BoundingBox box, centerBox;
+        for (uint32_t i = first; i < first + count; ++i) {
+            box += _boxes[_primitives[i]];
+            centerBox += centers[_primitives[i]];
+        }
+        _nodes[entry.node].box = box;
+        if (count <= kMaxLeafSize || entry.depth >= kMaxDepth) {
+            continue;
+        }
+
+        // best split plane of all axes, between bins of equal width over the centroid bounds
+        int bestAxis = -1, bestBin = 0;
+        float bestCost = std::numeric_limits<float>::max();
+        const glm::vec3 centerExtent = centerBox.max - centerBox.min;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (centerExtent[axis] <= 0.0f) {
+                continue;
+            }
+            const float scale = kBinCount / centerExtent[axis];
+            Bin bins[kBinCount];
+            for (uint32_t i = first; i < first + count; ++i) {
+                const uint32_t primitive = _primitives[i];
+                const int b = std::min(kBinCount - 1, static_cast<int>((centers[primitive][axis] - centerBox.min[axis]) * scale));
+                bins[b].box += _boxes[primitive];
+                bins[b].count++;
+            }
+
+            // sweep from the right to get the area and count right of every plane, then from the left
+            float rightArea[kBinCount];
+            uint32_t rightCount[kBinCount];
+            BoundingBox right;
+            uint32_t rightSum = 0;
+            for (int b = kBinCount - 1; b > 0; --b) {
+                right += bins[b].box;
+                rightSum += bins[b].count;
+                rightArea[b] = getArea(right);
+                rightCount[b] = rightSum;
+            }
+            BoundingBox left;
+            uint32_t leftSum = 0;
+            for (int b = 0; b < kBinCount - 1; ++b) {
+                left += bins[b].box;
+                leftSum += bins[b].count;
+                if (leftSum == 0 || rightCount[b + 1] == 0) {
+                    continue;
+                }
+                const float cost = getArea(left) * leftSum + rightArea[b + 1] * rightCount[b + 1];
+                if (cost < bestCost) {
+                    bestCost = cost, bestAxis = axis, bestBin = b;
+                }
+            }
+        }
+
+        // a leaf is cheaper unless it holds too many primitives for a leaf
+        uint32_t middle;
+        const float area = getArea(box);
+        const float leafCost = area * count;
+        if (bestAxis >= 0 && kTraversalCost * area + bestCost < leafCost) {
+            const float scale = kBinCount / centerExtent[bestAxis];
+            const float lo = centerBox.min[bestAxis];
+            auto it = std::partition(_primitives.begin() + first, _primitives.begin() + first + count,
+                [&](uint32_t primitive) {
+                    return std::min(kBinCount - 1, static_cast<int>((centers[primitive][bestAxis] - lo) * scale)) <= bestBin;
+                });
+            middle = static_cast<uint32_t>(it - _primitives.begin());
+        } else if (count > 4 * kMaxLeafSize) {
+            // centroids too close to split by bins, or SAH prefers a leaf that is too large: split at the median
+            const int axis = centerExtent.x >= centerExtent.y && centerExtent.x >= centerExtent.z ? 0 : centerExtent.y >= centerExtent.z ? 1 : 2;
+            middle = first + count / 2;
+            std::nth_element(_primitives.begin() + first, _primitives.begin() + middle, _primitives.begin() + first + count,
+                [&](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+        } else {
+            continue;
+        }
+
+        const uint32_t left = static_cast<uint32_t>(_nodes.size());
+        _nodes.emplace_back();
+        _nodes.emplace_back();
+        _nodes[left].first = first;
+        _nodes[left].count = middle - first;
+        _nodes[left + 1].first = middle;
+        _nodes[left + 1].count = first + count - middle;
+        _nodes[entry.node].first = left;
+        _nodes[entry.node].count = 0;
+        stack.push_back({ left + 1, entry.depth + 1 });
+        stack.push_back({ left, entry.depth + 1 });
+    }
+}
+
+void Bvh::clear() {
+    _nodes.clear();
+    _primitives.clear();
+    _boxes.clear();
+    _parents.clear();
+    _leaves.clear();
+    _buildCost = 0.0f;
+}
+
+void Bvh::refitNode(uint32_t index) {
+    Node& node = _nodes[index];
+    if (node.isLeaf()) {
+        node.box = BoundingBox();
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            node.box += _boxes[_primitives[i]];
+        }
+    } else {
+        node.box = _nodes[node.first].box;
+        node.box += _nodes[node.first + 1].box;
+    }
+}
+
+void Bvh::refit(const std::vector<BoundingBox>& boxes) {
+    _boxes = boxes;
+    // children are always stored after their parent
+    for (size_t i = _nodes.size(); i-- > 0;) {
+        refitNode(static_cast<uint32_t>(i));
+    }
+}
+
+void Bvh::refit(const std::vector<BoundingBox>& boxes, const std::vector<uint32_t>& changed) {
+    // a path to the root is about log2(nodes) long
+    size_t depth = 1;
+    while ((size_t(1) << depth) < _nodes.size()) {
+        ++depth;
+    }
+    if (changed.size() * depth >= _nodes.size()) {
+        refit(boxes);
+        return;
+    }
+
+    for (uint32_t primitive : changed) {
+        _boxes[primitive] = boxes[primitive];
+    }
+    for (uint32_t primitive : changed) {
+        uint32_t node = _leaves[primitive];
+        refitNode(node);
+        while (node != 0) {
+            node = _parents[node];
+            refitNode(node);
+        }
+    }
+}
+
+float Bvh::getCost() const {
+    if (_nodes.empty()) {
+        return 0.0f;
+    }
+    float cost = 0.0f;
+    for (const Node& node : _nodes) {
+        cost += getArea(node.box) * (node.isLeaf() ? static_cast<float>(node.count) : kTraversalCost);
+    }
+    return cost / std::max(getArea(_nodes[0].box), std::numeric_limits<float>::min());
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounding_box.h"
+#include "frustum.h"
+#include "ray.h"
+
+// bounding volume hierarchy over a set of boxes (primitives), built top down with the surface area
+// heuristic over binned centroids. the primitives are only known by their index into the box array,
+// so the same tree serves scenes (a box per mesh) and meshes (a box per triangle).
+// when the boxes move, refit() updates the node boxes without changing the topology; the tree gets
+// worse with every refit that moves boxes far, getCost() tells when a build pays off again.
+class Bvh {
+public:
+    struct Node {
+        BoundingBox box;
+        // leaf: offset of the first primitive in getPrimitives(). inner node: index of the left child, the right one follows
+        uint32_t first = 0;
+        // primitives of a leaf, 0 for inner nodes
+        uint32_t count = 0;
+
+        bool isLeaf() const {
+            return count != 0;
+        }
+    };
+
+    static constexpr uint32_t kMaxLeafSize = 4;
+    // deeper nodes become leaves, which bounds the traversal stacks
+    static constexpr uint32_t kMaxDepth = 48;
+
+    void build(const std::vector<BoundingBox>& boxes) {
+        build(boxes.data(), boxes.size());
+    }
+
+    void build(const BoundingBox* boxes, size_t count);
+
+    void clear();
+
+    // new boxes for the primitives of the last build, boxes has the same size
+    void refit(const std::vector<BoundingBox>& boxes);
+
+    // same if only the primitives in changed moved, their leaves and the path to the root are updated.
+    // falls back to a full refit when that is cheaper
+    void refit(const std::vector<BoundingBox>& boxes, const std::vector<uint32_t>& changed);
+
+    bool empty() const {
+        return _nodes.empty();
+    }
+
+    size_t getPrimitiveCount() const {
+        return _boxes.size();
+    }
+
+    const std::vector<Node>& getNodes() const {
+        return _nodes;
+    }
+
+    // primitive indices in leaf order
+    const std::vector<uint32_t>& getPrimitives() const {
+        return _primitives;
+    }
+
+    const BoundingBox& getBox(uint32_t primitive) const {
+        return _boxes[primitive];
+    }
+
+    // expected cost of a query relative to the root: traversals of inner nodes plus tests of leaf primitives,
+    // each weighted by the surface area of its node
+    float getCost() const;
+
+    // cost right after the last build
+    float getBuildCost() const {
+        return _buildCost;
+    }
+
+    // calls visit(primitive) for every primitive whose box intersects frustum, with the test of
+    // Frustum::intersect. planes a node lies inside of are not tested again below it
+    template <typename Visit>
+    void cull(const Frustum& frustum, Visit&& visit) const;
+
+    // calls hit(primitive, tMax) for the primitives whose box the ray enters before tMax, roughly nearest first.
+    // hit lowers tMax (a float&) when the primitive is hit closer, which prunes the rest. returns whether any did
+    template <typename Hit>
+    bool raycast(const Ray& ray, float& tMax, Hit&& hit) const;
+
+    // calls visit(primitive) for every primitive whose box overlaps box
+    template <typename Visit>
+    void overlap(const BoundingBox& box, Visit&& visit) const;
+
+    // calls visit(primitive) for every primitive whose box overlaps the sphere
+    template <typename Visit>
+    void overlap(const glm::vec3& center, float radius, Visit&& visit) const;
+
+private:
+    std::vector<Node> _nodes;
+    std::vector<uint32_t> _primitives;
+    std::vector<BoundingBox> _boxes;
+    // for partial refits: parent of every node and leaf of every primitive
+    std::vector<uint32_t> _parents;
+    std::vector<uint32_t> _leaves;
+    float _buildCost = 0.0f;
+
+    // splits the root, which holds all primitives, until every leaf is small enough
+    void split(const std::vector<glm::vec3>& centers);
+
+    void refitNode(uint32_t node);
+
+    static float getArea(const BoundingBox& box) {
+        const glm::vec3 d = glm::max(box.max - box.min, glm::vec3(0.0f));
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    static bool overlaps(const BoundingBox& a, const BoundingBox& b) {
+        return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+    }
+
+    static bool overlaps(const BoundingBox& box, const glm::vec3& center, float radius) {
+        const glm::vec3 d = center - glm::clamp(center, box.min, box.max);
+        return glm::dot(d, d) <= radius * radius;
+    }
+};
+
+template <typename Visit>
+void Bvh::cull(const Frustum& frustum, Visit&& visit) const {
+    if (_nodes.empty()) {
+        return;
+    }
+
+    // a node and the planes it may still be outside of, one bit per plane
+    struct Entry {
+        uint32_t node;
+        uint32_t planes;
+    };
+    Entry stack[kMaxDepth + 2];
+    int top = 0;
+    stack[top++] = { 0, 0x3f };
+
+    // -1 outside, otherwise the planes the box is not completely inside of
+    auto classify = [&frustum](const BoundingBox& box, uint32_t planes) -> int {
+        const glm::vec3 center = 0.5f * (box.max + box.min);
+        const glm::vec3 extent = 0.5f * (box.max - box.min);
+        for (int p = 0; p < 6; ++p) {
+            if (!(planes & (1u << p))) {
+                continue;
+            }
+            const Plane& plane = frustum.planes[p];
+            const float d = plane.getSignedDistanceToPoint(center);
+            const float r = glm::dot(extent, glm::abs(plane.normal));
+            if (d < -r) {
+                return -1;
+            }
+            if (d >= r) {
+                planes &= ~(1u << p);
+            }
+        }
+        return static_cast<int>(planes);
+    };
+
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        const Node& node = _nodes[entry.node];
+        const int planes = entry.planes ? classify(node.box, entry.planes) : 0;
+        if (planes < 0) {
+            continue;
+        }
+        if (!node.isLeaf()) {
+            stack[top++] = { node.first + 1, static_cast<uint32_t>(planes) };
+            stack[top++] = { node.first, static_cast<uint32_t>(planes) };
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            const uint32_t primitive = _primitives[i];
+            if (planes == 0 || classify(_boxes[primitive], static_cast<uint32_t>(planes)) >= 0) {
+                visit(primitive);
+            }
+        }
+    }
+}
+
+template <typename Hit>
+bool Bvh::raycast(const Ray& ray, float& tMax, Hit&& hit) const {
+    float tEnter;
+    if (_nodes.empty() || !ray.intersect(_nodes[0].box, tMax, tEnter)) {
+        return false;
+    }
+
+    struct Entry {
+        uint32_t node;
+        float tEnter;
+    };
+    Entry stack[kMaxDepth + 2];
+    int top = 0;
+    stack[top++] = { 0, tEnter };
+    const float tStart = tMax;
+
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        if (entry.tEnter > tMax) {
+            continue;
+        }
+        const Node& node = _nodes[entry.node];
+        if (node.isLeaf()) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const uint32_t primitive = _primitives[i];
+                if (ray.intersect(_boxes[primitive], tMax, tEnter)) {
+                    hit(primitive, tMax);
+                }
+            }
+            continue;
+        }
+
+        // the nearer child goes on top
+        float tLeft, tRight;
+        const bool left = ray.intersect(_nodes[node.first].box, tMax, tLeft);
+        const bool right = ray.intersect(_nodes[node.first + 1].box, tMax, tRight);
+        if (left && right) {
+            const bool leftFirst = tLeft <= tRight;
+            stack[top++] = leftFirst ? Entry{ node.first + 1, tRight } : Entry{ node.first, tLeft };
+            stack[top++] = leftFirst ? Entry{ node.first, tLeft } : Entry{ node.first + 1, tRight };
+        } else if (left) {
+            stack[top++] = { node.first, tLeft };
+        } else if (right) {
+            stack[top++] = { node.first + 1, tRight };
+        }
+    }
+    return tMax < tStart;
+}
+
+template <typename Visit>
+void Bvh::overlap(const BoundingBox& box, Visit&& visit) const {
+    if (_nodes.empty()) {
+        return;
+    }
+
+    uint32_t stack[kMaxDepth + 2];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = _nodes[stack[--top]];
+        if (!overlaps(node.box, box)) {
+            continue;
+        }
+        if (!node.isLeaf()) {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            if (overlaps(_boxes[_primitives[i]], box)) {
+                visit(_primitives[i]);
+            }
+        }
+    }
+}
+
+template <typename Visit>
+void Bvh::overlap(const glm::vec3& center, float radius, Visit&& visit) const {
+    if (_nodes.empty()) {
+        return;
+    }
+
+    uint32_t stack[kMaxDepth + 2];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = _nodes[stack[--top]];
+        if (!overlaps(node.box, center, radius)) {
+            continue;
+        }
+        if (!node.isLeaf()) {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            if (overlaps(_boxes[_primitives[i]], center, radius)) {
+                visit(_primitives[i]);
+            }
+        }
+    }
+}
@@ -3,6 +3,7 @@
 #include "bounding_box.h"
 #include "plane.h"
 #include <iostream>
+#include <limits>
 
 struct Frustum {
 public:
@@ -16,39 +17,66 @@ public:
         FarFace = 5
     };
 
+    // false only if the sphere lies completely outside one of the planes
+    bool intersect(const glm::vec3& center, float radius) const {
+        for (const auto& plane : planes) {
+            if (plane.getSignedDistanceToPoint(center) < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // false only if the box, given by center and half extent, lies completely outside one of the planes.
+    // conservative: boxes near a corner of the frustum may pass although they are outside
+    bool intersect(const glm::vec3& center, const glm::vec3& extent) const {
+        for (const auto& plane : planes) {
+            if (plane.getSignedDistanceToPoint(center) < -glm::dot(extent, glm::abs(plane.normal))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // same for a model space box under modelMatrix, tested as the world space box around it
     bool intersect(const BoundingBox& aabb, const glm::mat4& modelMatrix) const {
-        // TODO: judge whether the frustum intersects the bounding box
-        // Note: this is for Bonus project 'Frustum Culling'
-        // write your code here
-        // ------------------------------------------------------------
-        // return true;
-        // ------------------------------------------------------------
+        glm::vec3 center, extent;
+        transformBox(aabb, modelMatrix, center, extent);
+        return intersect(center, extent);
+    }
 
-        glm::vec3 point;
+    // planes of the clip volume of a view projection matrix (Gribb and Hartmann), normalized and pointing inside
+    static Frustum fromMatrix(const glm::mat4& viewProjection) {
+        auto row = [&](int i) {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        };
+        const glm::vec4 equations[6] = {
+            row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(3) + row(2), row(3) - row(2)
+        };
 
-        // for 2 x 2 x 2 points
-        for (int i = 0; i < 2; ++i) {
-            point.x = i ? aabb.max.x : aabb.min.x;
-            for (int j = 0; j < 2; ++j) {
-                point.y = j ? aabb.max.y : aabb.min.y;
-                for (int k = 0; k < 2; ++k) {
-                    point.z = k ? aabb.max.z : aabb.min.z;
-                    // change the point from model space to world space
-                    point = glm::vec3(modelMatrix * glm::vec4(point, 1.0f));
-                    // for all planes
-                    if (planes[0].getSignedDistanceToPoint(point) > 0.0f
-                        && planes[1].getSignedDistanceToPoint(point) > 0.0f
-                        && planes[2].getSignedDistanceToPoint(point) > 0.0f
-                        && planes[3].getSignedDistanceToPoint(point) > 0.0f
-                        && planes[4].getSignedDistanceToPoint(point) > 0.0f
-                        && planes[5].getSignedDistanceToPoint(point) > 0.0f) {
-                        return true;
-                    }
-                }
-            }
+        Frustum frustum;
+        for (int i = 0; i < 6; ++i) {
+            const float length = glm::length(glm::vec3(equations[i]));
+            frustum.planes[i] = Plane(glm::vec3(equations[i]) / length, equations[i].w / length);
         }
+        return frustum;
+    }
+
+    // the clip volume of an orthographic light open toward the light: a caster between the light and the near
+    // plane still throws its shadow into the volume, and is drawn with depth clamping instead of being clipped
+    static Frustum fromShadowMatrix(const glm::mat4& lightSpaceMatrix) {
+        Frustum frustum = fromMatrix(lightSpaceMatrix);
+        frustum.planes[4].signedDistance = std::numeric_limits<float>::max();
+        return frustum;
+    }
 
-        return false;
+    // center and half extent of the world space box around a model space box (Arvo 1990)
+    static void transformBox(const BoundingBox& aabb, const glm::mat4& modelMatrix, glm::vec3& center, glm::vec3& extent) {
+        const glm::vec3 localCenter = 0.5f * (aabb.max + aabb.min);
+        const glm::vec3 localExtent = 0.5f * (aabb.max - aabb.min);
+        center = glm::vec3(modelMatrix * glm::vec4(localCenter, 1.0f));
+        extent = glm::abs(glm::vec3(modelMatrix[0])) * localExtent.x + glm::abs(glm::vec3(modelMatrix[1])) * localExtent.y
+            + glm::abs(glm::vec3(modelMatrix[2])) * localExtent.z;
     }
 };
 
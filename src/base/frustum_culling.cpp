@@ -0,0 +1,149 @@
+#include <cmath>
+
+#include "frustum_culling.h"
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define CULLING_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CULLING_SSE 1
+#endif
+
+namespace {
+// set bits of a 4 bit movemask
+[[maybe_unused]] constexpr uint8_t kBitCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+// plane coefficients and the absolute values of the normal, which project an extent onto the normal
+struct CullingPlane {
+    float nx, ny, nz, w;
+    float ax, ay, az;
+};
+
+void getCullingPlanes(const Frustum& frustum, CullingPlane planes[6]) {
+    for (int p = 0; p < 6; ++p) {
+        const Plane& plane = frustum.planes[p];
+        planes[p] = { plane.normal.x, plane.normal.y, plane.normal.z, plane.signedDistance,
+            std::abs(plane.normal.x), std::abs(plane.normal.y), std::abs(plane.normal.z) };
+    }
+}
+} // namespace
+
+void CullingBoxes::clear() {
+    _centerX.clear(), _centerY.clear(), _centerZ.clear();
+    _extentX.clear(), _extentY.clear(), _extentZ.clear();
+}
+
+void CullingBoxes::reserve(size_t count) {
+    _centerX.reserve(count), _centerY.reserve(count), _centerZ.reserve(count);
+    _extentX.reserve(count), _extentY.reserve(count), _extentZ.reserve(count);
+}
+
+void CullingBoxes::push_back(const glm::vec3& center, const glm::vec3& extent) {
+    _centerX.push_back(center.x), _centerY.push_back(center.y), _centerZ.push_back(center.z);
+    _extentX.push_back(extent.x), _extentY.push_back(extent.y), _extentZ.push_back(extent.z);
+}
+
+void CullingBoxes::push_back(const BoundingBox& box, const glm::mat4& modelMatrix) {
+    glm::vec3 center, extent;
+    Frustum::transformBox(box, modelMatrix, center, extent);
+    push_back(center, extent);
+}
+
+void CullingBoxes::pop_back() {
+    _centerX.pop_back(), _centerY.pop_back(), _centerZ.pop_back();
+    _extentX.pop_back(), _extentY.pop_back(), _extentZ.pop_back();
+}
+
+void CullingBoxes::set(size_t i, const glm::vec3& center, const glm::vec3& extent) {
+    _centerX[i] = center.x, _centerY[i] = center.y, _centerZ[i] = center.z;
+    _extentX[i] = extent.x, _extentY[i] = extent.y, _extentZ[i] = extent.z;
+}
+
+size_t CullingBoxes::cull(const Frustum& frustum, size_t first, size_t count, uint8_t* visible) const {
+    CullingPlane planes[6];
+    getCullingPlanes(frustum, planes);
+
+    const size_t end = first + count;
+    size_t i = first;
+    size_t visibleCount = 0;
+
+#if defined(CULLING_AVX)
+    __m256 nx[6], ny[6], nz[6], w[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p) {
+        nx[p] = _mm256_set1_ps(planes[p].nx), ny[p] = _mm256_set1_ps(planes[p].ny);
+        nz[p] = _mm256_set1_ps(planes[p].nz), w[p] = _mm256_set1_ps(planes[p].w);
+        ax[p] = _mm256_set1_ps(planes[p].ax), ay[p] = _mm256_set1_ps(planes[p].ay);
+        az[p] = _mm256_set1_ps(planes[p].az);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= end; i += 8) {
+        const __m256 cx = _mm256_loadu_ps(&_centerX[i]), cy = _mm256_loadu_ps(&_centerY[i]);
+        const __m256 cz = _mm256_loadu_ps(&_centerZ[i]);
+        const __m256 ex = _mm256_loadu_ps(&_extentX[i]), ey = _mm256_loadu_ps(&_extentY[i]);
+        const __m256 ez = _mm256_loadu_ps(&_extentZ[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            const __m256 d = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_add_ps(_mm256_mul_ps(nz[p], cz), w[p]));
+            const __m256 r = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_GE_OQ));
+        }
+        const int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; ++k) {
+            visible[i - first + k] = (mask >> k) & 1;
+        }
+        visibleCount += kBitCount[mask & 15] + kBitCount[mask >> 4];
+    }
+#elif defined(CULLING_SSE)
+    __m128 nx[6], ny[6], nz[6], w[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p) {
+        nx[p] = _mm_set1_ps(planes[p].nx), ny[p] = _mm_set1_ps(planes[p].ny);
+        nz[p] = _mm_set1_ps(planes[p].nz), w[p] = _mm_set1_ps(planes[p].w);
+        ax[p] = _mm_set1_ps(planes[p].ax), ay[p] = _mm_set1_ps(planes[p].ay);
+        az[p] = _mm_set1_ps(planes[p].az);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= end; i += 4) {
+        const __m128 cx = _mm_loadu_ps(&_centerX[i]), cy = _mm_loadu_ps(&_centerY[i]), cz = _mm_loadu_ps(&_centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&_extentX[i]), ey = _mm_loadu_ps(&_extentY[i]), ez = _mm_loadu_ps(&_extentZ[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            const __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), w[p]));
+            const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), zero));
+        }
+        const int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k) {
+            visible[i - first + k] = (mask >> k) & 1;
+        }
+        visibleCount += kBitCount[mask];
+    }
+#endif
+
+    // the boxes left over by the vector loop, in the same arithmetic order
+    for (; i < end; ++i) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p) {
+            const CullingPlane& plane = planes[p];
+            const float d = (plane.nx * _centerX[i] + plane.ny * _centerY[i]) + (plane.nz * _centerZ[i] + plane.w);
+            const float r = (plane.ax * _extentX[i] + plane.ay * _extentY[i]) + plane.az * _extentZ[i];
+            inside = d + r >= 0.0f;
+        }
+        visible[i - first] = inside ? 1 : 0;
+        visibleCount += inside ? 1 : 0;
+    }
+    return visibleCount;
+}
+
+const char* CullingBoxes::getSimdName() {
+#if defined(CULLING_AVX)
+    return "AVX";
+#elif defined(CULLING_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bounding_box.h"
+#include "frustum.h"
+
+// world space boxes as center and half extent in structure of arrays, so that the culling loop tests
+// 4 (SSE) or 8 (AVX) boxes per iteration
+class CullingBoxes {
+public:
+    size_t size() const {
+        return _centerX.size();
+    }
+
+    void clear();
+
+    void reserve(size_t count);
+
+    void push_back(const glm::vec3& center, const glm::vec3& extent);
+
+    // the world space box around a model space box under modelMatrix, see Frustum::transformBox
+    void push_back(const BoundingBox& box, const glm::mat4& modelMatrix);
+
+    void pop_back();
+
+    void set(size_t i, const glm::vec3& center, const glm::vec3& extent);
+
+    glm::vec3 getCenter(size_t i) const {
+        return { _centerX[i], _centerY[i], _centerZ[i] };
+    }
+
+    glm::vec3 getExtent(size_t i) const {
+        return { _extentX[i], _extentY[i], _extentZ[i] };
+    }
+
+    // writes 1 to visible[i - first] for every box of [first, first + count) that intersects frustum, 0 otherwise.
+    // the test is the conservative one of Frustum::intersect. returns the number of visible boxes
+    size_t cull(const Frustum& frustum, size_t first, size_t count, uint8_t* visible) const;
+
+    size_t cull(const Frustum& frustum, uint8_t* visible) const {
+        return cull(frustum, 0, size(), visible);
+    }
+
+    // name of the instruction set the culling loop was compiled for
+    static const char* getSimdName();
+
+private:
+    std::vector<float> _centerX, _centerY, _centerZ;
+    std::vector<float> _extentX, _extentY, _extentZ;
+};
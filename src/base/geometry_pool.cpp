@@ -0,0 +1,207 @@
+#include "geometry_pool.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+// vertices of the first buffer of a format and the vertex rounding of its ranges
+constexpr uint32_t kInitialVertices = 1 << 16;
+constexpr uint32_t kVertexBlock = 32;
+// 4 byte units of the first index buffer and the rounding of its ranges
+constexpr uint32_t kInitialIndexUnits = 1 << 20;
+constexpr uint32_t kIndexBlock = 64;
+constexpr size_t kInitialDrawIds = 1024;
+
+// a buffer of bytes with the first copyBytes of source, which is deleted
+GLuint copyToLarger(GLuint source, size_t copyBytes, size_t bytes) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, copyBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &source);
+    return buffer;
+}
+
+void upload(GLuint buffer, size_t offset, size_t bytes, const void* data) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+} // namespace
+
+GeometryPool::~GeometryPool() {
+    release();
+}
+
+GeometryPool::Range GeometryPool::allocate(const void* vertexData, size_t vertexCount, VertexFormat format,
+                                           const void* indexData, size_t indexCount, GLenum indexType) {
+    Range range;
+    range.format = format;
+    if (vertexCount == 0 || indexCount == 0) {
+        return range;
+    }
+
+    Arena& arena = _arenas[static_cast<size_t>(format)];
+    if (arena.allocator == nullptr) {
+        createArena(format);
+    }
+
+    const uint32_t vertices = static_cast<uint32_t>(vertexCount);
+    uint32_t vertexOffset = arena.allocator->allocate(vertices);
+    while (vertexOffset == BuddyAllocator::kInvalid) {
+        growArena(format);
+        vertexOffset = arena.allocator->allocate(vertices);
+    }
+
+    const size_t indexBytes = indexCount * getIndexSize(indexType);
+    const uint32_t indexUnits = static_cast<uint32_t>((indexBytes + 3) / 4);
+    uint32_t indexOffset = _indexAllocator->allocate(indexUnits);
+    while (indexOffset == BuddyAllocator::kInvalid) {
+        growIndices();
+        indexOffset = _indexAllocator->allocate(indexUnits);
+    }
+
+    const size_t vertexSize = getVertexSize(format);
+    upload(arena.buffer, vertexOffset * vertexSize, vertexCount * vertexSize, vertexData);
+    upload(_indexBuffer, indexOffset * size_t(4), indexBytes, indexData);
+
+    range.baseVertex = vertexOffset;
+    range.vertexCount = vertices;
+    range.indexOffset = indexOffset;
+    range.indexUnits = indexUnits;
+    ++_rangeCount;
+    return range;
+}
+
+void GeometryPool::free(const Range& range) {
+    if (range.isEmpty()) {
+        return;
+    }
+
+    _arenas[static_cast<size_t>(range.format)].allocator->free(range.baseVertex, range.vertexCount);
+    _indexAllocator->free(range.indexOffset, range.indexUnits);
+    if (--_rangeCount == 0) {
+        release();
+    }
+}
+
+void GeometryPool::reserveDrawIds(size_t count) {
+    // without a vertex array nothing reads them, the first one reserves
+    if (count <= _drawIdCapacity || _drawIdBuffer == 0) {
+        return;
+    }
+
+    _drawIdCapacity = std::max(count, 2 * _drawIdCapacity);
+    std::vector<uint32_t> ids(_drawIdCapacity);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = static_cast<uint32_t>(i);
+    }
+    // the vertex arrays refer to the name, which stays
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _drawIdBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, ids.size() * sizeof(uint32_t), ids.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+size_t GeometryPool::getCapacityBytes() const {
+    size_t bytes = _indexAllocator != nullptr ? _indexAllocator->getCapacity() * size_t(4) : 0;
+    for (size_t i = 0; i < kFormatCount; ++i) {
+        if (_arenas[i].allocator != nullptr) {
+            bytes += _arenas[i].allocator->getCapacity() * getVertexSize(static_cast<VertexFormat>(i));
+        }
+    }
+    return bytes;
+}
+
+size_t GeometryPool::getUsedBytes() const {
+    size_t bytes = _indexAllocator != nullptr ? _indexAllocator->getUsed() * size_t(4) : 0;
+    for (size_t i = 0; i < kFormatCount; ++i) {
+        if (_arenas[i].allocator != nullptr) {
+            bytes += _arenas[i].allocator->getUsed() * getVertexSize(static_cast<VertexFormat>(i));
+        }
+    }
+    return bytes;
+}
+
+void GeometryPool::createArena(VertexFormat format) {
+    if (_indexAllocator == nullptr) {
+        _indexAllocator = std::make_unique<BuddyAllocator>(kInitialIndexUnits, kIndexBlock);
+        glGenBuffers(1, &_indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _indexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, _indexAllocator->getCapacity() * size_t(4), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glGenBuffers(1, &_drawIdBuffer);
+        reserveDrawIds(kInitialDrawIds);
+    }
+
+    Arena& arena = _arenas[static_cast<size_t>(format)];
+    arena.allocator = std::make_unique<BuddyAllocator>(kInitialVertices, kVertexBlock);
+    glGenBuffers(1, &arena.buffer);
+    glGenVertexArrays(1, &arena.vertexArray);
+
+    glBindVertexArray(arena.vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.buffer);
+    glBufferData(GL_ARRAY_BUFFER, arena.allocator->getCapacity() * getVertexSize(format), nullptr, GL_STATIC_DRAW);
+    setupVertexAttributes(format);
+
+    glBindBuffer(GL_ARRAY_BUFFER, _drawIdBuffer);
+    glEnableVertexAttribArray(kDrawIdLocation);
+    glVertexAttribIPointer(kDrawIdLocation, 1, GL_UNSIGNED_INT, sizeof(uint32_t), nullptr);
+    glVertexAttribDivisor(kDrawIdLocation, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::growArena(VertexFormat format) {
+    Arena& arena = _arenas[static_cast<size_t>(format)];
+    const size_t vertexSize = getVertexSize(format);
+    const size_t oldBytes = arena.allocator->getCapacity() * vertexSize;
+    arena.allocator->grow();
+    arena.buffer = copyToLarger(arena.buffer, oldBytes, arena.allocator->getCapacity() * vertexSize);
+
+    // the attribute pointers refer to the buffer they were set with
+    glBindVertexArray(arena.vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.buffer);
+    setupVertexAttributes(format);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::growIndices() {
+    const size_t oldBytes = _indexAllocator->getCapacity() * size_t(4);
+    _indexAllocator->grow();
+    _indexBuffer = copyToLarger(_indexBuffer, oldBytes, _indexAllocator->getCapacity() * size_t(4));
+
+    for (const Arena& arena : _arenas) {
+        if (arena.vertexArray != 0) {
+            glBindVertexArray(arena.vertexArray);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+        }
+    }
+    glBindVertexArray(0);
+}
+
+void GeometryPool::release() {
+    for (Arena& arena : _arenas) {
+        if (arena.vertexArray != 0) {
+            glDeleteVertexArrays(1, &arena.vertexArray);
+            glDeleteBuffers(1, &arena.buffer);
+        }
+        arena = Arena();
+    }
+
+    if (_indexBuffer != 0) {
+        glDeleteBuffers(1, &_indexBuffer);
+        glDeleteBuffers(1, &_drawIdBuffer);
+    }
+    _indexBuffer = 0;
+    _drawIdBuffer = 0;
+    _drawIdCapacity = 0;
+    _indexAllocator.reset();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "buddy_allocator.h"
+#include "gl_utility.h"
+#include "vertex_format.h"
+
+// DrawElementsIndirectCommand of glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    // in indices of the index type of the draw
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// process wide vertex and index megabuffers the meshes are uploaded to. every vertex format has one vertex
+// buffer and one vertex array, all of them share one index buffer, so meshes of a format are drawn without
+// binding anything in between and the draws of many meshes go into one glMultiDrawElementsIndirect.
+// the buffers are sub-allocated by BuddyAllocators and doubled with a GPU copy when they run out.
+// the vertex arrays also read a draw id at kDrawIdLocation, an instanced 0, 1, 2, ... so the base instance
+// of a command reaches the vertex shader without shader draw parameters.
+// everything has to happen on the context thread. the GL objects go with the last range, before the context
+class GeometryPool {
+public:
+    static constexpr GLuint kDrawIdLocation = 7;
+
+    // place of the geometry of one mesh
+    struct Range {
+        VertexFormat format = VertexFormat::Float;
+        // first vertex, the base vertex of its draws
+        uint32_t baseVertex = 0;
+        uint32_t vertexCount = 0;
+        // start and size in 4 byte units of the index buffer, so 16 and 32 bit indices share it
+        uint32_t indexOffset = 0;
+        uint32_t indexUnits = 0;
+
+        bool isEmpty() const {
+            return vertexCount == 0;
+        }
+    };
+
+    GeometryPool() = default;
+
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    static GeometryPool& getGlobal() {
+        static GeometryPool pool;
+        return pool;
+    }
+
+    // copies vertexCount vertices of format and indexCount indices of indexType into the buffers
+    Range allocate(const void* vertexData, size_t vertexCount, VertexFormat format, const void* indexData,
+                   size_t indexCount, GLenum indexType);
+
+    void free(const Range& range);
+
+    // vertex array of format with the index buffer, 0 before the first range of format
+    GLuint getVertexArray(VertexFormat format) const {
+        return _arenas[static_cast<size_t>(format)].vertexArray;
+    }
+
+    // first index of range for its index type
+    static uint32_t getFirstIndex(const Range& range, GLenum indexType) {
+        return range.indexOffset * 4 / getIndexSize(indexType);
+    }
+
+    static uint32_t getIndexSize(GLenum indexType) {
+        return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    // makes the draw ids [0, count) readable, before drawing commands with base instances below count
+    void reserveDrawIds(size_t count);
+
+    size_t getRangeCount() const {
+        return _rangeCount;
+    }
+
+    // bytes of the buffers and bytes the ranges take of them
+    size_t getCapacityBytes() const;
+
+    size_t getUsedBytes() const;
+
+private:
+    static constexpr size_t kFormatCount = 3;
+
+    struct Arena {
+        GLuint vertexArray = 0;
+        GLuint buffer = 0;
+        std::unique_ptr<BuddyAllocator> allocator;
+    };
+
+    Arena _arenas[kFormatCount];
+    GLuint _indexBuffer = 0;
+    std::unique_ptr<BuddyAllocator> _indexAllocator;
+    GLuint _drawIdBuffer = 0;
+    size_t _drawIdCapacity = 0;
+    size_t _rangeCount = 0;
+
+    void createArena(VertexFormat format);
+
+    void growArena(VertexFormat format);
+
+    void growIndices();
+
+    // deletes every GL object, once no range is left
+    void release();
+};
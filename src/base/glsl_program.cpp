@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <regex>
 #include <sstream>
 #include <stdexcept>
@@ -8,6 +10,13 @@
 
 #include "glsl_program.h"
 
+namespace {
+std::map<std::string, std::string>& getShaderIncludes() {
+    static std::map<std::string, std::string> includes;
+    return includes;
+}
+} // namespace
+
 GLSLProgram::GLSLProgram() {
     _handle = glCreateProgram();
     if (_handle == 0) {
@@ -16,13 +25,15 @@ GLSLProgram::GLSLProgram() {
 }
 
 GLSLProgram::GLSLProgram(GLSLProgram&& rhs) noexcept
-    : _handle(rhs._handle), _vertexShaders(std::move(rhs._vertexShaders)),
+    : _handle(rhs._handle), _uniformLocations(std::move(rhs._uniformLocations)), _vertexShaders(std::move(rhs._vertexShaders)),
       _geometryShaders(std::move(rhs._geometryShaders)),
-      _fragmentShaders(std::move(rhs._fragmentShaders)) {
+      _fragmentShaders(std::move(rhs._fragmentShaders)),
+      _computeShaders(std::move(rhs._computeShaders)) {
     rhs._handle = 0;
     rhs._vertexShaders.clear();
     rhs._geometryShaders.clear();
     rhs._fragmentShaders.clear();
+    rhs._computeShaders.clear();
 }
 
 GLSLProgram::~GLSLProgram() {
@@ -38,6 +49,10 @@ GLSLProgram::~GLSLProgram() {
         glDeleteShader(fragmentShader);
     }
 
+    for (const auto computeShader : _computeShaders) {
+        glDeleteShader(computeShader);
+    }
+
     if (_handle) {
         glDeleteProgram(_handle);
         _handle = 0;
@@ -82,6 +97,17 @@ void GLSLProgram::attachFragmentShader(const std::string& code, const std::strin
     attachFragmentShader(header + code);
 }
 
+void GLSLProgram::attachComputeShader(const std::string& code) {
+#ifndef __EMSCRIPTEN__
+    GLuint computeShader = createShader(code, GL_COMPUTE_SHADER);
+    glAttachShader(_handle, computeShader);
+    _computeShaders.push_back(computeShader);
+#else
+    std::cerr << "Compute shader is not supported by WebGL" << std::endl;
+    throw std::logic_error("Not implemented");
+#endif
+}
+
 void GLSLProgram::attachVertexShaderFromFile(const std::string& filePath) {
     const std::string& code = readFile(filePath);
     try {
@@ -154,6 +180,16 @@ void GLSLProgram::attachFragmentShaderFromFile(
     }
 }
 
+void GLSLProgram::attachComputeShaderFromFile(const std::string& filePath) {
+    const std::string& code = readFile(filePath);
+    try {
+        attachComputeShader(code);
+    } catch (const std::runtime_error&) {
+        std::cerr << "Compile " << filePath << " error" << std::endl;
+        throw;
+    }
+}
+
 void GLSLProgram::setTransformFeedbackVaryings(
     const std::vector<const char*>& varyings, GLenum bufferMode) {
     glTransformFeedbackVaryings(
@@ -170,6 +206,8 @@ void GLSLProgram::link() {
         glGetProgramInfoLog(_handle, sizeof(buffer), NULL, buffer);
         throw std::runtime_error("link program error: " + std::string(buffer));
     }
+
+    reflectUniforms();
 }
 
 void GLSLProgram::use() {
@@ -215,94 +253,141 @@ int GLSLProgram::getUniformBlockVariableOffset(const std::string& name) const {
     return offset;
 }
 
-void GLSLProgram::setUniformBool(const std::string& name, bool value) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
+GLint GLSLProgram::getUniformLocation(UniformName name) const {
+    auto it = std::lower_bound(_uniformLocations.begin(), _uniformLocations.end(), name.hash,
+        [](const UniformLocation& uniform, uint32_t hash) { return uniform.hash < hash; });
+    if (it == _uniformLocations.end() || it->hash != name.hash) {
+        return -1;
     }
 
-    glUniform1i(location, static_cast<int>(value));
+    return it->location;
 }
 
-void GLSLProgram::setUniformInt(const std::string& name, int value) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
+GLint GLSLProgram::findUniformLocation(UniformName name) const {
+    GLint location = getUniformLocation(name);
     if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
+        std::cerr << "find uniform " << name.name << " location failure" << std::endl;
     }
 
-    glUniform1i(location, value);
+    return location;
 }
 
-void GLSLProgram::setUniformUint(const std::string& name, uint32_t value) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
-    }
+void GLSLProgram::setUniformBool(UniformName name, bool value) const {
+    setUniformBool(findUniformLocation(name), value);
+}
 
-    glUniform1ui(location, value);
+void GLSLProgram::setUniformInt(UniformName name, int value) const {
+    setUniformInt(findUniformLocation(name), value);
 }
 
-void GLSLProgram::setUniformFloat(const std::string& name, float value) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
-    }
+void GLSLProgram::setUniformUint(UniformName name, uint32_t value) const {
+    setUniformUint(findUniformLocation(name), value);
+}
 
-    glUniform1f(location, value);
+void GLSLProgram::setUniformFloat(UniformName name, float value) const {
+    setUniformFloat(findUniformLocation(name), value);
 }
 
-void GLSLProgram::setUniformVec2(const std::string& name, const glm::vec2& v2) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
-    }
+void GLSLProgram::setUniformVec2(UniformName name, const glm::vec2& v2) const {
+    setUniformVec2(findUniformLocation(name), v2);
+}
+
+void GLSLProgram::setUniformIvec2(UniformName name, const glm::ivec2& v2) const {
+    setUniformIvec2(findUniformLocation(name), v2);
+}
 
+void GLSLProgram::setUniformVec3(UniformName name, const glm::vec3& v3) const {
+    setUniformVec3(findUniformLocation(name), v3);
+}
+
+void GLSLProgram::setUniformVec4(UniformName name, const glm::vec4& v4) const {
+    setUniformVec4(findUniformLocation(name), v4);
+}
+
+void GLSLProgram::setUniformMat2(UniformName name, const glm::mat2& mat2) const {
+    setUniformMat2(findUniformLocation(name), mat2);
+}
+
+void GLSLProgram::setUniformMat3(UniformName name, const glm::mat3& mat3) const {
+    setUniformMat3(findUniformLocation(name), mat3);
+}
+
+void GLSLProgram::setUniformMat4(UniformName name, const glm::mat4& mat4) const {
+    setUniformMat4(findUniformLocation(name), mat4);
+}
+
+void GLSLProgram::setUniformFloatArray(UniformName name, const float* values, size_t count) const {
+    setUniformFloatArray(findUniformLocation(name), values, count);
+}
+
+void GLSLProgram::setUniformVec4Array(UniformName name, const glm::vec4* values, size_t count) const {
+    setUniformVec4Array(findUniformLocation(name), values, count);
+}
+
+void GLSLProgram::setUniformMat4Array(UniformName name, const glm::mat4* values, size_t count) const {
+    setUniformMat4Array(findUniformLocation(name), values, count);
+}
+
+void GLSLProgram::setUniformBool(GLint location, bool value) const {
+    glUniform1i(location, static_cast<int>(value));
+}
+
+void GLSLProgram::setUniformInt(GLint location, int value) const {
+    glUniform1i(location, value);
+}
+
+void GLSLProgram::setUniformUint(GLint location, uint32_t value) const {
+    glUniform1ui(location, value);
+}
+
+void GLSLProgram::setUniformFloat(GLint location, float value) const {
+    glUniform1f(location, value);
+}
+
+void GLSLProgram::setUniformVec2(GLint location, const glm::vec2& v2) const {
     glUniform2fv(location, 1, glm::value_ptr(v2));
 }
 
-void GLSLProgram::setUniformVec3(const std::string& name, const glm::vec3& v3) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
-    }
+void GLSLProgram::setUniformIvec2(GLint location, const glm::ivec2& v2) const {
+    glUniform2iv(location, 1, glm::value_ptr(v2));
+}
 
+void GLSLProgram::setUniformVec3(GLint location, const glm::vec3& v3) const {
     glUniform3fv(location, 1, glm::value_ptr(v3));
 }
 
-void GLSLProgram::setUniformVec4(const std::string& name, const glm::vec4& v4) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
-    }
-
+void GLSLProgram::setUniformVec4(GLint location, const glm::vec4& v4) const {
     glUniform4fv(location, 1, glm::value_ptr(v4));
 }
 
-void GLSLProgram::setUniformMat2(const std::string& name, const glm::mat2& mat2) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
-    }
+void GLSLProgram::setUniformMat2(GLint location, const glm::mat2& mat2) const {
+    glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(mat2));
+}
 
-    glUniform3fv(location, 1, glm::value_ptr(mat2));
+void GLSLProgram::setUniformMat3(GLint location, const glm::mat3& mat3) const {
+    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat3));
 }
 
-void GLSLProgram::setUniformMat3(const std::string& name, const glm::mat3& mat3) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
-    }
+void GLSLProgram::setUniformMat4(GLint location, const glm::mat4& mat4) const {
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat4));
+}
 
-    glUniform3fv(location, 1, glm::value_ptr(mat3));
+void GLSLProgram::setUniformFloatArray(GLint location, const float* values, size_t count) const {
+    if (count != 0) {
+        glUniform1fv(location, static_cast<GLsizei>(count), values);
+    }
 }
 
-void GLSLProgram::setUniformMat4(const std::string& name, const glm::mat4& mat4) const {
-    GLint location = glGetUniformLocation(_handle, name.c_str());
-    if (location == -1) {
-        std::cerr << "find uniform " + name + " location failure" << std::endl;
+void GLSLProgram::setUniformVec4Array(GLint location, const glm::vec4* values, size_t count) const {
+    if (count != 0) {
+        glUniform4fv(location, static_cast<GLsizei>(count), glm::value_ptr(values[0]));
     }
+}
 
-    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat4));
+void GLSLProgram::setUniformMat4Array(GLint location, const glm::mat4* values, size_t count) const {
+    if (count != 0) {
+        glUniformMatrix4fv(location, static_cast<GLsizei>(count), GL_FALSE, glm::value_ptr(values[0]));
+    }
 }
 
 void GLSLProgram::setUniformBlockBinding(const std::string& name, uint32_t binding) const {
@@ -314,6 +399,92 @@ void GLSLProgram::setUniformBlockBinding(const std::string& name, uint32_t bindi
     glUniformBlockBinding(_handle, blockIndex, binding);
 }
 
+void GLSLProgram::reflectUniforms() {
+    _uniformLocations.clear();
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    std::string name;
+#if !defined(__EMSCRIPTEN__) && !defined(USE_GLES)
+    if (GLAD_GL_VERSION_4_3) {
+        glGetProgramInterfaceiv(_handle, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+        glGetProgramInterfaceiv(_handle, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxLength);
+        name.resize(std::max(maxLength, 1));
+
+        const GLenum properties[] = {GL_LOCATION, GL_ARRAY_SIZE};
+        for (GLint i = 0; i < count; ++i) {
+            GLint values[2];
+            glGetProgramResourceiv(_handle, GL_UNIFORM, i, 2, properties, 2, nullptr, values);
+            // members of uniform blocks have no location
+            if (values[0] == -1) {
+                continue;
+            }
+
+            GLsizei length = 0;
+            glGetProgramResourceName(_handle, GL_UNIFORM, i, maxLength, &length, name.data());
+            addUniformLocation(std::string_view(name.data(), length), values[0], values[1]);
+        }
+    } else
+#endif
+    {
+        glGetProgramiv(_handle, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(_handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        name.resize(std::max(maxLength, 1));
+
+        for (GLint i = 0; i < count; ++i) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(_handle, i, maxLength, &length, &size, &type, name.data());
+            GLint location = glGetUniformLocation(_handle, name.c_str());
+            if (location == -1) {
+                continue;
+            }
+
+            addUniformLocation(std::string_view(name.data(), length), location, size);
+        }
+    }
+
+    std::sort(_uniformLocations.begin(), _uniformLocations.end(), [](const UniformLocation& a, const UniformLocation& b) {
+        return a.hash < b.hash || (a.hash == b.hash && a.location < b.location);
+    });
+    _uniformLocations.erase(std::unique(_uniformLocations.begin(), _uniformLocations.end(),
+                                        [](const UniformLocation& a, const UniformLocation& b) {
+                                            return a.hash == b.hash && a.location == b.location;
+                                        }),
+                            _uniformLocations.end());
+    for (size_t i = 1; i < _uniformLocations.size(); ++i) {
+        if (_uniformLocations[i].hash == _uniformLocations[i - 1].hash) {
+            throw std::runtime_error("uniform name hash collision at location " +
+                                     std::to_string(_uniformLocations[i].location));
+        }
+    }
+}
+
+void GLSLProgram::addUniformLocation(std::string_view name, GLint location, GLint arraySize) {
+    _uniformLocations.push_back({hashUniformName(name), location});
+
+    // an array of basic types is reported as its first element, name[0]. the array name and every other element
+    // are keys too, with their own locations since they are not guaranteed to follow the first one
+    constexpr std::string_view firstElement = "[0]";
+    if (name.size() <= firstElement.size() || name.substr(name.size() - firstElement.size()) != firstElement) {
+        return;
+    }
+
+    const std::string_view arrayName = name.substr(0, name.size() - firstElement.size());
+    _uniformLocations.push_back({hashUniformName(arrayName), location});
+
+    std::string element;
+    for (GLint i = 1; i < arraySize; ++i) {
+        element.assign(arrayName);
+        element += "[" + std::to_string(i) + "]";
+        GLint elementLocation = glGetUniformLocation(_handle, element.c_str());
+        if (elementLocation != -1) {
+            _uniformLocations.push_back({hashUniformName(element), elementLocation});
+        }
+    }
+}
+
 std::string GLSLProgram::readFile(const std::string& filePath) {
     std::ifstream is;
     is.exceptions(std::ifstream::failbit | std::ifstream::badbit);
@@ -335,7 +506,8 @@ GLuint GLSLProgram::createShader(const std::string& code, GLenum shaderType) {
         throw std::runtime_error("create shader failure");
     }
 
-    const char* codeBuf = code.c_str();
+    const std::string source = resolveIncludes(code);
+    const char* codeBuf = source.c_str();
     glShaderSource(shader, 1, &codeBuf, nullptr);
     glCompileShader(shader);
 
@@ -344,13 +516,42 @@ GLuint GLSLProgram::createShader(const std::string& code, GLenum shaderType) {
     if (!success) {
         char buffer[1024];
         glGetShaderInfoLog(shader, sizeof(buffer), nullptr, buffer);
-        std::cerr << code << std::endl;
+        std::cerr << source << std::endl;
         throw std::runtime_error("compile error: \n" + std::string(buffer));
     }
 
     return shader;
 }
 
+void GLSLProgram::setShaderInclude(const std::string& name, const std::string& code) {
+    getShaderIncludes()[name] = code;
+}
+
+std::string GLSLProgram::resolveIncludes(const std::string& code) {
+    const std::map<std::string, std::string>& includes = getShaderIncludes();
+    if (includes.empty() || code.find("#include") == std::string::npos) {
+        return code;
+    }
+
+    // an unknown include is left for the compiler to report
+    std::regex regex(R"re(#include[ \t]+"([^"]+)"[^\n]*)re");
+    std::string result;
+    size_t line = 1;
+    auto last = code.cbegin();
+    for (auto it = std::sregex_iterator(code.begin(), code.end(), regex); it != std::sregex_iterator(); ++it) {
+        line += std::count((*it).prefix().first, (*it).prefix().second, '\n');
+        const auto include = includes.find((*it)[1].str());
+        if (include == includes.end()) {
+            continue;
+        }
+        result.append(last, (*it)[0].first);
+        result += include->second + "\n#line " + std::to_string(line + 1);
+        last = (*it)[0].second;
+    }
+    result.append(last, code.cend());
+    return result;
+}
+
 std::string GLSLProgram::generateVertexShaderHeader(const std::string& version) {
     return "#version " + version + "\n";
 }
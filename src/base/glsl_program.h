@@ -1,12 +1,38 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <glm/glm.hpp>
 
 #include "gl_utility.h"
 
+// 32 bit FNV-1a hash of a uniform name, the key of the uniform locations of a GLSLProgram
+constexpr uint32_t hashUniformName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (const char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+// name of a uniform with its hash. a string literal is hashed at compile time, a std::string at the call.
+// the name is only kept for the error messages and has to outlive the call
+struct UniformName {
+    uint32_t hash;
+    std::string_view name;
+
+    template <size_t N>
+    consteval UniformName(const char (&literal)[N])
+        : hash(hashUniformName(std::string_view(literal, N - 1))), name(literal, N - 1) {}
+
+    UniformName(const std::string& str) : hash(hashUniformName(str)), name(str) {}
+
+    explicit UniformName(std::string_view str) : hash(hashUniformName(str)), name(str) {}
+};
+
 class GLSLProgram {
 public:
     GLSLProgram();
@@ -27,6 +53,8 @@ public:
 
     void attachFragmentShader(const std::string& code, const std::string& version);
 
+    void attachComputeShader(const std::string& code);
+
     void attachVertexShaderFromFile(const std::string& filePath);
 
     void attachVertexShaderFromFile(const std::string& filePath, const std::string& version);
@@ -39,6 +67,12 @@ public:
 
     void attachFragmentShaderFromFile(const std::string& filePath, const std::string& version);
 
+    void attachComputeShaderFromFile(const std::string& filePath);
+
+    // code that replaces the lines #include "name" of the shaders compiled afterwards, GLSL has no includes.
+    // the lines after keep their numbers in the compile errors
+    static void setShaderInclude(const std::string& name, const std::string& code);
+
     void setTransformFeedbackVaryings(const std::vector<const char*>& varyings, GLenum bufferMode);
 
     void link();
@@ -53,41 +87,103 @@ public:
 
     int getUniformBlockVariableOffset(const std::string& name) const;
 
-    void setUniformBool(const std::string& name, bool value) const;
+    // location of a uniform from the table reflected at link, -1 if the program has no such active uniform.
+    // an array is found by its name, the one of its first element and the one of every element
+    GLint getUniformLocation(UniformName name) const;
+
+    // the setters by name look the location up in the table, without allocating or querying GL. the ones by
+    // location take a handle from getUniformLocation and pass it straight to GL
+    void setUniformBool(UniformName name, bool value) const;
+
+    void setUniformInt(UniformName name, int value) const;
+
+    void setUniformUint(UniformName name, uint32_t value) const;
+
+    void setUniformFloat(UniformName name, float value) const;
+
+    void setUniformVec2(UniformName name, const glm::vec2& v2) const;
+
+    void setUniformIvec2(UniformName name, const glm::ivec2& v2) const;
+
+    void setUniformVec3(UniformName name, const glm::vec3& v3) const;
+
+    void setUniformVec4(UniformName name, const glm::vec4& v4) const;
+
+    void setUniformMat2(UniformName name, const glm::mat2& mat2) const;
 
-    void setUniformInt(const std::string& name, int value) const;
+    void setUniformMat3(UniformName name, const glm::mat3& mat3) const;
 
-    void setUniformUint(const std::string& name, uint32_t value) const;
+    void setUniformMat4(UniformName name, const glm::mat4& mat4) const;
 
-    void setUniformFloat(const std::string& name, float value) const;
+    // count elements from the first of the array name, in one call
+    void setUniformFloatArray(UniformName name, const float* values, size_t count) const;
 
-    void setUniformVec2(const std::string& name, const glm::vec2& v2) const;
+    void setUniformVec4Array(UniformName name, const glm::vec4* values, size_t count) const;
 
-    void setUniformVec3(const std::string& name, const glm::vec3& v3) const;
+    void setUniformMat4Array(UniformName name, const glm::mat4* values, size_t count) const;
 
-    void setUniformVec4(const std::string& name, const glm::vec4& v4) const;
+    void setUniformBool(GLint location, bool value) const;
 
-    void setUniformMat2(const std::string& name, const glm::mat2& mat2) const;
+    void setUniformInt(GLint location, int value) const;
 
-    void setUniformMat3(const std::string& name, const glm::mat3& mat3) const;
+    void setUniformUint(GLint location, uint32_t value) const;
 
-    void setUniformMat4(const std::string& name, const glm::mat4& mat4) const;
+    void setUniformFloat(GLint location, float value) const;
+
+    void setUniformVec2(GLint location, const glm::vec2& v2) const;
+
+    void setUniformIvec2(GLint location, const glm::ivec2& v2) const;
+
+    void setUniformVec3(GLint location, const glm::vec3& v3) const;
+
+    void setUniformVec4(GLint location, const glm::vec4& v4) const;
+
+    void setUniformMat2(GLint location, const glm::mat2& mat2) const;
+
+    void setUniformMat3(GLint location, const glm::mat3& mat3) const;
+
+    void setUniformMat4(GLint location, const glm::mat4& mat4) const;
+
+    void setUniformFloatArray(GLint location, const float* values, size_t count) const;
+
+    void setUniformVec4Array(GLint location, const glm::vec4* values, size_t count) const;
+
+    void setUniformMat4Array(GLint location, const glm::mat4* values, size_t count) const;
 
     void setUniformBlockBinding(const std::string& name, uint32_t binding) const;
 
 private:
+    struct UniformLocation {
+        uint32_t hash;
+        GLint location;
+    };
+
     GLuint _handle = 0;
 
+    // locations of the active uniforms outside blocks, sorted by name hash
+    std::vector<UniformLocation> _uniformLocations;
+
     std::vector<GLuint> _vertexShaders;
 
     std::vector<GLuint> _geometryShaders;
 
     std::vector<GLuint> _fragmentShaders;
 
+    std::vector<GLuint> _computeShaders;
+
+    void reflectUniforms();
+
+    void addUniformLocation(std::string_view name, GLint location, GLint arraySize);
+
+    // location of name, with the error message of a missing uniform
+    GLint findUniformLocation(UniformName name) const;
+
     static std::string readFile(const std::string& filePath);
 
     static GLuint createShader(const std::string& code, GLenum shaderType);
 
+    static std::string resolveIncludes(const std::string& code);
+
     static std::string generateVertexShaderHeader(const std::string& version);
 
     static std::string generateGeometryShaderHeader(const std::string& version);
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "ktx2_file.h"
+
+#ifdef _WIN32
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace {
+constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr char SOURCE_TIME_KEY[] = "RTR.sourceTime";
+
+// a temporary file next to path that no other writer uses, on another thread or in another process
+std::string getTempPath(const std::string& path) {
+    static std::atomic<uint32_t> counter{0};
+#ifdef _WIN32
+    const int pid = _getpid();
+#else
+    const int pid = static_cast<int>(getpid());
+#endif
+    return path + '.' + std::to_string(pid) + '.' + std::to_string(counter++) + ".tmp";
+}
+
+#pragma pack(push, 4)
+struct Header {
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+#pragma pack(pop)
+static_assert(sizeof(Header) == 68, "ktx2 header must stay tightly packed");
+
+struct LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// VkFormat values of the block formats
+uint32_t getVkFormat(BCnFormat format) {
+    switch (format) {
+    case BCnFormat::BC1: return 131;  // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    case BCnFormat::BC3: return 137;  // VK_FORMAT_BC3_UNORM_BLOCK
+    case BCnFormat::BC4: return 139;  // VK_FORMAT_BC4_UNORM_BLOCK
+    case BCnFormat::BC5: return 141;  // VK_FORMAT_BC5_UNORM_BLOCK
+    }
+    return 0;
+}
+
+bool getFormat(uint32_t vkFormat, BCnFormat& format) {
+    switch (vkFormat) {
+    case 131: format = BCnFormat::BC1; return true;
+    case 137: format = BCnFormat::BC3; return true;
+    case 139: format = BCnFormat::BC4; return true;
+    case 141: format = BCnFormat::BC5; return true;
+    default: return false;
+    }
+}
+
+// basic data format descriptor of a block format, as required by the KTX2 spec
+std::vector<uint32_t> makeDataFormatDescriptor(BCnFormat format) {
+    struct Sample {
+        uint32_t bitOffset;
+        uint32_t channel;
+    };
+    uint32_t colorModel = 0;
+    std::vector<Sample> samples;
+    switch (format) {
+    case BCnFormat::BC1: colorModel = 128; samples = {{0, 0}}; break;
+    case BCnFormat::BC3: colorModel = 130; samples = {{0, 15}, {64, 0}}; break;
+    case BCnFormat::BC4: colorModel = 131; samples = {{0, 0}}; break;
+    case BCnFormat::BC5: colorModel = 132; samples = {{0, 0}, {64, 1}}; break;
+    }
+
+    const uint32_t blockSize = static_cast<uint32_t>(getBlockSize(format));
+    const uint32_t descriptorBlockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+    std::vector<uint32_t> words;
+    words.push_back(4 + descriptorBlockSize);  // dfdTotalSize
+    words.push_back(0);                         // vendor id, descriptor type
+    words.push_back(2 | (descriptorBlockSize << 16));
+    words.push_back(colorModel | (1u << 8) | (1u << 16));  // bt709 primaries, linear transfer
+    words.push_back(3 | (3u << 8));                         // 4x4 texel blocks
+    words.push_back(blockSize);
+    words.push_back(0);
+    for (const auto& sample : samples) {
+        words.push_back(sample.bitOffset | (63u << 16) | (sample.channel << 24));
+        words.push_back(0);
+        words.push_back(0);
+        words.push_back(0xFFFFFFFFu);
+    }
+    return words;
+}
+
+void writePadding(std::ofstream& os, size_t alignment) {
+    static const char zeros[16] = {};
+    const size_t offset = static_cast<size_t>(os.tellp());
+    const size_t padding = (alignment - offset % alignment) % alignment;
+    os.write(zeros, padding);
+}
+} // namespace
+
+bool Ktx2File::write(const std::string& path, const CompressedImage& image, int64_t sourceTime) {
+    if (image.empty()) {
+        return false;
+    }
+
+    const std::vector<uint32_t> dfd = makeDataFormatDescriptor(image.format);
+
+    std::string keyValue = SOURCE_TIME_KEY;
+    keyValue.push_back('\0');
+    keyValue += std::to_string(sourceTime);
+    keyValue.push_back('\0');
+    const uint32_t keyValueLength = static_cast<uint32_t>(keyValue.size());
+    const uint32_t kvdLength = (4 + keyValueLength + 3) & ~3u;
+
+    const size_t levelCount = image.levels.size();
+    const size_t blockSize = getBlockSize(image.format);
+
+    Header header = {};
+    header.vkFormat = getVkFormat(image.format);
+    header.typeSize = 1;
+    header.pixelWidth = static_cast<uint32_t>(image.levels[0].width);
+    header.pixelHeight = static_cast<uint32_t>(image.levels[0].height);
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(levelCount);
+    header.dfdByteOffset =
+        static_cast<uint32_t>(sizeof(KTX2_IDENTIFIER) + sizeof(Header) + levelCount * sizeof(LevelIndex));
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+    header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength = kvdLength;
+
+    // level data goes smallest mip first, every level aligned to the block size
+    std::vector<LevelIndex> levels(levelCount);
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    for (size_t i = levelCount; i-- > 0;) {
+        offset = (offset + blockSize - 1) / blockSize * blockSize;
+        levels[i].byteOffset = offset;
+        levels[i].byteLength = image.levels[i].data.size();
+        levels[i].uncompressedByteLength = image.levels[i].data.size();
+        offset += levels[i].byteLength;
+    }
+
+    // write to a temporary file of this writer first, so that a concurrent reader never sees a half written
+    // file and writers of the same path, e.g. a specular and a height map of one image, do not mix their bytes
+    const std::string tempPath = getTempPath(path);
+    {
+        std::ofstream os(tempPath, std::ios::binary | std::ios::trunc);
+        if (!os) {
+            return false;
+        }
+
+        os.write(reinterpret_cast<const char*>(KTX2_IDENTIFIER), sizeof(KTX2_IDENTIFIER));
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(LevelIndex));
+        os.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+        os.write(reinterpret_cast<const char*>(&keyValueLength), sizeof(keyValueLength));
+        os.write(keyValue.data(), keyValue.size());
+        writePadding(os, 4);
+        for (size_t i = levelCount; i-- > 0;) {
+            writePadding(os, blockSize);
+            os.write(
+                reinterpret_cast<const char*>(image.levels[i].data.data()), image.levels[i].data.size());
+        }
+        os.close();
+        if (!os) {
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool Ktx2File::read(const std::string& path, CompressedImage& image, int64_t& sourceTime) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        return false;
+    }
+    const std::vector<uint8_t> bytes(
+        (std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+    Header header;
+    if (bytes.size() < sizeof(KTX2_IDENTIFIER) + sizeof(Header) ||
+        std::memcmp(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        return false;
+    }
+    std::memcpy(&header, bytes.data() + sizeof(KTX2_IDENTIFIER), sizeof(Header));
+
+    BCnFormat format;
+    if (!getFormat(header.vkFormat, format) || header.faceCount != 1 || header.layerCount > 1 ||
+        header.pixelDepth > 1 || header.supercompressionScheme != 0 || header.levelCount == 0 ||
+        header.levelCount > 32) {
+        return false;
+    }
+
+    const size_t levelIndexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(Header);
+    if (levelIndexOffset + header.levelCount * sizeof(LevelIndex) > bytes.size() ||
+        static_cast<uint64_t>(header.kvdByteOffset) + header.kvdByteLength > bytes.size()) {
+        return false;
+    }
+
+    // find the source time among the key/value pairs
+    bool hasSourceTime = false;
+    size_t kvd = header.kvdByteOffset;
+    const size_t kvdEnd = kvd + header.kvdByteLength;
+    while (kvd + 4 <= kvdEnd) {
+        uint32_t length;
+        std::memcpy(&length, bytes.data() + kvd, 4);
+        if (kvd + 4 + length > kvdEnd) {
+            return false;
+        }
+        const char* entry = reinterpret_cast<const char*>(bytes.data() + kvd + 4);
+        const size_t keyLength = strnlen(entry, length);
+        if (keyLength < length && std::strcmp(entry, SOURCE_TIME_KEY) == 0) {
+            const std::string value(entry + keyLength + 1, length - keyLength - 1);
+            char* end = nullptr;
+            sourceTime = std::strtoll(value.c_str(), &end, 10);
+            hasSourceTime = end != value.c_str();
+        }
+        kvd += (4 + length + 3) & ~size_t(3);
+    }
+    if (!hasSourceTime) {
+        return false;
+    }
+
+    const size_t blockSize = getBlockSize(format);
+    image.format = format;
+    image.levels.resize(header.levelCount);
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        LevelIndex level;
+        std::memcpy(&level, bytes.data() + levelIndexOffset + i * sizeof(LevelIndex), sizeof(level));
+
+        auto& dst = image.levels[i];
+        dst.width = std::max<int>(header.pixelWidth >> i, 1);
+        dst.height = std::max<int>(header.pixelHeight >> i, 1);
+        const size_t expected =
+            static_cast<size_t>((dst.width + 3) / 4) * ((dst.height + 3) / 4) * blockSize;
+        if (level.byteLength != expected || level.byteOffset + level.byteLength > bytes.size()) {
+            image.levels.clear();
+            return false;
+        }
+        dst.data.assign(
+            bytes.begin() + level.byteOffset, bytes.begin() + level.byteOffset + level.byteLength);
+    }
+    return true;
+}
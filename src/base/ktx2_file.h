@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "bcn_encoder.h"
+
+// minimal KTX2 container for a CompressedImage: one layer, one face, no supercompression.
+// the modification time of the source image is kept in the key/value data, so that a
+// file written for an older version of the source can be told apart.
+class Ktx2File {
+public:
+    static bool write(const std::string& path, const CompressedImage& image, int64_t sourceTime);
+
+    // reads path into image, returns false if it is missing, corrupted or not written by write()
+    static bool read(const std::string& path, CompressedImage& image, int64_t& sourceTime);
+};
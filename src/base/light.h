@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cmath>
+#include <limits>
+
 #include "transform.h"
 
 struct Light {
@@ -13,6 +16,18 @@ struct Light {
 
 //struct AmbientLight : public Light {};
 
+// distance at which the attenuation 1 / (kc + kl * d + kq * d^2) falls to cutoff
+inline float getAttenuationRange(float kc, float kl, float kq, float cutoff) {
+    const float c = kc - 1.0f / cutoff;
+    if (c >= 0.0f) {
+        return 0.0f;
+    }
+    if (kq > 0.0f) {
+        return (-kl + std::sqrt(kl * kl - 4.0f * kq * c)) / (2.0f * kq);
+    }
+    return kl > 0.0f ? -c / kl : std::numeric_limits<float>::infinity();
+}
+
 struct DirectionalLight : public Light {
     glm::vec3 position;
     glm::vec3 direction = glm::vec3(1.0f,1.0f,1.0f);
@@ -28,15 +43,27 @@ struct PointLight : public Light {
     float kc = 0.3f;
     float kl = 0.09f;
     float kq = 0.0032f;
+
+    // distance at which the attenuation 1 / (kc + kl * d + kq * d^2) falls to cutoff
+    float getRange(float cutoff = 1.0f / 256.0f) const {
+        return getAttenuationRange(kc, kl, kq, cutoff);
+    }
 };
 
 struct SpotLight : public Light {
-    glm::vec3 position;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
+    glm::vec3 position  = glm::vec3(0.0f, 5.0f, 0.0f);
+    // the cone points along direction, angle is its half opening
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    glm::vec3 ambient   = glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::vec3 diffuse   = glm::vec3(0.8f, 0.8f, 0.8f);
+    glm::vec3 specular  = glm::vec3(1.0f, 1.0f, 1.0f);
     float angle = glm::radians(60.0f);
     float kc = 1.0f;
     float kl = 0.0f;
     float kq = 1.0f;
+
+    // same as PointLight::getRange, along the cone
+    float getRange(float cutoff = 1.0f / 256.0f) const {
+        return getAttenuationRange(kc, kl, kq, cutoff);
+    }
 };
\ No newline at end of file
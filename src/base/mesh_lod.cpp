@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "mesh_lod.h"
+#include "mesh_optimizer.h"
+
+namespace {
+// levels must lose at least this share of the triangles of the level before to be kept
+constexpr float kMinLodReduction = 0.25f;
+// meshes with fewer triangles are not simplified further
+constexpr size_t kMinLodTriangles = 32;
+
+// symmetric 4x4 matrix of the squared distance to a set of planes, weighted by triangle area
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    static Quadric fromPlane(const glm::dvec3& n, double d, double weight) {
+        Quadric q;
+        q.a00 = weight * n.x * n.x;
+        q.a01 = weight * n.x * n.y;
+        q.a02 = weight * n.x * n.z;
+        q.a11 = weight * n.y * n.y;
+        q.a12 = weight * n.y * n.z;
+        q.a22 = weight * n.z * n.z;
+        q.b0 = weight * n.x * d;
+        q.b1 = weight * n.y * d;
+        q.b2 = weight * n.z * d;
+        q.c = weight * d * d;
+        q.weight = weight;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& q) {
+        a00 += q.a00, a01 += q.a01, a02 += q.a02, a11 += q.a11, a12 += q.a12, a22 += q.a22;
+        b0 += q.b0, b1 += q.b1, b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+        return *this;
+    }
+
+    // weighted sum of squared distances of p to the planes
+    double evaluate(const glm::vec3& p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        const double result = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+            + 2 * (b0 * x + b1 * y + b2 * z) + c;
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+glm::vec3 triangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+    return glm::cross(p1 - p0, p2 - p0);
+}
+
+// vertices at the same position, with the state that decides how they may collapse
+struct PositionGroups {
+    // first vertex at the position of every vertex, quadrics are kept per position
+    std::vector<uint32_t> position;
+    // the other vertex of a two vertex attribute seam, ~0u if the position has a single vertex
+    std::vector<uint32_t> sibling;
+    // vertices on open borders and where more than two vertices meet never move
+    std::vector<char> locked;
+};
+
+PositionGroups findPositionGroups(const Vertex* vertices, size_t vertexCount, const uint32_t* indices,
+    size_t indexCount) {
+    PositionGroups groups;
+    groups.position.resize(vertexCount);
+    groups.sibling.assign(vertexCount, ~0u);
+    groups.locked.assign(vertexCount, 0);
+
+    std::unordered_map<glm::vec3, uint32_t> firstAtPosition;
+    firstAtPosition.reserve(vertexCount);
+    std::vector<uint32_t> groupSize(vertexCount, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        const uint32_t first = firstAtPosition.try_emplace(vertices[v].Position, v).first->second;
+        groups.position[v] = first;
+        if (first != v) {
+            groups.sibling[v] = first;
+            groups.sibling[first] = v;
+        }
+        groupSize[first]++;
+    }
+
+    // borders are found on positions, so that seams, which are open at the vertex level, are not borders
+    std::unordered_set<uint64_t> edges;
+    edges.reserve(indexCount);
+    auto edgeKey = [&](uint32_t a, uint32_t b) {
+        return (static_cast<uint64_t>(groups.position[a]) << 32) | groups.position[b];
+    };
+    for (size_t i = 0; i < indexCount; i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            edges.insert(edgeKey(indices[i + k], indices[i + (k + 1) % 3]));
+        }
+    }
+    std::vector<char> lockedPosition(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+            if (edges.count(edgeKey(b, a)) == 0) {
+                lockedPosition[groups.position[a]] = 1;
+                lockedPosition[groups.position[b]] = 1;
+            }
+        }
+    }
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        const uint32_t first = groups.position[v];
+        groups.locked[v] = lockedPosition[first] || groupSize[first] > 2;
+        if (groupSize[first] > 2) {
+            groups.sibling[v] = ~0u;
+        }
+    }
+    return groups;
+}
+} // namespace
+
+std::vector<uint32_t> simplifyMesh(const Vertex* vertices, size_t vertexCount, const uint32_t* indices,
+    size_t indexCount, size_t targetIndexCount, float& error) {
+    std::vector<uint32_t> result(indices, indices + indexCount);
+    error = 0.0f;
+
+    const PositionGroups groups = findPositionGroups(vertices, vertexCount, indices, indexCount);
+    const std::vector<uint32_t>& position = groups.position;
+    const std::vector<uint32_t>& sibling = groups.sibling;
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        const glm::dvec3 p0 = vertices[indices[i + 0]].Position;
+        const glm::dvec3 n = glm::cross(
+            glm::dvec3(vertices[indices[i + 1]].Position) - p0, glm::dvec3(vertices[indices[i + 2]].Position) - p0);
+        const double length = glm::length(n);
+        if (length == 0.0) {
+            continue;
+        }
+        const Quadric q = Quadric::fromPlane(n / length, -glm::dot(n / length, p0), 0.5 * length);
+        for (int k = 0; k < 3; ++k) {
+            quadrics[position[indices[i + k]]] += q;
+        }
+    }
+
+    std::vector<uint32_t> offsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<char> touched(vertexCount);
+    std::vector<Collapse> collapses;
+    double maxError = 0.0;
+
+    // counts the triangles around from that contain to and vanish, false if moving from onto to flips another
+    auto testCollapse = [&](uint32_t from, uint32_t to, size_t& collapsed) {
+        const glm::vec3& target = vertices[to].Position;
+        collapsed = 0;
+        for (uint32_t a = offsets[from]; a < offsets[from + 1]; ++a) {
+            const uint32_t* triangle = result.data() + adjacency[a] * 3;
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                ++collapsed;
+                continue;
+            }
+            glm::vec3 before[3], after[3];
+            for (int k = 0; k < 3; ++k) {
+                before[k] = vertices[triangle[k]].Position;
+                after[k] = triangle[k] == from ? target : before[k];
+            }
+            if (glm::dot(triangleNormal(before[0], before[1], before[2]), triangleNormal(after[0], after[1], after[2]))
+                <= 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto touchNeighbourhood = [&](uint32_t v) {
+        for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a) {
+            const uint32_t* triangle = result.data() + adjacency[a] * 3;
+            touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+        }
+    };
+    // seam vertices move together with their sibling, and only along the seam
+    auto canMove = [&](uint32_t from, uint32_t to) {
+        return !groups.locked[from] && position[from] != position[to]
+            && (sibling[from] == ~0u || sibling[to] != ~0u);
+    };
+
+    // every pass collapses the cheapest edges of the current mesh, at most one per vertex neighbourhood,
+    // so that the triangles around a collapse are the ones the flip test saw
+    while (result.size() > targetIndexCount) {
+        const size_t triangleCount = result.size() / 3;
+
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (uint32_t v : result) {
+            offsets[v + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i) {
+            adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+                Quadric q = quadrics[position[a]];
+                q += quadrics[position[b]];
+                if (canMove(a, b)) {
+                    collapses.push_back({ a, b, q.evaluate(vertices[b].Position) });
+                }
+                if (canMove(b, a)) {
+                    collapses.push_back({ b, a, q.evaluate(vertices[a].Position) });
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            remap[v] = v;
+        }
+        std::fill(touched.begin(), touched.end(), 0);
+
+        const size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+        // the expensive half is left for the next pass, whose costs account for this one's collapses
+        const size_t candidateCount = std::max<size_t>(collapses.size() / 2, 1);
+        size_t removed = 0;
+        for (size_t c = 0; c < candidateCount && removed < trianglesToRemove; ++c) {
+            const uint32_t from = collapses[c].from, to = collapses[c].to;
+            const uint32_t fromSibling = sibling[from], toSibling = sibling[to];
+            if (touched[from] || touched[to]
+                || (fromSibling != ~0u && (touched[fromSibling] || touched[toSibling]))) {
+                continue;
+            }
+
+            size_t collapsed = 0, siblingCollapsed = 0;
+            if (!testCollapse(from, to, collapsed) || collapsed == 0) {
+                continue;
+            }
+            // the siblings share an edge only if from and to lie on the same seam
+            if (fromSibling != ~0u && (!testCollapse(fromSibling, toSibling, siblingCollapsed) || siblingCollapsed == 0)) {
+                continue;
+            }
+
+            touchNeighbourhood(from);
+            remap[from] = to;
+            if (fromSibling != ~0u) {
+                touchNeighbourhood(fromSibling);
+                remap[fromSibling] = toSibling;
+            }
+            quadrics[position[to]] += quadrics[position[from]];
+            removed += collapsed + siblingCollapsed;
+
+            const double weight = quadrics[position[to]].weight;
+            maxError = std::max(maxError, weight > 0.0 ? collapses[c].cost / weight : 0.0);
+        }
+        if (removed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a != b && b != c && a != c) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    error = static_cast<float>(std::sqrt(maxError));
+    return result;
+}
+
+std::vector<MeshLod> buildLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t maxLods) {
+    std::vector<MeshLod> lods;
+    lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+    const size_t baseIndexCount = indices.size();
+    for (size_t level = 1; level < maxLods; ++level) {
+        const size_t targetTriangles = baseIndexCount / 3 >> level;
+        if (targetTriangles < kMinLodTriangles) {
+            break;
+        }
+
+        // every level starts from LOD0 so that the errors do not pile up over the chain
+        float error = 0.0f;
+        std::vector<uint32_t> lod
+            = simplifyMesh(vertices.data(), vertices.size(), indices.data(), baseIndexCount, targetTriangles * 3, error);
+        if (lod.size() > (1.0f - kMinLodReduction) * lods.back().indexCount) {
+            break;
+        }
+        optimizeVertexCache(lod.data(), lod.size(), vertices.size(), kVertexCacheSize);
+
+        lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.size()),
+            std::max(error, lods.back().error) });
+        indices.insert(indices.end(), lod.begin(), lod.end());
+    }
+    return lods;
+}
+
+size_t selectLod(const MeshLod* lods, size_t lodCount, float pixelsPerUnit, float maxErrorPixels) {
+    size_t level = 0;
+    while (level + 1 < lodCount && lods[level + 1].error * pixelsPerUnit <= maxErrorPixels) {
+        ++level;
+    }
+    return level;
+}
+
+float getPixelsPerUnit(float distance, float fovy, float viewportHeight) {
+    return viewportHeight / (2.0f * std::tan(0.5f * fovy) * std::max(distance, 1e-4f));
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vertex.h"
+
+constexpr size_t kMaxLodCount = 5;
+
+// one level of detail, a run of triangles in the index buffer of a mesh that shares the vertices of LOD0
+struct MeshLod {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    // largest distance in model space the level may deviate from LOD0
+    float error = 0.0f;
+};
+
+// simplifies a triangle list towards targetIndexCount indices with quadric error edge collapses
+// (Garland and Heckbert 1997). vertices only collapse onto other vertices, so the result indexes the same
+// vertex buffer. vertices on borders and on attribute seams are never moved.
+// error receives the geometric error of the result as a distance in model space.
+std::vector<uint32_t> simplifyMesh(const Vertex* vertices, size_t vertexCount, const uint32_t* indices,
+    size_t indexCount, size_t targetIndexCount, float& error);
+
+// appends up to maxLods - 1 coarser levels, each with about half the triangles of the one before, after
+// the indices of LOD0. stops early once a level no longer gets noticeably smaller. returns all levels, LOD0 first.
+std::vector<MeshLod> buildLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+    size_t maxLods = kMaxLodCount);
+
+// coarsest level whose error, scaled by pixelsPerUnit, stays within maxErrorPixels
+size_t selectLod(const MeshLod* lods, size_t lodCount, float pixelsPerUnit, float maxErrorPixels);
+
+// pixels one unit covers at distance for a vertical field of view fovy in radians and a viewport viewportHeight high
+float getPixelsPerUnit(float distance, float fovy, float viewportHeight);
@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "mesh_optimizer.h"
+
+namespace {
+constexpr int64_t kNoVertex = -1;
+
+// triangles around every vertex in compressed rows, adjacency[offsets[v]..offsets[v + 1]) are the triangles of v
+struct Adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+Adjacency buildAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    Adjacency adjacency;
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+        adjacency.offsets[indices[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacency.offsets[v + 1] += adjacency.offsets[v];
+    }
+
+    adjacency.triangles.resize(indexCount);
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (size_t i = 0; i < indexCount; ++i) {
+        adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    return adjacency;
+}
+
+// outward facing, far from the center clusters first: they are the most likely occluders
+float getOcclusionKey(const uint32_t* indices, size_t begin, size_t end, const Vertex* vertices,
+    const glm::vec3& meshCenter) {
+    glm::vec3 center(0.0f), normal(0.0f);
+    float area = 0.0f;
+    for (size_t i = begin; i < end; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i + 0]].Position;
+        const glm::vec3& p1 = vertices[indices[i + 1]].Position;
+        const glm::vec3& p2 = vertices[indices[i + 2]].Position;
+        const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        const float a = glm::length(n);
+        center += (p0 + p1 + p2) * (a / 3.0f);
+        normal += n;
+        area += a;
+    }
+    const float normalLength = glm::length(normal);
+    if (area == 0.0f || normalLength == 0.0f) {
+        return 0.0f;
+    }
+    return glm::dot(center / area - meshCenter, normal / normalLength);
+}
+float quantize(float v, float epsilon) {
+    return epsilon > 0.0f ? std::round(v / epsilon) * epsilon : v;
+}
+
+Vertex quantize(const Vertex& v, float epsilon) {
+    Vertex q = v;
+    for (int i = 0; i < 3; ++i) {
+        q.Position[i] = quantize(v.Position[i], epsilon);
+        q.Normal[i] = quantize(v.Normal[i], epsilon);
+        q.Tangent[i] = quantize(v.Tangent[i], epsilon);
+        q.Bitangent[i] = quantize(v.Bitangent[i], epsilon);
+    }
+    q.TexCoords = glm::vec2(quantize(v.TexCoords.x, epsilon), quantize(v.TexCoords.y, epsilon));
+    for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
+        q.m_Weights[i] = quantize(v.m_Weights[i], epsilon);
+    }
+    return q;
+}
+
+// Vertex::operator== leaves out the bone data, welding must not merge differently skinned vertices
+struct WeldEqual {
+    bool operator()(const Vertex& a, const Vertex& b) const {
+        return a == b && std::memcmp(a.m_BoneIDs, b.m_BoneIDs, sizeof(a.m_BoneIDs)) == 0
+            && std::memcmp(a.m_Weights, b.m_Weights, sizeof(a.m_Weights)) == 0;
+    }
+};
+} // namespace
+
+size_t weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float epsilon, ThreadPool& pool) {
+    const size_t vertexCount = vertices.size();
+    if (vertexCount < 2) {
+        return 0;
+    }
+
+    // quantized keys and their hashes, in chunks on the pool
+    constexpr size_t kChunkSize = 4096;
+    std::vector<Vertex> keys(vertexCount);
+    std::vector<size_t> hashes(vertexCount);
+    pool.parallelFor((vertexCount + kChunkSize - 1) / kChunkSize, [&](size_t chunk) {
+        const size_t end = std::min(vertexCount, (chunk + 1) * kChunkSize);
+        for (size_t i = chunk * kChunkSize; i < end; ++i) {
+            keys[i] = quantize(vertices[i], epsilon);
+            hashes[i] = std::hash<Vertex>()(keys[i]);
+        }
+    });
+
+    // equal keys have equal hashes, so the vertices are split into shards by hash and every shard is
+    // deduplicated on its own. shards list their vertices in ascending order, the first one of a group wins.
+    constexpr size_t kShardCount = 64;
+    std::vector<uint32_t> shardOffsets(kShardCount + 1, 0);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        shardOffsets[hashes[i] % kShardCount + 1]++;
+    }
+    for (size_t shard = 0; shard < kShardCount; ++shard) {
+        shardOffsets[shard + 1] += shardOffsets[shard];
+    }
+    std::vector<uint32_t> shardVertices(vertexCount);
+    std::vector<uint32_t> fill(shardOffsets.begin(), shardOffsets.end() - 1);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        shardVertices[fill[hashes[i] % kShardCount]++] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<uint32_t> representative(vertexCount);
+    pool.parallelFor(kShardCount, [&](size_t shard) {
+        std::unordered_map<Vertex, uint32_t, std::hash<Vertex>, WeldEqual> unique;
+        unique.reserve(shardOffsets[shard + 1] - shardOffsets[shard]);
+        for (uint32_t k = shardOffsets[shard]; k < shardOffsets[shard + 1]; ++k) {
+            const uint32_t i = shardVertices[k];
+            representative[i] = unique.try_emplace(keys[i], i).first->second;
+        }
+    });
+
+    // compact the kept vertices in their original order and rebuild the indices
+    std::vector<uint32_t> remap(vertexCount);
+    size_t kept = 0;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        if (representative[i] == i) {
+            vertices[kept] = vertices[i];
+            remap[i] = static_cast<uint32_t>(kept++);
+        } else {
+            remap[i] = remap[representative[i]];
+        }
+    }
+    vertices.resize(kept);
+    for (auto& index : indices) {
+        index = remap[index];
+    }
+    return vertexCount - kept;
+}
+
+VertexCacheStats analyzeVertexCache(
+    const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0) {
+        return stats;
+    }
+
+    // a vertex is in the FIFO if it missed within the last cacheSize misses
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    size_t time = cacheSize + 1;
+    size_t transformed = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        const uint32_t v = indices[i];
+        if (time - cacheTime[v] > cacheSize) {
+            cacheTime[v] = time++;
+            ++transformed;
+        }
+    }
+
+    stats.acmr = static_cast<float>(transformed) / static_cast<float>(indexCount / 3);
+    stats.atvr = static_cast<float>(transformed) / static_cast<float>(vertexCount);
+    return stats;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize,
+    std::vector<size_t>* clusters) {
+    if (clusters) {
+        clusters->clear();
+    }
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    const Adjacency adjacency = buildAdjacency(indices, triangleCount * 3, vertexCount);
+    std::vector<uint32_t> liveCount(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        liveCount[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    deadEnd.reserve(triangleCount * 3);
+    result.reserve(triangleCount * 3);
+
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+    bool flushed = true;
+    while (cursor < vertexCount && liveCount[cursor] == 0) {
+        ++cursor;
+    }
+    int64_t fanning = cursor < vertexCount ? static_cast<int64_t>(cursor) : kNoVertex;
+
+    while (fanning != kNoVertex) {
+        if (flushed && clusters) {
+            clusters->push_back(result.size());
+        }
+        flushed = false;
+
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; ++a) {
+            const uint32_t t = adjacency.triangles[a];
+            if (emitted[t]) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t v = indices[t * 3 + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[t] = 1;
+        }
+
+        // continue with the oldest candidate that is still cached after its remaining triangles
+        fanning = kNoVertex;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveCount[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            const size_t age = time - cacheTime[v];
+            if (age + 2 * liveCount[v] <= cacheSize) {
+                priority = static_cast<int64_t>(age);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+        if (fanning != kNoVertex) {
+            continue;
+        }
+
+        // dead end: take the most recently used vertex with triangles left, then the next one in input order
+        while (!deadEnd.empty()) {
+            const uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveCount[v] > 0) {
+                fanning = v;
+                break;
+            }
+        }
+        if (fanning == kNoVertex) {
+            while (cursor < vertexCount && liveCount[cursor] == 0) {
+                ++cursor;
+            }
+            fanning = cursor < vertexCount ? static_cast<int64_t>(cursor) : kNoVertex;
+        }
+        flushed = fanning != kNoVertex && time - cacheTime[fanning] > cacheSize;
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+    const std::vector<size_t>& clusters, float threshold) {
+    if (clusters.size() < 2 || indexCount < 3) {
+        return;
+    }
+
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i + 0]].Position;
+        const glm::vec3& p1 = vertices[indices[i + 1]].Position;
+        const glm::vec3& p2 = vertices[indices[i + 2]].Position;
+        const float a = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCenter += (p0 + p1 + p2) * (a / 3.0f);
+        meshArea += a;
+    }
+    if (meshArea > 0.0f) {
+        meshCenter /= meshArea;
+    }
+
+    struct Cluster {
+        size_t begin;
+        size_t end;
+        float key;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        sorted[c].begin = clusters[c];
+        sorted[c].end = c + 1 < clusters.size() ? clusters[c + 1] : indexCount;
+        sorted[c].key = getOcclusionKey(indices, sorted[c].begin, sorted[c].end, vertices, meshCenter);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+        return a.key > b.key;
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indexCount);
+    for (const auto& cluster : sorted) {
+        result.insert(result.end(), indices + cluster.begin, indices + cluster.end);
+    }
+
+    const float before = analyzeVertexCache(indices, indexCount, vertexCount).acmr;
+    const float after = analyzeVertexCache(result.data(), result.size(), vertexCount).acmr;
+    if (after <= before * threshold) {
+        std::copy(result.begin(), result.end(), indices);
+    }
+}
+
+size_t optimizeVertexFetch(Vertex* vertices, size_t vertexCount, uint32_t* indices, size_t indexCount) {
+    constexpr uint32_t kUnused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, kUnused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t& index = remap[indices[i]];
+        if (index == kUnused) {
+            index = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[indices[i]]);
+        }
+        indices[i] = index;
+    }
+
+    std::copy(reordered.begin(), reordered.end(), vertices);
+    return reordered.size();
+}
+
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<size_t> clusters;
+    optimizeVertexCache(indices.data(), indices.size(), vertices.size(), kVertexCacheSize, &clusters);
+    optimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertices.size(), clusters, 1.05f);
+    vertices.resize(optimizeVertexFetch(vertices.data(), vertices.size(), indices.data(), indices.size()));
+}
+
+std::vector<uint16_t> narrowIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    if (!hasShortIndices(vertexCount)) {
+        return {};
+    }
+    return std::vector<uint16_t>(indices, indices + indexCount);
+}
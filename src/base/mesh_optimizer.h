@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "thread_pool.h"
+#include "vertex.h"
+
+// efficiency of an index buffer on a simulated FIFO post-transform cache
+struct VertexCacheStats {
+    // transformed vertices per triangle, 0.5 is the lower bound of a regular grid, 3 the worst case
+    float acmr = 0.0f;
+    // transformed vertices per vertex, 1 means every vertex is shaded exactly once
+    float atvr = 0.0f;
+};
+
+// merges vertices that are equal after rounding every float to a multiple of epsilon (exact match for 0)
+// and rebuilds the index buffer. equal vertices are found with std::hash<Vertex> and Vertex::operator==,
+// bone data has to match exactly. the first vertex of every group is kept unchanged.
+// returns the number of vertices removed.
+size_t weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float epsilon, ThreadPool& pool);
+
+// FIFO size the optimizer targets and the stats are measured with
+constexpr size_t kVertexCacheSize = 16;
+
+VertexCacheStats analyzeVertexCache(
+    const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize = kVertexCacheSize);
+
+// reorders the triangles for the post-transform cache with Tipsify (Sander et al. 2007).
+// clusters receives the first index of every run that starts after a cache flush; these
+// runs can be reordered freely by optimizeOverdraw without hurting the cache.
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize,
+    std::vector<size_t>* clusters = nullptr);
+
+// sorts the clusters so that the outward facing ones, which occlude the rest of the mesh, are drawn
+// first. the order is kept only if the ACMR does not grow by more than threshold (e.g. 1.05).
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+    const std::vector<size_t>& clusters, float threshold);
+
+// renumbers the vertices in the order the index buffer first uses them and drops the unreferenced ones.
+// returns the new vertex count, vertices is compacted in place.
+size_t optimizeVertexFetch(Vertex* vertices, size_t vertexCount, uint32_t* indices, size_t indexCount);
+
+// runs the three stages above on a triangle list
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// meshes with fewer than 65536 vertices are drawn with 16 bit indices
+inline bool hasShortIndices(size_t vertexCount) {
+    return vertexCount < 65536;
+}
+
+// index data narrowed to 16 bit if hasShortIndices, empty otherwise
+std::vector<uint16_t> narrowIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount);
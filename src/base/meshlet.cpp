@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "meshlet.h"
+
+namespace {
+// narrower cones than this are not worth testing, they would hardly ever cull
+constexpr float kMinConeDot = 0.1f;
+
+void computeBounds(Meshlet& meshlet, const Vertex* vertices, const uint32_t* indices) {
+    const uint32_t end = meshlet.indexOffset + meshlet.indexCount;
+
+    glm::vec3 minPoint(std::numeric_limits<float>::max()), maxPoint(-std::numeric_limits<float>::max());
+    for (uint32_t i = meshlet.indexOffset; i < end; ++i) {
+        minPoint = glm::min(minPoint, vertices[indices[i]].Position);
+        maxPoint = glm::max(maxPoint, vertices[indices[i]].Position);
+    }
+    meshlet.center = 0.5f * (minPoint + maxPoint);
+    float radius2 = 0.0f;
+    for (uint32_t i = meshlet.indexOffset; i < end; ++i) {
+        const glm::vec3 d = vertices[indices[i]].Position - meshlet.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    meshlet.radius = std::sqrt(radius2);
+
+    // the cone axis is the average face normal, its spread the widest angle to any face normal
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = meshlet.indexOffset; i < end; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i + 0]].Position;
+        const glm::vec3 n = glm::cross(vertices[indices[i + 1]].Position - p0, vertices[indices[i + 2]].Position - p0);
+        const float length = glm::length(n);
+        if (length > 0.0f) {
+            axis += n / length;
+        }
+    }
+    const float axisLength = glm::length(axis);
+    if (axisLength == 0.0f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    float apexDistance = 0.0f;
+    for (uint32_t i = meshlet.indexOffset; i < end; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i + 0]].Position;
+        const glm::vec3 n = glm::cross(vertices[indices[i + 1]].Position - p0, vertices[indices[i + 2]].Position - p0);
+        const float length = glm::length(n);
+        if (length == 0.0f) {
+            continue;
+        }
+        const float d = glm::dot(n / length, axis);
+        minDot = std::min(minDot, d);
+        // move the apex back along the axis until it lies behind the plane of every triangle
+        if (d > 0.0f) {
+            apexDistance = std::max(apexDistance, glm::dot(meshlet.center - p0, n / length) / d);
+        }
+    }
+    if (minDot <= kMinConeDot) {
+        return;
+    }
+
+    meshlet.coneAxis = axis;
+    meshlet.coneApex = meshlet.center - axis * apexDistance;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+} // namespace
+
+std::vector<Meshlet> buildMeshlets(const Vertex* vertices, size_t vertexCount, uint32_t* indices,
+    size_t indexCount, size_t maxVertices, size_t maxTriangles) {
+    std::vector<Meshlet> meshlets;
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return meshlets;
+    }
+
+    // triangles around every vertex in compressed rows
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        offsets[indices[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const glm::vec3& p0 = vertices[indices[t * 3]].Position;
+        const glm::vec3 n = glm::cross(vertices[indices[t * 3 + 1]].Position - p0, vertices[indices[t * 3 + 2]].Position - p0);
+        const float length = glm::length(n);
+        normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+    }
+
+    // meshlet that used a vertex last, so the unique vertices of the current one are counted without a set
+    std::vector<uint32_t> owner(vertexCount, ~0u);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    size_t seed = 0;
+
+    auto countNew = [&](uint32_t t, uint32_t current) {
+        const uint32_t* triangle = indices + t * 3;
+        size_t count = 0;
+        for (int k = 0; k < 3; ++k) {
+            const bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+            if (!repeated && owner[triangle[k]] != current) {
+                ++count;
+            }
+        }
+        return count;
+    };
+
+    // grow every meshlet from a seed over neighbouring triangles, preferring the ones that add the fewest
+    // vertices and then the ones closest to the average normal, which keeps the normal cones narrow
+    while (true) {
+        while (seed < triangleCount && emitted[seed]) {
+            ++seed;
+        }
+        if (seed == triangleCount) {
+            break;
+        }
+
+        const uint32_t current = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet;
+        meshlet.indexOffset = static_cast<uint32_t>(result.size());
+        meshletVertices.clear();
+        glm::vec3 axis(0.0f);
+
+        uint32_t next = static_cast<uint32_t>(seed);
+        while (true) {
+            const uint32_t* triangle = indices + next * 3;
+            for (int k = 0; k < 3; ++k) {
+                if (owner[triangle[k]] != current) {
+                    owner[triangle[k]] = current;
+                    meshletVertices.push_back(triangle[k]);
+                }
+                result.push_back(triangle[k]);
+            }
+            emitted[next] = 1;
+            meshlet.indexCount += 3;
+            axis += normals[next];
+            if (meshlet.indexCount / 3 >= maxTriangles) {
+                break;
+            }
+
+            const float axisLength = glm::length(axis);
+            const glm::vec3 direction = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f);
+            float bestScore = std::numeric_limits<float>::max();
+            uint32_t best = ~0u;
+            for (uint32_t v : meshletVertices) {
+                for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a) {
+                    const uint32_t t = adjacency[a];
+                    if (emitted[t]) {
+                        continue;
+                    }
+                    const size_t added = countNew(t, current);
+                    if (meshletVertices.size() + added > maxVertices) {
+                        continue;
+                    }
+                    const float score = static_cast<float>(added) + (1.0f - glm::dot(normals[t], direction));
+                    if (score < bestScore) {
+                        bestScore = score;
+                        best = t;
+                    }
+                }
+            }
+            if (best == ~0u) {
+                break;
+            }
+            next = best;
+        }
+
+        meshlets.push_back(meshlet);
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+    for (auto& meshlet : meshlets) {
+        computeBounds(meshlet, vertices, indices);
+    }
+    return meshlets;
+}
+
+size_t cullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::mat4& model,
+    const glm::vec3& cameraPosition, std::vector<IndexRange>& ranges, const OcclusionBuffer* occlusion,
+    const glm::mat4& viewProjection) {
+    // the cones are tested in model space: the sign of dot(p - camera, n) does not change under an affine model
+    // matrix if the normal is transformed with its inverse transpose, so no cone has to be transformed
+    const glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    const float scale = std::max(
+        { glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+
+    size_t triangles = 0;
+    for (const auto& meshlet : meshlets) {
+        if (meshlet.coneCutoff < 1.0f
+            && glm::dot(glm::normalize(meshlet.coneApex - localCamera), meshlet.coneAxis) >= meshlet.coneCutoff) {
+            continue;
+        }
+        const glm::vec3 center = glm::vec3(model * glm::vec4(meshlet.center, 1.0f));
+        if (!frustum.intersect(center, meshlet.radius * scale)) {
+            continue;
+        }
+        if (occlusion != nullptr && !occlusion->isVisible(center, glm::vec3(meshlet.radius * scale), viewProjection)) {
+            continue;
+        }
+
+        if (!ranges.empty() && ranges.back().first + ranges.back().count == meshlet.indexOffset) {
+            ranges.back().count += meshlet.indexCount;
+        } else {
+            ranges.push_back({ meshlet.indexOffset, meshlet.indexCount });
+        }
+        triangles += meshlet.indexCount / 3;
+    }
+    return triangles;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+#include "occlusion_buffer.h"
+#include "vertex.h"
+
+constexpr size_t kMeshletMaxVertices = 64;
+constexpr size_t kMeshletMaxTriangles = 124;
+
+// a contiguous run of triangles in the index buffer of a mesh, with bounds in model space
+struct Meshlet {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    // bounding sphere
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    // normal cone: the meshlet faces away from every camera with
+    // dot(normalize(coneApex - camera), coneAxis) >= coneCutoff. coneCutoff is 1 if the cone is too wide to cull
+    glm::vec3 coneApex = glm::vec3(0.0f);
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f;
+};
+
+// range of indices to draw, in indices from the start of the index buffer
+struct IndexRange {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+// splits a triangle list into meshlets of at most maxVertices unique vertices and maxTriangles triangles.
+// the triangles are reordered so that every meshlet is one contiguous run of indices.
+std::vector<Meshlet> buildMeshlets(const Vertex* vertices, size_t vertexCount, uint32_t* indices,
+    size_t indexCount, size_t maxVertices = kMeshletMaxVertices, size_t maxTriangles = kMeshletMaxTriangles);
+
+// appends the index ranges of the meshlets that intersect frustum and do not face away from cameraPosition,
+// both in world space. neighbouring meshlets are merged into one range. returns the triangles kept.
+// with an occlusion buffer rendered under viewProjection, the meshlets hidden in it are dropped too
+size_t cullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::mat4& model,
+    const glm::vec3& cameraPosition, std::vector<IndexRange>& ranges, const OcclusionBuffer* occlusion = nullptr,
+    const glm::mat4& viewProjection = glm::mat4(1.0f));
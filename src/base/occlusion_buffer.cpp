@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "occlusion_buffer.h"
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define OCCLUSION_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define OCCLUSION_SSE 1
+#endif
+
+namespace {
+constexpr float kEmptyDepth = std::numeric_limits<float>::infinity();
+// triangles are set up in chunks of this many, one task each
+constexpr size_t kChunkSize = 4096;
+// screen coordinates beyond this many pixels lose too much precision in the edge functions, such triangles are skipped
+constexpr float kMaxCoordinate = 4096.0f;
+// widen the coverage and depth margins against rounding in the edge and depth functions. the coverage margin
+// makes the edges inclusive, so a pixel center on the edge shared by two triangles is never left empty
+constexpr float kEdgeMargin = 1e-3f;
+constexpr float kDepthMargin = 1e-5f;
+} // namespace
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) {
+    resize(width, height);
+}
+
+void OcclusionBuffer::resize(int width, int height) {
+    _tilesX = std::max(1, (width + kTileSize - 1) / kTileSize);
+    _tilesY = std::max(1, (height + kTileSize - 1) / kTileSize);
+    _width = _tilesX * kTileSize;
+    _height = _tilesY * kTileSize;
+    _depth.resize(static_cast<size_t>(_width) * _height);
+    _tileDepth.resize(static_cast<size_t>(_tilesX) * _tilesY);
+    clear();
+}
+
+void OcclusionBuffer::clear() {
+    std::fill(_depth.begin(), _depth.end(), kEmptyDepth);
+    std::fill(_tileDepth.begin(), _tileDepth.end(), kEmptyDepth);
+    _occluders.clear();
+    _triangleCount = 0;
+}
+
+void OcclusionBuffer::addOccluder(const glm::vec3* positions, size_t stride, const uint32_t* indices, size_t count, const glm::mat4& clipMatrix) {
+    for (size_t first = 0; first < count; first += 3 * kChunkSize) {
+        _occluders.push_back({ positions, stride, indices + first, std::min(count - first, 3 * kChunkSize), clipMatrix });
+    }
+}
+
+void OcclusionBuffer::render(ThreadPool& pool) {
+    // the depth stays empty, and parallelFor takes at least one task
+    if (_occluders.empty()) {
+        return;
+    }
+    _triangles.resize(_occluders.size());
+    pool.parallelFor(_occluders.size(), [this](size_t i) { setupTriangles(_occluders[i], _triangles[i]); });
+    for (const auto& triangles : _triangles) {
+        _triangleCount += triangles.size();
+    }
+
+    // a band is one row of tiles, so no two tasks write the same pixel or tile
+    pool.parallelFor(static_cast<size_t>(_tilesY), [this](size_t band) {
+        const int minY = static_cast<int>(band) * kTileSize;
+        rasterizeBand(minY, minY + kTileSize - 1);
+    });
+    _occluders.clear();
+}
+
+void OcclusionBuffer::setupTriangles(const Occluder& occluder, std::vector<Triangle>& triangles) const {
+    triangles.clear();
+    const char* base = reinterpret_cast<const char*>(occluder.positions);
+    const glm::vec2 scale(0.5f * _width, 0.5f * _height);
+    for (size_t i = 0; i + 2 < occluder.count; i += 3) {
+        glm::vec2 p[3];
+        float z[3];
+        bool clipped = false;
+        for (int k = 0; k < 3; ++k) {
+            const glm::vec3& position = *reinterpret_cast<const glm::vec3*>(base + occluder.stride * occluder.indices[i + k]);
+            const glm::vec4 clip = occluder.clipMatrix * glm::vec4(position, 1.0f);
+            // only triangles entirely between the near and far plane, the others would need clipping
+            if (!(clip.w > 0.0f && clip.z >= -clip.w && clip.z <= clip.w)) {
+                clipped = true;
+                break;
+            }
+            const float invW = 1.0f / clip.w;
+            p[k] = (glm::vec2(clip) * invW + 1.0f) * scale;
+            z[k] = clip.z * invW;
+            if (std::abs(p[k].x) > kMaxCoordinate || std::abs(p[k].y) > kMaxCoordinate) {
+                clipped = true;
+                break;
+            }
+        }
+        if (clipped) {
+            continue;
+        }
+
+        // counter clockwise triangles face the view, back facing and degenerate ones are skipped
+        const float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+        if (!(area > 0.0f)) {
+            continue;
+        }
+
+        Triangle triangle;
+        triangle.minX = std::max(0, static_cast<int>(std::floor(std::min({ p[0].x, p[1].x, p[2].x }))));
+        triangle.maxX = std::min(_width - 1, static_cast<int>(std::floor(std::max({ p[0].x, p[1].x, p[2].x }))));
+        triangle.minY = std::max(0, static_cast<int>(std::floor(std::min({ p[0].y, p[1].y, p[2].y }))));
+        triangle.maxY = std::min(_height - 1, static_cast<int>(std::floor(std::max({ p[0].y, p[1].y, p[2].y }))));
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+            continue;
+        }
+
+        // edge k runs from vertex k to k + 1 and is positive inside, evaluated at pixel centers
+        for (int k = 0; k < 3; ++k) {
+            const glm::vec2& from = p[k];
+            const glm::vec2& to = p[(k + 1) % 3];
+            triangle.a[k] = from.y - to.y;
+            triangle.b[k] = to.x - from.x;
+            triangle.c[k] = -(triangle.a[k] * from.x + triangle.b[k] * from.y) + 0.5f * (triangle.a[k] + triangle.b[k]);
+            // the pixel is covered when its center is inside, like the GPU samples it
+            triangle.offset[k] = -kEdgeMargin * (std::abs(triangle.a[k]) + std::abs(triangle.b[k]));
+        }
+
+        // the weight of a vertex is the edge opposite to it over the area
+        const float invArea = 1.0f / area;
+        const glm::vec3 weightA = glm::vec3(triangle.a[1], triangle.a[2], triangle.a[0]) * invArea;
+        const glm::vec3 weightB = glm::vec3(triangle.b[1], triangle.b[2], triangle.b[0]) * invArea;
+        const glm::vec3 weightC = glm::vec3(triangle.c[1], triangle.c[2], triangle.c[0]) * invArea;
+        const glm::vec3 depth(z[0], z[1], z[2]);
+        triangle.z = glm::vec3(glm::dot(weightA, depth), glm::dot(weightB, depth), glm::dot(weightC, depth));
+        // farthest corner of the pixel, plus a margin for the rounding of the plane across the buffer
+        const float rounding = kDepthMargin * (std::abs(triangle.z.x) * _width + std::abs(triangle.z.y) * _height + std::abs(triangle.z.z));
+        triangle.z.z += 0.5f * (std::abs(triangle.z.x) + std::abs(triangle.z.y)) + rounding;
+        triangles.push_back(triangle);
+    }
+}
+
+void OcclusionBuffer::rasterizeBand(int minY, int maxY) {
+    for (const auto& triangles : _triangles) {
+        for (const Triangle& triangle : triangles) {
+            const int y0 = std::max(minY, triangle.minY);
+            const int y1 = std::min(maxY, triangle.maxY);
+            for (int y = y0; y <= y1; ++y) {
+                rasterizeRow(triangle, y, _depth.data() + static_cast<size_t>(y) * _width);
+            }
+        }
+    }
+
+    const int tileY = minY / kTileSize;
+    for (int tileX = 0; tileX < _tilesX; ++tileX) {
+        float farthest = -kEmptyDepth;
+        for (int y = minY; y <= maxY; ++y) {
+            const float* row = _depth.data() + static_cast<size_t>(y) * _width + tileX * kTileSize;
+            farthest = std::max(farthest, *std::max_element(row, row + kTileSize));
+        }
+        _tileDepth[static_cast<size_t>(tileY) * _tilesX + tileX] = farthest;
+    }
+}
+
+void OcclusionBuffer::rasterizeRow(const Triangle& triangle, int y, float* row) const {
+    const float fy = static_cast<float>(y);
+    float rowE[3];
+    for (int k = 0; k < 3; ++k) {
+        rowE[k] = triangle.b[k] * fy + triangle.c[k];
+    }
+    const float rowZ = triangle.z.y * fy + triangle.z.z;
+
+    // narrow the bounding box to the span of the row the edges leave, with a pixel of slack as the pixels are
+    // still tested one by one below
+    float spanMin = static_cast<float>(triangle.minX);
+    float spanMax = static_cast<float>(triangle.maxX);
+    for (int k = 0; k < 3; ++k) {
+        const float bound = triangle.offset[k] - rowE[k];
+        if (triangle.a[k] > 0.0f) {
+            spanMin = std::max(spanMin, bound / triangle.a[k] - 1.0f);
+        } else if (triangle.a[k] < 0.0f) {
+            spanMax = std::min(spanMax, bound / triangle.a[k] + 1.0f);
+        } else if (bound > 0.0f) {
+            return;
+        }
+    }
+    if (!(spanMin <= spanMax)) {
+        return;
+    }
+    int x = static_cast<int>(spanMin);
+    const int maxX = static_cast<int>(spanMax);
+
+#if defined(OCCLUSION_AVX)
+    // rows are whole tiles wide, so aligning down to 8 pixels stays inside the row
+    x &= ~7;
+    const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 a[3], e[3], offset[3];
+    for (int k = 0; k < 3; ++k) {
+        a[k] = _mm256_set1_ps(triangle.a[k]);
+        offset[k] = _mm256_set1_ps(triangle.offset[k]);
+    }
+    const __m256 zx = _mm256_set1_ps(triangle.z.x);
+    for (; x <= maxX; x += 8) {
+        const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lanes);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int k = 0; k < 3; ++k) {
+            e[k] = _mm256_add_ps(_mm256_mul_ps(a[k], px), _mm256_set1_ps(rowE[k]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(e[k], offset[k], _CMP_GE_OQ));
+        }
+        if (_mm256_movemask_ps(inside) == 0) {
+            continue;
+        }
+        const __m256 z = _mm256_add_ps(_mm256_mul_ps(zx, px), _mm256_set1_ps(rowZ));
+        const __m256 old = _mm256_loadu_ps(row + x);
+        _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, z), inside));
+    }
+#elif defined(OCCLUSION_SSE)
+    x &= ~3;
+    const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 a[3], offset[3];
+    for (int k = 0; k < 3; ++k) {
+        a[k] = _mm_set1_ps(triangle.a[k]);
+        offset[k] = _mm_set1_ps(triangle.offset[k]);
+    }
+    const __m128 zx = _mm_set1_ps(triangle.z.x);
+    for (; x <= maxX; x += 4) {
+        const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int k = 0; k < 3; ++k) {
+            const __m128 e = _mm_add_ps(_mm_mul_ps(a[k], px), _mm_set1_ps(rowE[k]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(e, offset[k]));
+        }
+        if (_mm_movemask_ps(inside) == 0) {
+            continue;
+        }
+        const __m128 z = _mm_add_ps(_mm_mul_ps(zx, px), _mm_set1_ps(rowZ));
+        const __m128 old = _mm_loadu_ps(row + x);
+        const __m128 nearer = _mm_min_ps(old, z);
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+    }
+#endif
+
+    // the pixels left over by the vector loop, in the same arithmetic order
+    for (; x <= maxX; ++x) {
+        const float px = static_cast<float>(x);
+        bool inside = true;
+        for (int k = 0; k < 3; ++k) {
+            inside = inside && triangle.a[k] * px + rowE[k] >= triangle.offset[k];
+        }
+        if (inside) {
+            row[x] = std::min(row[x], triangle.z.x * px + rowZ);
+        }
+    }
+}
+
+bool OcclusionBuffer::isVisible(const BoundingBox& box, const glm::mat4& clipMatrix) const {
+    const glm::vec3 center = 0.5f * (box.min + box.max);
+    const glm::vec3 extent = 0.5f * (box.max - box.min);
+    // the corners in clip space are the transformed center plus or minus the transformed extent axes
+    const glm::vec4 c = clipMatrix * glm::vec4(center, 1.0f);
+    const glm::vec4 ex = clipMatrix[0] * extent.x, ey = clipMatrix[1] * extent.y, ez = clipMatrix[2] * extent.z;
+
+    glm::vec2 minP(std::numeric_limits<float>::max()), maxP(-std::numeric_limits<float>::max());
+    float minZ = std::numeric_limits<float>::max();
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec4 clip = c + ((corner & 1) ? ex : -ex) + ((corner & 2) ? ey : -ey) + ((corner & 4) ? ez : -ez);
+        if (!(clip.w > 0.0f && clip.z >= -clip.w)) {
+            return true;
+        }
+        const float invW = 1.0f / clip.w;
+        const glm::vec2 p = (glm::vec2(clip) * invW + 1.0f) * glm::vec2(0.5f * _width, 0.5f * _height);
+        minP = glm::min(minP, p);
+        maxP = glm::max(maxP, p);
+        minZ = std::min(minZ, clip.z * invW);
+    }
+    return isRectVisible(minP.x, maxP.x, minP.y, maxP.y, minZ);
+}
+
+bool OcclusionBuffer::isVisible(const glm::vec3& center, const glm::vec3& extent, const glm::mat4& clipMatrix) const {
+    BoundingBox box;
+    box.min = center - extent;
+    box.max = center + extent;
+    return isVisible(box, clipMatrix);
+}
+
+bool OcclusionBuffer::isRectVisible(float minX, float maxX, float minY, float maxY, float depth) const {
+    // every pixel the rect touches, the part outside the buffer is outside the view
+    if (!(maxX >= 0.0f && maxY >= 0.0f && minX < _width && minY < _height)) {
+        return true;
+    }
+    const int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+    const int x1 = std::min(_width - 1, static_cast<int>(std::floor(maxX)));
+    const int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+    const int y1 = std::min(_height - 1, static_cast<int>(std::floor(maxY)));
+
+    for (int tileY = y0 / kTileSize; tileY <= y1 / kTileSize; ++tileY) {
+        for (int tileX = x0 / kTileSize; tileX <= x1 / kTileSize; ++tileX) {
+            if (_tileDepth[static_cast<size_t>(tileY) * _tilesX + tileX] < depth) {
+                continue;
+            }
+            const int ty0 = std::max(y0, tileY * kTileSize), ty1 = std::min(y1, tileY * kTileSize + kTileSize - 1);
+            const int tx0 = std::max(x0, tileX * kTileSize), tx1 = std::min(x1, tileX * kTileSize + kTileSize - 1);
+            for (int y = ty0; y <= ty1; ++y) {
+                for (int x = tx0; x <= tx1; ++x) {
+                    if (getDepth(x, y) >= depth) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+const char* OcclusionBuffer::getSimdName() {
+#if defined(OCCLUSION_AVX)
+    return "AVX";
+#elif defined(OCCLUSION_SSE)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
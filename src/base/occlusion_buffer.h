@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounding_box.h"
+#include "thread_pool.h"
+
+// low resolution depth buffer of occluders rasterized on the CPU, for rejecting boxes hidden behind them before
+// they are submitted. coverage is sampled at pixel centers like the GPU does, so the triangles of a mesh fill
+// their shared edges and small triangles of tessellated occluders still cover pixels. the depth is conservative:
+// a pixel takes the farthest depth of the triangle plane inside it, so a box is only reported hidden behind the
+// occluders as they are sampled at this resolution. a second level keeps the farthest depth of every tile of
+// 8 x 8 pixels, which rejects most boxes without reading the pixels. rows of 8 pixels are rasterized with AVX
+// (or 4 with SSE2, see RENDERER_AVX) and the bands of tile rows are rasterized on worker threads
+class OcclusionBuffer {
+public:
+    static constexpr int kTileSize = 8;
+
+    // width and height are rounded up to whole tiles
+    explicit OcclusionBuffer(int width = 256, int height = 144);
+
+    void resize(int width, int height);
+
+    int getWidth() const {
+        return _width;
+    }
+
+    int getHeight() const {
+        return _height;
+    }
+
+    // drops the occluders and empties the depth
+    void clear();
+
+    // queues the triangles of indices (count of them, 3 per triangle) over positions, which are stride bytes apart,
+    // for the next render. clipMatrix takes them to clip space (projection * view * model). the arrays are only
+    // read by render and have to live until then
+    void addOccluder(const glm::vec3* positions, size_t stride, const uint32_t* indices, size_t count, const glm::mat4& clipMatrix);
+
+    // transforms and rasterizes the queued occluders on pool and builds the tile level
+    void render(ThreadPool& pool);
+
+    // false if the box under clipMatrix is behind the occluders everywhere on screen. boxes crossing the near
+    // plane or leaving the buffer are always visible
+    bool isVisible(const BoundingBox& box, const glm::mat4& clipMatrix) const;
+
+    // same for a world space box as center and half extent, clipMatrix is projection * view
+    bool isVisible(const glm::vec3& center, const glm::vec3& extent, const glm::mat4& clipMatrix) const;
+
+    // normalized device depth of pixel (x, y), y up. empty pixels are infinitely far
+    float getDepth(int x, int y) const {
+        return _depth[static_cast<size_t>(y) * _width + x];
+    }
+
+    // triangles rasterized by the last render, after culling the back facing and clipped ones
+    size_t getTriangleCount() const {
+        return _triangleCount;
+    }
+
+    // name of the instruction set the rasterizer was compiled for
+    static const char* getSimdName();
+
+private:
+    struct Occluder {
+        const glm::vec3* positions;
+        size_t stride;
+        const uint32_t* indices;
+        size_t count;
+        glm::mat4 clipMatrix;
+    };
+
+    // screen space triangle set up for rasterization: edge functions e = a * x + b * y + c are >= offset
+    // for the pixels whose center they cover, depth = z.x * x + z.y * y + z.z is the farthest depth within the pixel
+    struct Triangle {
+        float a[3], b[3], c[3];
+        float offset[3];
+        glm::vec3 z;
+        int minX, maxX, minY, maxY;
+    };
+
+    int _width = 0;
+    int _height = 0;
+    int _tilesX = 0;
+    int _tilesY = 0;
+    std::vector<float> _depth;
+    std::vector<float> _tileDepth;
+    std::vector<Occluder> _occluders;
+    // set up triangles of every occluder
+    std::vector<std::vector<Triangle>> _triangles;
+    size_t _triangleCount = 0;
+
+    void setupTriangles(const Occluder& occluder, std::vector<Triangle>& triangles) const;
+
+    // rasterizes all triangles into the pixel rows [minY, maxY] and updates their tiles
+    void rasterizeBand(int minY, int maxY);
+
+    void rasterizeRow(const Triangle& triangle, int y, float* row) const;
+
+    bool isRectVisible(float minX, float maxX, float minY, float maxY, float depth) const;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "bounding_box.h"
+
+// Ray Equation
+// P(t) = origin + t * direction, t >= 0. direction need not be normalized, distances are in units of it
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    // 1 / direction, inf for axis parallel rays
+    glm::vec3 invDirection;
+
+public:
+    Ray() : Ray(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)) {}
+    Ray(const glm::vec3& origin, const glm::vec3& direction)
+        : origin{origin}, direction{direction}, invDirection{1.0f / direction} {}
+
+    glm::vec3 getPoint(float t) const {
+        return origin + t * direction;
+    }
+
+    // the same ray in the space of matrix, t keeps its meaning since the direction is not renormalized
+    Ray transform(const glm::mat4& matrix) const {
+        return Ray(glm::vec3(matrix * glm::vec4(origin, 1.0f)), glm::vec3(matrix * glm::vec4(direction, 0.0f)));
+    }
+
+    // slab test, tEnter is the distance at which the ray enters the box (0 if it starts inside)
+    bool intersect(const BoundingBox& box, float tMax, float& tEnter) const {
+        const glm::vec3 t0 = (box.min - origin) * invDirection;
+        const glm::vec3 t1 = (box.max - origin) * invDirection;
+        const glm::vec3 tNear = glm::min(t0, t1);
+        const glm::vec3 tFar = glm::max(t0, t1);
+        tEnter = std::max(std::max(tNear.x, std::max(tNear.y, tNear.z)), 0.0f);
+        const float tExit = std::min(std::min(tFar.x, std::min(tFar.y, tFar.z)), tMax);
+        return tEnter <= tExit;
+    }
+
+    // Moller-Trumbore, both faces of the triangle count. t is only written on a hit closer than tMax
+    bool intersect(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float tMax, float& t) const {
+        const glm::vec3 ab = b - a, ac = c - a;
+        const glm::vec3 p = glm::cross(direction, ac);
+        const float det = glm::dot(ab, p);
+        if (std::abs(det) < std::numeric_limits<float>::min()) {
+            return false;
+        }
+        const float invDet = 1.0f / det;
+        const glm::vec3 s = origin - a;
+        const float u = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f) {
+            return false;
+        }
+        const glm::vec3 q = glm::cross(s, ab);
+        const float v = glm::dot(direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) {
+            return false;
+        }
+        const float hit = glm::dot(ac, q) * invDet;
+        if (hit < 0.0f || hit >= tMax) {
+            return false;
+        }
+        t = hit;
+        return true;
+    }
+};
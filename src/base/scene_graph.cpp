@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <cassert>
+
+#include "scene_graph.h"
+
+uint32_t SceneGraph::addNode(uint32_t parent, const glm::mat4& localMatrix) {
+    const uint32_t node = static_cast<uint32_t>(_parents.size());
+    assert(parent == kNoParent || parent < node);
+    _parents.push_back(parent);
+    _localMatrices.push_back(localMatrix);
+    _worldMatrices.push_back(localMatrix);
+    _dirty.push_back(1);
+    _firstDirty = std::min(_firstDirty, node);
+    return node;
+}
+
+void SceneGraph::clear() {
+    _parents.clear();
+    _localMatrices.clear();
+    _worldMatrices.clear();
+    _dirty.clear();
+    _firstDirty = 0;
+}
+
+void SceneGraph::setLocalMatrix(uint32_t node, const glm::mat4& localMatrix) {
+    if (_localMatrices[node] == localMatrix) {
+        return;
+    }
+    _localMatrices[node] = localMatrix;
+    _dirty[node] = 1;
+    _firstDirty = std::min(_firstDirty, node);
+}
+
+size_t SceneGraph::update() {
+    const uint32_t count = static_cast<uint32_t>(_parents.size());
+    size_t updated = 0;
+    // a parent comes before its children, so its flag and matrix are final when they are reached
+    for (uint32_t node = _firstDirty; node < count; ++node) {
+        const uint32_t parent = _parents[node];
+        if (parent != kNoParent && _dirty[parent]) {
+            _dirty[node] = 1;
+        }
+        if (!_dirty[node]) {
+            continue;
+        }
+        _worldMatrices[node] = parent == kNoParent ? _localMatrices[node] : _worldMatrices[parent] * _localMatrices[node];
+        ++updated;
+    }
+    // flags are cleared after the pass, the children above read them
+    std::fill(_dirty.begin() + std::min(_firstDirty, count), _dirty.end(), 0);
+    _firstDirty = count;
+    return updated;
+}
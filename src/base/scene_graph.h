@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// hierarchy of transforms. nodes are stored parents first, so one pass over the arrays in index order
+// updates every world matrix after the one of its parent. the world matrices live in one contiguous array
+// that the render passes read, and only nodes whose local matrix or an ancestor's changed are recomputed.
+class SceneGraph {
+public:
+    static constexpr uint32_t kNoParent = ~0u;
+
+    // appends a node below parent, which has to exist already (kNoParent for a root). returns its index
+    uint32_t addNode(uint32_t parent, const glm::mat4& localMatrix);
+
+    void clear();
+
+    size_t size() const {
+        return _parents.size();
+    }
+
+    uint32_t getParent(uint32_t node) const {
+        return _parents[node];
+    }
+
+    const glm::mat4& getLocalMatrix(uint32_t node) const {
+        return _localMatrices[node];
+    }
+
+    // marks the subtree of node for the next update, unless the matrix is the same
+    void setLocalMatrix(uint32_t node, const glm::mat4& localMatrix);
+
+    // valid after update() for all nodes added or changed before it
+    const glm::mat4& getWorldMatrix(uint32_t node) const {
+        return _worldMatrices[node];
+    }
+
+    const std::vector<glm::mat4>& getWorldMatrices() const {
+        return _worldMatrices;
+    }
+
+    // recomputes the world matrices of the dirty subtrees, once per frame. returns the number of nodes updated
+    size_t update();
+
+private:
+    std::vector<uint32_t> _parents;
+    std::vector<glm::mat4> _localMatrices;
+    std::vector<glm::mat4> _worldMatrices;
+    std::vector<uint8_t> _dirty;
+    // nodes before this one are clean, size() if all are
+    uint32_t _firstDirty = 0;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+#include "thread_pool.h"
+
+// fire and forget coroutine. it starts running as soon as it is called and its frame is
+// freed when the body returns, so the body has to handle its own errors.
+struct Task {
+    struct promise_type {
+        Task get_return_object() {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+// co_await schedule(pool) continues the coroutine on one of the pool workers
+inline auto schedule(ThreadPool& pool) {
+    struct Awaiter {
+        ThreadPool& pool;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            pool.submit([handle]() { handle.resume(); });
+        }
+
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{pool};
+}
+
+// coroutines waiting to be resumed by the thread that owns the queue, e.g. the render thread
+// for work that needs the GL context. co_await queue.schedule() suspends until the next drain.
+class TaskQueue {
+public:
+    TaskQueue() = default;
+
+    TaskQueue(const TaskQueue& rhs) = delete;
+
+    // coroutines still waiting are dropped, which runs the destructors of their locals
+    ~TaskQueue() {
+        for (auto handle : _handles) {
+            handle.destroy();
+        }
+    }
+
+    auto schedule() {
+        struct Awaiter {
+            TaskQueue& queue;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lock(queue._mutex);
+                queue._handles.push_back(handle);
+            }
+
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // resumes waiting coroutines on the calling thread until the queue is empty or the
+    // budget is used up. at least one coroutine is resumed per call, so loading always moves on.
+    size_t drain(float budgetMs) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        size_t resumed = 0;
+        while (true) {
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_handles.empty()) {
+                    break;
+                }
+                handle = _handles.front();
+                _handles.pop_front();
+            }
+            handle.resume();
+            ++resumed;
+
+            const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+            if (std::chrono::duration<float, std::milli>(elapsed).count() >= budgetMs) {
+                break;
+            }
+        }
+        return resumed;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _handles.size();
+    }
+
+private:
+    std::deque<std::coroutine_handle<>> _handles;
+    mutable std::mutex _mutex;
+};
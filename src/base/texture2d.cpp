@@ -1,9 +1,18 @@
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 #include <stb_image.h>
 
 #include "texture2d.h"
 
+// s3tc enums are not part of the generated core profile loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 Texture2D::Texture2D(
     GLint internalFormat, int width, int height, GLenum format, GLenum dataType, void* data) {
     glBindTexture(GL_TEXTURE_2D, _handle);
@@ -100,8 +109,72 @@ ImageTexture2D::ImageTexture2D(
     check();
 }
 
+ImageTexture2D::ImageTexture2D(const CompressedImage& image, const std::string& uri) : _uri(uri) {
+    if (image.empty()) {
+        cleanup();
+        throw std::runtime_error("empty compressed image " + uri);
+    }
+
+    _width = image.levels[0].width;
+    _height = image.levels[0].height;
+    _channels = (image.format == BCnFormat::BC4) ? 1 : (image.format == BCnFormat::BC5) ? 2 : 4;
+
+    glBindTexture(GL_TEXTURE_2D, _handle);
+
+    // set texture parameters
+    setDefaultParameters();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size()) - 1);
+    if (image.levels.size() > 1) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+    if (image.format == BCnFormat::BC4) {
+        // single channel maps are read as .rgb by the shaders
+        const GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    // transfer the blocks of every level to GPU
+    const GLenum internalFormat = getCompressedFormat(image.format);
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        const auto& level = image.levels[i];
+        glCompressedTexImage2D(
+            GL_TEXTURE_2D, static_cast<GLint>(i), internalFormat, level.width, level.height, 0,
+            static_cast<GLsizei>(level.data.size()), level.data.data());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // check error
+    check();
+}
+
+GLenum ImageTexture2D::getCompressedFormat(BCnFormat format) {
+    switch (format) {
+    case BCnFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BCnFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BCnFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case BCnFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    }
+    return GL_NONE;
+}
+
+bool ImageTexture2D::isCompressedFormatSupported(BCnFormat format) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    std::vector<GLint> formats(count);
+    if (count > 0) {
+        glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+    }
+
+    const GLint wanted = static_cast<GLint>(getCompressedFormat(format));
+    // rgtc is core since GL 3.0 but drivers do not have to list it
+    return std::find(formats.begin(), formats.end(), wanted) != formats.end() ||
+           format == BCnFormat::BC4 || format == BCnFormat::BC5;
+}
+
 ImageTexture2D::ImageTexture2D(ImageTexture2D&& rhs) noexcept
-    : Texture2D(std::move(rhs)), _uri(std::move(rhs._uri)) {
+    : Texture2D(std::move(rhs)), _uri(std::move(rhs._uri)), _width(rhs._width),
+      _height(rhs._height), _channels(rhs._channels) {
     rhs._uri = "";
 }
 
@@ -109,6 +182,18 @@ const std::string& ImageTexture2D::getUri() const {
     return _uri;
 }
 
+int ImageTexture2D::getWidth() const {
+    return _width;
+}
+
+int ImageTexture2D::getHeight() const {
+    return _height;
+}
+
+int ImageTexture2D::getChannels() const {
+    return _channels;
+}
+
 void ImageTexture2D::setDefaultParameters() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -119,6 +204,10 @@ void ImageTexture2D::setDefaultParameters() {
 void ImageTexture2D::upload(
     const void* data, int width, int height, int channels, GLint internalformat, GLenum format,
     GLenum type) {
+    _width = width;
+    _height = height;
+    _channels = channels;
+
     // 1. set alignment for data transfer
     GLint alignment = 1;
     size_t pitch = width * channels * sizeof(unsigned char);
@@ -2,6 +2,7 @@
 
 #include <string>
 
+#include "bcn_encoder.h"
 #include "texture.h"
 
 class Texture2D : public Texture {
@@ -32,20 +33,40 @@ private:
 
 class ImageTexture2D : public Texture2D {
 public:
-    ImageTexture2D(const std::string& path);
-
     ImageTexture2D(
         const void* data, int width, int height, int channels, GLint internalformat, GLenum format,
         GLenum type, const std::string& uri);
 
+    // uploads every mip level of a block compressed image with glCompressedTexImage2D
+    ImageTexture2D(const CompressedImage& image, const std::string& uri);
+
     ImageTexture2D(ImageTexture2D&& rhs) noexcept;
 
     ~ImageTexture2D() = default;
 
+    static GLenum getCompressedFormat(BCnFormat format);
+
+    // whether the context can sample the format, BC1/BC3 need EXT_texture_compression_s3tc
+    static bool isCompressedFormatSupported(BCnFormat format);
+
     const std::string& getUri() const;
 
+    int getWidth() const;
+
+    int getHeight() const;
+
+    int getChannels() const;
+
 private:
+    // image files are loaded with TextureCache::load, so that every file is decoded and uploaded once
+    friend class TextureCache;
+
     std::string _uri;
+    int _width = 0;
+    int _height = 0;
+    int _channels = 0;
+
+    ImageTexture2D(const std::string& path);
 
     void setDefaultParameters();
 
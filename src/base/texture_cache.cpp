@@ -0,0 +1,84 @@
+#include <filesystem>
+
+#include "texture_cache.h"
+
+std::string TextureCache::makeKey(const std::string& path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+std::shared_ptr<ImageTexture2D> TextureCache::find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(key);
+    if (it != _entries.end()) {
+        if (auto texture = it->second.texture.lock()) {
+            ++_hits;
+            return texture;
+        }
+    }
+    ++_misses;
+    return nullptr;
+}
+
+bool TextureCache::contains(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(key);
+    return it != _entries.end() && !it->second.texture.expired();
+}
+
+std::shared_ptr<ImageTexture2D> TextureCache::add(
+    const std::string& key, std::unique_ptr<ImageTexture2D> texture, size_t bytes) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Entry& entry = _entries[key];
+    if (auto resident = entry.texture.lock()) {
+        return resident;
+    }
+
+    // the previous texture under this key (if any) is already on its way out,
+    // its remove() sees the new pointer and leaves the entry alone
+    if (entry.pointer != nullptr) {
+        _residentBytes -= entry.bytes;
+    }
+
+    std::shared_ptr<ImageTexture2D> shared(texture.release(), [this, key](ImageTexture2D* t) {
+        remove(key, t);
+        delete t;
+    });
+    entry.texture = shared;
+    entry.pointer = shared.get();
+    entry.bytes = bytes;
+    _residentBytes += bytes;
+    return shared;
+}
+
+std::shared_ptr<ImageTexture2D> TextureCache::load(const std::string& path) {
+    const std::string key = makeKey(path);
+    if (auto texture = find(key)) {
+        return texture;
+    }
+
+    std::unique_ptr<ImageTexture2D> texture(new ImageTexture2D(path));
+    const size_t bytes = static_cast<size_t>(texture->getWidth()) * texture->getHeight() *
+                         texture->getChannels();
+    return add(key, std::move(texture), bytes);
+}
+
+size_t TextureCache::getTextureCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t count = 0;
+    for (const auto& entry : _entries) {
+        if (!entry.second.texture.expired()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void TextureCache::remove(const std::string& key, const ImageTexture2D* texture) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(key);
+    if (it == _entries.end() || it->second.pointer != texture) {
+        return;
+    }
+    _residentBytes -= it->second.bytes;
+    _entries.erase(it);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "texture2d.h"
+
+// process wide registry of image textures keyed by their file.
+// every user holds a shared_ptr, the GL texture is deleted when the last one is dropped.
+// lookups are thread safe, creating and dropping textures has to happen on the context thread.
+class TextureCache {
+public:
+    TextureCache() = default;
+
+    TextureCache(const TextureCache& rhs) = delete;
+
+    static TextureCache& getGlobal() {
+        static TextureCache cache;
+        return cache;
+    }
+
+    // normalized form of a file path, so that different spellings of a file share one texture
+    static std::string makeKey(const std::string& path);
+
+    // the resident texture for key, nullptr if there is none
+    std::shared_ptr<ImageTexture2D> find(const std::string& key);
+
+    bool contains(const std::string& key) const;
+
+    // registers texture under key, bytes is its approximate GPU size.
+    // if another texture got registered under the same key meanwhile, that one is returned instead.
+    std::shared_ptr<ImageTexture2D> add(
+        const std::string& key, std::unique_ptr<ImageTexture2D> texture, size_t bytes);
+
+    // the texture of an image file, decoded and uploaded on a miss. the only way to create an ImageTexture2D
+    // from a path, so that no file bypasses the sharing and the resident bytes
+    std::shared_ptr<ImageTexture2D> load(const std::string& path);
+
+    size_t getResidentBytes() const {
+        return _residentBytes;
+    }
+
+    size_t getTextureCount() const;
+
+    size_t getHitCount() const {
+        return _hits;
+    }
+
+    size_t getMissCount() const {
+        return _misses;
+    }
+
+private:
+    struct Entry {
+        std::weak_ptr<ImageTexture2D> texture;
+        const ImageTexture2D* pointer = nullptr;
+        size_t bytes = 0;
+    };
+
+    std::unordered_map<std::string, Entry> _entries;
+    mutable std::mutex _mutex;
+
+    std::atomic<size_t> _residentBytes{0};
+    std::atomic<size_t> _hits{0};
+    std::atomic<size_t> _misses{0};
+
+    void remove(const std::string& key, const ImageTexture2D* texture);
+};
@@ -1,7 +1,10 @@
+#include <array>
 #include <cassert>
+#include <memory>
 #include <stb_image.h>
 
 #include "texture_cubemap.h"
+#include "thread_pool.h"
 
 TextureCubemap::TextureCubemap(
     GLint internalFormat, int width, int height, GLenum format, GLenum dataType) {
@@ -50,22 +53,31 @@ ImageTextureCubemap::ImageTextureCubemap(const std::vector<std::string>& filepat
     // ...
     // -----------------------------------------------
 
-    for (int i = 0; i < 6; ++i) {
+    // decode the six faces in parallel, the upload below stays on the context thread
+    struct Face {
         int width = 0, height = 0, channels = 0;
-        unsigned char* data = stbi_load(_uris[i].c_str(), &width, &height, &channels, 0);
-        if (data == nullptr) {
+        std::unique_ptr<unsigned char, void (*)(void*)> data{nullptr, stbi_image_free};
+    };
+    std::array<Face, 6> faces;
+    ThreadPool::getGlobal().parallelFor(faces.size(), [&](size_t i) {
+        Face& face = faces[i];
+        face.data.reset(stbi_load(_uris[i].c_str(), &face.width, &face.height, &face.channels, 0));
+    });
+
+    for (int i = 0; i < 6; ++i) {
+        const Face& face = faces[i];
+        if (face.data == nullptr) {
             cleanup();
             throw std::runtime_error("load " + filepaths[i] + " failure");
         }
 
         GLenum format = GL_RGB;
-        switch (channels) {
+        switch (face.channels) {
         case 1: format = GL_RED; break;
         case 3: format = GL_RGB; break;
         case 4: format = GL_RGBA; break;
         default:
             cleanup();
-            stbi_image_free(data);
             throw std::runtime_error("unsupported format");
         }
         GLint internalFormat = static_cast<GLint>(format);
@@ -83,7 +95,7 @@ ImageTextureCubemap::ImageTextureCubemap(const std::vector<std::string>& filepat
         // transfer data to gpu
         // 1. set the alignment for data transfer
         GLint alignment = 1;
-        size_t pitch = width * channels * sizeof(unsigned char);
+        size_t pitch = face.width * face.channels * sizeof(unsigned char);
         if (pitch % 8 == 0)
             alignment = 8;
         else if (pitch % 4 == 0)
@@ -97,17 +109,14 @@ ImageTextureCubemap::ImageTextureCubemap(const std::vector<std::string>& filepat
 
         // 2. transfer data
         glTexImage2D(
-            GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, width, height, 0, format,
-            GL_UNSIGNED_BYTE, data);
+            GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, face.width, face.height, 0,
+            format, GL_UNSIGNED_BYTE, face.data.get());
 
         // 3. restore the alignment
         glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
         // unbind
         glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-
-        // free data
-        stbi_image_free(data);
     }
 
     check();
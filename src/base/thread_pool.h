@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = getDefaultThreadCount()) {
+        threadCount = std::max<size_t>(threadCount, 1);
+        _workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i) {
+            _workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool& rhs) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _condition.notify_all();
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    size_t getThreadCount() const {
+        return _workers.size();
+    }
+
+    template <typename F>
+    auto submit(F&& func) -> std::future<decltype(func())> {
+        using Result = decltype(func());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.emplace([task]() { (*task)(); });
+        }
+        _condition.notify_one();
+        return result;
+    }
+
+    // runs func(i) for every i in [0, count) and returns once all of them finished.
+    // the calling thread takes part in the work, so it is safe to call from a worker.
+    void parallelFor(size_t count, const std::function<void(size_t)>& func) {
+        if (count == 0) {
+            return;
+        }
+
+        struct State {
+            std::function<void(size_t)> func;
+            size_t count = 0;
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+
+        auto state = std::make_shared<State>();
+        state->func = func;
+        state->count = count;
+
+        auto work = [state]() {
+            size_t i;
+            while ((i = state->next.fetch_add(1)) < state->count) {
+                state->func(i);
+                if (state->done.fetch_add(1) + 1 == state->count) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->finished.notify_all();
+                }
+            }
+        };
+
+        const size_t helpers = std::min(count, _workers.size()) - 1;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (size_t i = 0; i < helpers; ++i) {
+                _tasks.emplace(work);
+            }
+        }
+        _condition.notify_all();
+
+        work();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&state]() { return state->done.load() == state->count; });
+    }
+
+    // process wide pool used by the asset loaders
+    static ThreadPool& getGlobal() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    static size_t getDefaultThreadCount() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+private:
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stop = false;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+                if (_stop && _tasks.empty()) {
+                    return;
+                }
+                task = std::move(_tasks.front());
+                _tasks.pop();
+            }
+            task();
+        }
+    }
+};
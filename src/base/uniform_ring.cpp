@@ -0,0 +1,153 @@
+#include "uniform_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// waits of a fence are this long between checks, in nanoseconds
+constexpr GLuint64 kFenceWaitNs = 1000000;
+
+bool hasPersistentMapping() {
+#if !defined(__EMSCRIPTEN__) && !defined(USE_GLES)
+    return GLAD_GL_VERSION_4_4 != 0;
+#else
+    return false;
+#endif
+}
+} // namespace
+
+UniformRing::UniformRing(size_t frameCapacity) {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    _alignment = std::max<size_t>(alignment, 16);
+    create(frameCapacity);
+}
+
+UniformRing::~UniformRing() {
+    for (GLsync& fence : _fences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+
+    for (const RetiredBuffer& retired : _retiredBuffers) {
+        if (retired.fence != nullptr) {
+            glDeleteSync(retired.fence);
+        }
+        glDeleteBuffers(1, &retired.buffer);
+    }
+
+    if (_buffer != 0) {
+        glDeleteBuffers(1, &_buffer);
+        _buffer = 0;
+    }
+}
+
+void UniformRing::beginFrame() {
+    // buffers replaced during a frame go once its commands are done, without waiting
+    _retiredBuffers.erase(std::remove_if(_retiredBuffers.begin(), _retiredBuffers.end(),
+                                         [](const RetiredBuffer& retired) {
+                                             if (retired.fence == nullptr) {
+                                                 return false;
+                                             }
+                                             const GLenum status = glClientWaitSync(retired.fence, 0, 0);
+                                             if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                                                 return false;
+                                             }
+                                             glDeleteSync(retired.fence);
+                                             glDeleteBuffers(1, &retired.buffer);
+                                             return true;
+                                         }),
+                          _retiredBuffers.end());
+
+    _frame = (_frame + 1) % kFrameCount;
+    _head = 0;
+    waitFence(_fences[_frame]);
+}
+
+void UniformRing::endFrame() {
+    for (RetiredBuffer& retired : _retiredBuffers) {
+        if (retired.fence == nullptr) {
+            retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    if (_mapped != nullptr) {
+        _fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+UniformRing::Range UniformRing::push(const void* data, size_t size) {
+    if (_head + size > _frameCapacity) {
+        grow(std::max(2 * _frameCapacity, _head + size));
+    }
+
+    Range range;
+    range.buffer = _buffer;
+    range.offset = static_cast<GLintptr>(_frame * _frameCapacity + _head);
+    range.size = static_cast<GLsizeiptr>(size);
+    if (_mapped != nullptr) {
+        std::memcpy(_mapped + range.offset, data, size);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, range.offset, range.size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    _head = std::min(_frameCapacity, (_head + size + _alignment - 1) / _alignment * _alignment);
+    return range;
+}
+
+void UniformRing::create(size_t frameCapacity) {
+    _frameCapacity = (frameCapacity + _alignment - 1) / _alignment * _alignment;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(kFrameCount * _frameCapacity);
+
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+#if !defined(__EMSCRIPTEN__) && !defined(USE_GLES)
+    if (hasPersistentMapping()) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        _mapped = static_cast<uint8_t*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+    } else
+#endif
+    {
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        _mapped = nullptr;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformRing::grow(size_t minFrameCapacity) {
+    // the ranges of this frame stay bound to the old buffer, it lives until the frame is done
+    if (_mapped != nullptr) {
+        glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    _retiredBuffers.push_back({_buffer, nullptr});
+
+    // the new buffer has no commands reading it
+    for (GLsync& fence : _fences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    create(minFrameCapacity);
+    _head = 0;
+}
+
+void UniformRing::waitFence(GLsync& fence) {
+    if (fence == nullptr) {
+        return;
+    }
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceWaitNs);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gl_utility.h"
+
+// ring of uniform block data for kFrameCount frames in flight. every frame writes its blocks into its own part
+// of one buffer, persistently mapped and coherent where GL 4.4 allows it, and binds them with glBindBufferRange.
+// a part is written again kFrameCount frames later, once the fence placed at the end of its frame is signaled,
+// so the CPU never waits on the GPU unless it runs kFrameCount frames ahead
+class UniformRing {
+public:
+    static constexpr uint32_t kFrameCount = 3;
+
+    // block data in the ring, valid until the end of the frame it was pushed in
+    struct Range {
+        GLuint buffer = 0;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    // frameCapacity bytes per frame, grown when a frame pushes more
+    explicit UniformRing(size_t frameCapacity = 256 * 1024);
+
+    ~UniformRing();
+
+    UniformRing(const UniformRing&) = delete;
+
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    // waits for the GPU to be done with the part of kFrameCount frames ago and starts writing to it
+    void beginFrame();
+
+    // fences the commands of the frame, that read its part of the ring
+    void endFrame();
+
+    // copies size bytes of data into the part of the frame, at an offset glBindBufferRange accepts
+    Range push(const void* data, size_t size);
+
+    template <typename T>
+    Range push(const T& block) {
+        return push(&block, sizeof(T));
+    }
+
+    // binds range to the uniform block binding
+    static void bind(GLuint binding, const Range& range) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, range.buffer, range.offset, range.size);
+    }
+
+    // bytes pushed since beginFrame, alignment included
+    size_t getFrameUsage() const {
+        return _head;
+    }
+
+    size_t getFrameCapacity() const {
+        return _frameCapacity;
+    }
+
+    // persistent mapping, glBufferSubData per push otherwise
+    bool isPersistent() const {
+        return _mapped != nullptr;
+    }
+
+private:
+    // a buffer replaced by a larger one, deleted once the commands of its last frame are done
+    struct RetiredBuffer {
+        GLuint buffer;
+        GLsync fence;
+    };
+
+    GLuint _buffer = 0;
+    uint8_t* _mapped = nullptr;
+    size_t _frameCapacity = 0;
+    size_t _alignment = 256;
+    uint32_t _frame = 0;
+    size_t _head = 0;
+    GLsync _fences[kFrameCount] = {};
+    std::vector<RetiredBuffer> _retiredBuffers;
+
+    void create(size_t frameCapacity);
+
+    void grow(size_t minFrameCapacity);
+
+    static void waitFence(GLsync& fence);
+};
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+#include "gl_utility.h"
+#include "vertex_format.h"
+
+namespace {
+// maps a unit vector onto the octahedron and unfolds it to [-1, 1]^2
+glm::vec2 octEncode(const glm::vec3& n) {
+    const float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (sum == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    glm::vec2 p = glm::vec2(n.x, n.y) / sum;
+    if (n.z < 0.0f) {
+        const glm::vec2 folded = glm::vec2(1.0f - std::abs(p.y), 1.0f - std::abs(p.x));
+        p = glm::vec2(p.x >= 0.0f ? folded.x : -folded.x, p.y >= 0.0f ? folded.y : -folded.y);
+    }
+    return p;
+}
+
+int16_t toSnorm16(float v) {
+    return static_cast<int16_t>(std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+int8_t toSnorm8(float v) {
+    return static_cast<int8_t>(std::round(std::clamp(v, -1.0f, 1.0f) * 127.0f));
+}
+
+uint8_t toUnorm8(float v) {
+    return static_cast<uint8_t>(std::round(std::clamp(v, 0.0f, 1.0f) * 255.0f));
+}
+
+PackedVertex pack(const Vertex& v) {
+    PackedVertex p;
+    std::memcpy(p.position, &v.Position, sizeof(p.position));
+
+    const glm::vec2 normal = octEncode(v.Normal);
+    p.normal[0] = toSnorm16(normal.x);
+    p.normal[1] = toSnorm16(normal.y);
+
+    const glm::vec2 tangent = octEncode(v.Tangent);
+    const bool flipped = glm::dot(glm::cross(v.Normal, v.Tangent), v.Bitangent) < 0.0f;
+    p.tangent[0] = toSnorm8(tangent.x);
+    p.tangent[1] = toSnorm8(tangent.y);
+    p.tangent[2] = flipped ? -127 : 127;
+    p.tangent[3] = 0;
+
+    p.texCoords[0] = glm::packHalf1x16(v.TexCoords.x);
+    p.texCoords[1] = glm::packHalf1x16(v.TexCoords.y);
+    return p;
+}
+} // namespace
+
+size_t getVertexSize(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Packed: return sizeof(PackedVertex);
+    case VertexFormat::PackedSkinned: return sizeof(PackedSkinnedVertex);
+    default: return sizeof(Vertex);
+    }
+}
+
+VertexFormat chooseVertexFormat(const Vertex* vertices, size_t count) {
+    bool skinned = false;
+    for (size_t i = 0; i < count; ++i) {
+        for (int j = 0; j < MAX_BONE_INFLUENCE; ++j) {
+            if (vertices[i].m_Weights[j] == 0.0f) {
+                continue;
+            }
+            if (vertices[i].m_BoneIDs[j] < 0 || vertices[i].m_BoneIDs[j] > 255) {
+                return VertexFormat::Float;
+            }
+            skinned = true;
+        }
+    }
+    return skinned ? VertexFormat::PackedSkinned : VertexFormat::Packed;
+}
+
+std::vector<uint8_t> packVertices(const Vertex* vertices, size_t count, VertexFormat format) {
+    std::vector<uint8_t> result(getVertexSize(format) * count);
+    switch (format) {
+    case VertexFormat::Float: std::memcpy(result.data(), vertices, result.size()); break;
+    case VertexFormat::Packed: {
+        PackedVertex* dst = reinterpret_cast<PackedVertex*>(result.data());
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = pack(vertices[i]);
+        }
+        break;
+    }
+    case VertexFormat::PackedSkinned: {
+        PackedSkinnedVertex* dst = reinterpret_cast<PackedSkinnedVertex*>(result.data());
+        for (size_t i = 0; i < count; ++i) {
+            dst[i].base = pack(vertices[i]);
+            for (int j = 0; j < MAX_BONE_INFLUENCE; ++j) {
+                const bool used = vertices[i].m_Weights[j] != 0.0f;
+                dst[i].boneIds[j] = used ? static_cast<uint8_t>(vertices[i].m_BoneIDs[j]) : 0;
+                dst[i].weights[j] = toUnorm8(vertices[i].m_Weights[j]);
+            }
+        }
+        break;
+    }
+    }
+    return result;
+}
+
+void setupVertexAttributes(VertexFormat format) {
+    if (format == VertexFormat::Float) {
+        const GLsizei stride = sizeof(Vertex);
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Bitangent));
+        // ids
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_INT, stride, (void*)offsetof(Vertex, m_BoneIDs));
+        // weights
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, m_Weights));
+        return;
+    }
+
+    const GLsizei stride = static_cast<GLsizei>(getVertexSize(format));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, position));
+    // octahedral normal, decoded in the vertex shader
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, texCoords));
+    // octahedral tangent in xy, bitangent sign in z
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 4, GL_BYTE, GL_TRUE, stride, (void*)offsetof(PackedVertex, tangent));
+    glDisableVertexAttribArray(4);
+
+    if (format == VertexFormat::PackedSkinned) {
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(
+            5, 4, GL_UNSIGNED_BYTE, stride, (void*)offsetof(PackedSkinnedVertex, boneIds));
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(
+            6, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(PackedSkinnedVertex, weights));
+    } else {
+        glDisableVertexAttribArray(5);
+        glDisableVertexAttribArray(6);
+    }
+}
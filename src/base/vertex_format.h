@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vertex.h"
+
+// layout of the vertex buffer of a mesh
+enum class VertexFormat : uint32_t {
+    // Vertex as is, 88 bytes
+    Float = 0,
+    // PackedVertex, 24 bytes
+    Packed = 1,
+    // PackedSkinnedVertex, 32 bytes
+    PackedSkinned = 2,
+};
+
+// position stays full float, the normal is octahedral encoded in two snorm16, the tangent in two snorm8
+// plus the sign of the bitangent, which the shader rebuilds as cross(normal, tangent) * sign
+struct PackedVertex {
+    float position[3];
+    int16_t normal[2];
+    int8_t tangent[4];
+    uint16_t texCoords[2];  // half floats
+};
+static_assert(sizeof(PackedVertex) == 24, "packed vertex must stay tightly packed");
+
+struct PackedSkinnedVertex {
+    PackedVertex base;
+    uint8_t boneIds[MAX_BONE_INFLUENCE];
+    uint8_t weights[MAX_BONE_INFLUENCE];  // unorm8
+};
+static_assert(sizeof(PackedSkinnedVertex) == 32, "packed vertex must stay tightly packed");
+
+size_t getVertexSize(VertexFormat format);
+
+// the smallest format that holds the vertices: bone data is only kept when a weight is set,
+// meshes with bone ids beyond 255 stay Float
+VertexFormat chooseVertexFormat(const Vertex* vertices, size_t count);
+
+// converts vertices into format, the result is getVertexSize(format) * count bytes
+std::vector<uint8_t> packVertices(const Vertex* vertices, size_t count, VertexFormat format);
+
+// sets the attribute pointers of the bound VAO / vertex buffer for format:
+// 0 position, 1 normal, 2 texcoords, 3 tangent, 4 bitangent (Float only), 5 bone ids, 6 weights
+void setupVertexAttributes(VertexFormat format);
@@ -0,0 +1,1840 @@
+#include "benchmark.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include "base/bvh.h"
+#include "base/camera.h"
+#include "base/frustum_culling.h"
+#include "base/occlusion_buffer.h"
+#include "base/scene_graph.h"
+#include "base/uniform_ring.h"
+#include "gpu_culling.h"
+#include "light_clusters.h"
+#include "model.h"
+#include "model_loader.h"
+#include "render_stats.h"
+#include "renderer.h"
+#include "scene.h"
+#include "scene_objects.h"
+#include "spdlogMgr.h"
+#include "uniform_blocks.h"
+
+namespace
+{
+using Clock = std::chrono::high_resolution_clock;
+
+float elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+// resident set size of the process, and its peak since the last resetPeakResidentBytes, in bytes
+size_t getResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    return K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, residentPages = 0;
+    statm >> pages >> residentPages;
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+size_t getPeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    return K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key)
+    {
+        if (key == "VmHWM:")
+        {
+            size_t kb = 0;
+            status >> kb;
+            return kb * 1024;
+        }
+        status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return 0;
+#endif
+}
+
+// windows keeps the peak for the lifetime of the process
+void resetPeakResidentBytes()
+{
+#ifndef _WIN32
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+// appends a closed block of 12 triangles, given by center and half extent
+void addBlock(const glm::vec3& center, const glm::vec3& extent, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+{
+    const uint32_t faces[] = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+    const uint32_t first = static_cast<uint32_t>(positions.size());
+    for (int k = 0; k < 8; ++k)
+    {
+        positions.push_back(center + extent * glm::vec3(k & 1 ? 1.0f : -1.0f, k & 2 ? 1.0f : -1.0f, k & 4 ? 1.0f : -1.0f));
+    }
+    for (uint32_t index : faces)
+    {
+        indices.push_back(first + index);
+    }
+}
+
+// true if the box, given by center and half extent, touches one of the planes within rounding, where the compute
+// shader and the SIMD test may decide differently
+bool touchesPlane(const Frustum& frustum, const glm::vec3& center, const glm::vec3& extent)
+{
+    for (const auto& plane : frustum.planes)
+    {
+        const float distance = plane.getSignedDistanceToPoint(center);
+        const float radius = glm::dot(extent, glm::abs(plane.normal));
+        if (std::abs(distance + radius) <= 1e-4f * std::max(1.0f, std::abs(distance) + radius))
+            return true;
+    }
+    return false;
+}
+
+// appends a wall facing +z of count x count quads, so its triangles stay below a pixel of the OcclusionBuffer
+void addTessellatedWall(const glm::vec3& center, float halfSize, int count, std::vector<glm::vec3>& positions,
+    std::vector<uint32_t>& indices)
+{
+    const uint32_t first = static_cast<uint32_t>(positions.size());
+    for (int y = 0; y <= count; ++y)
+    {
+        for (int x = 0; x <= count; ++x)
+        {
+            positions.push_back(center + halfSize * glm::vec3(2.0f * x / count - 1.0f, 2.0f * y / count - 1.0f, 0.0f));
+        }
+    }
+    for (int y = 0; y < count; ++y)
+    {
+        for (int x = 0; x < count; ++x)
+        {
+            const uint32_t corner = first + y * (count + 1) + x;
+            const uint32_t quad[] = { corner, corner + 1, corner + count + 2, corner, corner + count + 2, corner + count + 1 };
+            indices.insert(indices.end(), std::begin(quad), std::end(quad));
+        }
+    }
+}
+
+// known answers of the OcclusionBuffer for one wall in front of the camera, as a block of two triangles a side
+// and as a finely tessellated quad: boxes behind it are hidden, also behind the diagonal two triangles share,
+// boxes in front of it and around the camera, crossing the near plane, are visible. logs every failed case
+bool checkOcclusionBuffer()
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    PerspectiveCamera camera(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    camera.transform.position = glm::vec3(0.0f);
+    camera.transform.lookAt(glm::vec3(0.0f, 0.0f, -1.0f));
+    const glm::mat4 viewProjection = camera.getProjectionMatrix() * camera.getViewMatrix();
+
+    struct Wall
+    {
+        const char* name;
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+    Wall walls[2] = { { "block" }, { "tessellated wall" } };
+    addBlock(glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(10.0f, 10.0f, 1.0f), walls[0].positions, walls[0].indices);
+    addTessellatedWall(glm::vec3(0.0f, 0.0f, -19.0f), 10.0f, 128, walls[1].positions, walls[1].indices);
+
+    struct Case
+    {
+        const char* name;
+        glm::vec3 center;
+        glm::vec3 extent;
+        bool visible;
+    };
+    const Case cases[] = {
+        { "behind the center", glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(1.0f), false },
+        { "behind the corner", glm::vec3(5.0f, 5.0f, -40.0f), glm::vec3(1.0f), false },
+        { "in front", glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(1.0f), true },
+        { "crossing the near plane", glm::vec3(0.0f), glm::vec3(1.0f), true },
+    };
+
+    ThreadPool pool(1);
+    OcclusionBuffer buffer;
+    bool passed = true;
+    for (const auto& wall : walls)
+    {
+        buffer.clear();
+        buffer.addOccluder(wall.positions.data(), sizeof(glm::vec3), wall.indices.data(), wall.indices.size(), viewProjection);
+        buffer.render(pool);
+        for (const auto& c : cases)
+        {
+            if (buffer.isVisible(c.center, c.extent, viewProjection) != c.visible)
+            {
+                console_logger->error("[occlusion-culling] box {} of the {} is {}", c.name, wall.name, c.visible ? "hidden" : "visible");
+                passed = false;
+            }
+        }
+    }
+    return passed;
+}
+} // namespace
+
+namespace benchmark
+{
+bool isContextFree(const std::string& name)
+{
+    return name == "frustum-culling" || name == "scene-graph" || name == "scene-objects" || name == "occlusion-culling";
+}
+
+bool runContextFree(const std::string& name)
+{
+    if (name == "frustum-culling")
+    {
+        frustumCulling(100000, 20);
+        return true;
+    }
+    if (name == "scene-graph")
+    {
+        sceneGraph(10000, 8, 100);
+        return true;
+    }
+    if (name == "scene-objects")
+    {
+        sceneObjects({ 1000, 10000, 100000 }, 100);
+        return true;
+    }
+    if (name == "occlusion-culling")
+        return occlusionCulling(400, 100000, 20);
+    return false;
+}
+
+void meshCacheLoad(const std::vector<std::string>& modelPaths, int warmRuns)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    for (const auto& path : modelPaths)
+    {
+        std::error_code ec;
+        std::filesystem::remove(MeshCache::getCachePath(path), ec);
+
+        auto start = Clock::now();
+        {
+            AssimpModel model(path);
+            glFinish();
+        }
+        const float coldMs = elapsedMs(start);
+
+        float warmMs = 0.0f;
+        for (int i = 0; i < warmRuns; ++i)
+        {
+            start = Clock::now();
+            {
+                AssimpModel model(path);
+                glFinish();
+            }
+            warmMs += elapsedMs(start);
+        }
+        warmMs /= std::max(warmRuns, 1);
+
+        console_logger->info("[mesh-cache] {}: cold {:.2f} ms, warm {:.2f} ms ({:.1f}x)", path, coldMs, warmMs,
+            coldMs / std::max(warmMs, 0.001f));
+    }
+}
+
+void meshConversionScaling(const std::vector<std::string>& modelPaths, int runs)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    std::vector<size_t> threadCounts;
+    for (size_t n = 1; n < ThreadPool::getDefaultThreadCount(); n *= 2)
+    {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(ThreadPool::getDefaultThreadCount());
+
+    for (const auto& path : modelPaths)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, AssimpModel::importFlags);
+        if (!scene || !scene->mRootNode)
+        {
+            console_logger->error("[mesh-threads] import {} failed: {}", path, importer.GetErrorString());
+            continue;
+        }
+
+        vector<const aiMesh*> aiMeshes;
+        AssimpModel::collectMeshes(scene->mRootNode, scene, aiMeshes);
+
+        float serialMs = 0.0f;
+        for (size_t threads : threadCounts)
+        {
+            ThreadPool pool(threads);
+            float ms = 0.0f;
+            for (int i = 0; i < runs; ++i)
+            {
+                const auto start = Clock::now();
+                vector<MeshData> meshData = AssimpModel::convertMeshes(aiMeshes, pool);
+                ms += elapsedMs(start);
+            }
+            ms /= std::max(runs, 1);
+            if (threads == 1) serialMs = ms;
+
+            console_logger->info("[mesh-threads] {} ({} meshes): {} threads {:.2f} ms ({:.2f}x)", path,
+                aiMeshes.size(), threads, ms, serialMs / std::max(ms, 0.001f));
+        }
+    }
+}
+
+void meshOptimization(const std::vector<std::string>& modelPaths)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    for (const auto& path : modelPaths)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, AssimpModel::importFlags);
+        if (!scene || !scene->mRootNode)
+        {
+            console_logger->error("[mesh-optimize] import {} failed: {}", path, importer.GetErrorString());
+            continue;
+        }
+
+        vector<const aiMesh*> aiMeshes;
+        AssimpModel::collectMeshes(scene->mRootNode, scene, aiMeshes);
+        vector<MeshData> meshData = AssimpModel::convertMeshes(aiMeshes, ThreadPool::getGlobal());
+
+        // totals over all meshes, so the ratios are weighted by mesh size
+        size_t triangles = 0, verticesBefore = 0, verticesAfter = 0, indexBytesBefore = 0, indexBytesAfter = 0;
+        double transformedBefore = 0, transformedAfter = 0;
+        float ms = 0.0f;
+        for (auto& mesh : meshData)
+        {
+            const size_t meshTriangles = mesh.indices.size() / 3;
+            triangles += meshTriangles;
+            verticesBefore += mesh.vertices.size();
+            indexBytesBefore += mesh.indices.size() * sizeof(unsigned int);
+            transformedBefore += analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size()).acmr
+                * meshTriangles;
+
+            const auto start = Clock::now();
+            weldVertices(mesh.vertices, mesh.indices, ModelImport::weldEpsilon, ThreadPool::getGlobal());
+            optimizeMesh(mesh.vertices, mesh.indices);
+            ms += elapsedMs(start);
+
+            verticesAfter += mesh.vertices.size();
+            indexBytesAfter += mesh.indices.size()
+                * (hasShortIndices(mesh.vertices.size()) ? sizeof(uint16_t) : sizeof(unsigned int));
+            transformedAfter += analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size()).acmr
+                * meshTriangles;
+        }
+
+        const double tris = static_cast<double>(std::max<size_t>(triangles, 1));
+        console_logger->info("[mesh-optimize] {} ({} meshes, {} triangles): ACMR {:.3f} -> {:.3f}, "
+            "ATVR {:.3f} -> {:.3f}, {} -> {} vertices, index buffers {:.1f} KB -> {:.1f} KB, {:.2f} ms",
+            path, meshData.size(), triangles, transformedBefore / tris, transformedAfter / tris,
+            transformedBefore / std::max<size_t>(verticesBefore, 1), transformedAfter / std::max<size_t>(verticesAfter, 1),
+            verticesBefore, verticesAfter, indexBytesBefore / 1024.0, indexBytesAfter / 1024.0, ms);
+    }
+}
+
+void meshletCulling(const std::vector<std::string>& modelPaths, int azimuthSteps)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    for (const auto& path : modelPaths)
+    {
+        ModelImport import;
+        import.packVertices = false;
+        if (!import.load(path, true, ThreadPool::getGlobal()))
+        {
+            console_logger->error("[meshlet-culling] import {} failed", path);
+            continue;
+        }
+
+        vector<vector<Meshlet>> meshlets;
+        size_t meshletCount = 0, triangleCount = 0;
+        for (const auto& mesh : import.meshes)
+        {
+            meshlets.emplace_back(mesh.meshlets, mesh.meshlets + mesh.meshletCount);
+            meshletCount += mesh.meshletCount;
+            triangleCount += (mesh.lodCount > 0 ? mesh.lods[0].indexCount : mesh.indexCount) / 3;
+        }
+
+        // orbit at the distance that frames the whole model and at a close up, from below, level and above
+        const glm::vec3 center = 0.5f * (import.box.min + import.box.max);
+        const float size = glm::length(import.box.max - import.box.min);
+        const float fovy = glm::radians(45.0f);
+        const float framed = 0.5f * size / std::sin(0.5f * fovy);
+        for (float distance : { framed, 0.4f * framed })
+        {
+            PerspectiveCamera camera(fovy, 16.0f / 9.0f, 0.1f, 1000.0f);
+            size_t views = 0, kept = 0;
+            float ms = 0.0f;
+            std::vector<IndexRange> ranges;
+            for (float elevation : { -20.0f, 0.0f, 30.0f })
+            {
+                for (int step = 0; step < azimuthSteps; ++step)
+                {
+                    const float azimuth = glm::two_pi<float>() * step / azimuthSteps;
+                    const float e = glm::radians(elevation);
+                    camera.transform.position = center
+                        + distance * glm::vec3(std::cos(e) * std::sin(azimuth), std::sin(e), std::cos(e) * std::cos(azimuth));
+                    camera.transform.lookAt(center);
+
+                    const auto start = Clock::now();
+                    const Frustum frustum = camera.getFrustum();
+                    for (const auto& mesh : meshlets)
+                    {
+                        ranges.clear();
+                        kept += cullMeshlets(mesh, frustum, glm::mat4(1.0f), camera.transform.position, ranges);
+                    }
+                    ms += elapsedMs(start);
+                    ++views;
+                }
+            }
+
+            console_logger->info("[meshlet-culling] {} ({} meshlets, {} triangles) at {:.2f}: {:.1f}% of the triangles "
+                "rejected per frame, culling {:.3f} ms per frame", path, meshletCount, triangleCount, distance,
+                100.0 * (1.0 - static_cast<double>(kept) / (static_cast<double>(triangleCount) * views)),
+                ms / std::max<size_t>(views, 1));
+        }
+    }
+}
+
+void asyncModelLoad(const std::vector<std::string>& modelPaths, float uploadBudgetMs)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    // blocking: the render thread is stalled until every model is in memory
+    auto start = Clock::now();
+    {
+        std::vector<AssimpModel> models;
+        for (const auto& path : modelPaths)
+        {
+            models.emplace_back(path);
+        }
+        glFinish();
+    }
+    const float blockingMs = elapsedMs(start);
+
+    // streamed: all models load concurrently, the render thread only spends the upload budget per frame
+    start = Clock::now();
+    ModelLoader loader;
+    std::vector<std::shared_ptr<ModelLoader::Request>> requests;
+    for (const auto& path : modelPaths)
+    {
+        requests.push_back(loader.load(path));
+    }
+
+    int frames = 0;
+    float worstFrameMs = 0.0f;
+    while (loader.getLoadingCount() > 0)
+    {
+        const auto frameStart = Clock::now();
+        loader.update(uploadBudgetMs);
+        glFinish();
+        worstFrameMs = std::max(worstFrameMs, elapsedMs(frameStart));
+        ++frames;
+    }
+    const float streamedMs = elapsedMs(start);
+
+    size_t failed = 0;
+    for (const auto& request : requests)
+    {
+        if (request->state != ModelLoader::Request::State::Ready) ++failed;
+    }
+
+    console_logger->info("[async-load] {} models: blocking {:.2f} ms, streamed {:.2f} ms over {} frames, "
+        "worst frame {:.2f} ms (budget {:.1f} ms), {} failed",
+        modelPaths.size(), blockingMs, streamedMs, frames, worstFrameMs, uploadBudgetMs, failed);
+}
+
+void textureDecode(const std::vector<std::string>& modelPaths, int runs)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    ThreadPool serialPool(1);
+    for (const auto& path : modelPaths)
+    {
+        // the first import warms the mesh cache, so the timed imports are dominated by texture decoding
+        size_t textureCount = 0, imageCount = 0;
+        {
+            ModelImport import;
+            if (!import.load(path, true, ThreadPool::getGlobal()))
+            {
+                console_logger->error("[texture-decode] import {} failed", path);
+                continue;
+            }
+            textureCount = import.textures.size();
+            imageCount = import.images.size();
+        }
+
+        auto timeImport = [&](ThreadPool& pool) {
+            float ms = 0.0f;
+            for (int i = 0; i < runs; ++i)
+            {
+                const auto start = Clock::now();
+                ModelImport import;
+                import.load(path, true, pool);
+                ms += elapsedMs(start);
+            }
+            return ms / std::max(runs, 1);
+        };
+        const float serialMs = timeImport(serialPool);
+        const float parallelMs = timeImport(ThreadPool::getGlobal());
+
+        console_logger->info("[texture-decode] {}: {} textures ({} unique images), serial {:.2f} ms, "
+            "{} threads {:.2f} ms ({:.2f}x)", path, textureCount, imageCount, serialMs,
+            ThreadPool::getGlobal().getThreadCount(), parallelMs, serialMs / std::max(parallelMs, 0.001f));
+    }
+}
+
+void textureSharing(const std::vector<std::string>& modelPaths, int copies)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    const TextureCache& cache = TextureCache::getGlobal();
+    const size_t baseBytes = cache.getResidentBytes();
+    for (const auto& path : modelPaths)
+    {
+        std::vector<AssimpModel> models;
+        size_t referenced = 0;
+        float firstMs = 0.0f, otherMs = 0.0f;
+        for (int i = 0; i < copies; ++i)
+        {
+            const auto start = Clock::now();
+            models.emplace_back(path);
+            glFinish();
+            (i == 0 ? firstMs : otherMs) += elapsedMs(start);
+            referenced += models.back().textures_loaded.size();
+        }
+
+        console_logger->info("[texture-sharing] {} x{}: {} texture references, {} resident textures, {:.1f} MB, "
+            "first load {:.2f} ms, further loads {:.2f} ms", path, copies, referenced, cache.getTextureCount(),
+            (cache.getResidentBytes() - baseBytes) / (1024.0 * 1024.0), firstMs, otherMs / std::max(copies - 1, 1));
+    }
+    console_logger->info("[texture-sharing] after unloading: {} resident textures, {:.1f} MB",
+        cache.getTextureCount(), cache.getResidentBytes() / (1024.0 * 1024.0));
+}
+
+void textureCompression(const std::vector<std::string>& modelPaths, int runs)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    // raw pixels of every texture the models reference, with the format its type maps to
+    struct Source
+    {
+        DecodedImage image;
+        BCnFormat format;
+    };
+    std::vector<Source> sources;
+    size_t pixels = 0;
+    const bool compressTextures = ModelImport::compressTextures;
+    ModelImport::compressTextures = false;
+    for (const auto& path : modelPaths)
+    {
+        ModelImport import;
+        if (!import.load(path, true, ThreadPool::getGlobal()))
+        {
+            continue;
+        }
+        for (const auto& texture : import.textures)
+        {
+            DecodedImage image = DecodeImage(texture.path.c_str(), import.directory);
+            if (!image.data)
+            {
+                continue;
+            }
+            const BCnFormat format = GetTextureFormat(texture.type, image.channels);
+            pixels += static_cast<size_t>(image.width) * image.height;
+            sources.push_back({ std::move(image), format });
+        }
+    }
+    ModelImport::compressTextures = compressTextures;
+
+    auto encodeAll = [&](ThreadPool& pool) {
+        size_t rawBytes = 0, compressedBytes = 0;
+        float ms = 0.0f;
+        for (int run = 0; run < runs; ++run)
+        {
+            rawBytes = compressedBytes = 0;
+            const auto start = Clock::now();
+            for (const auto& source : sources)
+            {
+                const CompressedImage compressed = compressImage(source.image.data, source.image.width,
+                    source.image.height, source.image.channels, source.format, pool);
+                rawBytes += static_cast<size_t>(source.image.width) * source.image.height * source.image.channels * 4 / 3;
+                compressedBytes += compressed.getByteSize();
+            }
+            ms += elapsedMs(start);
+        }
+        ms /= std::max(runs, 1);
+        console_logger->info("[texture-compression] {} threads: {} images in {:.2f} ms, {:.1f} images/s, "
+            "{:.1f} MPixel/s, {:.1f} MB -> {:.1f} MB", pool.getThreadCount(), sources.size(), ms,
+            sources.size() * 1000.0f / std::max(ms, 0.001f), pixels / 1000.0f / std::max(ms, 0.001f),
+            rawBytes / (1024.0 * 1024.0), compressedBytes / (1024.0 * 1024.0));
+    };
+
+    ThreadPool serialPool(1);
+    encodeAll(serialPool);
+    encodeAll(ThreadPool::getGlobal());
+}
+
+void lodSelection(Renderer& renderer, const std::vector<std::string>& modelPaths, int width, int height, int frames)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    // a column of copies of every model, each copy twice as far from the camera as the one before
+    constexpr int copies = 6;
+    Scene scene;
+    scene.directionalLights.push_back(DirectionalLight());
+    float x = 0.0f, maxSize = 0.0f;
+    for (const auto& path : modelPaths)
+    {
+        float size = 0.0f;
+        for (int k = 0; k < copies; ++k)
+        {
+            AssimpModel model(path);
+            if (model.meshes.empty())
+            {
+                console_logger->error("[lod-selection] load {} failed", path);
+                break;
+            }
+            size = glm::length(model.box.max - model.box.min);
+            model.transform.position = glm::vec3(x, 0.0f, -size * static_cast<float>(1 << k))
+                - 0.5f * (model.box.min + model.box.max);
+            scene.addToScene(model);
+        }
+        x += size;
+        maxSize = std::max(maxSize, size);
+    }
+
+    auto camera = std::make_unique<PerspectiveCamera>(glm::radians(45.0f), 1.0f * width / height, 0.1f, 1000.0f);
+    camera->transform.position = glm::vec3(0.5f * x, 0.5f * maxSize, 1.5f * maxSize);
+    camera->transform.lookAt(glm::vec3(0.5f * x, 0.0f, -maxSize));
+    renderer.setScreenSize(height, width);
+
+    for (RenderType renderType : { RenderType::FORAWRD, RenderType::DEFERRED })
+    {
+        const char* pathName = renderType == RenderType::FORAWRD ? "forward" : "deferred";
+        size_t fixedTriangles = 0;
+        for (bool adaptive : { false, true })
+        {
+            UIOptions options;
+            options.renderType = renderType;
+            options.adaptiveLod = adaptive;
+
+            // the renderer logs the camera every frame
+            console_logger->set_level(spdlog::level::warn);
+            size_t triangles = 0, shadowTriangles = 0;
+            float ms = 0.0f;
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                const auto start = Clock::now();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.render(camera, scene, options);
+                glFinish();
+                ms += elapsedMs(start);
+                triangles += RenderStats::getFrame().triangles;
+                shadowTriangles += RenderStats::getFrame().shadowTriangles;
+            }
+            console_logger->set_level(spdlog::level::info);
+
+            const int n = std::max(frames, 1);
+            const size_t total = (triangles + shadowTriangles) / n;
+            if (!adaptive)
+            {
+                fixedTriangles = total;
+                console_logger->info("[lod-selection] {} fixed LOD0: {} view + {} shadow triangles per frame, "
+                    "{:.2f} ms per frame", pathName, triangles / n, shadowTriangles / n, ms / n);
+            }
+            else
+            {
+                console_logger->info("[lod-selection] {} adaptive: {} view + {} shadow triangles per frame "
+                    "({:.1f}% fewer), {:.2f} ms per frame", pathName, triangles / n, shadowTriangles / n,
+                    100.0 * (1.0 - static_cast<double>(total) / std::max<size_t>(fixedTriangles, 1)), ms / n);
+            }
+        }
+    }
+}
+
+void meshMemory(const std::vector<std::string>& modelPaths)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    for (const auto& path : modelPaths)
+    {
+        // the first load writes the mesh cache and warms the texture files, so every policy loads the same way
+        {
+            AssimpModel model(path);
+            glFinish();
+        }
+
+        for (MeshCpuData cpuData : { MeshCpuData::Full, MeshCpuData::Positions, MeshCpuData::None })
+        {
+            const size_t before = getResidentBytes();
+            resetPeakResidentBytes();
+
+            AssimpModel model(path, false, true, true, cpuData);
+            glFinish();
+            const size_t peak = getPeakResidentBytes();
+            const size_t steady = getResidentBytes();
+            size_t cpuBytes = 0;
+            for (const auto& mesh : model.meshes)
+            {
+                cpuBytes += mesh.getCpuBytes();
+            }
+
+            const char* policy = cpuData == MeshCpuData::Full ? "full" : cpuData == MeshCpuData::Positions ? "positions" : "none";
+            const double mb = 1024.0 * 1024.0;
+            console_logger->info("[mesh-memory] {} keeping {}: peak +{:.1f} MB, steady +{:.1f} MB, mesh arrays {:.1f} MB",
+                path, policy, (std::max(peak, before) - before) / mb, (std::max(steady, before) - before) / mb, cpuBytes / mb);
+        }
+    }
+}
+
+void frustumCulling(int boxCount, int runs)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    // boxes scattered around a camera at the origin, so that some are in front, some behind and some straddle a plane
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> size(0.1f, 20.0f);
+    std::vector<BoundingBox> boxes(boxCount);
+    CullingBoxes soa;
+    soa.reserve(boxCount);
+    for (auto& box : boxes)
+    {
+        const glm::vec3 center(position(random), position(random), position(random));
+        const glm::vec3 extent(size(random), size(random), size(random));
+        box.min = center - extent;
+        box.max = center + extent;
+        soa.push_back(center, extent);
+    }
+
+    PerspectiveCamera camera(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    camera.transform.lookAt(glm::vec3(1.0f, 0.2f, -1.0f));
+    const Frustum frustum = camera.getFrustum();
+    const glm::mat4 identity(1.0f);
+
+    std::vector<uint8_t> scalarVisible(boxCount), simdVisible(boxCount);
+    float scalarMs = std::numeric_limits<float>::max(), simdMs = std::numeric_limits<float>::max();
+    size_t scalarCount = 0, simdCount = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        auto start = Clock::now();
+        scalarCount = 0;
+        for (int i = 0; i < boxCount; ++i)
+        {
+            scalarVisible[i] = frustum.intersect(boxes[i], identity) ? 1 : 0;
+            scalarCount += scalarVisible[i];
+        }
+        scalarMs = std::min(scalarMs, elapsedMs(start));
+
+        start = Clock::now();
+        simdCount = soa.cull(frustum, simdVisible.data());
+        simdMs = std::min(simdMs, elapsedMs(start));
+    }
+
+    size_t mismatches = 0;
+    for (int i = 0; i < boxCount; ++i)
+    {
+        mismatches += scalarVisible[i] != simdVisible[i] ? 1 : 0;
+    }
+
+    const double n = std::max(boxCount, 1);
+    console_logger->info("[frustum-culling] {} boxes, {} visible", boxCount, simdCount);
+    console_logger->info("[frustum-culling] scalar AoS: {:.3f} ms, {:.2f} ns per box", scalarMs, 1e6 * scalarMs / n);
+    console_logger->info("[frustum-culling] {} SoA: {:.3f} ms, {:.2f} ns per box ({:.1f}x)", CullingBoxes::getSimdName(),
+        simdMs, 1e6 * simdMs / n, scalarMs / std::max(simdMs, 1e-6f));
+    if (mismatches != 0 || scalarCount != simdCount)
+        console_logger->error("[frustum-culling] {} boxes differ between the scalar and the SIMD test", mismatches);
+}
+
+void sceneBvh(const std::vector<std::string>& modelPaths, int modelCount, int queries)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    // synthetic scene: models of a few meshes each, scattered with random transforms. the world boxes of the
+    // meshes are what SceneBvh builds on, so the tree is exercised without creating GL meshes
+    constexpr int meshesPerModel = 4;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+    std::vector<BoundingBox> meshBoxes(static_cast<size_t>(modelCount) * meshesPerModel);
+    std::vector<Transform> transforms(modelCount);
+    for (auto& box : meshBoxes)
+    {
+        const glm::vec3 center(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f);
+        const glm::vec3 extent = 0.05f + 0.25f * glm::vec3(unit(random), unit(random), unit(random));
+        box.min = center - extent;
+        box.max = center + extent;
+    }
+    auto getWorldBoxes = [&](std::vector<BoundingBox>& boxes, const std::vector<uint32_t>* models) {
+        auto transformModel = [&](uint32_t i) {
+            const glm::mat4 modelMatrix = transforms[i].getLocalMatrix();
+            for (int m = 0; m < meshesPerModel; ++m)
+            {
+                glm::vec3 center, extent;
+                Frustum::transformBox(meshBoxes[i * meshesPerModel + m], modelMatrix, center, extent);
+                boxes[i * meshesPerModel + m].min = center - extent;
+                boxes[i * meshesPerModel + m].max = center + extent;
+            }
+        };
+        if (models == nullptr)
+            for (int i = 0; i < modelCount; ++i)
+                transformModel(i);
+        else
+            for (uint32_t i : *models)
+                transformModel(i);
+    };
+    for (auto& transform : transforms)
+    {
+        transform.position = glm::vec3(position(random), 0.1f * position(random), position(random));
+        transform.rotation = glm::angleAxis(6.2832f * unit(random), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform.scale = glm::vec3(1.0f + 9.0f * unit(random));
+    }
+    std::vector<BoundingBox> boxes(meshBoxes.size());
+    getWorldBoxes(boxes, nullptr);
+
+    Bvh bvh;
+    auto start = Clock::now();
+    bvh.build(boxes);
+    const float buildMs = elapsedMs(start);
+    console_logger->info("[scene-bvh] {} models, {} meshes: build {:.2f} ms, {} nodes, SAH cost {:.1f}",
+        modelCount, boxes.size(), buildMs, bvh.getNodes().size(), bvh.getCost());
+
+    // 1% of the models move a little: partial refit. then all of them move: full refit against a rebuild
+    std::vector<uint32_t> movedModels, changed;
+    for (int i = 0; i < modelCount; i += 100)
+    {
+        transforms[i].position += glm::vec3(5.0f * unit(random), 0.0f, 5.0f * unit(random));
+        movedModels.push_back(i);
+        for (int m = 0; m < meshesPerModel; ++m)
+            changed.push_back(i * meshesPerModel + m);
+    }
+    start = Clock::now();
+    getWorldBoxes(boxes, &movedModels);
+    bvh.refit(boxes, changed);
+    const float partialMs = elapsedMs(start);
+    for (auto& transform : transforms)
+    {
+        transform.position += glm::vec3(5.0f * unit(random), 0.0f, 5.0f * unit(random));
+    }
+    start = Clock::now();
+    getWorldBoxes(boxes, nullptr);
+    bvh.refit(boxes);
+    const float fullMs = elapsedMs(start);
+    const float refitCost = bvh.getCost();
+    start = Clock::now();
+    Bvh rebuilt;
+    rebuilt.build(boxes);
+    const float rebuildMs = elapsedMs(start);
+    console_logger->info("[scene-bvh] refit of {} moved models {:.3f} ms, of all models {:.3f} ms (cost {:.1f}), "
+        "rebuild {:.2f} ms (cost {:.1f})", movedModels.size(), partialMs, fullMs, refitCost, rebuildMs, rebuilt.getCost());
+
+    // frustum culling: hierarchical against the flat SIMD test of every box
+    PerspectiveCamera camera(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    camera.transform.position = glm::vec3(0.0f, 50.0f, 0.0f);
+    CullingBoxes flat;
+    flat.reserve(boxes.size());
+    for (const auto& box : boxes)
+        flat.push_back(0.5f * (box.min + box.max), 0.5f * (box.max - box.min));
+    std::vector<uint8_t> flatVisible(boxes.size()), bvhVisible(boxes.size());
+    constexpr int views = 16;
+    float flatMs = 0.0f, bvhMs = 0.0f;
+    size_t visible = 0, mismatches = 0;
+    for (int view = 0; view < views; ++view)
+    {
+        const float angle = 6.2832f * view / views;
+        camera.transform.lookAt(camera.transform.position + glm::vec3(std::cos(angle), -0.1f, std::sin(angle)));
+        const Frustum frustum = camera.getFrustum();
+        start = Clock::now();
+        flat.cull(frustum, flatVisible.data());
+        flatMs += elapsedMs(start);
+
+        start = Clock::now();
+        std::fill(bvhVisible.begin(), bvhVisible.end(), 0);
+        rebuilt.cull(frustum, [&](uint32_t mesh) { bvhVisible[mesh] = 1; });
+        bvhMs += elapsedMs(start);
+
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            visible += bvhVisible[i];
+            mismatches += flatVisible[i] != bvhVisible[i] ? 1 : 0;
+        }
+    }
+    console_logger->info("[scene-bvh] frustum culling, {} of {} meshes visible: flat {} {:.3f} ms, bvh {:.3f} ms per view",
+        visible / views, boxes.size(), CullingBoxes::getSimdName(), flatMs / views, bvhMs / views);
+    if (mismatches != 0)
+        console_logger->error("[scene-bvh] {} culling results differ between flat boxes and bvh", mismatches);
+
+    // nearest box along random rays through the scene, a sample against testing every box
+    std::vector<Ray> rays(queries);
+    for (auto& ray : rays)
+    {
+        const glm::vec3 origin(position(random), 50.0f, position(random));
+        const glm::vec3 target(position(random), 0.0f, position(random));
+        ray = Ray(origin, glm::normalize(target - origin));
+    }
+    auto nearestBox = [&](const Ray& ray, float& tMax, uint32_t& nearest) {
+        return rebuilt.raycast(ray, tMax, [&](uint32_t mesh, float& t) {
+            float tEnter;
+            if (!ray.intersect(boxes[mesh], t, tEnter) || tEnter >= t)
+                return;
+            t = tEnter, nearest = mesh;
+        });
+    };
+    start = Clock::now();
+    size_t hits = 0;
+    for (const auto& ray : rays)
+    {
+        float tMax = std::numeric_limits<float>::max();
+        uint32_t nearest = 0;
+        hits += nearestBox(ray, tMax, nearest) ? 1 : 0;
+    }
+    const float rayMs = elapsedMs(start);
+    const int bruteRays = std::min(queries, 100);
+    size_t rayMismatches = 0;
+    start = Clock::now();
+    for (int k = 0; k < bruteRays; ++k)
+    {
+        float best = std::numeric_limits<float>::max(), tEnter;
+        for (const auto& box : boxes)
+        {
+            if (rays[k].intersect(box, best, tEnter) && tEnter < best)
+                best = tEnter;
+        }
+        float tMax = std::numeric_limits<float>::max();
+        uint32_t nearest = 0;
+        nearestBox(rays[k], tMax, nearest);
+        rayMismatches += tMax != best ? 1 : 0;
+    }
+    const float bruteMs = elapsedMs(start);
+    console_logger->info("[scene-bvh] {} rays, {} hits: {:.0f} rays per second, brute force {:.0f} rays per second",
+        queries, hits, 1000.0f * queries / std::max(rayMs, 1e-3f), 1000.0f * bruteRays / std::max(bruteMs, 1e-3f));
+    if (rayMismatches != 0)
+        console_logger->error("[scene-bvh] {} rays hit a different box than with brute force", rayMismatches);
+
+    // light to object overlap: meshes within the range of randomly placed point lights
+    PointLight light;
+    const float range = light.getRange();
+    start = Clock::now();
+    size_t overlaps = 0;
+    for (int k = 0; k < queries; ++k)
+    {
+        const glm::vec3 center(position(random), 0.0f, position(random));
+        rebuilt.overlap(center, range, [&](uint32_t) { overlaps++; });
+    }
+    const float overlapMs = elapsedMs(start);
+    console_logger->info("[scene-bvh] {} point light queries (range {:.1f}): {:.0f} queries per second, {:.1f} meshes each",
+        queries, range, 1000.0f * queries / std::max(overlapMs, 1e-3f), static_cast<double>(overlaps) / std::max(queries, 1));
+
+    // triangle level: picking rays against real models that keep their positions
+    for (const auto& path : modelPaths)
+    {
+        Scene scene;
+        AssimpModel model(path, false, true, true, MeshCpuData::Positions);
+        if (model.meshes.empty())
+        {
+            console_logger->error("[scene-bvh] load {} failed", path);
+            continue;
+        }
+        const glm::vec3 center = 0.5f * (model.box.min + model.box.max);
+        const float radius = 0.5f * glm::length(model.box.max - model.box.min);
+        scene.addToScene(model);
+        scene.update();
+
+        std::vector<Ray> picks(queries);
+        for (auto& ray : picks)
+        {
+            const glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) - 0.5f);
+            const glm::vec3 target = center + 0.5f * radius * (glm::vec3(unit(random), unit(random), unit(random)) - 0.5f);
+            ray = Ray(target - 2.0f * radius * direction, direction);
+        }
+
+        // the first pick builds the triangle trees of the meshes it reaches
+        RayHit hit;
+        start = Clock::now();
+        scene.pick(picks[0], hit);
+        const float firstMs = elapsedMs(start);
+        start = Clock::now();
+        size_t triangleHits = 0;
+        for (const auto& ray : picks)
+        {
+            triangleHits += scene.pick(ray, hit) && hit.triangle != RayHit::kNoTriangle ? 1 : 0;
+        }
+        const float pickMs = elapsedMs(start);
+        console_logger->info("[scene-bvh] {}: first pick {:.2f} ms, then {:.0f} picks per second, {} of {} hit a triangle",
+            path, firstMs, 1000.0f * queries / std::max(pickMs, 1e-3f), triangleHits, queries);
+    }
+}
+
+void sceneGraph(int modelCount, int nodesPerModel, int frames)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    // synthetic models of a root and a chain of imported nodes, like the node trees assimp hands over
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Transform> transforms(modelCount);
+    std::vector<uint32_t> roots(modelCount);
+    SceneGraph graph;
+    for (int i = 0; i < modelCount; ++i)
+    {
+        transforms[i].position = 1000.0f * glm::vec3(unit(random), unit(random), unit(random));
+        roots[i] = graph.addNode(SceneGraph::kNoParent, transforms[i].getLocalMatrix());
+        for (int n = 0; n < nodesPerModel; ++n)
+        {
+            const uint32_t parent = n == 0 ? roots[i] : roots[i] + 1 + static_cast<uint32_t>(random() % n);
+            graph.addNode(parent, glm::translate(glm::mat4(1.0f), glm::vec3(unit(random), unit(random), unit(random))));
+        }
+    }
+    graph.update();
+
+    // what the passes did before: rebuild translate * rotate * scale of every model for every mesh of every pass.
+    // forward with one shadow map reads it twice per mesh, plus once for the lod of each pass
+    constexpr int reads = 2;
+    glm::mat4 sink(0.0f);
+    auto start = Clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+        for (int i = 0; i < modelCount; ++i)
+            for (int n = 0; n < reads * nodesPerModel + reads; ++n)
+                sink += transforms[i].getLocalMatrix();
+    const float trsMs = elapsedMs(start) / frames;
+
+    // every model moves each frame: all nodes are recomputed once
+    size_t updated = 0;
+    start = Clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (int i = 0; i < modelCount; ++i)
+        {
+            transforms[i].position.y += 0.01f;
+            graph.setLocalMatrix(roots[i], transforms[i].getLocalMatrix());
+        }
+        updated += graph.update();
+    }
+    const float allMs = elapsedMs(start) / frames;
+    const size_t allNodes = updated / frames;
+
+    // 1% of the models move: only their subtrees are recomputed, the roots of the others are compared
+    updated = 0;
+    start = Clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (int i = 0; i < modelCount; ++i)
+        {
+            if (i % 100 == frame % 100)
+                transforms[i].position.y += 0.01f;
+            graph.setLocalMatrix(roots[i], transforms[i].getLocalMatrix());
+        }
+        updated += graph.update();
+    }
+    const float fewMs = elapsedMs(start) / frames;
+    const size_t fewNodes = updated / frames;
+
+    // the sum keeps the matrices above from being optimized away
+    console_logger->info("[scene-graph] {} models of {} nodes: TRS per mesh and pass {:.3f} ms per frame (sum {:.1f})",
+        modelCount, nodesPerModel + 1, trsMs, sink[3][1]);
+    console_logger->info("[scene-graph] all models moving: {} nodes updated, {:.3f} ms per frame", allNodes, allMs);
+    console_logger->info("[scene-graph] 1% moving: {} nodes updated, {:.3f} ms per frame", fewNodes, fewMs);
+}
+
+void sceneObjects(const std::vector<int>& objectCounts, int frames)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    // a few shared models of a few meshes each, as a placed copy only refers to them
+    constexpr int modelCount = 4;
+    constexpr int meshesPerModel = 4;
+    std::vector<BoundingBox> modelBoxes(modelCount);
+    std::vector<std::vector<glm::mat4>> meshMatrices(modelCount);
+    for (int m = 0; m < modelCount; ++m)
+    {
+        modelBoxes[m].min = glm::vec3(-1.0f - m);
+        modelBoxes[m].max = glm::vec3(1.0f + m);
+        for (int k = 0; k < meshesPerModel; ++k)
+            meshMatrices[m].push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f * k, 0.0f)));
+    }
+
+    // the layout the passes walked before: one heap object per placement that owns its meshes and material,
+    // with the model matrix rebuilt for every mesh
+    struct MeshStub
+    {
+        std::vector<unsigned int> textures;
+        BoundingBox box;
+        unsigned int VAO = 0;
+    };
+    struct ModelLike
+    {
+        std::string path;
+        std::vector<MeshStub> meshes;
+        std::unique_ptr<PhongMaterial> material;
+        BoundingBox box;
+        Transform transform;
+        bool display = true;
+    };
+
+    PerspectiveCamera camera(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    camera.transform.position = glm::vec3(0.0f, 20.0f, 0.0f);
+    camera.transform.lookAt(glm::vec3(1.0f, 19.8f, 1.0f));
+    const Frustum frustum = camera.getFrustum();
+
+    for (int count : objectCounts)
+    {
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        const float radius = 10.0f * std::sqrt(static_cast<float>(count));
+        std::vector<Transform> transforms(count);
+        std::vector<uint32_t> models(count);
+        for (int i = 0; i < count; ++i)
+        {
+            transforms[i].position = glm::vec3(radius * (2.0f * unit(random) - 1.0f), 0.0f, radius * (2.0f * unit(random) - 1.0f));
+            transforms[i].rotation = glm::angleAxis(6.2832f * unit(random), glm::vec3(0.0f, 1.0f, 0.0f));
+            models[i] = static_cast<uint32_t>(random() % modelCount);
+        }
+
+        SceneObjects objects;
+        std::vector<std::unique_ptr<ModelLike>> modelLikes;
+        for (int i = 0; i < count; ++i)
+        {
+            objects.add(models[i], transforms[i]);
+            auto model = std::make_unique<ModelLike>();
+            model->path = "model/copy" + std::to_string(i) + ".obj";
+            model->meshes.resize(meshesPerModel);
+            for (auto& mesh : model->meshes)
+                mesh.textures.resize(3);
+            model->material = std::make_unique<PhongMaterial>();
+            model->box = modelBoxes[models[i]];
+            model->transform = transforms[i];
+            modelLikes.push_back(std::move(model));
+        }
+        objects.update(modelBoxes);
+
+        // per frame: 1% of the objects move, then update, cull against the camera and walk the draws
+        ObjectVisibility visibility;
+        glm::mat4 sink(0.0f);
+        float updateMs = 0.0f, cullMs = 0.0f, submitMs = 0.0f;
+        size_t visible = 0;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            auto start = Clock::now();
+            for (int i = frame % 100; i < count; i += 100)
+            {
+                Transform transform = objects.getTransform(i);
+                transform.position.y += 0.01f;
+                objects.setTransform(i, transform);
+            }
+            objects.update(modelBoxes);
+            updateMs += elapsedMs(start);
+
+            start = Clock::now();
+            visible += objects.cull(&frustum, visibility);
+            cullMs += elapsedMs(start);
+
+            start = Clock::now();
+            for (uint32_t object : visibility.objects)
+            {
+                const glm::mat4& matrix = objects.getMatrix(object);
+                for (const auto& meshMatrix : meshMatrices[objects.getModel(object)])
+                    sink += matrix * meshMatrix;
+            }
+            submitMs += elapsedMs(start);
+        }
+
+        float aosCullMs = 0.0f, aosSubmitMs = 0.0f;
+        size_t aosVisible = 0;
+        std::vector<const ModelLike*> aosList;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            for (int i = frame % 100; i < count; i += 100)
+                modelLikes[i]->transform.position.y += 0.01f;
+
+            auto start = Clock::now();
+            aosList.clear();
+            for (const auto& model : modelLikes)
+            {
+                if (model->display && frustum.intersect(model->box, model->transform.getLocalMatrix()))
+                    aosList.push_back(model.get());
+            }
+            aosVisible += aosList.size();
+            aosCullMs += elapsedMs(start);
+
+            start = Clock::now();
+            for (const ModelLike* model : aosList)
+            {
+                for (size_t m = 0; m < model->meshes.size(); ++m)
+                    sink += model->transform.getLocalMatrix() * meshMatrices[0][m];
+            }
+            aosSubmitMs += elapsedMs(start);
+        }
+
+        // the sum keeps the matrices above from being optimized away
+        console_logger->info("[scene-objects] {} objects, {} visible: update {:.3f} ms, cull {:.3f} ms ({}), submit {:.3f} ms per frame (sum {:.1f})",
+            count, visible / frames, updateMs / frames, cullMs / frames, CullingBoxes::getSimdName(), submitMs / frames, sink[3][1]);
+        console_logger->info("[scene-objects] {} model objects, {} visible: cull {:.3f} ms, submit {:.3f} ms per frame",
+            count, aosVisible / frames, aosCullMs / frames, aosSubmitMs / frames);
+        if (visible != aosVisible)
+            console_logger->error("[scene-objects] {} visible objects against {} model objects", visible, aosVisible);
+    }
+}
+
+bool occlusionCulling(int blockCount, int boxCount, int frames)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+    const bool passed = checkOcclusionBuffer();
+
+    // a grid of closed blocks of 12 triangles, the camera at street level looking down a diagonal
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const int side = std::max(1, static_cast<int>(std::sqrt(static_cast<float>(blockCount))));
+    constexpr float spacing = 20.0f;
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    for (int z = 0; z < side; ++z)
+    {
+        for (int x = 0; x < side; ++x)
+        {
+            const glm::vec3 extent(4.0f + 4.0f * unit(random), 10.0f + 30.0f * unit(random), 4.0f + 4.0f * unit(random));
+            addBlock(glm::vec3(spacing * x, 0.0f, -spacing * z), extent, positions, indices);
+        }
+    }
+
+    // small boxes in the streets between the blocks
+    std::vector<glm::vec3> centers(boxCount);
+    const glm::vec3 extent(1.0f);
+    for (auto& center : centers)
+    {
+        center = glm::vec3(spacing * ((random() % side) + 0.5f), 1.0f, -spacing * ((random() % side) + 0.5f * unit(random)));
+    }
+
+    PerspectiveCamera camera(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2000.0f);
+    camera.transform.position = glm::vec3(-10.0f, 2.0f, 10.0f);
+    camera.transform.lookAt(glm::vec3(spacing * side, 2.0f, -spacing * side));
+    const glm::mat4 viewProjection = camera.getProjectionMatrix() * camera.getViewMatrix();
+    const Frustum frustum = camera.getFrustum();
+
+    std::vector<size_t> threadCounts;
+    for (size_t n = 1; n < ThreadPool::getDefaultThreadCount(); n *= 2)
+    {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(ThreadPool::getDefaultThreadCount());
+
+    OcclusionBuffer buffer;
+    for (size_t threads : threadCounts)
+    {
+        ThreadPool pool(threads);
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            buffer.clear();
+            buffer.addOccluder(positions.data(), sizeof(glm::vec3), indices.data(), indices.size(), viewProjection);
+            buffer.render(pool);
+        }
+        console_logger->info("[occlusion-culling] {} blocks, {} triangles rasterized at {}x{} on {} threads: {:.3f} ms ({})",
+            side * side, buffer.getTriangleCount(), buffer.getWidth(), buffer.getHeight(), threads,
+            elapsedMs(start) / frames, OcclusionBuffer::getSimdName());
+    }
+
+    size_t inFrustum = 0, visible = 0;
+    auto start = Clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (const auto& center : centers)
+        {
+            if (!frustum.intersect(center, extent))
+                continue;
+            inFrustum++;
+            visible += buffer.isVisible(center, extent, viewProjection);
+        }
+    }
+    const float testMs = elapsedMs(start) / frames;
+    inFrustum /= frames, visible /= frames;
+    console_logger->info("[occlusion-culling] {} boxes, {} in the frustum, {} hidden ({:.1f}%): {:.3f} ms, {:.1f} ns per box",
+        boxCount, inFrustum, inFrustum - visible, 100.0f * (inFrustum - visible) / std::max<size_t>(inFrustum, 1), testMs,
+        1e6f * testMs / std::max<size_t>(inFrustum, 1));
+    return passed;
+}
+
+bool gpuCulling(const std::string& shaderBasePath, const std::vector<std::string>& modelPaths, int copiesPerModel, int views)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+    if (!GpuCulling::isSupported())
+    {
+        console_logger->error("[gpu-culling] compute shaders need GL 4.3");
+        return false;
+    }
+
+    Scene scene;
+    for (const auto& path : modelPaths)
+    {
+        AssimpModel model(path);
+        if (model.meshes.empty())
+        {
+            console_logger->error("[gpu-culling] load {} failed", path);
+            continue;
+        }
+        scene.addToScene(model);
+    }
+    for (size_t i = 0; i < scene.models.size(); i++)
+    {
+        scene.scatterObjects(i, copiesPerModel);
+    }
+    scene.update();
+
+    GpuCulling culling(shaderBasePath);
+    auto start = Clock::now();
+    culling.update(scene.models, scene.graph, scene.objects);
+    glFinish();
+    const float updateMs = elapsedMs(start);
+
+    // the CPU culls the same world boxes the records carry
+    const size_t drawCount = culling.getDrawCount();
+    CullingBoxes boxes;
+    boxes.reserve(drawCount);
+    float radius = 1.0f;
+    for (size_t i = 0; i < drawCount; i++)
+    {
+        boxes.push_back(culling.getCenter(i), culling.getExtent(i));
+        radius = std::max(radius, glm::length(culling.getCenter(i)));
+    }
+
+    std::vector<uint8_t> cpuVisible(drawCount), gpuVisible;
+    size_t visible = 0, mismatches = 0, borderline = 0;
+    float gpuMs = 0.0f, cpuMs = 0.0f;
+    PerspectiveCamera camera(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 2.0f * radius);
+    for (int view = 0; view < views; ++view)
+    {
+        // half of the views from inside the scene, half from its edge
+        const float angle = 6.2832f * view / std::max(views, 1);
+        const float distance = (view & 1) ? radius : 0.25f * radius;
+        camera.transform.position = glm::vec3(distance * std::cos(angle), 0.1f * radius, distance * std::sin(angle));
+        camera.transform.lookAt(glm::vec3(0.0f));
+        const Frustum frustum = camera.getFrustum();
+
+        start = Clock::now();
+        culling.cull(frustum, false);
+        glFinish();
+        gpuMs += elapsedMs(start);
+        culling.readVisibility(gpuVisible);
+
+        start = Clock::now();
+        visible += boxes.cull(frustum, cpuVisible.data());
+        cpuMs += elapsedMs(start);
+
+        for (size_t i = 0; i < drawCount; i++)
+        {
+            if ((gpuVisible[i] != 0) == (cpuVisible[i] != 0))
+                continue;
+            if (touchesPlane(frustum, culling.getCenter(i), culling.getExtent(i)))
+                borderline++;
+            else
+                mismatches++;
+        }
+    }
+
+    const int n = std::max(views, 1);
+    console_logger->info("[gpu-culling] {} draws in {} batches, update {:.2f} ms", drawCount, culling.getBatches().size(), updateMs);
+    console_logger->info("[gpu-culling] per view: compute {:.3f} ms, CPU SIMD {:.3f} ms, {} visible, {} mismatches and {} "
+        "differing boxes touching a plane in {} views", gpuMs / n, cpuMs / n, visible / n, mismatches, borderline, views);
+    if (mismatches != 0)
+        console_logger->error("[gpu-culling] the visible sets differ for {} boxes clear of every plane", mismatches);
+    return mismatches == 0;
+}
+
+void shadowCulling(Renderer& renderer, const std::vector<std::string>& modelPaths, int copiesPerModel, int width, int height, int frames)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    Scene scene;
+    scene.directionalLights.push_back(DirectionalLight());
+    float maxSize = 1.0f;
+    for (const auto& path : modelPaths)
+    {
+        AssimpModel model(path);
+        if (model.meshes.empty())
+        {
+            console_logger->error("[shadow-culling] load {} failed", path);
+            continue;
+        }
+        maxSize = std::max(maxSize, glm::length(model.box.max - model.box.min));
+        scene.addToScene(model);
+    }
+    for (size_t i = 0; i < scene.models.size(); i++)
+    {
+        scene.scatterObjects(i, copiesPerModel);
+    }
+    scene.update();
+
+    auto camera = std::make_unique<PerspectiveCamera>(glm::radians(45.0f), 1.0f * width / height, 0.1f, 1000.0f);
+    camera->transform.position = glm::vec3(0.0f, maxSize, 3.0f * maxSize);
+    camera->transform.lookAt(glm::vec3(0.0f));
+    renderer.setScreenSize(height, width);
+
+    for (ForwardShaderType shaderType : { ForwardShaderType::CSM, ForwardShaderType::Phong })
+    {
+        const char* shaderName = shaderType == ForwardShaderType::CSM ? "csm" : "phong";
+        for (bool culled : { false, true })
+        {
+            UIOptions options;
+            options.fShaderType = shaderType;
+            options.frustumCulling = culled;
+
+            console_logger->set_level(spdlog::level::warn);
+            std::vector<RenderStats::ShadowMap> maps;
+            float ms = 0.0f;
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                const auto start = Clock::now();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.render(camera, scene, options);
+                glFinish();
+                ms += elapsedMs(start);
+                const std::vector<RenderStats::ShadowMap>& frameMaps = RenderStats::getFrame().shadowMaps;
+                maps.resize(std::max(maps.size(), frameMaps.size()));
+                for (size_t i = 0; i < frameMaps.size(); i++)
+                {
+                    maps[i].draws += frameMaps[i].draws;
+                    maps[i].triangles += frameMaps[i].triangles;
+                }
+            }
+            console_logger->set_level(spdlog::level::info);
+
+            const int n = std::max(frames, 1);
+            console_logger->info("[shadow-culling] {} {}: {:.2f} ms per frame", shaderName, culled ? "culled" : "all casters", ms / n);
+            for (size_t i = 0; i < maps.size(); i++)
+            {
+                console_logger->info("[shadow-culling]   map {}: {} draws, {} triangles", i, maps[i].draws / n, maps[i].triangles / n);
+            }
+        }
+    }
+}
+
+void clusteredLighting(Renderer& renderer, const std::vector<std::string>& modelPaths, const std::vector<int>& lightCounts,
+    int width, int height, int frames)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    Scene scene;
+    scene.directionalLights.push_back(DirectionalLight());
+    for (const auto& path : modelPaths)
+    {
+        AssimpModel model(path);
+        if (model.meshes.empty())
+        {
+            console_logger->error("[clustered-lighting] load {} failed", path);
+            continue;
+        }
+        scene.addToScene(model);
+    }
+    for (size_t i = 0; i < scene.models.size(); i++)
+    {
+        scene.scatterObjects(i, 100);
+    }
+    scene.update();
+
+    // the lights spread over the copies, each reaching a few of them
+    float radius = 1.0f;
+    for (uint32_t object = 0; object < scene.objects.size(); object++)
+    {
+        radius = std::max(radius, glm::length(scene.objects.getCenter(object)));
+    }
+    const float range = 0.15f * radius;
+
+    auto camera = std::make_unique<PerspectiveCamera>(glm::radians(45.0f), 1.0f * width / height, 0.1f, 4.0f * radius);
+    camera->transform.position = glm::vec3(0.0f, 0.3f * radius, 1.2f * radius);
+    camera->transform.lookAt(glm::vec3(0.0f));
+    renderer.setScreenSize(height, width);
+
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    LightClusters clusters;
+    for (int count : lightCounts)
+    {
+        // half point lights, half spot lights pointing down, attenuated to range
+        scene.pointLights.clear();
+        scene.spotLights.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            const glm::vec3 position(radius * (2.0f * unit(random) - 1.0f), 0.1f * radius * unit(random), radius * (2.0f * unit(random) - 1.0f));
+            const glm::vec3 color(unit(random), unit(random), unit(random));
+            if (i % 2 == 0)
+            {
+                PointLight light;
+                light.position = position;
+                light.ambient = glm::vec3(0.0f);
+                light.diffuse = light.specular = color;
+                light.kc = 1.0f, light.kl = 0.0f, light.kq = 255.0f / (range * range);
+                scene.pointLights.push_back(light);
+            }
+            else
+            {
+                SpotLight light;
+                light.position = position;
+                light.direction = glm::normalize(glm::vec3(unit(random) - 0.5f, -1.0f, unit(random) - 0.5f));
+                light.angle = glm::radians(20.0f + 40.0f * unit(random));
+                light.diffuse = light.specular = color;
+                light.kc = 1.0f, light.kl = 0.0f, light.kq = 255.0f / (range * range);
+                scene.spotLights.push_back(light);
+            }
+        }
+
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            clusters.build(scene.pointLights, scene.spotLights, camera->getViewMatrix(), camera->getProjectionMatrix(), camera->znear, camera->zfar);
+        }
+        const float binMs = elapsedMs(start) / std::max(frames, 1);
+
+        float forwardMs = 0.0f, deferredMs = 0.0f;
+        for (RenderType renderType : { RenderType::FORAWRD, RenderType::DEFERRED })
+        {
+            UIOptions options;
+            options.renderType = renderType;
+            options.fShaderType = ForwardShaderType::ForwardPlus;
+            options.dShaderType = DeferredShaderType::ClusteredLighting;
+            options.useShadow = false;
+
+            console_logger->set_level(spdlog::level::warn);
+            float ms = 0.0f;
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                start = Clock::now();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.render(camera, scene, options);
+                glFinish();
+                ms += elapsedMs(start);
+            }
+            console_logger->set_level(spdlog::level::info);
+            (renderType == RenderType::FORAWRD ? forwardMs : deferredMs) = ms / std::max(frames, 1);
+        }
+        console_logger->info("[clustered-lighting] {} lights: binning {:.3f} ms, {} cluster entries, Forward+ {:.2f} ms, "
+            "deferred {:.2f} ms per frame", count, binMs, clusters.getIndexCount(), forwardMs, deferredMs);
+    }
+}
+
+void uniformUpdate(const std::string& shaderBasePath, int meshCount, int frames)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    // the uniforms CSMShader::renderMesh set for every mesh before the uniform blocks, every one of them used
+    const char* vertexCode = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+uniform mat4 model;
+uniform bool packedVertex;
+void main()
+{
+    gl_Position = model * vec4(packedVertex ? -aPos : aPos, 1.0);
+})";
+    const char* fragmentCode = R"(#version 330 core
+out vec4 FragColor;
+struct Material {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+uniform Material material;
+uniform bool LayerVisulization;
+uniform mat4 lightSpaceMatrices[16];
+uniform float cascadePlaneDistances[16];
+uniform int cascadeCount;
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_normal1;
+uniform sampler2DArray shadowMap;
+uniform bool use_texture_kd;
+uniform bool use_texture_ks;
+uniform bool use_texture_normal;
+void main()
+{
+    vec4 color = vec4(material.ambient + material.diffuse + material.specular, material.shininess);
+    for (int i = 0; i < cascadeCount; i++)
+        color += lightSpaceMatrices[i] * vec4(cascadePlaneDistances[i]);
+    if (use_texture_kd)
+        color *= texture(texture_diffuse1, vec2(0.5));
+    if (use_texture_normal)
+        color *= texture(texture_normal1, vec2(0.5));
+    if (use_texture_ks || LayerVisulization)
+        color *= texture(shadowMap, vec3(0.5));
+    FragColor = color;
+})";
+    GLSLProgram program;
+    program.attachVertexShader(vertexCode);
+    program.attachFragmentShader(fragmentCode);
+    program.link();
+    program.use();
+    GLint handle = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &handle);
+
+    // with 4 cascades
+    constexpr int kCascades = 4;
+    const glm::mat4 matrices[kCascades] = { glm::mat4(1.0f), glm::mat4(2.0f), glm::mat4(3.0f), glm::mat4(4.0f) };
+    const float distances[kCascades - 1] = { 10.0f, 50.0f, 200.0f };
+    const glm::vec3 color(0.5f);
+    const int uniformsPerMesh = 14 + 2 * kCascades - 1;
+    const std::string textureTypes[] = { "texture_diffuse", "texture_normal" };
+
+    // as the setters did before the location table: a name string per uniform, glGetUniformLocation per call
+    auto setByString = [&](const glm::mat4& model)
+    {
+        auto location = [&](const std::string& name) { return glGetUniformLocation(handle, name.c_str()); };
+        const std::string materialStr = "material";
+        glUniform3fv(location(materialStr + ".ambient"), 1, &color[0]);
+        glUniform3fv(location(materialStr + ".diffuse"), 1, &color[0]);
+        glUniform3fv(location(materialStr + ".specular"), 1, &color[0]);
+        glUniform1f(location(materialStr + ".shininess"), 32.0f);
+        glUniform1i(location("LayerVisulization"), 0);
+        glUniformMatrix4fv(location("model"), 1, GL_FALSE, &model[0][0]);
+        for (int i = 0; i < kCascades; i++)
+        {
+            glUniformMatrix4fv(location("lightSpaceMatrices[" + std::to_string(i) + "]"), 1, GL_FALSE, &matrices[i][0][0]);
+            if (i < kCascades - 1)
+                glUniform1f(location("cascadePlaneDistances[" + std::to_string(i) + "]"), distances[i]);
+        }
+        glUniform1i(location("cascadeCount"), kCascades - 1);
+        for (int i = 0; i < 2; i++)
+            glUniform1i(location(textureTypes[i] + std::to_string(1)), i + 1);
+        glUniform1i(location("use_texture_kd"), 1);
+        glUniform1i(location("use_texture_ks"), 0);
+        glUniform1i(location("use_texture_normal"), 1);
+        glUniform1i(location("packedVertex"), 0);
+        glUniform1i(location("shadowMap"), 0);
+    };
+
+    // the setters by name, literals hashed at compile time and looked up in the location table
+    auto setByName = [&](const glm::mat4& model)
+    {
+        program.setUniformVec3("material.ambient", color);
+        program.setUniformVec3("material.diffuse", color);
+        program.setUniformVec3("material.specular", color);
+        program.setUniformFloat("material.shininess", 32.0f);
+        program.setUniformBool("LayerVisulization", false);
+        program.setUniformMat4("model", model);
+        program.setUniformMat4Array("lightSpaceMatrices", matrices, kCascades);
+        program.setUniformFloatArray("cascadePlaneDistances", distances, kCascades - 1);
+        program.setUniformInt("cascadeCount", kCascades - 1);
+        std::string scratch;
+        for (int i = 0; i < 2; i++)
+            program.setUniformInt(getSamplerUniform(textureTypes[i], 1, scratch), i + 1);
+        program.setUniformBool("use_texture_kd", true);
+        program.setUniformBool("use_texture_ks", false);
+        program.setUniformBool("use_texture_normal", true);
+        program.setUniformBool("packedVertex", false);
+        program.setUniformInt("shadowMap", 0);
+    };
+
+    // the setters by location, the handles looked up once
+    struct Locations
+    {
+        GLint ambient, diffuse, specular, shininess, layers, model, lightSpaceMatrices, cascadePlaneDistances, cascadeCount;
+        GLint samplers[2];
+        GLint useKd, useKs, useNormal, packedVertex, shadowMap;
+    };
+    const Locations locations = {
+        program.getUniformLocation("material.ambient"), program.getUniformLocation("material.diffuse"),
+        program.getUniformLocation("material.specular"), program.getUniformLocation("material.shininess"),
+        program.getUniformLocation("LayerVisulization"), program.getUniformLocation("model"),
+        program.getUniformLocation("lightSpaceMatrices"), program.getUniformLocation("cascadePlaneDistances"),
+        program.getUniformLocation("cascadeCount"),
+        { program.getUniformLocation("texture_diffuse1"), program.getUniformLocation("texture_normal1") },
+        program.getUniformLocation("use_texture_kd"), program.getUniformLocation("use_texture_ks"),
+        program.getUniformLocation("use_texture_normal"), program.getUniformLocation("packedVertex"),
+        program.getUniformLocation("shadowMap") };
+    auto setByLocation = [&](const glm::mat4& model)
+    {
+        program.setUniformVec3(locations.ambient, color);
+        program.setUniformVec3(locations.diffuse, color);
+        program.setUniformVec3(locations.specular, color);
+        program.setUniformFloat(locations.shininess, 32.0f);
+        program.setUniformBool(locations.layers, false);
+        program.setUniformMat4(locations.model, model);
+        program.setUniformMat4Array(locations.lightSpaceMatrices, matrices, kCascades);
+        program.setUniformFloatArray(locations.cascadePlaneDistances, distances, kCascades - 1);
+        program.setUniformInt(locations.cascadeCount, kCascades - 1);
+        for (int i = 0; i < 2; i++)
+            program.setUniformInt(locations.samplers[i], i + 1);
+        program.setUniformBool(locations.useKd, true);
+        program.setUniformBool(locations.useKs, false);
+        program.setUniformBool(locations.useNormal, true);
+        program.setUniformBool(locations.packedVertex, false);
+        program.setUniformInt(locations.shadowMap, 0);
+    };
+
+    // the uniform blocks of the CSM shaders: the frame block pushed to the ring once per frame, the draw block
+    // per mesh and bound by range, only the samplers left as uniforms
+    registerUniformBlocks();
+    GLSLProgram blockProgram;
+    blockProgram.attachVertexShaderFromFile(shaderBasePath + "/csm/csm.vert");
+    blockProgram.attachFragmentShaderFromFile(shaderBasePath + "/csm/csm.frag");
+    blockProgram.link();
+    bindUniformBlocks(blockProgram);
+    const GLint blockSamplers[3] = { blockProgram.getUniformLocation("texture_diffuse1"),
+        blockProgram.getUniformLocation("texture_normal1"), blockProgram.getUniformLocation("shadowMap") };
+    UniformRing ring;
+    FrameUniforms frameUniforms = {};
+    std::copy(matrices, matrices + kCascades, frameUniforms.lightSpaceMatrices);
+    for (int i = 0; i < kCascades - 1; i++)
+        frameUniforms.cascadePlaneDistances[i].x = distances[i];
+    frameUniforms.cascadeCount = kCascades - 1;
+    DrawUniforms drawUniforms = {};
+    drawUniforms.material.ambient = drawUniforms.material.diffuse = drawUniforms.material.specular = color;
+    drawUniforms.material.shininess = 32.0f;
+    drawUniforms.useTextureKd = drawUniforms.useTextureNormal = 1;
+    auto setByRing = [&](const glm::mat4& model)
+    {
+        drawUniforms.model = model;
+        UniformRing::bind(kDrawBlockBinding, ring.push(drawUniforms));
+        for (int i = 0; i < 2; i++)
+            blockProgram.setUniformInt(blockSamplers[i], i + 1);
+        blockProgram.setUniformInt(blockSamplers[2], 0);
+    };
+
+    // frameRing set pushes the frame block to it at the start of every frame
+    auto run = [&](const char* label, auto&& setUniforms, UniformRing* frameRing = nullptr)
+    {
+        float ms = 0.0f;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            const auto start = Clock::now();
+            if (frameRing != nullptr)
+            {
+                frameRing->beginFrame();
+                UniformRing::bind(kFrameBlockBinding, frameRing->push(frameUniforms));
+            }
+            for (int mesh = 0; mesh < meshCount; ++mesh)
+                setUniforms(glm::translate(glm::mat4(1.0f), glm::vec3(float(mesh), 0.0f, 0.0f)));
+            if (frameRing != nullptr)
+                frameRing->endFrame();
+            ms += elapsedMs(start);
+            glFinish();
+        }
+        const float frameMs = ms / std::max(frames, 1);
+        console_logger->info("[uniform-update] {:>9}: {:.3f} ms per frame, {:.1f} ns per uniform", label, frameMs,
+            1e6f * frameMs / std::max(meshCount * uniformsPerMesh, 1));
+        return frameMs;
+    };
+
+    console_logger->info("[uniform-update] {} meshes, {} uniforms each, {} frames", meshCount, uniformsPerMesh, frames);
+    const float stringMs = run("strings", setByString);
+    const float nameMs = run("names", setByName);
+    const float locationMs = run("locations", setByLocation);
+    blockProgram.use();
+    const float ringMs = run("ring", setByRing, &ring);
+    console_logger->info("[uniform-update] names {:.1f}x, locations {:.1f}x, ring {:.1f}x faster than strings, ring {}",
+        stringMs / std::max(nameMs, 1e-6f), stringMs / std::max(locationMs, 1e-6f), stringMs / std::max(ringMs, 1e-6f),
+        ring.isPersistent() ? "persistently mapped" : "written with glBufferSubData");
+    blockProgram.unuse();
+}
+
+void renderQueue(Renderer& renderer, const std::vector<std::string>& modelPaths, int copiesPerModel, int width, int height, int frames)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    console_logger->set_level(spdlog::level::info);
+
+    Scene scene;
+    scene.directionalLights.push_back(DirectionalLight());
+    float maxSize = 1.0f;
+    for (const auto& path : modelPaths)
+    {
+        AssimpModel model(path);
+        if (model.meshes.empty())
+        {
+            console_logger->error("[render-queue] load {} failed", path);
+            continue;
+        }
+        maxSize = std::max(maxSize, glm::length(model.box.max - model.box.min));
+        scene.addToScene(model);
+    }
+    for (size_t i = 0; i < scene.models.size(); i++)
+    {
+        scene.scatterObjects(i, copiesPerModel);
+    }
+    scene.update();
+
+    auto camera = std::make_unique<PerspectiveCamera>(glm::radians(45.0f), 1.0f * width / height, 0.1f, 1000.0f);
+    camera->transform.position = glm::vec3(0.0f, maxSize, 3.0f * maxSize);
+    camera->transform.lookAt(glm::vec3(0.0f));
+    renderer.setScreenSize(height, width);
+
+    for (RenderType renderType : { RenderType::FORAWRD, RenderType::DEFERRED })
+    {
+        const char* typeName = renderType == RenderType::FORAWRD ? "forward" : "deferred";
+        // scene order, sorted with a draw call per mesh, sorted with a multi draw per run
+        const struct
+        {
+            const char* name;
+            bool queued;
+            bool multiDraw;
+        } modes[] = { { "scene order", false, false }, { "sorted", true, false }, { "multi draw", true, true } };
+        for (const auto& mode : modes)
+        {
+            UIOptions options;
+            options.renderType = renderType;
+            options.renderQueue = mode.queued;
+            options.multiDraw = mode.multiDraw;
+
+            console_logger->set_level(spdlog::level::warn);
+            size_t programs = 0, textures = 0, vertexArrays = 0, multiDraws = 0, shadowDraws = 0;
+            float ms = 0.0f;
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                const auto start = Clock::now();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.render(camera, scene, options);
+                glFinish();
+                ms += elapsedMs(start);
+                const RenderStats& stats = RenderStats::getFrame();
+                programs += stats.programBinds;
+                textures += stats.textureBinds;
+                vertexArrays += stats.vertexArrayBinds;
+                multiDraws += stats.multiDraws;
+                for (const RenderStats::ShadowMap& map : stats.shadowMaps)
+                    shadowDraws += map.draws;
+            }
+            console_logger->set_level(spdlog::level::info);
+
+            const int n = std::max(frames, 1);
+            console_logger->info("[render-queue] {} {}: {:.2f} ms per frame, {} program, {} texture, {} vertex array binds, "
+                "{} multi draws, {} shadow draw calls", typeName, mode.name, ms / n, programs / n, textures / n,
+                vertexArrays / n, multiDraws / n, shadowDraws / n);
+        }
+    }
+}
+
+} // namespace benchmark
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Renderer;
+
+// benchmarks run from the command line with `renderer --benchmark <name>`.
+// most need the GL context of the viewer, all report through the console logger.
+namespace benchmark
+{
+// true for the benchmarks that run on the CPU only. main runs them before it opens a window, so they also run on
+// machines without a GPU
+bool isContextFree(const std::string& name);
+
+// runs one of them, returns false if its checks failed
+bool runContextFree(const std::string& name);
+
+// cold (assimp import + cache write) against warm (mapped mesh cache) model loads
+void meshCacheLoad(const std::vector<std::string>& modelPaths, int warmRuns);
+
+// CPU side mesh conversion time against the number of worker threads
+void meshConversionScaling(const std::vector<std::string>& modelPaths, int runs);
+
+// model import (warm mesh cache, so mostly texture decoding) on one thread against the global pool
+void textureDecode(const std::vector<std::string>& modelPaths, int runs);
+
+// loads every model several times and reports the texture memory resident through the TextureCache
+void textureSharing(const std::vector<std::string>& modelPaths, int copies);
+
+// BCn encoding throughput of the model textures in images per second, one thread against the global pool
+void textureCompression(const std::vector<std::string>& modelPaths, int runs);
+
+// ACMR / ATVR of the imported index buffers before and after vertex welding and the mesh optimizer, plus their run time
+void meshOptimization(const std::vector<std::string>& modelPaths);
+
+// fraction of triangles the meshlet frustum and cone culling rejects, from orbit views around every model
+void meshletCulling(const std::vector<std::string>& modelPaths, int azimuthSteps);
+
+// triangles and frame time with every mesh at LOD0 against the adaptive LOD selection, forward and deferred,
+// for columns of model copies at doubling distances
+void lodSelection(Renderer& renderer, const std::vector<std::string>& modelPaths, int width, int height, int frames);
+
+// process memory while loading a model and after, for every MeshCpuData policy
+void meshMemory(const std::vector<std::string>& modelPaths);
+
+// blocking loads against streamed loads through the ModelLoader, reports the worst frame stall
+void asyncModelLoad(const std::vector<std::string>& modelPaths, float uploadBudgetMs);
+
+// scalar Frustum::intersect over an array of boxes against the SIMD CullingBoxes::cull over the same boxes
+void frustumCulling(int boxCount, int runs);
+
+// build, refit and query times of the scene bvh for a synthetic scene of modelCount models, plus picking
+// rays against the triangles of real models
+void sceneBvh(const std::vector<std::string>& modelPaths, int modelCount, int queries);
+
+// per frame cost of the cached world matrices of a SceneGraph against rebuilding the model matrix for every
+// mesh of every pass, with all models moving and with 1% of them moving
+void sceneGraph(int modelCount, int nodesPerModel, int frames);
+
+// per frame CPU cost of updating, culling and walking the draws of placed copies in the SceneObjects arrays,
+// against one heap object per copy that owns its meshes and material, for every count of objects
+void sceneObjects(const std::vector<int>& objectCounts, int frames);
+
+// cost of rasterizing a synthetic city of occluder blocks into the OcclusionBuffer for every thread count,
+// and of testing boxCount boxes between the blocks against it, with the fraction of boxes hidden.
+// returns false if the buffer fails the known answers of boxes behind, in front of and around a wall of two
+// triangles and a tessellated one
+bool occlusionCulling(int blockCount, int boxCount, int frames);
+
+// visible set of the compute shader culling against the SIMD CullingBoxes for the same draws and frustums,
+// from views orbiting a scene of copiesPerModel scattered copies of every model, with the cost of both.
+// returns false if the sets differ for a box that does not touch a plane of the frustum within rounding
+bool gpuCulling(const std::string& shaderBasePath, const std::vector<std::string>& modelPaths, int copiesPerModel, int views);
+
+// draw calls and triangles of every shadow map with the casters culled per cascade against drawing all of them,
+// for the cascaded and the single shadow map, in a field of scattered copies of every model
+void shadowCulling(Renderer& renderer, const std::vector<std::string>& modelPaths, int copiesPerModel, int width, int height, int frames);
+
+// frame time of Forward+ and of the clustered deferred lighting, and the CPU binning time of the lights, for every
+// count of random point and spot lights over a field of scattered copies of every model
+void clusteredLighting(Renderer& renderer, const std::vector<std::string>& modelPaths, const std::vector<int>& lightCounts,
+    int width, int height, int frames);
+
+// per frame CPU cost of setting the uniforms of CSMShader::renderMesh for meshCount meshes: name strings built
+// and resolved with glGetUniformLocation on every call, as before the location table of GLSLProgram, against
+// names hashed at compile time, against locations looked up once and against the uniform blocks in a UniformRing
+void uniformUpdate(const std::string& shaderBasePath, int meshCount, int frames);
+
+// frame time and program, texture and vertex array binds of the main view with the draws in scene order against
+// sorted by the RenderQueue, with a draw call each or a multi draw per run, forward and deferred, in a field of
+// scattered copies of every model. also counts the draw calls of the shadow maps
+void renderQueue(Renderer& renderer, const std::vector<std::string>& modelPaths, int copiesPerModel, int width, int height, int frames);
+}
@@ -74,6 +74,19 @@ void CameraController::update(const Input& input, float deltaTime) {
     _camera.transform.position = _target + _eye;
 }
 
+Ray CameraController::getPickRay(float pageX, float pageY) const {
+    const glm::vec2 ndc(
+        2.0f * (pageX - _screenLeft) / _screenWidth - 1.0f,
+        1.0f - 2.0f * (pageY - _screenTop) / _screenHeight);
+    const glm::mat4 inverseViewProjection =
+        glm::inverse(_camera.getProjectionMatrix() * _camera.getViewMatrix());
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+    return Ray(glm::vec3(nearPoint), glm::normalize(glm::vec3(farPoint - nearPoint)));
+}
+
 glm::vec2 CameraController::getMouseOnScreen(float pageX, float pageY) {
     return glm::vec2((pageX - _screenLeft) / _screenWidth, (pageY - _screenTop) / _screenHeight);
 }
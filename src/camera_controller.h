@@ -5,6 +5,7 @@
 
 #include "base/camera.h"
 #include "base/input.h"
+#include "base/ray.h"
 
 class CameraController {
 private:
@@ -21,6 +22,9 @@ public:
 
     void update(const Input& input, float deltaTime);
 
+    // world space ray from the camera through the window position (pageX, pageY), with a unit direction
+    Ray getPickRay(float pageX, float pageY) const;
+
     ~CameraController() = default;
 
 private:
@@ -24,6 +24,8 @@ public:
     void BindForWriting();
     void BindForReading();
     void SetReadBuffer(GBUFFER_TEXTURE_TYPE TextureType);
+    // binds the position, diffuse and normal textures and the depth to texture units 0 to 3, for a lighting pass
+    void BindTextures();
 private:
     GLuint m_fbo;
     GLuint m_textures[GBUFFER_NUM_TEXTURES];
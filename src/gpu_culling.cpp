@@ -0,0 +1,339 @@
+#include "gpu_culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// work group size of cull.comp and depthPyramid.comp
+constexpr GLuint kCullGroupSize = 64;
+constexpr GLuint kPyramidGroupSize = 8;
+// texture unit of the depth textures, apart from the shadow map the passes keep bound to unit 0
+constexpr GLint kPyramidUnit = 8;
+
+GLuint getGroupCount(size_t count, GLuint groupSize)
+{
+    return static_cast<GLuint>((count + groupSize - 1) / groupSize);
+}
+
+// grows buffer to bytes, its name stays valid for the vertex arrays that refer to it
+void allocateBuffer(GLuint buffer, GLenum target, size_t bytes)
+{
+    glBindBuffer(target, buffer);
+    glBufferData(target, bytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(target, 0);
+}
+}
+
+GpuCulling::GpuCulling(const std::string& shaderBasePath)
+{
+    _cullShader = std::make_unique<GLSLProgram>();
+    _cullShader->attachComputeShaderFromFile(shaderBasePath + "/cull/cull.comp");
+    _cullShader->link();
+
+    _pyramidShader = std::make_unique<GLSLProgram>();
+    _pyramidShader->attachComputeShaderFromFile(shaderBasePath + "/cull/depthPyramid.comp");
+    _pyramidShader->link();
+
+    GLuint buffers[5];
+    glGenBuffers(5, buffers);
+    _matrixBuffer = buffers[0], _recordBuffer = buffers[1], _commandBuffer = buffers[2];
+    _countBuffer = buffers[3], _visibleBuffer = buffers[4];
+    _drawCount = GLAD_GL_VERSION_4_6 && glMultiDrawElementsIndirectCount != nullptr;
+}
+
+GpuCulling::~GpuCulling()
+{
+    const GLuint buffers[5] = { _matrixBuffer, _recordBuffer, _commandBuffer, _countBuffer, _visibleBuffer };
+    glDeleteBuffers(5, buffers);
+    glDeleteTextures(1, &_depthTexture);
+    glDeleteTextures(1, &_pyramidTexture);
+}
+
+bool GpuCulling::isSupported()
+{
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+void GpuCulling::update(const std::vector<AssimpModel>& models, const SceneGraph& graph, const SceneObjects& objects)
+{
+    _batches.clear();
+    _records.clear();
+    _matrices.clear();
+    _batchVaos.clear();
+    _batchIndexTypes.clear();
+    _runs.clear();
+
+    // the copies of every model grouped by material, so that a batch is one mesh with one material
+    _modelObjects.resize(models.size());
+    for (auto& list : _modelObjects)
+    {
+        list.clear();
+    }
+    for (uint32_t object = 0; object < objects.size(); object++)
+    {
+        if (objects.isDisplayed(object))
+            _modelObjects[objects.getModel(object)].push_back(object);
+    }
+
+    auto addBatch = [&](uint32_t modelIndex, size_t m, const PhongMaterial* material) {
+        const Mesh& mesh = models[modelIndex].meshes[m];
+        _batches.push_back({ modelIndex, static_cast<uint32_t>(m), material, static_cast<uint32_t>(_records.size()), 0 });
+        _batchVaos.push_back(mesh.VAO);
+        _batchIndexTypes.push_back(mesh.indexType);
+    };
+    auto addDraw = [&](const Mesh& mesh, const glm::mat4& matrix) {
+        Batch& batch = _batches.back();
+        glm::vec3 center, extent;
+        Frustum::transformBox(mesh.box, matrix, center, extent);
+        const uint32_t slot = static_cast<uint32_t>(_records.size());
+        _records.push_back({ glm::vec4(center, 1.0f), glm::vec4(extent, 0.0f), static_cast<uint32_t>(_batches.size() - 1),
+            batch.firstCommand, slot, mesh.indexCount, mesh.firstIndex, mesh.baseVertex, 0, 0 });
+        _matrices.push_back(matrix);
+        batch.drawCount++;
+    };
+
+    for (uint32_t i = 0; i < models.size(); i++)
+    {
+        const AssimpModel& model = models[i];
+        std::vector<uint32_t>& copies = _modelObjects[i];
+        std::stable_sort(copies.begin(), copies.end(), [&](uint32_t a, uint32_t b) {
+            return objects.getMaterialIndex(a) < objects.getMaterialIndex(b);
+        });
+
+        // copies of the same material share the batches of the meshes, the model itself goes with the copies
+        // keeping its facet material, which sort last
+        auto addGroup = [&](const PhongMaterial* material, bool withModel, size_t first, size_t last) {
+            for (size_t m = 0; m < model.meshes.size(); m++)
+            {
+                addBatch(i, m, material);
+                if (withModel)
+                    addDraw(model.meshes[m], model.getMeshMatrix(graph, m));
+                for (size_t c = first; c < last; c++)
+                {
+                    addDraw(model.meshes[m], objects.getMatrix(copies[c]) * model.meshMatrices[m]);
+                }
+            }
+        };
+        bool modelAdded = !model.display;
+        for (size_t first = 0, last = 0; first < copies.size(); first = last)
+        {
+            const uint32_t material = objects.getMaterialIndex(copies[first]);
+            while (last < copies.size() && objects.getMaterialIndex(copies[last]) == material)
+            {
+                last++;
+            }
+            const bool withModel = !modelAdded && material == SceneObjects::kModelMaterial;
+            addGroup(&objects.getMaterial(copies[first], model), withModel, first, last);
+            modelAdded = modelAdded || withModel;
+        }
+        if (!modelAdded)
+            addGroup(static_cast<const PhongMaterial*>(model.facetMaterial.get()), true, 0, 0);
+    }
+
+    // the batches of a vertex array follow each other where the meshes of a model share a format
+    for (size_t i = 0; i < _batches.size(); i++)
+    {
+        const Batch& batch = _batches[i];
+        if (_runs.empty() || _runs.back().vertexArray != _batchVaos[i] || _runs.back().indexType != _batchIndexTypes[i])
+            _runs.push_back({ _batchVaos[i], _batchIndexTypes[i], batch.firstCommand, 0 });
+        _runs.back().commandCount += batch.drawCount;
+    }
+
+    reserve(_records.size(), _batches.size());
+    if (_records.empty())
+        return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _matrixBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, _matrices.size() * sizeof(glm::mat4), _matrices.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _recordBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, _records.size() * sizeof(DrawRecord), _records.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // the record of a draw is read at its base instance as the draw id of the vertex arrays
+    GeometryPool::getGlobal().reserveDrawIds(_records.size());
+}
+
+void GpuCulling::reserve(size_t drawCount, size_t batchCount)
+{
+    if (drawCount > _capacity)
+    {
+        _capacity = std::max(drawCount, 2 * _capacity);
+        allocateBuffer(_matrixBuffer, GL_SHADER_STORAGE_BUFFER, _capacity * sizeof(glm::mat4));
+        allocateBuffer(_recordBuffer, GL_SHADER_STORAGE_BUFFER, _capacity * sizeof(DrawRecord));
+        allocateBuffer(_commandBuffer, GL_SHADER_STORAGE_BUFFER, _capacity * sizeof(DrawElementsIndirectCommand));
+        allocateBuffer(_visibleBuffer, GL_SHADER_STORAGE_BUFFER, _capacity * sizeof(uint32_t));
+    }
+    if (batchCount > _batchCapacity)
+    {
+        _batchCapacity = std::max(batchCount, 2 * _batchCapacity);
+        allocateBuffer(_countBuffer, GL_SHADER_STORAGE_BUFFER, _batchCapacity * sizeof(uint32_t));
+    }
+}
+
+void GpuCulling::cull(const Frustum& frustum, bool useDepthPyramid, bool packCommands)
+{
+    if (_records.empty())
+        return;
+
+    // packed commands need the counts, the others keep their slots with zero instances
+    _packed = _drawCount && packCommands;
+    if (_packed)
+    {
+        const uint32_t zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _countBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    _cullShader->use();
+    _cullShader->setUniformUint("recordCount", static_cast<uint32_t>(_records.size()));
+    glm::vec4 planes[6];
+    for (int i = 0; i < 6; i++)
+    {
+        const Plane& plane = frustum.planes[i];
+        planes[i] = glm::vec4(plane.normal, plane.signedDistance);
+    }
+    _cullShader->setUniformVec4Array("frustumPlanes", planes, 6);
+    _cullShader->setUniformBool("compact", _packed);
+
+    const bool testPyramid = useDepthPyramid && _pyramidValid;
+    _cullShader->setUniformBool("useDepthPyramid", testPyramid);
+    _cullShader->setUniformInt("depthPyramid", kPyramidUnit);
+    if (testPyramid)
+    {
+        glActiveTexture(GL_TEXTURE0 + kPyramidUnit);
+        glBindTexture(GL_TEXTURE_2D, _pyramidTexture);
+        glActiveTexture(GL_TEXTURE0);
+        _cullShader->setUniformMat4("pyramidViewProjection", _pyramidViewProjection);
+        _cullShader->setUniformIvec2("pyramidSize", glm::ivec2(_pyramidWidth, _pyramidHeight));
+        _cullShader->setUniformInt("pyramidLevels", _pyramidLevels);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, _recordBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, _commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, _countBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, _visibleBuffer);
+    glDispatchCompute(getGroupCount(_records.size(), kCullGroupSize), 1, 1);
+    // the commands and counts are read by the draws, the flags by readVisibility
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    _cullShader->unuse();
+}
+
+void GpuCulling::drawBatch(size_t batch) const
+{
+    const Batch& b = _batches[batch];
+    if (b.drawCount == 0)
+        return;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kMatrixBinding, _matrixBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+    const void* commands = reinterpret_cast<const void*>(b.firstCommand * sizeof(DrawElementsIndirectCommand));
+    if (_packed)
+    {
+        glBindBuffer(GL_PARAMETER_BUFFER, _countBuffer);
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, _batchIndexTypes[batch], commands,
+            static_cast<GLintptr>(batch * sizeof(uint32_t)), static_cast<GLsizei>(b.drawCount), 0);
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    }
+    else
+    {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, _batchIndexTypes[batch], commands, static_cast<GLsizei>(b.drawCount), 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+size_t GpuCulling::drawRuns() const
+{
+    if (_records.empty())
+        return 0;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kMatrixBinding, _matrixBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+    for (const Run& run : _runs)
+    {
+        glBindVertexArray(run.vertexArray);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, run.indexType,
+            reinterpret_cast<const void*>(run.firstCommand * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLsizei>(run.commandCount), 0);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    return _runs.size();
+}
+
+void GpuCulling::readVisibility(std::vector<uint8_t>& visible) const
+{
+    std::vector<uint32_t> flags(_records.size());
+    if (!flags.empty())
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _visibleBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, flags.size() * sizeof(uint32_t), flags.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    visible.assign(flags.begin(), flags.end());
+}
+
+void GpuCulling::updateDepthPyramid(int width, int height, const glm::mat4& viewProjection)
+{
+    if (width <= 0 || height <= 0)
+        return;
+    resizePyramid(width, height);
+
+    glActiveTexture(GL_TEXTURE0 + kPyramidUnit);
+    glBindTexture(GL_TEXTURE_2D, _depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+    // a multisampled or stencil only read framebuffer cannot be copied, the culling goes on without the pyramid
+    if (glGetError() != GL_NO_ERROR)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        _pyramidValid = false;
+        return;
+    }
+
+    _pyramidShader->use();
+    _pyramidShader->setUniformInt("depthTexture", kPyramidUnit);
+    int sourceWidth = width, sourceHeight = height;
+    for (int level = 0; level < _pyramidLevels; level++)
+    {
+        const int levelWidth = std::max(1, width >> level);
+        const int levelHeight = std::max(1, height >> level);
+        _pyramidShader->setUniformInt("level", level);
+        _pyramidShader->setUniformIvec2("sourceSize", glm::ivec2(sourceWidth, sourceHeight));
+        _pyramidShader->setUniformIvec2("destinationSize", glm::ivec2(levelWidth, levelHeight));
+        glBindImageTexture(0, _pyramidTexture, std::max(level - 1, 0), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, _pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute(getGroupCount(levelWidth, kPyramidGroupSize), getGroupCount(levelHeight, kPyramidGroupSize), 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        sourceWidth = levelWidth, sourceHeight = levelHeight;
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    _pyramidShader->unuse();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    _pyramidViewProjection = viewProjection;
+    _pyramidValid = true;
+}
+
+void GpuCulling::resizePyramid(int width, int height)
+{
+    if (width == _pyramidWidth && height == _pyramidHeight)
+        return;
+    glDeleteTextures(1, &_depthTexture);
+    glDeleteTextures(1, &_pyramidTexture);
+    _pyramidWidth = width, _pyramidHeight = height;
+    _pyramidLevels = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(width, height)))));
+
+    glActiveTexture(GL_TEXTURE0 + kPyramidUnit);
+    glGenTextures(1, &_depthTexture);
+    glBindTexture(GL_TEXTURE_2D, _depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // all levels are allocated at once, so texelFetch of any level sees a complete texture
+    glGenTextures(1, &_pyramidTexture);
+    glBindTexture(GL_TEXTURE_2D, _pyramidTexture);
+    glTexStorage2D(GL_TEXTURE_2D, _pyramidLevels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    _pyramidValid = false;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/frustum.h"
+#include "base/geometry_pool.h"
+#include "base/glsl_program.h"
+#include "base/scene_graph.h"
+#include "material.h"
+#include "model.h"
+#include "scene_objects.h"
+
+// GPU driven submission of the models and their placed copies. every mesh of every model and copy is one draw
+// record in a shader storage buffer with its world matrix and world box. a compute shader culls the records
+// against a frustum, and against the depth pyramid of the last frame, and writes the survivors as indirect
+// commands. the records are grouped in batches of the same mesh and material, one glMultiDrawElementsIndirect
+// each, with the number of commands taken from a parameter buffer where GL 4.6 allows it. the shadow maps
+// draw the batches of a vertex array of the GeometryPool together, see drawRuns.
+// the vertex shaders read the world matrix of a draw through drawRecord, an instanced attribute the base
+// instance of the command points at, so GL 4.3 without shader draw parameters is enough
+class GpuCulling
+{
+public:
+    // shader storage binding of the world matrices in the vertex shaders and location of drawRecord,
+    // the draw id of the vertex arrays of the GeometryPool
+    static constexpr GLuint kMatrixBinding = 0;
+    static constexpr GLuint kRecordLocation = GeometryPool::kDrawIdLocation;
+
+    // mesh of models[model] drawn with material, its draws are the commands [firstCommand, firstCommand + drawCount)
+    struct Batch
+    {
+        uint32_t model;
+        uint32_t mesh;
+        const PhongMaterial* material;
+        uint32_t firstCommand;
+        uint32_t drawCount;
+    };
+
+    // loads the compute shaders from shaderBasePath/cull, needs isSupported
+    explicit GpuCulling(const std::string& shaderBasePath);
+
+    ~GpuCulling();
+
+    GpuCulling(const GpuCulling&) = delete;
+
+    GpuCulling& operator=(const GpuCulling&) = delete;
+
+    // compute shaders and indirect multi draws, GL 4.3
+    static bool isSupported();
+
+    // rebuilds the draws of the displayed models and of the displayed copies from their world matrices, once
+    // per frame after the scene update, and uploads them
+    void update(const std::vector<AssimpModel>& models, const SceneGraph& graph, const SceneObjects& objects);
+
+    // culls every draw against frustum, and against the last depth pyramid if useDepthPyramid and there is one.
+    // the commands are ready for drawBatch when it returns, until the next cull. with packCommands the survivors
+    // of a batch are packed at its start where GL 4.6 allows it, without every draw keeps its command and the
+    // hidden ones draw no instance, as drawRuns needs
+    void cull(const Frustum& frustum, bool useDepthPyramid, bool packCommands = true);
+
+    const std::vector<Batch>& getBatches() const { return _batches; }
+
+    size_t getDrawCount() const { return _records.size(); }
+
+    // issues the surviving draws of batch. the vertex array of its mesh has to be bound and a program reading
+    // drawMatrices in use with gpuDriven set
+    void drawBatch(size_t batch) const;
+
+    // issues the draws of every batch, one multi draw per run of batches of the same vertex array and index type,
+    // whose vertex array it binds, for passes without state per batch like the shadow maps. needs a cull without
+    // packCommands. returns the multi draws, leaves no vertex array bound
+    size_t drawRuns() const;
+
+    // the world box of a draw as the culling tests it
+    glm::vec3 getCenter(size_t draw) const { return glm::vec3(_records[draw].center); }
+
+    glm::vec3 getExtent(size_t draw) const { return glm::vec3(_records[draw].extent); }
+
+    // visible flag of every draw of the last cull, read back from the GPU. stalls, for checks against the CPU
+    void readVisibility(std::vector<uint8_t>& visible) const;
+
+    // copies the depth of the bound read framebuffer, width x height, and reduces it to the max depth pyramid
+    // the next frame culls against. viewProjection is the one the depth was rendered with
+    void updateDepthPyramid(int width, int height, const glm::mat4& viewProjection);
+
+    void invalidateDepthPyramid() { _pyramidValid = false; }
+
+private:
+    // std430 layout of DrawRecord in cull.comp
+    struct DrawRecord
+    {
+        glm::vec4 center;
+        glm::vec4 extent;
+        uint32_t batch;
+        uint32_t firstCommand;
+        uint32_t slot;
+        uint32_t indexCount;
+        // place of the mesh in the GeometryPool
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t pad0;
+        uint32_t pad1;
+    };
+
+    // batches of one vertex array and index type, whose commands follow each other
+    struct Run
+    {
+        GLuint vertexArray;
+        GLenum indexType;
+        uint32_t firstCommand;
+        uint32_t commandCount;
+    };
+
+    std::unique_ptr<GLSLProgram> _cullShader;
+    std::unique_ptr<GLSLProgram> _pyramidShader;
+
+    std::vector<Batch> _batches;
+    std::vector<DrawRecord> _records;
+    std::vector<glm::mat4> _matrices;
+    std::vector<GLuint> _batchVaos;
+    std::vector<GLenum> _batchIndexTypes;
+    std::vector<Run> _runs;
+    // scratch of update: the copies of every model, sorted by material
+    std::vector<std::vector<uint32_t>> _modelObjects;
+
+    GLuint _matrixBuffer = 0;
+    GLuint _recordBuffer = 0;
+    GLuint _commandBuffer = 0;
+    GLuint _countBuffer = 0;
+    GLuint _visibleBuffer = 0;
+    size_t _capacity = 0;
+    size_t _batchCapacity = 0;
+    // glMultiDrawElementsIndirectCount of GL 4.6
+    bool _drawCount = false;
+    // the last cull packed the commands
+    bool _packed = false;
+
+    GLuint _depthTexture = 0;
+    GLuint _pyramidTexture = 0;
+    int _pyramidWidth = 0;
+    int _pyramidHeight = 0;
+    int _pyramidLevels = 0;
+    glm::mat4 _pyramidViewProjection = glm::mat4(1.0f);
+    bool _pyramidValid = false;
+
+    void reserve(size_t drawCount, size_t batchCount);
+
+    void resizePyramid(int width, int height);
+};
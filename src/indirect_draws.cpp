@@ -0,0 +1,111 @@
+#include "indirect_draws.h"
+
+IndirectDraws::~IndirectDraws()
+{
+    if (_matrixBuffer != 0)
+    {
+        const GLuint buffers[2] = { _matrixBuffer, _commandBuffer };
+        glDeleteBuffers(2, buffers);
+    }
+}
+
+void IndirectDraws::reset()
+{
+    for (size_t i = 0; i < _batchCount; i++)
+    {
+        _batches[i].commands.clear();
+    }
+    _batchCount = 0;
+    _matrices.clear();
+}
+
+size_t IndirectDraws::addBatch(GLuint vertexArray, GLenum indexType)
+{
+    if (_batchCount == _batches.size())
+        _batches.emplace_back();
+    Batch& batch = _batches[_batchCount];
+    batch.vertexArray = vertexArray;
+    batch.indexType = indexType;
+    batch.firstCommand = 0;
+    return _batchCount++;
+}
+
+size_t IndirectDraws::findBatch(GLuint vertexArray, GLenum indexType)
+{
+    for (size_t i = 0; i < _batchCount; i++)
+    {
+        if (_batches[i].vertexArray == vertexArray && _batches[i].indexType == indexType)
+            return i;
+    }
+    return addBatch(vertexArray, indexType);
+}
+
+uint32_t IndirectDraws::addDraw(const glm::mat4& matrix)
+{
+    _matrices.push_back(matrix);
+    return static_cast<uint32_t>(_matrices.size() - 1);
+}
+
+size_t IndirectDraws::addLod(const Mesh& mesh, const glm::mat4& matrix, size_t level)
+{
+    const size_t batch = findBatch(mesh.VAO, mesh.indexType);
+    return mesh.addLodCommand(level, addDraw(matrix), _batches[batch].commands);
+}
+
+void IndirectDraws::upload()
+{
+    if (_matrices.empty())
+        return;
+
+    _commands.clear();
+    for (size_t i = 0; i < _batchCount; i++)
+    {
+        Batch& batch = _batches[i];
+        batch.firstCommand = _commands.size();
+        _commands.insert(_commands.end(), batch.commands.begin(), batch.commands.end());
+    }
+
+    if (_matrixBuffer == 0)
+    {
+        GLuint buffers[2];
+        glGenBuffers(2, buffers);
+        _matrixBuffer = buffers[0], _commandBuffer = buffers[1];
+    }
+    // respecified, so the draws of the last upload keep reading the old storage
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _matrixBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, _matrices.size() * sizeof(glm::mat4), _matrices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, _commands.size() * sizeof(DrawElementsIndirectCommand), _commands.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    GeometryPool::getGlobal().reserveDrawIds(_matrices.size());
+}
+
+void IndirectDraws::drawBatch(size_t batch) const
+{
+    const Batch& b = _batches[batch];
+    if (b.commands.empty())
+        return;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GpuCulling::kMatrixBinding, _matrixBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, b.indexType,
+        reinterpret_cast<const void*>(b.firstCommand * sizeof(DrawElementsIndirectCommand)),
+        static_cast<GLsizei>(b.commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+size_t IndirectDraws::draw() const
+{
+    size_t draws = 0;
+    for (size_t i = 0; i < _batchCount; i++)
+    {
+        if (_batches[i].commands.empty())
+            continue;
+        glBindVertexArray(_batches[i].vertexArray);
+        drawBatch(i);
+        draws++;
+    }
+    glBindVertexArray(0);
+    return draws;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/geometry_pool.h"
+#include "gpu_culling.h"
+#include "mesh.h"
+
+// draws of meshes of the GeometryPool collected on the CPU as indirect commands and submitted with one
+// glMultiDrawElementsIndirect per batch of one vertex array and index type. the world matrix of every draw is in
+// a shader storage buffer at GpuCulling::kMatrixBinding, read through drawRecord at the base instance of its
+// commands, so the programs draw them like the ones of the GPU culling, with gpuDriven set.
+// the buffers are created by the first upload and respecified by every one after it
+class IndirectDraws
+{
+public:
+    IndirectDraws() = default;
+
+    ~IndirectDraws();
+
+    IndirectDraws(const IndirectDraws&) = delete;
+
+    IndirectDraws& operator=(const IndirectDraws&) = delete;
+
+    // drops the draws and the batches, keeps the memory
+    void reset();
+
+    // starts a batch of vertexArray and indexType after the others, returns its index
+    size_t addBatch(GLuint vertexArray, GLenum indexType);
+
+    // the batch of vertexArray and indexType, a new one if there is none, for draws whose order does not matter
+    size_t findBatch(GLuint vertexArray, GLenum indexType);
+
+    // a draw at matrix, whose commands take the returned id as base instance
+    uint32_t addDraw(const glm::mat4& matrix);
+
+    std::vector<DrawElementsIndirectCommand>& getCommands(size_t batch) { return _batches[batch].commands; }
+
+    // a draw of the level of mesh at matrix in the batch of its vertex array, returns the triangles
+    size_t addLod(const Mesh& mesh, const glm::mat4& matrix, size_t level);
+
+    // uploads the matrices and the commands of every batch, before drawBatch and draw
+    void upload();
+
+    // the multi draw of batch, its vertex array has to be bound and a program reading drawMatrices in use
+    void drawBatch(size_t batch) const;
+
+    // binds the vertex array of every batch and draws it, returns the multi draws. leaves no vertex array bound
+    size_t draw() const;
+
+    size_t getBatchCount() const { return _batchCount; }
+
+    size_t getDrawCount() const { return _matrices.size(); }
+
+private:
+    struct Batch
+    {
+        GLuint vertexArray;
+        GLenum indexType;
+        std::vector<DrawElementsIndirectCommand> commands;
+        // place of the commands in the command buffer, set by upload
+        size_t firstCommand;
+    };
+
+    // the batches in use are the first _batchCount, the others keep their command memory for the next frames
+    std::vector<Batch> _batches;
+    size_t _batchCount = 0;
+    std::vector<glm::mat4> _matrices;
+    // scratch of upload
+    std::vector<DrawElementsIndirectCommand> _commands;
+
+    GLuint _matrixBuffer = 0;
+    GLuint _commandBuffer = 0;
+};
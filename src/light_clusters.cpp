@@ -0,0 +1,274 @@
+#include "light_clusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+constexpr uint32_t kTileCount = LightClusters::kTilesX * LightClusters::kTilesY;
+// lights without an attenuation reach every cluster, their bounds are kept finite
+constexpr float kMaxRange = 1.0e6f;
+// below the cosine of any cone, marks a point light for the shaders
+constexpr float kPointLightCosine = -2.0f;
+
+uint32_t getTile(float ndc, uint32_t tiles)
+{
+    const float tile = std::floor((ndc * 0.5f + 0.5f) * static_cast<float>(tiles));
+    return static_cast<uint32_t>(std::clamp(tile, 0.0f, static_cast<float>(tiles - 1)));
+}
+
+// upload of at least one element, an empty buffer cannot be bound
+template <typename T>
+void uploadBuffer(GLuint buffer, const std::vector<T>& data)
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(data.size(), 1) * sizeof(T), data.empty() ? nullptr : data.data(),
+        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+}
+
+LightClusters::LightClusters()
+{
+    GLuint buffers[3];
+    glGenBuffers(3, buffers);
+    _lightBuffer = buffers[0], _clusterBuffer = buffers[1], _indexBuffer = buffers[2];
+    _clusters.resize(kClusterCount, glm::uvec2(0));
+    _slices.resize(kSlices);
+}
+
+LightClusters::~LightClusters()
+{
+    const GLuint buffers[3] = { _lightBuffer, _clusterBuffer, _indexBuffer };
+    glDeleteBuffers(3, buffers);
+}
+
+void LightClusters::build(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights,
+    const glm::mat4& view, const glm::mat4& projection, float znear, float zfar, ThreadPool& pool)
+{
+    if (projection != _projection || znear != _znear || zfar != _zfar)
+        updateClusterBoxes(projection, znear, zfar);
+
+    _lights.clear();
+    for (const auto& light : pointLights)
+    {
+        const float range = std::min(light.getRange(), kMaxRange);
+        _lights.push_back({ glm::vec4(light.position, range), glm::vec4(0.0f, 0.0f, -1.0f, kPointLightCosine),
+            glm::vec4(light.ambient, 0.0f), glm::vec4(light.diffuse, 0.0f), glm::vec4(light.specular, 0.0f),
+            glm::vec4(light.kc, light.kl, light.kq, 0.0f) });
+    }
+    for (const auto& light : spotLights)
+    {
+        const float range = std::min(light.getRange(), kMaxRange);
+        const float cosine = light.angle < glm::radians(90.0f) ? std::cos(light.angle) : kPointLightCosine;
+        _lights.push_back({ glm::vec4(light.position, range), glm::vec4(glm::normalize(light.direction), cosine),
+            glm::vec4(light.ambient, 0.0f), glm::vec4(light.diffuse, 0.0f), glm::vec4(light.specular, 0.0f),
+            glm::vec4(light.kc, light.kl, light.kq, 0.0f) });
+    }
+
+    // bounding sphere of the range, or of the cone of a spot light
+    _bounds.resize(_lights.size());
+    pool.parallelFor(_lights.size(), [&](size_t i) {
+        const GpuLight& light = _lights[i];
+        glm::vec3 center = glm::vec3(light.positionRange);
+        float radius = light.positionRange.w;
+        const float cosine = light.directionCosine.w;
+        if (cosine >= -1.0f)
+        {
+            const glm::vec3 direction = glm::vec3(light.directionCosine);
+            if (cosine < std::sqrt(0.5f))
+            {
+                center += direction * radius * cosine;
+                radius *= std::sqrt(1.0f - cosine * cosine);
+            }
+            else
+            {
+                radius /= 2.0f * cosine;
+                center += direction * radius;
+            }
+        }
+        computeBounds(i, glm::vec3(view * glm::vec4(center, 1.0f)), radius, projection);
+    });
+
+    pool.parallelFor(kSlices, [&](size_t slice) { binSlice(static_cast<uint32_t>(slice)); });
+
+    // the slices are concatenated in order, so the lists do not depend on the number of threads
+    _indices.clear();
+    for (uint32_t slice = 0; slice < kSlices; slice++)
+    {
+        const SliceBins& bins = _slices[slice];
+        uint32_t offset = static_cast<uint32_t>(_indices.size());
+        for (uint32_t tile = 0; tile < kTileCount; tile++)
+        {
+            _clusters[slice * kTileCount + tile] = glm::uvec2(offset, bins.tileCounts[tile]);
+            offset += bins.tileCounts[tile];
+        }
+        _indices.insert(_indices.end(), bins.indices.begin(), bins.indices.end());
+    }
+}
+
+void LightClusters::upload()
+{
+    uploadBuffer(_lightBuffer, _lights);
+    uploadBuffer(_clusterBuffer, _clusters);
+    uploadBuffer(_indexBuffer, _indices);
+}
+
+void LightClusters::bind(const GLSLProgram& program, int screenWidth, int screenHeight) const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLightBinding, _lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kClusterBinding, _clusterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kIndexBinding, _indexBuffer);
+    program.setUniformIvec2("clusterTiles", glm::ivec2(kTilesX, kTilesY));
+    program.setUniformInt("clusterSlices", kSlices);
+    program.setUniformVec2("clusterScreenSize", glm::vec2(std::max(screenWidth, 1), std::max(screenHeight, 1)));
+    program.setUniformFloat("clusterScale", _sliceScale);
+    program.setUniformFloat("clusterBias", _sliceBias);
+}
+
+void LightClusters::updateClusterBoxes(const glm::mat4& projection, float znear, float zfar)
+{
+    _projection = projection;
+    _znear = znear;
+    _zfar = zfar;
+    const float logRatio = std::log(zfar / znear);
+    _sliceScale = static_cast<float>(kSlices) / logRatio;
+    _sliceBias = -static_cast<float>(kSlices) * std::log(znear) / logRatio;
+
+    // view space direction through every tile corner, scaled to depth 1
+    const glm::mat4 inverseProjection = glm::inverse(projection);
+    std::vector<glm::vec3> rays((kTilesX + 1) * (kTilesY + 1));
+    for (uint32_t y = 0; y <= kTilesY; y++)
+    {
+        for (uint32_t x = 0; x <= kTilesX; x++)
+        {
+            const glm::vec2 ndc = glm::vec2(x, y) / glm::vec2(kTilesX, kTilesY) * 2.0f - 1.0f;
+            const glm::vec4 point = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+            const glm::vec3 ray = glm::vec3(point) / point.w;
+            rays[y * (kTilesX + 1) + x] = ray / -ray.z;
+        }
+    }
+
+    _clusterMin.resize(kClusterCount);
+    _clusterMax.resize(kClusterCount);
+    for (uint32_t slice = 0; slice < kSlices; slice++)
+    {
+        const float nearDepth = znear * std::pow(zfar / znear, static_cast<float>(slice) / kSlices);
+        const float farDepth = znear * std::pow(zfar / znear, static_cast<float>(slice + 1) / kSlices);
+        for (uint32_t y = 0; y < kTilesY; y++)
+        {
+            for (uint32_t x = 0; x < kTilesX; x++)
+            {
+                glm::vec3 boxMin(std::numeric_limits<float>::max()), boxMax(std::numeric_limits<float>::lowest());
+                for (uint32_t corner = 0; corner < 4; corner++)
+                {
+                    const glm::vec3& ray = rays[(y + (corner >> 1)) * (kTilesX + 1) + x + (corner & 1)];
+                    for (float depth : { nearDepth, farDepth })
+                    {
+                        boxMin = glm::min(boxMin, ray * depth);
+                        boxMax = glm::max(boxMax, ray * depth);
+                    }
+                }
+                const uint32_t cluster = (slice * kTilesY + y) * kTilesX + x;
+                _clusterMin[cluster] = boxMin;
+                _clusterMax[cluster] = boxMax;
+            }
+        }
+    }
+}
+
+void LightClusters::computeBounds(size_t light, const glm::vec3& center, float radius, const glm::mat4& projection)
+{
+    LightBounds& bounds = _bounds[light];
+    bounds.center = center;
+    bounds.radius = radius;
+    // an empty slice range skips the light
+    bounds.minSlice = 1;
+    bounds.maxSlice = 0;
+
+    const float depth = -center.z;
+    if (depth + radius < _znear || depth - radius > _zfar)
+        return;
+    auto getSlice = [&](float d) {
+        const float slice = std::floor(std::log(d) * _sliceScale + _sliceBias);
+        return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(kSlices - 1)));
+    };
+    bounds.minSlice = getSlice(std::max(depth - radius, _znear));
+    bounds.maxSlice = getSlice(std::min(depth + radius, _zfar));
+
+    // a sphere reaching the camera plane may cover any tile
+    bounds.minTile[0] = bounds.minTile[1] = 0;
+    bounds.maxTile[0] = kTilesX - 1;
+    bounds.maxTile[1] = kTilesY - 1;
+    if (depth - radius <= _znear)
+        return;
+
+    // the projected corners of the box around the sphere, all in front of the camera
+    glm::vec2 ndcMin(std::numeric_limits<float>::max()), ndcMax(std::numeric_limits<float>::lowest());
+    for (int corner = 0; corner < 8; corner++)
+    {
+        const glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+        const glm::vec4 clip = projection * glm::vec4(center + offset, 1.0f);
+        ndcMin = glm::min(ndcMin, glm::vec2(clip) / clip.w);
+        ndcMax = glm::max(ndcMax, glm::vec2(clip) / clip.w);
+    }
+    if (ndcMin.x > 1.0f || ndcMin.y > 1.0f || ndcMax.x < -1.0f || ndcMax.y < -1.0f)
+    {
+        bounds.minSlice = 1;
+        bounds.maxSlice = 0;
+        return;
+    }
+    bounds.minTile[0] = getTile(ndcMin.x, kTilesX);
+    bounds.minTile[1] = getTile(ndcMin.y, kTilesY);
+    bounds.maxTile[0] = getTile(ndcMax.x, kTilesX);
+    bounds.maxTile[1] = getTile(ndcMax.y, kTilesY);
+}
+
+void LightClusters::binSlice(uint32_t slice)
+{
+    SliceBins& bins = _slices[slice];
+    bins.scratchTiles.clear();
+    bins.scratchLights.clear();
+    for (uint32_t light = 0; light < _bounds.size(); light++)
+    {
+        const LightBounds& bounds = _bounds[light];
+        if (slice < bounds.minSlice || slice > bounds.maxSlice)
+            continue;
+        const float radius2 = bounds.radius * bounds.radius;
+        for (uint32_t y = bounds.minTile[1]; y <= bounds.maxTile[1]; y++)
+        {
+            for (uint32_t x = bounds.minTile[0]; x <= bounds.maxTile[0]; x++)
+            {
+                // distance from the sphere center to the view space box of the cluster
+                const uint32_t tile = y * kTilesX + x;
+                const uint32_t cluster = slice * kTileCount + tile;
+                const glm::vec3 closest = glm::clamp(bounds.center, _clusterMin[cluster], _clusterMax[cluster]);
+                const glm::vec3 offset = closest - bounds.center;
+                if (glm::dot(offset, offset) > radius2)
+                    continue;
+                bins.scratchTiles.push_back(tile);
+                bins.scratchLights.push_back(light);
+            }
+        }
+    }
+
+    // counting sort by tile, stable so the lights of a cluster stay in scene order
+    bins.tileCounts.assign(kTileCount, 0);
+    for (uint32_t tile : bins.scratchTiles)
+    {
+        bins.tileCounts[tile]++;
+    }
+    uint32_t offsets[kTileCount];
+    uint32_t offset = 0;
+    for (uint32_t tile = 0; tile < kTileCount; tile++)
+    {
+        offsets[tile] = offset;
+        offset += bins.tileCounts[tile];
+    }
+    bins.indices.resize(bins.scratchLights.size());
+    for (size_t i = 0; i < bins.scratchLights.size(); i++)
+    {
+        bins.indices[offsets[bins.scratchTiles[i]]++] = bins.scratchLights[i];
+    }
+}
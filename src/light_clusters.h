@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/gl_utility.h"
+#include "base/glsl_program.h"
+#include "base/light.h"
+#include "base/thread_pool.h"
+
+// clustered shading of the point and spot lights of a scene. the view frustum is cut into kTilesX x kTilesY
+// screen tiles and kSlices depth slices spaced exponentially (froxels), every light is binned on the CPU into
+// the clusters its range reaches, one slice per task, and a fragment is lit only by the lights of its cluster.
+// the lights, the offset and count of every cluster and the compact light index lists live in shader storage
+// buffers, read by phongClustered.frag and the deferred lighting pass
+class LightClusters
+{
+public:
+    static constexpr uint32_t kTilesX = 16;
+    static constexpr uint32_t kTilesY = 9;
+    static constexpr uint32_t kSlices = 24;
+    static constexpr uint32_t kClusterCount = kTilesX * kTilesY * kSlices;
+
+    // shader storage bindings of the lights, the clusters and the light indices, after those of GpuCulling
+    static constexpr GLuint kLightBinding = 5;
+    static constexpr GLuint kClusterBinding = 6;
+    static constexpr GLuint kIndexBinding = 7;
+
+    LightClusters();
+
+    ~LightClusters();
+
+    LightClusters(const LightClusters&) = delete;
+
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    // bins the lights for the camera of view and projection, znear and zfar those of projection. CPU only
+    void build(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights, const glm::mat4& view,
+        const glm::mat4& projection, float znear, float zfar, ThreadPool& pool = ThreadPool::getGlobal());
+
+    // uploads the last build to the shader storage buffers
+    void upload();
+
+    // binds the buffers to their bindings and sets the uniforms of the cluster lookup, with program in use
+    void bind(const GLSLProgram& program, int screenWidth, int screenHeight) const;
+
+    size_t getLightCount() const { return _lights.size(); }
+
+    // light references in all clusters, the size of the index lists
+    size_t getIndexCount() const { return _indices.size(); }
+
+    // offset in the index lists and light count of cluster (x, y, slice), x and y from the left bottom of the screen
+    glm::uvec2 getCluster(uint32_t x, uint32_t y, uint32_t slice) const
+    {
+        return _clusters[(slice * kTilesY + y) * kTilesX + x];
+    }
+
+    const std::vector<uint32_t>& getIndices() const { return _indices; }
+
+private:
+    // std430 layout of ClusterLight in the shaders. a point light has a spot cosine below -1
+    struct GpuLight
+    {
+        glm::vec4 positionRange;
+        glm::vec4 directionCosine;
+        glm::vec4 ambient;
+        glm::vec4 diffuse;
+        glm::vec4 specular;
+        glm::vec4 attenuation;
+    };
+
+    // view space bounding sphere of a light and the clusters it may reach, empty if it is outside the frustum
+    struct LightBounds
+    {
+        glm::vec3 center;
+        float radius;
+        uint32_t minTile[2];
+        uint32_t maxTile[2];
+        uint32_t minSlice;
+        uint32_t maxSlice;
+    };
+
+    // lights of one slice sorted by tile, filled by one task
+    struct SliceBins
+    {
+        std::vector<uint32_t> tileCounts;
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> scratchTiles;
+        std::vector<uint32_t> scratchLights;
+    };
+
+    std::vector<GpuLight> _lights;
+    std::vector<LightBounds> _bounds;
+    std::vector<SliceBins> _slices;
+    std::vector<glm::uvec2> _clusters;
+    std::vector<uint32_t> _indices;
+
+    // view space boxes of the clusters, rebuilt when the projection changes
+    std::vector<glm::vec3> _clusterMin;
+    std::vector<glm::vec3> _clusterMax;
+    glm::mat4 _projection = glm::mat4(0.0f);
+    float _znear = 0.0f;
+    float _zfar = 0.0f;
+    // slice = log(depth) * _sliceScale + _sliceBias
+    float _sliceScale = 0.0f;
+    float _sliceBias = 0.0f;
+
+    GLuint _lightBuffer = 0;
+    GLuint _clusterBuffer = 0;
+    GLuint _indexBuffer = 0;
+
+    void updateClusterBoxes(const glm::mat4& projection, float znear, float zfar);
+
+    void computeBounds(size_t light, const glm::vec3& center, float radius, const glm::mat4& projection);
+
+    void binSlice(uint32_t slice);
+};
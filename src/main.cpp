@@ -1,4 +1,5 @@
 #include "viewer.h"
+#include "benchmark.h"
 #include "config.h"
 #include <filesystem>
 #include <string>
@@ -21,11 +22,29 @@ Options getOptions(int argc, char* argv[]) {
     return options;
 }
 
+// `--benchmark <name>` runs a benchmark instead of the interactive viewer
+std::string getBenchmarkName(int argc, char* argv[]) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--benchmark") {
+            return argv[i + 1];
+        }
+    }
+    return "";
+}
+
 int main(int argc, char* argv[]) {
     Options options = getOptions(argc, argv);
+    const std::string benchmarkName = getBenchmarkName(argc, argv);
     std::cout << "current path = " << std::filesystem::current_path() << std::endl;
     try {
+        // without a window, so the CPU only benchmarks run on machines without a GPU
+        if (benchmark::isContextFree(benchmarkName)) {
+            return benchmark::runContextFree(benchmarkName) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
         Viewer viewer(options);
+        if (!benchmarkName.empty()) {
+            return viewer.runBenchmark(benchmarkName) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
         viewer.run();
     } catch (std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -6,7 +6,12 @@
 
 #include <string>
 #include <vector>
+#include "base/bounding_box.h"
+#include "base/geometry_pool.h"
+#include "base/mesh_lod.h"
+#include "base/meshlet.h"
 #include "base/vertex.h"
+#include "base/vertex_format.h"
 
 #include "base/glsl_program.h"
 
@@ -19,23 +24,226 @@ struct Textures {
     string path;
 };
 
+// sampler uniform of the number-th texture of type, from 1: texture_diffuse1, texture_diffuse2, ...
+// the shaders declare the first sampler of every type, those names are hashed at compile time. any other
+// name is built in scratch, which has to outlive the returned name
+inline UniformName getSamplerUniform(const string& type, unsigned int number, string& scratch)
+{
+    if (number == 1)
+    {
+        if (type == "texture_diffuse")
+            return "texture_diffuse1";
+        if (type == "texture_specular")
+            return "texture_specular1";
+        if (type == "texture_normal")
+            return "texture_normal1";
+        if (type == "texture_height")
+            return "texture_height1";
+    }
+    scratch = type;
+    scratch += std::to_string(number);
+    return scratch;
+}
+
+// CPU side geometry of a mesh, produced by the importer before anything is uploaded
+struct MeshData {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    BoundingBox          box;
+    vector<Meshlet>      meshlets;
+    // levels of detail, their indices follow the ones of LOD0 in indices
+    vector<MeshLod>      lods;
+};
+
+// non-owning view of the geometry of one mesh plus its texture references (ids not resolved yet).
+// the geometry lives in a MeshData or in a mapped mesh cache.
+struct MeshView {
+    const Vertex*       vertices = nullptr;
+    size_t              vertexCount = 0;
+    const unsigned int* indices = nullptr;
+    size_t              indexCount = 0;
+    const Meshlet*      meshlets = nullptr;
+    size_t              meshletCount = 0;
+    const MeshLod*      lods = nullptr;
+    size_t              lodCount = 0;
+    BoundingBox         box;
+    vector<Textures>    textures;
+};
+
+// node of the transform hierarchy of an imported model (an aiNode). nodes are stored parents first
+struct ModelNode {
+    string name;
+    // index of the parent node, ~0u for the root
+    uint32_t parent = ~0u;
+    // relative to the parent
+    glm::mat4 transform = glm::mat4(1.0f);
+};
+
+// transform of every node relative to the model root
+inline vector<glm::mat4> getNodeMatrices(const vector<ModelNode>& nodes)
+{
+    vector<glm::mat4> matrices(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+        matrices[i] = nodes[i].parent == ~0u ? nodes[i].transform : matrices[nodes[i].parent] * nodes[i].transform;
+    return matrices;
+}
+
+// transform of every mesh relative to the model root, meshNodes holds the node of every mesh
+inline vector<glm::mat4> getMeshMatrices(const vector<ModelNode>& nodes, const vector<uint32_t>& meshNodes)
+{
+    const vector<glm::mat4> nodeMatrices = getNodeMatrices(nodes);
+    vector<glm::mat4> matrices(meshNodes.size());
+    for (size_t i = 0; i < meshNodes.size(); i++)
+        matrices[i] = nodeMatrices[meshNodes[i]];
+    return matrices;
+}
+
+// CPU side geometry a Mesh keeps once it is uploaded
+enum class MeshCpuData {
+    // vertices and LOD0 indices in the Float layout
+    Full,
+    // positions and LOD0 indices, enough for picking
+    Positions,
+    // nothing, the geometry only lives on the GPU
+    None
+};
+
+// GPU geometry of one mesh. Meshes are move-only and own their range of the global GeometryPool, which is freed
+// with the mesh. the VAO is the one of the vertex format, shared by every mesh of the format
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data, filled as MeshCpuData asks for
     vector<Vertex>       vertices;
+    vector<glm::vec3>    positions;
     vector<unsigned int> indices;
     vector<Textures>      textures;
-    unsigned int VAO;
+    BoundingBox          box;
+    // contiguous index ranges with bounds, drawn selectively by drawVisible
+    vector<Meshlet>      meshlets;
+    // levels of detail in the same index buffer, empty if the mesh has LOD0 only
+    vector<MeshLod>      lods;
+    unsigned int VAO = 0;
+    // place of the mesh in the buffers of the VAO, the draws add them to their vertices and indices
+    int baseVertex = 0;
+    unsigned int firstIndex = 0;
+    // indices of LOD0
+    unsigned int indexCount = 0;
+    // GL_UNSIGNED_SHORT for meshes with fewer than 65536 vertices, see narrowIndices
+    GLenum indexType = GL_UNSIGNED_INT;
+    VertexFormat vertexFormat = VertexFormat::Float;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Textures> textures)
+    // constructor, takes over the arrays and keeps what cpuData asks for after the upload
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Textures> textures, MeshCpuData cpuData = MeshCpuData::Full)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), VertexFormat::Float, this->indices.data(), this->indices.size(), GL_UNSIGNED_INT);
+
+        if (cpuData == MeshCpuData::Full)
+            return;
+        if (cpuData == MeshCpuData::Positions)
+            keepPositions(this->vertices.data(), this->vertices.size());
+        else
+            vector<unsigned int>().swap(this->indices);
+        vector<Vertex>().swap(this->vertices);
+    }
+
+    // constructor for geometry that lives in memory owned by someone else (e.g. a mapped mesh cache).
+    // the data goes straight to the GPU and no CPU-side copy is kept.
+    Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, vector<Textures> textures)
+        : textures(std::move(textures))
+    {
+        setupMesh(vertexData, vertexCount, VertexFormat::Float, indexData, indexCount, GL_UNSIGNED_INT);
+    }
+
+    // same for vertices already converted to format (see packVertices) and 16 or 32 bit indices
+    Mesh(const void* vertexData, size_t vertexCount, VertexFormat format, const void* indexData, size_t indexCount, GLenum indexType, vector<Textures> textures)
+        : textures(std::move(textures))
+    {
+        setupMesh(vertexData, vertexCount, format, indexData, indexCount, indexType);
+    }
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&& rhs) noexcept
+        : vertices(std::move(rhs.vertices)), positions(std::move(rhs.positions)), indices(std::move(rhs.indices)),
+          textures(std::move(rhs.textures)), box(rhs.box), meshlets(std::move(rhs.meshlets)), lods(std::move(rhs.lods)),
+          VAO(rhs.VAO), baseVertex(rhs.baseVertex), firstIndex(rhs.firstIndex), indexCount(rhs.indexCount),
+          indexType(rhs.indexType), vertexFormat(rhs.vertexFormat), geometry(rhs.geometry)
+    {
+        rhs.VAO = 0;
+        rhs.geometry = GeometryPool::Range();
+    }
+
+    Mesh& operator=(Mesh&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            release();
+            vertices = std::move(rhs.vertices);
+            positions = std::move(rhs.positions);
+            indices = std::move(rhs.indices);
+            textures = std::move(rhs.textures);
+            box = rhs.box;
+            meshlets = std::move(rhs.meshlets);
+            lods = std::move(rhs.lods);
+            VAO = rhs.VAO;
+            baseVertex = rhs.baseVertex, firstIndex = rhs.firstIndex;
+            indexCount = rhs.indexCount;
+            indexType = rhs.indexType;
+            vertexFormat = rhs.vertexFormat;
+            geometry = rhs.geometry;
+            rhs.VAO = 0;
+            rhs.geometry = GeometryPool::Range();
+        }
+        return *this;
+    }
+
+    // frees the range of the pool, has to run on the context thread
+    ~Mesh()
+    {
+        release();
+    }
+
+    // copies the CPU side geometry cpuData asks for from the data the mesh was uploaded from,
+    // the LOD0 indices are the first indexCount ones
+    void keepCpuData(MeshCpuData cpuData, const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData)
+    {
+        if (cpuData == MeshCpuData::None)
+            return;
+        if (cpuData == MeshCpuData::Full)
+            vertices.assign(vertexData, vertexData + vertexCount);
+        else
+            keepPositions(vertexData, vertexCount);
+        indices.assign(indexData, indexData + indexCount);
+    }
+
+    // bytes of CPU side geometry the mesh holds
+    size_t getCpuBytes() const
+    {
+        return vertices.capacity() * sizeof(Vertex) + positions.capacity() * sizeof(glm::vec3)
+            + indices.capacity() * sizeof(unsigned int) + meshlets.capacity() * sizeof(Meshlet) + lods.capacity() * sizeof(MeshLod);
+    }
+
+    // shaders decode normal and tangent themselves for packed layouts, see the packedVertex uniform
+    bool isPacked() const
+    {
+        return vertexFormat != VertexFormat::Float;
+    }
+
+    // index buffer holds the levels of detail after LOD0, indexCount stays the one of LOD0
+    void setLods(const MeshLod* lodData, size_t lodCount)
+    {
+        lods.assign(lodData, lodData + lodCount);
+        if (!lods.empty())
+            indexCount = lods.front().indexCount;
+    }
+
+    // coarsest level whose error stays within maxErrorPixels, see ::selectLod
+    size_t selectLod(float pixelsPerUnit, float maxErrorPixels) const
+    {
+        return lods.empty() ? 0 : ::selectLod(lods.data(), lods.size(), pixelsPerUnit, maxErrorPixels);
     }
 
     // render the mesh
@@ -50,80 +258,138 @@ public:
         {
             glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
+            unsigned int number = 0;
+            const string& name = textures[i].type;
             if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
+                number = diffuseNr++;
             else if (name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
+                number = specularNr++;
             else if (name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
+                number = normalNr++;
             else if (name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
+                number = heightNr++;
 
             // now set the sampler to the correct texture unit
-            shader.setUniformInt((name + number).c_str(), i);
+            string scratch;
+            shader.setUniformInt(getSamplerUniform(name, number, scratch), i);
 
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
 
         // draw mesh
+        shader.setUniformBool("packedVertex", isPacked());
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        drawLod(0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // draws the meshlets of LOD0 inside frustum that do not face away from cameraPosition (both in world space),
+    // or all of LOD0 if it has no meshlets. the VAO has to be bound. returns the triangles drawn.
+    // occlusion rendered under viewProjection drops the hidden meshlets, see cullMeshlets
+    size_t drawVisible(const Frustum& frustum, const glm::mat4& model, const glm::vec3& cameraPosition,
+        const OcclusionBuffer* occlusion = nullptr, const glm::mat4& viewProjection = glm::mat4(1.0f)) const
+    {
+        if (meshlets.empty())
+            return drawLod(0);
+
+        static thread_local vector<IndexRange> ranges;
+        static thread_local vector<GLsizei> counts;
+        static thread_local vector<const void*> offsets;
+        static thread_local vector<GLint> baseVertices;
+        ranges.clear();
+        const size_t triangles = cullMeshlets(meshlets, frustum, model, cameraPosition, ranges, occlusion, viewProjection);
+
+        const size_t indexSize = GeometryPool::getIndexSize(indexType);
+        counts.resize(ranges.size());
+        offsets.resize(ranges.size());
+        baseVertices.assign(ranges.size(), baseVertex);
+        for (size_t i = 0; i < ranges.size(); i++)
+        {
+            counts[i] = static_cast<GLsizei>(ranges[i].count);
+            offsets[i] = reinterpret_cast<const void*>((firstIndex + ranges[i].first) * indexSize);
+        }
+        if (!ranges.empty())
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), indexType, offsets.data(),
+                static_cast<GLsizei>(ranges.size()), baseVertices.data());
+        return triangles;
+    }
+
+    // draws one level of detail, the VAO has to be bound. returns the triangles drawn
+    size_t drawLod(size_t level) const
+    {
+        const IndexRange range = getLodRange(level);
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.count, indexType,
+            reinterpret_cast<const void*>((firstIndex + range.first) * GeometryPool::getIndexSize(indexType)), baseVertex);
+        return range.count / 3;
+    }
+
+    // appends the command of one level of detail to commands instead of drawing it, baseInstance is the draw id
+    // the vertex shader gets. returns the triangles of the command
+    size_t addLodCommand(size_t level, uint32_t baseInstance, vector<DrawElementsIndirectCommand>& commands) const
+    {
+        const IndexRange range = getLodRange(level);
+        commands.push_back({ range.count, 1, firstIndex + range.first, baseVertex, baseInstance });
+        return range.count / 3;
+    }
+
+    // appends the commands of the meshlets drawVisible would draw, one per run of meshlets, all with baseInstance
+    size_t addVisibleCommands(const Frustum& frustum, const glm::mat4& model, const glm::vec3& cameraPosition,
+        uint32_t baseInstance, vector<DrawElementsIndirectCommand>& commands, const OcclusionBuffer* occlusion = nullptr,
+        const glm::mat4& viewProjection = glm::mat4(1.0f)) const
+    {
+        if (meshlets.empty())
+            return addLodCommand(0, baseInstance, commands);
+
+        static thread_local vector<IndexRange> ranges;
+        ranges.clear();
+        const size_t triangles = cullMeshlets(meshlets, frustum, model, cameraPosition, ranges, occlusion, viewProjection);
+        for (const IndexRange& range : ranges)
+            commands.push_back({ range.count, 1, firstIndex + range.first, baseVertex, baseInstance });
+        return triangles;
+    }
+
 private:
     // render data 
-    unsigned int VBO, EBO;
+    GeometryPool::Range geometry;
 
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    // indices of one level of detail from the first one of the mesh, LOD0 for levels the mesh does not have
+    IndexRange getLodRange(size_t level) const
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        if (level == 0 || level >= lods.size())
+            return { 0, indexCount };
+        return { lods[level].indexOffset, lods[level].indexCount };
+    }
 
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-        // ids
-        glEnableVertexAttribArray(5);
-        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-        // weights
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+    void release()
+    {
+        GeometryPool::getGlobal().free(geometry);
+        geometry = GeometryPool::Range();
+        VAO = 0;
+    }
+
+    void keepPositions(const Vertex* vertexData, size_t vertexCount)
+    {
+        positions.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+            positions[i] = vertexData[i].Position;
+    }
+
+    // uploads the vertices and indices to the pool, whose VAO of the format already has the attribute pointers
+    void setupMesh(const void* vertexData, size_t vertexCount, VertexFormat format, const void* indexData, size_t indexCount, GLenum indexType)
+    {
+        this->indexCount = static_cast<unsigned int>(indexCount);
+        this->indexType = indexType;
+        this->vertexFormat = format;
+
+        GeometryPool& pool = GeometryPool::getGlobal();
+        geometry = pool.allocate(vertexData, vertexCount, format, indexData, indexCount, indexType);
+        VAO = pool.getVertexArray(format);
+        baseVertex = static_cast<int>(geometry.baseVertex);
+        firstIndex = GeometryPool::getFirstIndex(geometry, indexType);
     }
 };
 #endif
\ No newline at end of file
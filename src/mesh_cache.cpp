@@ -0,0 +1,429 @@
+#include "mesh_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+constexpr char CACHE_MAGIC[8] = {'R', 'T', 'R', 'M', 'E', 'S', 'H', '\0'};
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t importFlags;
+    uint32_t meshCount;
+    int64_t sourceTime;
+    float boxMin[3];
+    float boxMax[3];
+    uint32_t sourcePathLength;
+    uint32_t nodeCount;
+    float weldEpsilon;
+    uint32_t padding;
+};
+static_assert(sizeof(FileHeader) == 72, "mesh cache header must stay tightly packed");
+
+struct MeshHeader
+{
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t meshletCount;
+    uint32_t lodCount;
+    uint32_t textureCount;
+    float boxMin[3];
+    float boxMax[3];
+};
+
+size_t alignTo4(size_t offset)
+{
+    return (offset + 3) & ~size_t(3);
+}
+
+// bounds checked reader over the mapped bytes
+class Reader
+{
+public:
+    Reader(const uint8_t* data, size_t size) : _data(data), _size(size) {}
+
+    template <typename T>
+    const T* take(size_t count = 1)
+    {
+        const size_t bytes = sizeof(T) * count;
+        if (_offset + bytes > _size) return nullptr;
+        const T* p = reinterpret_cast<const T*>(_data + _offset);
+        _offset += bytes;
+        return p;
+    }
+
+    bool takeString(std::string& s)
+    {
+        const uint32_t* length = take<uint32_t>();
+        if (!length) return false;
+        const char* chars = take<char>(*length);
+        if (!chars) return false;
+        s.assign(chars, *length);
+        return true;
+    }
+
+    bool align()
+    {
+        _offset = alignTo4(_offset);
+        return _offset <= _size;
+    }
+
+    // whether count records of at least recordSize bytes each can still follow, checked before sizing
+    // containers by counts read from the file
+    bool canHold(size_t count, size_t recordSize) const
+    {
+        return _offset <= _size && count <= (_size - _offset) / recordSize;
+    }
+
+private:
+    const uint8_t* _data;
+    size_t _size;
+    size_t _offset = 0;
+};
+
+// whether every index is a vertex of the mesh and every meshlet and level of detail lies in its indices,
+// so that a corrupted cache of the right size can not make the importer or the draws read outside the mesh
+bool hasValidRanges(const MeshView& mesh)
+{
+    if (mesh.indexCount % 3 != 0
+        || std::any_of(mesh.indices, mesh.indices + mesh.indexCount, [&](unsigned int index) { return index >= mesh.vertexCount; }))
+        return false;
+
+    const auto inIndices = [&](uint32_t offset, uint32_t count) { return uint64_t(offset) + count <= mesh.indexCount; };
+    return std::all_of(mesh.meshlets, mesh.meshlets + mesh.meshletCount,
+               [&](const Meshlet& meshlet) { return inIndices(meshlet.indexOffset, meshlet.indexCount); })
+        && std::all_of(mesh.lods, mesh.lods + mesh.lodCount,
+               [&](const MeshLod& lod) { return inIndices(lod.indexOffset, lod.indexCount); });
+}
+
+void writeString(std::ofstream& os, const std::string& s)
+{
+    const uint32_t length = static_cast<uint32_t>(s.size());
+    os.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    os.write(s.data(), length);
+}
+
+void writePadding(std::ofstream& os)
+{
+    static const char zeros[4] = {};
+    const size_t offset = static_cast<size_t>(os.tellp());
+    os.write(zeros, alignTo4(offset) - offset);
+}
+} // namespace
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept
+    : _data(rhs._data), _size(rhs._size)
+#ifdef _WIN32
+    , _file(rhs._file), _mapping(rhs._mapping)
+#endif
+{
+    rhs._data = nullptr;
+    rhs._size = 0;
+#ifdef _WIN32
+    rhs._file = nullptr;
+    rhs._mapping = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    _file = file;
+    _mapping = mapping;
+    _data = static_cast<const uint8_t*>(view);
+    _size = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+
+    _data = static_cast<const uint8_t*>(view);
+    _size = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data == nullptr) return;
+#ifdef _WIN32
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+    CloseHandle(_file);
+    _mapping = nullptr;
+    _file = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(_data), _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+std::string MeshCache::getCachePath(const std::string& sourcePath)
+{
+    return sourcePath + ".meshcache";
+}
+
+int64_t MeshCache::getSourceTime(const std::string& sourcePath)
+{
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(sourcePath, ec);
+    if (ec) return 0;
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+bool MeshCache::open(const std::string& sourcePath, unsigned int importFlags, float weldEpsilon)
+{
+    _meshes.clear();
+    _nodes.clear();
+    _meshNodes.clear();
+    if (!_file.open(getCachePath(sourcePath))) return false;
+
+    Reader reader(_file.data(), _file.size());
+
+    const FileHeader* header = reader.take<FileHeader>();
+    if (!header
+        || std::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header->version != VERSION
+        || header->vertexSize != sizeof(Vertex)
+        || header->importFlags != importFlags
+        || header->weldEpsilon != weldEpsilon
+        || header->sourceTime != getSourceTime(sourcePath))
+    {
+        _file.close();
+        return false;
+    }
+
+    const char* path = reader.take<char>(header->sourcePathLength);
+    if (!path || sourcePath != std::string(path, header->sourcePathLength) || !reader.align())
+    {
+        _file.close();
+        return false;
+    }
+
+    _box.min = glm::vec3(header->boxMin[0], header->boxMin[1], header->boxMin[2]);
+    _box.max = glm::vec3(header->boxMax[0], header->boxMax[1], header->boxMax[2]);
+
+    // a mesh is at least its header and its node index, a node its name length, parent and matrix
+    constexpr size_t minNodeSize = 2 * sizeof(uint32_t) + 16 * sizeof(float);
+    if (!reader.canHold(header->meshCount, sizeof(MeshHeader) + sizeof(uint32_t))
+        || !reader.canHold(header->nodeCount, minNodeSize))
+    {
+        _file.close();
+        return false;
+    }
+
+    _meshes.resize(header->meshCount);
+    for (auto& entry : _meshes)
+    {
+        const MeshHeader* meshHeader = reader.take<MeshHeader>();
+        // a texture is at least the lengths of its type and path
+        if (!meshHeader || !reader.canHold(meshHeader->textureCount, 2 * sizeof(uint32_t)))
+        {
+            _meshes.clear();
+            _file.close();
+            return false;
+        }
+
+        entry.textures.resize(meshHeader->textureCount);
+        for (auto& texture : entry.textures)
+        {
+            texture.id = 0;
+            if (!reader.takeString(texture.type) || !reader.takeString(texture.path))
+            {
+                _meshes.clear();
+                _file.close();
+                return false;
+            }
+        }
+
+        entry.box.min = glm::vec3(meshHeader->boxMin[0], meshHeader->boxMin[1], meshHeader->boxMin[2]);
+        entry.box.max = glm::vec3(meshHeader->boxMax[0], meshHeader->boxMax[1], meshHeader->boxMax[2]);
+        entry.vertexCount = meshHeader->vertexCount;
+        entry.indexCount = meshHeader->indexCount;
+        entry.meshletCount = meshHeader->meshletCount;
+        entry.lodCount = meshHeader->lodCount;
+        if (!reader.align()
+            || !(entry.vertices = reader.take<Vertex>(entry.vertexCount))
+            || !(entry.indices = reader.take<unsigned int>(entry.indexCount))
+            || !(entry.meshlets = reader.take<Meshlet>(entry.meshletCount))
+            || !(entry.lods = reader.take<MeshLod>(entry.lodCount))
+            || !hasValidRanges(entry))
+        {
+            _meshes.clear();
+            _file.close();
+            return false;
+        }
+    }
+
+    // the hierarchy follows the meshes: name, parent and matrix of every node, then the node of every mesh
+    _nodes.resize(header->nodeCount);
+    for (auto& node : _nodes)
+    {
+        const uint32_t* parent = nullptr;
+        const float* transform = nullptr;
+        if (!reader.takeString(node.name) || !reader.align()
+            || !(parent = reader.take<uint32_t>()) || !(transform = reader.take<float>(16))
+            || (*parent != ~0u && *parent >= static_cast<uint32_t>(&node - _nodes.data())))
+        {
+            _meshes.clear();
+            _nodes.clear();
+            _file.close();
+            return false;
+        }
+        node.parent = *parent;
+        std::memcpy(&node.transform[0][0], transform, sizeof(node.transform));
+    }
+    const uint32_t* meshNodes = reader.take<uint32_t>(_meshes.size());
+    if (!meshNodes || std::any_of(meshNodes, meshNodes + _meshes.size(), [&](uint32_t node) { return node >= _nodes.size(); }))
+    {
+        _meshes.clear();
+        _nodes.clear();
+        _file.close();
+        return false;
+    }
+    _meshNodes.assign(meshNodes, meshNodes + _meshes.size());
+
+    return true;
+}
+
+bool MeshCache::write(const std::string& sourcePath, unsigned int importFlags, float weldEpsilon,
+    const std::vector<MeshView>& meshes, const std::vector<ModelNode>& nodes, const std::vector<uint32_t>& meshNodes,
+    const BoundingBox& box)
+{
+    // write to a temporary file first so that a concurrent reader never maps a half written cache
+    const std::string cachePath = getCachePath(sourcePath);
+    const std::string tempPath = cachePath + ".tmp";
+
+    {
+        std::ofstream os(tempPath, std::ios::binary | std::ios::trunc);
+        if (!os) return false;
+
+        FileHeader header = {};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.importFlags = importFlags;
+        header.weldEpsilon = weldEpsilon;
+        header.meshCount = static_cast<uint32_t>(meshes.size());
+        header.sourceTime = getSourceTime(sourcePath);
+        for (int i = 0; i < 3; ++i)
+        {
+            header.boxMin[i] = box.min[i];
+            header.boxMax[i] = box.max[i];
+        }
+        header.sourcePathLength = static_cast<uint32_t>(sourcePath.size());
+        header.nodeCount = static_cast<uint32_t>(nodes.size());
+
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(sourcePath.data(), sourcePath.size());
+        writePadding(os);
+
+        for (const auto& mesh : meshes)
+        {
+            MeshHeader meshHeader = {};
+            meshHeader.vertexCount = static_cast<uint32_t>(mesh.vertexCount);
+            meshHeader.indexCount = static_cast<uint32_t>(mesh.indexCount);
+            meshHeader.meshletCount = static_cast<uint32_t>(mesh.meshletCount);
+            meshHeader.lodCount = static_cast<uint32_t>(mesh.lodCount);
+            meshHeader.textureCount = static_cast<uint32_t>(mesh.textures.size());
+            for (int i = 0; i < 3; ++i)
+            {
+                meshHeader.boxMin[i] = mesh.box.min[i];
+                meshHeader.boxMax[i] = mesh.box.max[i];
+            }
+            os.write(reinterpret_cast<const char*>(&meshHeader), sizeof(meshHeader));
+
+            for (const auto& texture : mesh.textures)
+            {
+                writeString(os, texture.type);
+                writeString(os, texture.path);
+            }
+            writePadding(os);
+
+            os.write(reinterpret_cast<const char*>(mesh.vertices), mesh.vertexCount * sizeof(Vertex));
+            os.write(reinterpret_cast<const char*>(mesh.indices), mesh.indexCount * sizeof(unsigned int));
+            os.write(reinterpret_cast<const char*>(mesh.meshlets), mesh.meshletCount * sizeof(Meshlet));
+            os.write(reinterpret_cast<const char*>(mesh.lods), mesh.lodCount * sizeof(MeshLod));
+        }
+
+        for (const auto& node : nodes)
+        {
+            writeString(os, node.name);
+            writePadding(os);
+            os.write(reinterpret_cast<const char*>(&node.parent), sizeof(node.parent));
+            os.write(reinterpret_cast<const char*>(&node.transform[0][0]), sizeof(node.transform));
+        }
+        os.write(reinterpret_cast<const char*>(meshNodes.data()), meshNodes.size() * sizeof(uint32_t));
+
+        if (!os) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    return true;
+}
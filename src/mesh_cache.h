@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/bounding_box.h"
+#include "base/vertex.h"
+#include "mesh.h"
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile& rhs) = delete;
+
+    MappedFile(MappedFile&& rhs) noexcept;
+
+    ~MappedFile();
+
+    bool open(const std::string& path);
+
+    void close();
+
+    const uint8_t* data() const { return _data; }
+
+    size_t size() const { return _size; }
+
+private:
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+};
+
+// binary cache of the processed meshes of an imported model.
+// the cache lives next to the source asset and is only valid for the same
+// source path, modification time, post-process flags, weld epsilon and cache version.
+class MeshCache
+{
+public:
+    // bump whenever the file layout or the mesh processing changes
+    static constexpr uint32_t VERSION = 8;
+
+    // maps the cache of sourcePath, returns false if it is missing, stale or corrupted. the sizes, the indices and
+    // the meshlet and LOD ranges are checked, the vertices themselves are trusted
+    bool open(const std::string& sourcePath, unsigned int importFlags, float weldEpsilon);
+
+    // views into the mapped file, valid as long as the cache is open
+    const std::vector<MeshView>& getMeshes() const { return _meshes; }
+
+    const BoundingBox& getBoundingBox() const { return _box; }
+
+    // transform hierarchy and the node of every mesh, see ModelImport
+    const std::vector<ModelNode>& getNodes() const { return _nodes; }
+
+    const std::vector<uint32_t>& getMeshNodes() const { return _meshNodes; }
+
+    static bool write(const std::string& sourcePath, unsigned int importFlags, float weldEpsilon,
+        const std::vector<MeshView>& meshes, const std::vector<ModelNode>& nodes, const std::vector<uint32_t>& meshNodes,
+        const BoundingBox& box);
+
+    static std::string getCachePath(const std::string& sourcePath);
+
+    // modification time of a source file as stored in caches, 0 if it can not be read
+    static int64_t getSourceTime(const std::string& sourcePath);
+
+private:
+    MappedFile _file;
+    std::vector<MeshView> _meshes;
+    std::vector<ModelNode> _nodes;
+    std::vector<uint32_t> _meshNodes;
+    BoundingBox _box;
+};
@@ -1,41 +1,447 @@
 #include "model.h"
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
+#include <cstring>
+
+#include "base/ktx2_file.h"
+
+namespace
+{
+// 64 bit hash of a byte range, reads 8 bytes per step so hashing a decoded image stays cheap
+uint64_t hashBytes(const unsigned char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t getImageSize(const DecodedImage& image)
+{
+    return static_cast<size_t>(image.width) * image.height * image.channels;
+}
+
+// bytes that end up on the GPU, pixels or blocks of level 0
+const unsigned char* getPayload(const DecodedImage& image, size_t& size)
+{
+    if (!image.compressed.empty())
+    {
+        size = image.compressed.levels[0].data.size();
+        return image.compressed.levels[0].data.data();
+    }
+    size = getImageSize(image);
+    return image.data;
+}
+
+bool isSamePayload(const DecodedImage& a, const DecodedImage& b)
+{
+    size_t sizeA, sizeB;
+    const unsigned char* payloadA = getPayload(a, sizeA);
+    const unsigned char* payloadB = getPayload(b, sizeB);
+    return a.width == b.width && a.height == b.height && a.channels == b.channels
+        && a.compressed.format == b.compressed.format && a.compressed.levels.size() == b.compressed.levels.size()
+        && sizeA == sizeB && std::memcmp(payloadA, payloadB, sizeA) == 0;
+}
+} // namespace
+
+// BC5 keeps the two channels a tangent space normal needs, BC4 the single channel of
+// specular and height maps. BC7 is not available in stb_dxt, so diffuse maps use BC1 or BC3 with alpha
+BCnFormat GetTextureFormat(const string& typeName, int channels)
+{
+    if (typeName == "texture_normal")
+        return BCnFormat::BC5;
+    if (typeName == "texture_specular" || typeName == "texture_height")
+        return BCnFormat::BC4;
+    return (channels == 2 || channels == 4) ? BCnFormat::BC3 : BCnFormat::BC1;
+}
+
+BCnFormat GetFileTextureFormat(const string& filename, const string& typeName)
+{
+    int width = 0, height = 0, channels = 0;
+    stbi_info(filename.c_str(), &width, &height, &channels);
+    return GetTextureFormat(typeName, channels);
+}
+
+DecodedImage::DecodedImage(DecodedImage&& rhs) noexcept
+    : width(rhs.width), height(rhs.height), channels(rhs.channels), data(rhs.data), compressed(std::move(rhs.compressed))
+{
+    rhs.data = nullptr;
+}
+
+DecodedImage& DecodedImage::operator=(DecodedImage&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        stbi_image_free(data);
+        width = rhs.width;
+        height = rhs.height;
+        channels = rhs.channels;
+        data = rhs.data;
+        compressed = std::move(rhs.compressed);
+        rhs.data = nullptr;
+    }
+    return *this;
+}
+
+DecodedImage::~DecodedImage()
+{
+    stbi_image_free(data);
+}
+
+DecodedImage DecodeImage(const char* path, const string& directory)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    DecodedImage image;
+    image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (!image.data)
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+    }
+    return image;
+}
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+DecodedImage DecodeCompressedImage(const char* path, const string& directory, const string& typeName, ThreadPool& pool)
+{
+    const string filename = directory + '/' + path;
+    const BCnFormat format = GetFileTextureFormat(filename, typeName);
+    const string ktxPath = filename + '.' + getFormatName(format) + ".ktx2";
+    const int64_t sourceTime = MeshCache::getSourceTime(filename);
+
+    DecodedImage image;
+    int64_t ktxSourceTime = 0;
+    if (Ktx2File::read(ktxPath, image.compressed, ktxSourceTime)
+        && ktxSourceTime == sourceTime && image.compressed.format == format)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
+        image.width = image.compressed.levels[0].width;
+        image.height = image.compressed.levels[0].height;
+        return image;
+    }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    image = DecodeImage(path, directory);
+    if (!image.data)
+        return image;
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    image.compressed = compressImage(image.data, image.width, image.height, image.channels, format, pool);
+    stbi_image_free(image.data);
+    image.data = nullptr;
+    image.channels = 0;
 
-        stbi_image_free(data);
+    if (!Ktx2File::write(ktxPath, image.compressed, sourceTime))
+    {
+        spdlogManagement::getConsoleLogHandle()->warn("write texture cache {} failed", ktxPath);
+    }
+    return image;
+}
+
+shared_ptr<ImageTexture2D> TextureFromImage(const DecodedImage& image, const string& key)
+{
+    if (!image.compressed.empty())
+    {
+        auto texture = make_unique<ImageTexture2D>(image.compressed, key);
+        const size_t bytes = image.compressed.getByteSize();
+        return TextureCache::getGlobal().add(key, std::move(texture), bytes);
     }
+
+    if (!image.data)
+    {
+        // keep the mesh drawable with a black texture, it is not cached so a fixed file is picked up on the next load
+        const unsigned char black[3] = { 0, 0, 0 };
+        return make_shared<ImageTexture2D>(black, 1, 1, 3, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE, key);
+    }
+
+    GLenum format;
+    if (image.channels == 1)
+        format = GL_RED;
+    else if (image.channels == 3)
+        format = GL_RGB;
+    else if (image.channels == 4)
+        format = GL_RGBA;
     else
+        format = GL_RG;
+
+    auto texture = make_unique<ImageTexture2D>(image.data, image.width, image.height, image.channels,
+        static_cast<GLint>(format), format, GL_UNSIGNED_BYTE, key);
+    texture->bind();
+    texture->generateMipmap();
+    texture->setParamterInt(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    texture->unbind();
+
+    // a full mip chain adds about a third on top of the base level
+    const size_t bytes = getImageSize(image) * 4 / 3;
+    return TextureCache::getGlobal().add(key, std::move(texture), bytes);
+}
+
+shared_ptr<ImageTexture2D> TextureFromFile(const char* path, const string& directory, const string& typeName)
+{
+    const string key = ModelImport::getTextureKey(directory, path, typeName);
+    if (auto texture = TextureCache::getGlobal().find(key))
+        return texture;
+    if (ModelImport::compressTextures)
+        return TextureFromImage(DecodeCompressedImage(path, directory, typeName, ThreadPool::getGlobal()), key);
+    return TextureFromImage(DecodeImage(path, directory), key);
+}
+
+string ModelImport::getTextureKey(const string& directory, const string& path, const string& typeName)
+{
+    const string key = TextureCache::makeKey(directory + '/' + path);
+    if (!compressTextures)
+        return key;
+    return key + '.' + getFormatName(GetFileTextureFormat(directory + '/' + path, typeName));
+}
+
+bool ModelImport::load(const string& path, bool useCache, ThreadPool& pool)
+{
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    this->path = path;
+    // retrieve the directory path of the filepath
+    directory = path.substr(0, path.find_last_of('/'));
+
+    // try the binary mesh cache first, it skips the whole assimp import
+    const bool fromCache = useCache && cache.open(path, importFlags, weldEpsilon);
+    if (fromCache)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        box = cache.getBoundingBox();
+        meshes = cache.getMeshes();
+        nodes = cache.getNodes();
+        meshNodes = cache.getMeshNodes();
+    }
+    else if (!importWithAssimp(useCache, pool))
+    {
+        return false;
+    }
+    if (nodes.empty())
+    {
+        nodes.emplace_back();
+        meshNodes.assign(meshes.size(), 0);
+    }
+
+    packMeshes(pool);
+    decodeImages(pool);
+
+    console_logger->info("load {} {} in {:.2f} ms", path, fromCache ? "from mesh cache" : "with assimp",
+        std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    return true;
+}
+
+bool ModelImport::importWithAssimp(bool writeCache, ThreadPool& pool)
+{
+    // read file via ASSIMP
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, importFlags);
+    // check for errors
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+    {
+        cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+        return false;
+    }
+
+    // convert the meshes of ASSIMP's node tree in parallel
+    vector<const aiMesh*> aiMeshes;
+    AssimpModel::collectMeshes(scene->mRootNode, scene, aiMeshes, &nodes, &meshNodes);
+    meshData = AssimpModel::convertMeshes(aiMeshes, pool);
+    optimizeMeshes(pool);
+    const vector<glm::mat4> nodeMatrices = getNodeMatrices(nodes);
+
+    meshes.resize(aiMeshes.size());
+    for (size_t i = 0; i < aiMeshes.size(); i++)
+    {
+        MeshView& view = meshes[i];
+        view.vertices = meshData[i].vertices.data();
+        view.vertexCount = meshData[i].vertices.size();
+        view.indices = meshData[i].indices.data();
+        view.indexCount = meshData[i].indices.size();
+        view.meshlets = meshData[i].meshlets.data();
+        view.meshletCount = meshData[i].meshlets.size();
+        view.lods = meshData[i].lods.data();
+        view.lodCount = meshData[i].lods.size();
+        view.box = meshData[i].box;
+        view.textures = AssimpModel::collectTextures(scene->mMaterials[aiMeshes[i]->mMaterialIndex]);
+        // the model box is in the space of the root, around the meshes placed by their nodes
+        glm::vec3 center, extent;
+        Frustum::transformBox(view.box, nodeMatrices[meshNodes[i]], center, extent);
+        box += center - extent;
+        box += center + extent;
     }
 
-    return textureID;
-}
\ No newline at end of file
+    if (writeCache && !MeshCache::write(path, importFlags, weldEpsilon, meshes, nodes, meshNodes, box))
+    {
+        spdlogManagement::getConsoleLogHandle()->warn("write mesh cache {} failed", MeshCache::getCachePath(path));
+    }
+    return true;
+}
+
+void ModelImport::releaseMesh(size_t i)
+{
+    vector<uint8_t>().swap(packedVertices[i]);
+    vector<uint16_t>().swap(shortIndices[i]);
+    // cached meshes point into the mapping, which goes away with the import
+    if (i < meshData.size())
+        meshData[i] = MeshData();
+    const BoundingBox box = meshes[i].box;
+    meshes[i] = MeshView();
+    meshes[i].box = box;
+}
+
+void ModelImport::optimizeMeshes(ThreadPool& pool)
+{
+    // weld the copies assimp leaves for every face corner, reorder for the post-transform cache and overdraw,
+    // split into meshlets, order the vertices for fetch and simplify into levels of detail. this runs before
+    // the mesh cache is written, so cached loads skip it
+    vector<VertexCacheStats> before(meshData.size()), after(meshData.size());
+    vector<size_t> vertexCounts(meshData.size()), welded(meshData.size());
+    pool.parallelFor(meshData.size(), [&](size_t i) {
+        MeshData& mesh = meshData[i];
+        vertexCounts[i] = mesh.vertices.size();
+        before[i] = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+        welded[i] = weldVertices(mesh.vertices, mesh.indices, weldEpsilon, pool);
+        optimizeMesh(mesh.vertices, mesh.indices);
+        mesh.meshlets = buildMeshlets(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+        mesh.vertices.resize(optimizeVertexFetch(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size()));
+        after[i] = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+        // the levels index the vertices of LOD0, so they are built after its vertex order is final
+        mesh.lods = buildLods(mesh.vertices, mesh.indices);
+    });
+
+    // totals of the whole model, the ratios are weighted by the triangle and vertex counts of the meshes
+    double triangles = 0, transformedBefore = 0, transformedAfter = 0, verticesBefore = 0, verticesAfter = 0;
+    size_t weldedCount = 0;
+    vector<size_t> lodTriangles(kMaxLodCount, 0);
+    for (size_t i = 0; i < meshData.size(); i++)
+    {
+        const auto& lods = meshData[i].lods;
+        // meshes with fewer levels count with their coarsest one in the totals of the missing levels
+        for (size_t level = 0; level < kMaxLodCount; level++)
+            lodTriangles[level] += lods[std::min(level, lods.size() - 1)].indexCount / 3;
+
+        const double meshTriangles = static_cast<double>(lods.front().indexCount / 3);
+        triangles += meshTriangles;
+        transformedBefore += before[i].acmr * meshTriangles;
+        transformedAfter += after[i].acmr * meshTriangles;
+        verticesBefore += vertexCounts[i];
+        verticesAfter += meshData[i].vertices.size();
+        weldedCount += welded[i];
+    }
+    if (verticesBefore > 0)
+    {
+        const size_t vertexCount = static_cast<size_t>(verticesBefore);
+        spdlogManagement::getConsoleLogHandle()->info("weld vertices of {}: {} -> {} ({:.1f}% fewer)", path,
+            vertexCount, vertexCount - weldedCount, 100.0 * weldedCount / verticesBefore);
+    }
+    if (triangles > 0)
+    {
+        spdlogManagement::getConsoleLogHandle()->info("optimize meshes of {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+            path, transformedBefore / triangles, transformedAfter / triangles,
+            transformedBefore / verticesBefore, transformedAfter / verticesAfter);
+        spdlogManagement::getConsoleLogHandle()->info("build lods of {}: {} / {} / {} / {} / {} triangles", path,
+            lodTriangles[0], lodTriangles[1], lodTriangles[2], lodTriangles[3], lodTriangles[4]);
+    }
+}
+
+void ModelImport::packMeshes(ThreadPool& pool)
+{
+    vertexFormats.assign(meshes.size(), VertexFormat::Float);
+    packedVertices.assign(meshes.size(), {});
+    shortIndices.assign(meshes.size(), {});
+
+    pool.parallelFor(meshes.size(), [&](size_t i) {
+        const MeshView& mesh = meshes[i];
+        shortIndices[i] = narrowIndices(mesh.indices, mesh.indexCount, mesh.vertexCount);
+        if (!packVertices)
+            return;
+        vertexFormats[i] = chooseVertexFormat(mesh.vertices, mesh.vertexCount);
+        if (vertexFormats[i] != VertexFormat::Float)
+            packedVertices[i] = ::packVertices(mesh.vertices, mesh.vertexCount, vertexFormats[i]);
+    });
+
+    size_t floatBytes = 0, packedBytes = 0;
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        floatBytes += meshes[i].vertexCount * sizeof(Vertex);
+        packedBytes += meshes[i].vertexCount * getVertexSize(vertexFormats[i]);
+    }
+    spdlogManagement::getConsoleLogHandle()->info("pack vertices of {}: {:.1f} KB -> {:.1f} KB", path,
+        floatBytes / 1024.0, packedBytes / 1024.0);
+}
+
+void ModelImport::decodeImages(ThreadPool& pool)
+{
+    // dedupe the references by path and type first, every use of a file is decoded only once
+    unordered_map<string, size_t> useIndex;
+    for (const auto& mesh : meshes)
+    {
+        for (const auto& texture : mesh.textures)
+        {
+            if (useIndex.emplace(getTextureUse(texture.path, texture.type), textures.size()).second)
+                textures.push_back(texture);
+        }
+    }
+
+    // decode all images on the pool that no other model has resident, hashing the pixels on the same worker
+    vector<DecodedImage> decoded(textures.size());
+    vector<uint64_t> hashes(textures.size(), 0);
+    vector<char> resident(textures.size(), 0);
+    pool.parallelFor(textures.size(), [&](size_t i) {
+        resident[i] = TextureCache::getGlobal().contains(getTextureKey(directory, textures[i].path, textures[i].type));
+        if (resident[i])
+            return;
+        if (compressTextures)
+            decoded[i] = DecodeCompressedImage(textures[i].path.c_str(), directory, textures[i].type, pool);
+        else
+            decoded[i] = DecodeImage(textures[i].path.c_str(), directory);
+
+        size_t size = 0;
+        const unsigned char* payload = getPayload(decoded[i], size);
+        if (payload)
+            hashes[i] = hashBytes(payload, size);
+    });
+
+    // then dedupe by content, different files with the same pixels end up in one GL texture
+    unordered_multimap<uint64_t, size_t> contentIndex;
+    textureImages.resize(textures.size());
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        if (resident[i])
+        {
+            textureImages[i] = residentImage;
+            continue;
+        }
+
+        DecodedImage& image = decoded[i];
+        size_t size = 0;
+        const bool valid = getPayload(image, size) != nullptr;
+        size_t imageIndex = images.size();
+        if (valid)
+        {
+            auto range = contentIndex.equal_range(hashes[i]);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (isSamePayload(images[it->second], image))
+                {
+                    imageIndex = it->second;
+                    break;
+                }
+            }
+        }
+
+        textureImages[i] = imageIndex;
+        if (imageIndex == images.size())
+        {
+            if (valid)
+                contentIndex.emplace(hashes[i], imageIndex);
+            images.push_back(std::move(image));
+        }
+    }
+}
@@ -6,46 +6,219 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "spdlogMgr.h"
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include "material.h"
+#include "base/bcn_encoder.h"
 #include "base/bounding_box.h"
+#include "base/mesh_optimizer.h"
+#include "base/scene_graph.h"
+#include "base/texture_cache.h"
+#include "base/thread_pool.h"
 #include "base/transform.h"
 
 using namespace std;
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
+// image decoded by stb_image, or block compressed (then data is null). decoding needs no GL context,
+// the upload happens later on the context thread.
+struct DecodedImage
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* data = nullptr;
+    CompressedImage compressed;
+
+    DecodedImage() = default;
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage(DecodedImage&& rhs) noexcept;
+    DecodedImage& operator=(DecodedImage&& rhs) noexcept;
+    ~DecodedImage();
+};
+
+DecodedImage DecodeImage(const char* path, const string& directory);
+// block format used for a texture of the given type
+BCnFormat GetTextureFormat(const string& typeName, int channels);
+// block format of the image file for a texture of the given type, from the channels in its header
+BCnFormat GetFileTextureFormat(const string& filename, const string& typeName);
+// block compressed image of path (relative to directory) in the format for typeName. it is read from the
+// KTX2 file next to the image named after the format (image.png.bc5.ktx2) when that is up to date,
+// otherwise encoded on pool and written there.
+DecodedImage DecodeCompressedImage(const char* path, const string& directory, const string& typeName, ThreadPool& pool);
+// uploads a decoded image as mipmapped model texture and registers it in the global TextureCache under key
+shared_ptr<ImageTexture2D> TextureFromImage(const DecodedImage& image, const string& key);
+// the texture of path (relative to directory) from the global TextureCache, decoded and uploaded on a miss
+shared_ptr<ImageTexture2D> TextureFromFile(const char* path, const string& directory, const string& typeName);
+
+// CPU side of loading a model: mesh cache or assimp import, mesh conversion and texture decoding.
+// nothing in here touches GL, so the whole import may run on a worker thread while the viewer renders.
+class ModelImport
+{
+public:
+    // post-process steps applied on import, part of the mesh cache key
+    static constexpr unsigned int importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+    // block compress textures on import, turned off when the context can not sample BCn
+    static inline bool compressTextures = true;
+
+    // vertices of an imported mesh that are equal after rounding every attribute to a multiple of this are welded
+    // into one, 0 welds exact copies only. part of the mesh cache key
+    static inline float weldEpsilon = 1e-5f;
+
+    string path;
+    string directory;
+    BoundingBox box;
+    // geometry and texture references of every mesh, pointing into meshData or the mapped cache
+    vector<MeshView> meshes;
+    // transform hierarchy of the file, the meshes are in the space of their node
+    vector<ModelNode> nodes;
+    // node of every mesh
+    vector<uint32_t> meshNodes;
+    // convert every mesh to the smallest VertexFormat that holds it, otherwise meshes stay Float
+    bool packVertices = true;
+    // CPU side geometry the meshes keep once they are uploaded
+    MeshCpuData cpuData = MeshCpuData::None;
+    // vertex layout of every mesh, and the converted vertices of the packed ones
+    vector<VertexFormat> vertexFormats;
+    vector<vector<uint8_t>> packedVertices;
+    // 16 bit copy of the indices of every mesh with fewer than 65536 vertices, empty for the others
+    vector<vector<uint16_t>> shortIndices;
+    // every texture referenced by the meshes once (deduplicated by getTextureUse), in order of first use
+    vector<Textures> textures;
+    // index into images for every texture, textures with identical pixels share one image.
+    // textures already resident in the TextureCache are not decoded again and map to residentImage
+    vector<size_t> textureImages;
+    static constexpr size_t residentImage = ~size_t(0);
+    // decoded images, deduplicated by content
+    vector<DecodedImage> images;
+
+    ModelImport() = default;
+    ModelImport(const ModelImport&) = delete;
+
+    // imports the model at path, returns false if it could not be read
+    bool load(const string& path, bool useCache, ThreadPool& pool);
+
+    // frees the staging data of the i-th mesh once it is uploaded, its view is empty afterwards
+    void releaseMesh(size_t i);
+
+    // frees the i-th decoded image once it is uploaded
+    void releaseImage(size_t i)
+    {
+        images[i] = DecodedImage();
+    }
+
+    // TextureCache key of a texture path relative to a model directory used as typeName. with compressTextures
+    // it ends in the block format, so one file used as two types is resident once per format
+    static string getTextureKey(const string& directory, const string& path, const string& typeName);
+
+    // one use of an image file. a file used as two texture types is decoded for each of them, as they may
+    // compress to different formats
+    static string getTextureUse(const string& path, const string& typeName)
+    {
+        return typeName + ':' + path;
+    }
+
+private:
+    vector<MeshData> meshData;
+    MeshCache cache;
+
+    bool importWithAssimp(bool writeCache, ThreadPool& pool);
+
+    void optimizeMeshes(ThreadPool& pool);
+
+    void packMeshes(ThreadPool& pool);
+
+    void decodeImages(ThreadPool& pool);
+};
 
 class AssimpModel
 {
 public:
     // model data 
     vector<Textures> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    unordered_map<string, size_t> textures_index;	// ModelImport::getTextureUse -> index into textures_loaded
+    vector<shared_ptr<ImageTexture2D>> textures_shared;	// keeps the GL textures of textures_loaded alive, they are shared with other models through the TextureCache
     vector<Mesh>    meshes;
     unique_ptr<Material> facetMaterial;
     BoundingBox box;
     string directory;
+    // placement of the model root in the scene
     Transform transform;
+    // imported transform hierarchy below the root and the node of every mesh, see ModelImport
+    vector<ModelNode> nodes;
+    vector<uint32_t> meshNodes;
+    // transform of every mesh relative to the model root, for copies of the model placed outside the graph
+    vector<glm::mat4> meshMatrices;
+    // root node of the model in the SceneGraph of the scene it was added to, its nodes follow it in order
+    uint32_t sceneNode = SceneGraph::kNoParent;
     bool gammaCorrection;
     bool display = true;
+    // rasterized into the occlusion buffers to hide what is behind it, needs the LOD0 positions on the CPU
+    bool occluder = false;
+
+    // post-process steps applied on import, part of the mesh cache key
+    static constexpr unsigned int importFlags = ModelImport::importFlags;
+
+    // constructor, expects a filepath to a 3D model. the model is imported and uploaded right away.
+    AssimpModel(string const& path, bool gamma = false, bool useCache = true, bool packVertices = true,
+        MeshCpuData cpuData = MeshCpuData::None) : gammaCorrection(gamma)
+    {
+        facetMaterial.reset(new PhongMaterial());
+
+        ModelImport import;
+        import.packVertices = packVertices;
+        import.cpuData = cpuData;
+        if (!import.load(path, useCache, ThreadPool::getGlobal()))
+            return;
+
+        directory = import.directory;
+        box = import.box;
+        nodes = import.nodes;
+        meshNodes = import.meshNodes;
+        meshMatrices = getMeshMatrices(nodes, meshNodes);
+        // staging memory goes away as soon as the GL copy exists, so the import never peaks at its full size
+        for (size_t i = 0; i < import.images.size(); i++)
+        {
+            uploadTexture(import, i);
+            import.releaseImage(i);
+        }
+        meshes.reserve(import.meshes.size());
+        for (size_t i = 0; i < import.meshes.size(); i++)
+        {
+            uploadMesh(import, i);
+            import.releaseMesh(i);
+        }
+    }
+
+    AssimpModel(AssimpModel&&) noexcept = default;
+    AssimpModel& operator=(AssimpModel&&) noexcept = default;
 
-    // constructor, expects a filepath to a 3D model.
-    AssimpModel(string const& path, bool gamma = false) : gammaCorrection(gamma)
+    // creates an empty model for an import done elsewhere (e.g. on a worker thread).
+    // the GL side is filled in step by step with uploadTexture and uploadMesh.
+    explicit AssimpModel(const ModelImport& import, bool gamma = false)
+        : box(import.box), directory(import.directory), nodes(import.nodes), meshNodes(import.meshNodes), gammaCorrection(gamma)
     {
-        loadModel(path);
         facetMaterial.reset(new PhongMaterial());
+        meshMatrices = getMeshMatrices(nodes, meshNodes);
+        meshes.reserve(import.meshes.size());
     }
 
     // draws the model, and thus all its meshes
@@ -55,113 +228,129 @@ public:
             meshes[i].Draw(shader);
     }
 
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const& path)
-    {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
-        }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+    // world matrix of the model root, the model has to be in graph
+    const glm::mat4& getWorldMatrix(const SceneGraph& graph) const
+    {
+        return graph.getWorldMatrix(sceneNode);
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    // world matrix of the i-th mesh: the model root times the imported transform of its node
+    const glm::mat4& getMeshMatrix(const SceneGraph& graph, size_t i) const
+    {
+        return graph.getWorldMatrix(sceneNode + 1 + meshNodes[i]);
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode* node, const aiScene* scene)
+    // pixels one model space unit covers on a viewport viewportHeight high with vertical field of view fovy,
+    // measured at the point of the bounding sphere closest to cameraPosition. model is the world matrix
+    // of the root. drives the LOD selection
+    float getPixelsPerUnit(const glm::mat4& model, const glm::vec3& cameraPosition, float fovy, float viewportHeight) const
     {
-        // process each mesh located at the current node
+        const float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+        const glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (box.min + box.max), 1.0f));
+        const float radius = 0.5f * glm::length(box.max - box.min) * scale;
+        const float distance = glm::length(center - cameraPosition) - radius;
+        return scale * ::getPixelsPerUnit(distance, fovy, viewportHeight);
+    }
+
+    // collects the meshes of a node and its children (if any) in depth first order.
+    // the node object only contains indices to index the actual objects in the scene.
+    // with nodes given, the hierarchy is kept too: the node, its transform and the node of every mesh collected
+    static void collectMeshes(const aiNode* node, const aiScene* scene, vector<const aiMesh*>& aiMeshes,
+        vector<ModelNode>* nodes = nullptr, vector<uint32_t>* meshNodes = nullptr, uint32_t parent = ~0u)
+    {
+        uint32_t index = parent;
+        if (nodes)
+        {
+            index = static_cast<uint32_t>(nodes->size());
+            const aiMatrix4x4& m = node->mTransformation;
+            // assimp matrices are row major
+            nodes->push_back({ node->mName.C_Str(), parent, glm::transpose(glm::make_mat4(&m.a1)) });
+        }
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
         {
-            // the node object only contains indices to index the actual objects in the scene. 
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            aiMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+            if (meshNodes)
+                meshNodes->push_back(index);
         }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            collectMeshes(node->mChildren[i], scene, aiMeshes, nodes, meshNodes, index);
         }
+    }
 
+    // converts all meshes as parallel tasks, one per aiMesh. results keep the order of the input.
+    static vector<MeshData> convertMeshes(const vector<const aiMesh*>& aiMeshes, ThreadPool& pool)
+    {
+        vector<MeshData> results(aiMeshes.size());
+        pool.parallelFor(aiMeshes.size(), [&](size_t i) { results[i] = convertMesh(aiMeshes[i]); });
+        return results;
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    // converts the geometry of a single aiMesh. it touches no GL state and may run on any thread.
+    static MeshData convertMesh(const aiMesh* mesh)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Textures> textures;
+        MeshData data;
+        data.vertices.resize(mesh->mNumVertices);
+        data.indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
 
         // walk through each of the mesh's vertices
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
+            Vertex& vertex = data.vertices[i];
             // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            this->box+=vector;
+            vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+            data.box += vertex.Position;
             // normals
             if (mesh->HasNormals())
             {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
+                vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
             }
             // texture coordinates
             if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
             {
-                glm::vec2 vec;
                 // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
                 // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+                if (mesh->HasTangentsAndBitangents())
+                {
+                    vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+                    vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+                }
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        // now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
         for (unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for (unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            const aiFace& face = mesh->mFaces[i];
+            data.indices.insert(data.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+        }
+
+        return data;
+    }
+
+    // collects the texture references of one material type, the textures are uploaded later by uploadTexture.
+    // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
+    // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
+    // Same applies to other texture as the following list summarizes:
+    // diffuse: texture_diffuseN
+    // specular: texture_specularN
+    // normal: texture_normalN
+    static vector<Textures> loadMaterialTextures(const aiMaterial* mat, aiTextureType type, const string& typeName)
+    {
+        vector<Textures> textures;
+        for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        {
+            aiString str;
+            mat->GetTexture(type, i, &str);
+            textures.push_back({ 0, typeName, str.C_Str() });
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
-        // Same applies to other texture as the following list summarizes:
-        // diffuse: texture_diffuseN
-        // specular: texture_specularN
-        // normal: texture_normalN
+        return textures;
+    }
 
+    // texture references of all material types of a mesh, in the sampler order used by Mesh::Draw
+    static vector<Textures> collectTextures(const aiMaterial* material)
+    {
+        vector<Textures> textures;
         // 1. diffuse maps
         vector<Textures> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
@@ -174,42 +363,75 @@ private:
         // 4. height maps
         std::vector<Textures> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        return textures;
+    }
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+    // uploads the i-th decoded image of the import and registers it for every texture path showing it.
+    // the texture cache knows it under the path of its first texture. has to run on the context thread
+    void uploadTexture(const ModelImport& import, size_t i)
+    {
+        shared_ptr<ImageTexture2D> shared;
+        for (size_t j = 0; j < import.textures.size(); j++)
+        {
+            if (import.textureImages[j] != i)
+                continue;
+            if (!shared)
+                shared = TextureFromImage(import.images[i], ModelImport::getTextureKey(directory, import.textures[j].path,
+                    import.textures[j].type));
+            addLoadedTexture(import.textures[j], shared);
+        }
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Textures> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+    // creates the GL side of the i-th mesh of the import, has to run on the context thread
+    void uploadMesh(const ModelImport& import, size_t i)
     {
+        const MeshView& view = import.meshes[i];
         vector<Textures> textures;
-        for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        textures.reserve(view.textures.size());
+        for (const auto& texture : view.textures)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if (!skip)
-            {   // if texture hasn't been loaded already, load it
-                Textures texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-            }
+            textures.push_back(loadTexture(texture.path.c_str(), texture.type));
         }
-        return textures;
+        const void* vertexData = view.vertices;
+        if (import.vertexFormats[i] != VertexFormat::Float)
+            vertexData = import.packedVertices[i].data();
+        if (!import.shortIndices[i].empty())
+            meshes.emplace_back(vertexData, view.vertexCount, import.vertexFormats[i],
+                import.shortIndices[i].data(), view.indexCount, GL_UNSIGNED_SHORT, std::move(textures));
+        else
+            meshes.emplace_back(vertexData, view.vertexCount, import.vertexFormats[i],
+                view.indices, view.indexCount, GL_UNSIGNED_INT, std::move(textures));
+        meshes.back().meshlets.assign(view.meshlets, view.meshlets + view.meshletCount);
+        meshes.back().setLods(view.lods, view.lodCount);
+        meshes.back().keepCpuData(import.cpuData, view.vertices, view.vertexCount, view.indices);
+        meshes.back().box = view.box;
+    }
+
+private:
+    // loads the texture at path (relative to the model directory) unless it was loaded before
+    Textures loadTexture(const char* path, const string& typeName)
+    {
+        // check if texture was loaded before and if so, skip loading a new texture
+        auto it = textures_index.find(ModelImport::getTextureUse(path, typeName));
+        if (it != textures_index.end())
+        {
+            // a texture with the same filepath and type has already been loaded, continue to next one. (optimization)
+            return textures_loaded[it->second];
+        }
+        // if texture hasn't been loaded already, load it. another model may still have it resident
+        Textures texture;
+        texture.type = typeName;
+        texture.path = path;
+        addLoadedTexture(texture, TextureFromFile(path, this->directory, typeName));
+        return textures_loaded.back();
+    }
+
+    void addLoadedTexture(Textures texture, shared_ptr<ImageTexture2D> shared)
+    {
+        texture.id = shared->getHandle();
+        textures_index.emplace(ModelImport::getTextureUse(texture.path, texture.type), textures_loaded.size());
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+        textures_shared.push_back(std::move(shared));
     }
 
     void updateBoundingBox()
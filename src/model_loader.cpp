@@ -0,0 +1,101 @@
+#include "model_loader.h"
+
+#include <chrono>
+#include <limits>
+#include <thread>
+
+#include "spdlogMgr.h"
+
+namespace
+{
+// decrements the loading count when a load coroutine ends or is destroyed
+struct LoadingScope
+{
+    size_t& count;
+
+    ~LoadingScope() { --count; }
+};
+} // namespace
+
+ModelLoader::ModelLoader(ThreadPool& pool)
+    : _pool(pool)
+{
+}
+
+ModelLoader::~ModelLoader()
+{
+    _cancelled = true;
+    while (_loadingCount > 0)
+    {
+        _uploadQueue.drain(std::numeric_limits<float>::max());
+        std::this_thread::yield();
+    }
+}
+
+std::shared_ptr<ModelLoader::Request> ModelLoader::load(const std::string& path, MeshCpuData cpuData)
+{
+    auto request = std::make_shared<Request>();
+    request->path = path;
+    request->cpuData = cpuData;
+    ++_loadingCount;
+    loadModel(request);
+    return request;
+}
+
+void ModelLoader::update(float budgetMs)
+{
+    _uploadQueue.drain(budgetMs);
+}
+
+Task ModelLoader::loadModel(std::shared_ptr<Request> request)
+{
+    LoadingScope scope{ _loadingCount };
+    auto console_logger = spdlogManagement::getConsoleLogHandle();
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    // worker thread: everything that does not need the GL context
+    co_await schedule(_pool);
+    auto import = std::make_unique<ModelImport>();
+    import->cpuData = request->cpuData;
+    bool imported = false;
+    try
+    {
+        imported = import->load(request->path, true, _pool);
+    }
+    catch (const std::exception& e)
+    {
+        console_logger->error("import {} failed: {}", request->path, e.what());
+    }
+
+    // render thread from here on, one upload per step
+    co_await _uploadQueue.schedule();
+    if (!imported || _cancelled)
+    {
+        request->state = Request::State::Failed;
+        co_return;
+    }
+
+    auto model = std::make_unique<AssimpModel>(*import);
+    for (size_t i = 0; i < import->images.size() && !_cancelled; i++)
+    {
+        model->uploadTexture(*import, i);
+        import->releaseImage(i);
+        co_await _uploadQueue.schedule();
+    }
+    for (size_t i = 0; i < import->meshes.size() && !_cancelled; i++)
+    {
+        model->uploadMesh(*import, i);
+        import->releaseMesh(i);
+        co_await _uploadQueue.schedule();
+    }
+    if (_cancelled)
+    {
+        request->state = Request::State::Failed;
+        co_return;
+    }
+
+    request->model = std::move(model);
+    request->state = Request::State::Ready;
+    console_logger->info("{} ready after {:.2f} ms", request->path,
+        std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+}
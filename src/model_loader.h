@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "base/task.h"
+#include "base/thread_pool.h"
+#include "model.h"
+
+// loads models in the background while the viewer keeps rendering.
+// each load is a coroutine: import and texture decoding run on the thread pool, then the
+// coroutine moves to the render thread and uploads one texture or mesh per step. the steps
+// are resumed by update() under a time budget, so a frame never stalls on a whole model.
+class ModelLoader
+{
+public:
+    // one model load, shared between the loader and the one waiting for the model
+    struct Request
+    {
+        enum class State { Loading, Ready, Failed };
+
+        std::string path;
+        // CPU side geometry the meshes keep after the upload
+        MeshCpuData cpuData = MeshCpuData::None;
+        State state = State::Loading;
+        // set once the state is Ready, the receiver takes it over
+        std::unique_ptr<AssimpModel> model;
+    };
+
+    explicit ModelLoader(ThreadPool& pool = ThreadPool::getGlobal());
+
+    ModelLoader(const ModelLoader& rhs) = delete;
+
+    // pending loads are cancelled at their next step, waits for running imports to finish
+    ~ModelLoader();
+
+    // starts loading the model at path, returns immediately
+    std::shared_ptr<Request> load(const std::string& path, MeshCpuData cpuData = MeshCpuData::None);
+
+    // runs pending GPU uploads on the calling thread for about budgetMs, call once per frame
+    void update(float budgetMs);
+
+    size_t getLoadingCount() const { return _loadingCount; }
+
+private:
+    ThreadPool& _pool;
+    // loads that are waiting for the render thread
+    TaskQueue _uploadQueue;
+    // only touched on the render thread
+    size_t _loadingCount = 0;
+    bool _cancelled = false;
+
+    Task loadModel(std::shared_ptr<Request> request);
+};
@@ -0,0 +1,121 @@
+#include "occlusion_culling.h"
+
+#include <algorithm>
+
+#include "base/thread_pool.h"
+
+void OcclusionCulling::resize(int width, int height)
+{
+    if (width != _buffer.getWidth() || height != _buffer.getHeight())
+        _buffer.resize(width, height);
+}
+
+size_t OcclusionCulling::render(const std::vector<AssimpModel>& models, const SceneGraph& graph, const SceneObjects* objects,
+    const ObjectVisibility* objectVisibility, const glm::mat4& viewProjection)
+{
+    _viewProjection = viewProjection;
+    _buffer.clear();
+    for (const auto& model : models)
+    {
+        if (!model.display || !model.occluder)
+            continue;
+        for (size_t m = 0; m < model.meshes.size(); m++)
+        {
+            addMesh(model.meshes[m], viewProjection * model.getMeshMatrix(graph, m));
+        }
+    }
+
+    auto addObject = [&](uint32_t object) {
+        const AssimpModel& model = models[objects->getModel(object)];
+        if (!model.occluder)
+            return;
+        const glm::mat4 clipMatrix = viewProjection * objects->getMatrix(object);
+        for (size_t m = 0; m < model.meshes.size(); m++)
+        {
+            addMesh(model.meshes[m], clipMatrix * model.meshMatrices[m]);
+        }
+    };
+    if (objects != nullptr && objectVisibility != nullptr)
+    {
+        for (uint32_t object : objectVisibility->objects)
+        {
+            addObject(object);
+        }
+    }
+    else if (objects != nullptr)
+    {
+        for (uint32_t object = 0; object < objects->size(); object++)
+        {
+            if (objects->isDisplayed(object))
+                addObject(object);
+        }
+    }
+
+    _buffer.render(ThreadPool::getGlobal());
+    return _buffer.getTriangleCount();
+}
+
+size_t OcclusionCulling::cull(const std::vector<AssimpModel>& models, const SceneGraph& graph, Visibility& visibility) const
+{
+    size_t hidden = 0;
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        if (!visibility.isModelVisible(i))
+            continue;
+        const AssimpModel& model = models[i];
+        uint8_t* meshes = visibility.meshes.data() + visibility.meshOffsets[i];
+        // one test of the model box hides all of its meshes
+        const bool modelVisible = isVisible(model.box, model.getWorldMatrix(graph));
+        size_t visibleMeshes = 0;
+        for (size_t m = 0; m < model.meshes.size(); m++)
+        {
+            if (!meshes[m])
+                continue;
+            if (!modelVisible || !isVisible(model.meshes[m].box, model.getMeshMatrix(graph, m)))
+            {
+                meshes[m] = 0;
+                hidden++;
+                continue;
+            }
+            visibleMeshes++;
+        }
+        if (visibleMeshes == 0)
+        {
+            visibility.models[i] = 0;
+            visibility.visibleModels--;
+        }
+    }
+    visibility.visibleMeshes -= hidden;
+    return hidden;
+}
+
+size_t OcclusionCulling::cull(const SceneObjects& objects, ObjectVisibility& visibility) const
+{
+    // filtering in place keeps the objects grouped by model
+    const size_t count = visibility.objects.size();
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint32_t object = visibility.objects[i];
+        if (!_buffer.isVisible(objects.getCenter(object), objects.getExtent(object), _viewProjection))
+        {
+            visibility.flags[object] = 0;
+            continue;
+        }
+        visibility.objects[kept++] = object;
+    }
+    visibility.objects.resize(kept);
+    return count - kept;
+}
+
+void OcclusionCulling::addMesh(const Mesh& mesh, const glm::mat4& clipMatrix)
+{
+    // only LOD0 is kept on the CPU, the coarser levels share its vertices but not their indices
+    const size_t indexCount = std::min<size_t>(mesh.indices.size(), mesh.indexCount);
+    if (indexCount == 0)
+        return;
+    if (!mesh.positions.empty())
+        _buffer.addOccluder(mesh.positions.data(), sizeof(glm::vec3), mesh.indices.data(), indexCount, clipMatrix);
+    else if (!mesh.vertices.empty())
+        _buffer.addOccluder(&mesh.vertices[0].Position, sizeof(Vertex), mesh.indices.data(), indexCount, clipMatrix);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/occlusion_buffer.h"
+#include "base/scene_graph.h"
+#include "model.h"
+#include "scene_culling.h"
+#include "scene_objects.h"
+
+// software occlusion culling of one view: the models flagged as occluders (and their placed copies) are
+// rasterized on the CPU into an OcclusionBuffer, then the boxes left by frustum culling are tested against it
+// before anything is submitted. only meshes that keep their LOD0 positions on the CPU can occlude, see MeshCpuData
+class OcclusionCulling
+{
+public:
+    // sets the resolution of the buffer, kept if unchanged
+    void resize(int width, int height);
+
+    // rasterizes the displayed occluders under viewProjection, replacing the last ones. the copies of occluder
+    // models in objects (may be null) are the ones objectVisibility lists, all displayed ones if it is null.
+    // returns the triangles rasterized
+    size_t render(const std::vector<AssimpModel>& models, const SceneGraph& graph, const SceneObjects* objects,
+        const ObjectVisibility* objectVisibility, const glm::mat4& viewProjection);
+
+    // clears the flags of the visible models and meshes hidden behind the occluders and updates the counts.
+    // returns the number of meshes hidden
+    size_t cull(const std::vector<AssimpModel>& models, const SceneGraph& graph, Visibility& visibility) const;
+
+    // removes the hidden objects from visibility, keeping the grouping by model. returns the number removed
+    size_t cull(const SceneObjects& objects, ObjectVisibility& visibility) const;
+
+    // false if the model space box under modelMatrix is hidden
+    bool isVisible(const BoundingBox& box, const glm::mat4& modelMatrix) const
+    {
+        return _buffer.isVisible(box, _viewProjection * modelMatrix);
+    }
+
+    const glm::mat4& getViewProjection() const { return _viewProjection; }
+
+    const OcclusionBuffer& getBuffer() const { return _buffer; }
+
+private:
+    OcclusionBuffer _buffer;
+    glm::mat4 _viewProjection = glm::mat4(1.0f);
+
+    void addMesh(const Mesh& mesh, const glm::mat4& clipMatrix);
+};
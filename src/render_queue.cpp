@@ -0,0 +1,249 @@
+#include "render_queue.h"
+
+#include <algorithm>
+
+#include "render_stats.h"
+
+namespace
+{
+// state of the GL context submit has not set yet
+constexpr GLuint kUnknown = ~GLuint(0);
+
+uint64_t getField(uint64_t value, int bits)
+{
+    return value & ((uint64_t(1) << bits) - 1);
+}
+
+// folds a 64 bit hash into bits
+uint64_t foldHash(uint64_t hash, int bits)
+{
+    hash ^= hash >> 32;
+    hash *= 0x9e3779b97f4a7c15ull;
+    return hash >> (64 - bits);
+}
+
+uint64_t hashTextures(const Mesh& mesh)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const Textures& texture : mesh.textures)
+        hash = (hash ^ texture.id) * 1099511628211ull;
+    return hash;
+}
+
+bool sameTextures(const Mesh& a, const Mesh& b)
+{
+    if (a.textures.size() != b.textures.size())
+        return false;
+    for (size_t i = 0; i < a.textures.size(); i++)
+    {
+        if (a.textures[i].id != b.textures[i].id)
+            return false;
+    }
+    return true;
+}
+}
+
+void RenderQueue::reset(float farPlane)
+{
+    _items.clear();
+    _keys.clear();
+    _passes.clear();
+    _depthScale = farPlane > 0.0f ? 1.0f / farPlane : 0.0f;
+}
+
+void RenderQueue::add(RenderPass& pass, const Mesh& mesh, const PhongMaterial& material, const glm::mat4& matrix,
+    float pixelsPerUnit, float depth)
+{
+    const uint32_t passIndex = getPassIndex(pass);
+    _items.push_back({ &pass, &mesh, &material, matrix, pixelsPerUnit });
+    _keys.push_back(makeKey(passIndex, mesh, material, depth));
+}
+
+void RenderQueue::submit(bool multiDraw)
+{
+    if (_items.empty())
+        return;
+    sortKeys(_keys, _order, _scratch);
+    if (multiDraw)
+    {
+        addRuns();
+        _draws.upload();
+    }
+
+    RenderStats& stats = RenderStats::getFrame();
+    GLuint boundVertexArray = kUnknown;
+    GLuint boundTextures[kTextureUnits];
+    std::fill(boundTextures, boundTextures + kTextureUnits, kUnknown);
+
+    // what the pass in use was given, reset with the program
+    RenderPass* pass = nullptr;
+    const PhongMaterial* material = nullptr;
+    const Mesh* textureMesh = nullptr;
+    const Mesh* vertexMesh = nullptr;
+    auto setState = [&](const Item& item) {
+        if (item.pass != pass)
+        {
+            if (pass != nullptr)
+                pass->endPass();
+            pass = item.pass;
+            pass->beginPass();
+            stats.programBinds++;
+            material = nullptr, textureMesh = nullptr, vertexMesh = nullptr;
+        }
+        if (item.material != material)
+        {
+            material = item.material;
+            pass->setMaterial(*material);
+        }
+        if (textureMesh == nullptr || !sameTextures(*item.mesh, *textureMesh))
+        {
+            textureMesh = item.mesh;
+            const size_t count = std::min<size_t>(textureMesh->textures.size(), kTextureUnits - 1);
+            for (size_t i = 0; i < count; i++)
+            {
+                const GLuint id = textureMesh->textures[i].id;
+                if (boundTextures[i + 1] == id)
+                    continue;
+                glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i + 1));
+                glBindTexture(GL_TEXTURE_2D, id);
+                boundTextures[i + 1] = id;
+                stats.textureBinds++;
+            }
+            pass->setTextures(*textureMesh);
+        }
+        if (item.mesh != vertexMesh)
+        {
+            vertexMesh = item.mesh;
+            if (vertexMesh->VAO != boundVertexArray)
+            {
+                glBindVertexArray(vertexMesh->VAO);
+                boundVertexArray = vertexMesh->VAO;
+                stats.vertexArrayBinds++;
+            }
+            pass->setVertexArray(*vertexMesh);
+        }
+    };
+
+    if (multiDraw)
+    {
+        for (const Run& run : _runs)
+        {
+            setState(_items[_order[run.first]]);
+            pass->drawCommands(_draws, run.batch);
+        }
+        stats.multiDraws += _runs.size();
+    }
+    else
+    {
+        for (uint32_t index : _order)
+        {
+            const Item& item = _items[index];
+            setState(item);
+            pass->drawItem(*item.mesh, item.matrix, item.pixelsPerUnit);
+        }
+    }
+    pass->endPass();
+
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void RenderQueue::draw(RenderPass& pass, const Mesh& mesh, const PhongMaterial& material, const glm::mat4& matrix,
+    float pixelsPerUnit)
+{
+    pass.beginPass();
+    pass.setMaterial(material);
+    for (size_t i = 0; i < mesh.textures.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i + 1));
+        glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+    }
+    pass.setTextures(mesh);
+    glBindVertexArray(mesh.VAO);
+    pass.setVertexArray(mesh);
+    pass.drawItem(mesh, matrix, pixelsPerUnit);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+    pass.endPass();
+
+    RenderStats& stats = RenderStats::getFrame();
+    stats.programBinds++;
+    stats.textureBinds += mesh.textures.size();
+    stats.vertexArrayBinds++;
+}
+
+void RenderQueue::sortKeys(const std::vector<uint64_t>& keys, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch)
+{
+    const size_t count = keys.size();
+    order.resize(count);
+    scratch.resize(count);
+    for (size_t i = 0; i < count; i++)
+        order[i] = static_cast<uint32_t>(i);
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t offsets[256] = {};
+        for (size_t i = 0; i < count; i++)
+            offsets[(keys[i] >> shift) & 0xff]++;
+        // every key has the same byte, the order stays
+        if (offsets[(keys[0] >> shift) & 0xff] == count)
+            continue;
+
+        size_t sum = 0;
+        for (size_t& offset : offsets)
+        {
+            const size_t digitCount = offset;
+            offset = sum;
+            sum += digitCount;
+        }
+        for (uint32_t index : order)
+            scratch[offsets[(keys[index] >> shift) & 0xff]++] = index;
+        order.swap(scratch);
+    }
+}
+
+uint32_t RenderQueue::getPassIndex(RenderPass& pass)
+{
+    for (size_t i = 0; i < _passes.size(); i++)
+    {
+        if (_passes[i] == &pass)
+            return static_cast<uint32_t>(i);
+    }
+    _passes.push_back(&pass);
+    return static_cast<uint32_t>(_passes.size() - 1);
+}
+
+void RenderQueue::addRuns()
+{
+    _draws.reset();
+    _runs.clear();
+    const Item* last = nullptr;
+    for (uint32_t i = 0; i < _order.size(); i++)
+    {
+        const Item& item = _items[_order[i]];
+        // the draws of a run share all the stages set, only the matrix and the level of detail differ
+        if (last == nullptr || item.pass != last->pass || item.material != last->material
+            || !sameTextures(*item.mesh, *last->mesh) || item.mesh->VAO != last->mesh->VAO
+            || item.mesh->indexType != last->mesh->indexType)
+        {
+            _runs.push_back({ i, _draws.addBatch(item.mesh->VAO, item.mesh->indexType) });
+        }
+        item.pass->addCommands(*item.mesh, item.matrix, item.pixelsPerUnit, _draws.addDraw(item.matrix),
+            _draws.getCommands(_runs.back().batch));
+        last = &item;
+    }
+}
+
+uint64_t RenderQueue::makeKey(uint32_t pass, const Mesh& mesh, const PhongMaterial& material, float depth) const
+{
+    const uint64_t depthMax = (uint64_t(1) << kDepthBits) - 1;
+    const uint64_t depthField = static_cast<uint64_t>(std::clamp(depth * _depthScale, 0.0f, 1.0f) * depthMax);
+    const uint64_t materialField = foldHash(reinterpret_cast<uintptr_t>(&material), kMaterialBits);
+
+    uint64_t key = getField(pass, kPassBits);
+    key = (key << kTextureBits) | foldHash(hashTextures(mesh), kTextureBits);
+    key = (key << kMaterialBits) | materialField;
+    key = (key << kVertexArrayBits) | getField(mesh.VAO, kVertexArrayBits);
+    key = (key << kDepthBits) | depthField;
+    return key;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "base/gl_utility.h"
+#include "indirect_draws.h"
+#include "material.h"
+#include "mesh.h"
+
+// the program and the uniforms of the draws of one pass. RenderQueue::submit calls every stage only when its
+// state differs from the one of the draw before, the queue binds the vertex arrays and the textures itself
+class RenderPass
+{
+public:
+    virtual ~RenderPass() = default;
+
+    // puts the program in use and sets the uniforms shared by every draw of the pass
+    virtual void beginPass() = 0;
+
+    virtual void setMaterial(const PhongMaterial& material) = 0;
+
+    // sampler uniforms and flags of the textures of mesh, texture i is bound to unit i + 1
+    virtual void setTextures(const Mesh& mesh) = 0;
+
+    // uniforms of the vertex format of mesh, its vertex array is bound
+    virtual void setVertexArray(const Mesh& mesh) = 0;
+
+    // model matrix and the draw call of the level of mesh for pixelsPerUnit
+    virtual void drawItem(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit) = 0;
+
+    // the commands of what drawItem would draw, with drawId as base instance. no GL state is needed
+    virtual void addCommands(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit, uint32_t drawId,
+        std::vector<DrawElementsIndirectCommand>& commands) = 0;
+
+    // draws batch of draws, whose commands addCommands gave, after the stages of its first item
+    virtual void drawCommands(const IndirectDraws& draws, size_t batch) = 0;
+
+    virtual void endPass() = 0;
+};
+
+// draws of a frame collected from the passes, sorted on a 64 bit key and submitted with the redundant program,
+// vertex array and texture binds and material uniforms skipped. the key holds from the most significant bit
+// the pass, so one program, the texture set, the material, the vertex array and the depth, front to back.
+// the fields are hashes where they do not fit: a collision only costs a bind, submit compares the real state.
+// the draws of a run with the same state but the matrix go into one glMultiDrawElementsIndirect, the meshes of
+// a vertex format share the vertex array of the GeometryPool
+class RenderQueue
+{
+public:
+    static constexpr int kPassBits = 8;
+    static constexpr int kTextureBits = 20;
+    static constexpr int kMaterialBits = 12;
+    static constexpr int kVertexArrayBits = 12;
+    static constexpr int kDepthBits = 12;
+
+    // texture units the queue tracks, unit 0 is left to the shadow maps
+    static constexpr uint32_t kTextureUnits = 16;
+
+    // empties the queue for a frame whose depth goes from the camera to farPlane
+    void reset(float farPlane);
+
+    // queues mesh drawn by pass at matrix, depth the distance from the camera. passes are submitted in the order
+    // of their first draw
+    void add(RenderPass& pass, const Mesh& mesh, const PhongMaterial& material, const glm::mat4& matrix,
+        float pixelsPerUnit, float depth);
+
+    size_t size() const { return _items.size(); }
+
+    // sorts the draws and issues them, a multi draw per run of draws with the same state or, without multiDraw,
+    // one draw each. then leaves no vertex array bound and texture unit 0 active.
+    // counts the program, texture and vertex array binds and the multi draws into RenderStats
+    void submit(bool multiDraw = true);
+
+    // draws mesh through every stage of pass and binds all of its state, without a queue
+    static void draw(RenderPass& pass, const Mesh& mesh, const PhongMaterial& material, const glm::mat4& matrix,
+        float pixelsPerUnit);
+
+    // radix sorts keys, 8 bits per round, order receives the indices of keys in ascending order of key.
+    // the rounds of a byte all keys share are skipped
+    static void sortKeys(const std::vector<uint64_t>& keys, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch);
+
+private:
+    struct Item
+    {
+        RenderPass* pass;
+        const Mesh* mesh;
+        const PhongMaterial* material;
+        glm::mat4 matrix;
+        float pixelsPerUnit;
+    };
+
+    // items of submit drawn with one multi draw, first in the sorted order, and the batch of their commands
+    struct Run
+    {
+        uint32_t first;
+        size_t batch;
+    };
+
+    std::vector<Item> _items;
+    std::vector<uint64_t> _keys;
+    std::vector<uint32_t> _order;
+    std::vector<uint32_t> _scratch;
+    std::vector<RenderPass*> _passes;
+    float _depthScale = 0.0f;
+    IndirectDraws _draws;
+    std::vector<Run> _runs;
+
+    uint32_t getPassIndex(RenderPass& pass);
+
+    // splits the sorted items into runs and collects their commands
+    void addRuns();
+
+    uint64_t makeKey(uint32_t pass, const Mesh& mesh, const PhongMaterial& material, float depth) const;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// work submitted to the GPU in the current frame, reset at the start of Renderer::render
+struct RenderStats
+{
+    // triangles of the main view, forward or gbuffer pass
+    size_t triangles = 0;
+    // triangles of all shadow maps, every cascade counts
+    size_t shadowTriangles = 0;
+    // models and meshes left in the main view by frustum culling, all displayed ones without it
+    size_t visibleModels = 0;
+    size_t visibleMeshes = 0;
+    // placed copies of models left in the main view, see SceneObjects
+    size_t visibleObjects = 0;
+    // meshes and objects left by frustum culling that the occluders hide, in the main view and in all shadow maps
+    size_t occluded = 0;
+    size_t shadowOccluded = 0;
+    // occluder triangles rasterized for the main view
+    size_t occluderTriangles = 0;
+    // draw calls and triangles of every shadow map of the frame, one per cascade, the ground plane included.
+    // a multi draw counts one call. the draws of the GPU culling count no triangles, the GPU alone knows those
+    struct ShadowMap
+    {
+        size_t draws = 0;
+        size_t triangles = 0;
+    };
+    std::vector<ShadowMap> shadowMaps;
+    // point and spot lights binned into the clusters and the entries of their lists, see LightClusters
+    size_t lights = 0;
+    size_t lightIndices = 0;
+    // draws submitted to the GPU culling, every pass counts, before the compute shader culls them
+    size_t gpuDraws = 0;
+    // state changes of the draws of the main view, the forward or gbuffer pass, see RenderQueue
+    size_t programBinds = 0;
+    size_t textureBinds = 0;
+    size_t vertexArrayBinds = 0;
+    // glMultiDrawElementsIndirect calls of the main view, one per run of draws of the same state, see RenderQueue
+    size_t multiDraws = 0;
+    // bytes of uniform blocks written to the ring in the frame, alignment included, see UniformRing
+    size_t uniformBytes = 0;
+
+    void reset()
+    {
+        *this = RenderStats();
+    }
+
+    static RenderStats& getFrame()
+    {
+        static RenderStats stats;
+        return stats;
+    }
+};
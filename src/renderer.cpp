@@ -1,20 +1,32 @@
 #include "renderer.h"
 
+namespace
+{
+//width of the occlusion buffers in pixels, enough to hide whole meshes at a fraction of the screen cost
+constexpr int kOcclusionWidth = 256;
+}
+
 Renderer::Renderer(const std::string& shaderBasePath)
 {
     initShaders(shaderBasePath);
     initBackground();
+    //the shadow maps are square, the camera buffer follows the screen
+    _shadowOcclusion.resize(kOcclusionWidth, kOcclusionWidth);
 }
 
 Renderer::~Renderer() 
 {
     glDeleteVertexArrays(1, &planeVAO);
     glDeleteBuffers(1, &planeVBO);
+    glDeleteVertexArrays(1, &_screenVAO);
 }
 
 void Renderer::render(unique_ptr<PerspectiveCamera>& camera, const Scene& scene, const UIOptions& options)
 {
     _options = std::make_shared<UIOptions>(options);
+    _graph = &scene.graph;
+    RenderStats::getFrame().reset();
+    _uniformRing.beginFrame();
 
     if (options.renderType == RenderType::FORAWRD)
     {
@@ -24,6 +36,9 @@ void Renderer::render(unique_ptr<PerspectiveCamera>& camera, const Scene& scene,
     {
         deferredShading(camera, scene);
     }
+
+    RenderStats::getFrame().uniformBytes = _uniformRing.getFrameUsage();
+    _uniformRing.endFrame();
 }
 
 void Renderer::forwardShading(unique_ptr<PerspectiveCamera>& camera, const Scene& scene)
@@ -37,6 +52,10 @@ void Renderer::forwardShading(unique_ptr<PerspectiveCamera>& camera, const Scene
     {
         _currentShader = _csmShader;
     }
+    else if (_options->fShaderType == ForwardShaderType::ForwardPlus)
+    {
+        _currentShader = _forwardPlusShader;
+    }
 
     //update ui options
     _currentShader->setRenderOptions(*_options);
@@ -44,6 +63,8 @@ void Renderer::forwardShading(unique_ptr<PerspectiveCamera>& camera, const Scene
     //update screen size
     _currentShader->setScreenSize(this->screenWidth, this->screenHeight);
     _currentShader->setBackgroundVAOVBO(this->planeVAO, this->planeVBO);
+    _currentShader->graph = _graph;
+    _currentShader->objects = &scene.objects;
     // update camera
     updateCamera(camera);
 
@@ -58,21 +79,53 @@ void Renderer::forwardShading(unique_ptr<PerspectiveCamera>& camera, const Scene
         updateDirectionalLight(scene.directionalLights[0]);
     }
 
+    //the point and spot lights reach the Forward+ shader through the clusters
+    if (_options->fShaderType == ForwardShaderType::ForwardPlus)
+    {
+        updateLightClusters(camera, scene);
+        _forwardPlusShader->_shader->use();
+        _lightClusters.bind(*_forwardPlusShader->_shader, screenWidth, screenHeight);
+        _forwardPlusShader->_shader->unuse();
+    }
+
+    cullScene(camera, scene);
+    _currentShader->occlusion = _occlusionValid ? &_occlusion : nullptr;
+    GpuCulling* gpuCulling = updateGpuCulling(scene);
+    _currentShader->gpuCulling = gpuCulling;
+
     //gen shadow map
     if (_options->useShadow)
     {
+        _currentShader->culling = _options->frustumCulling ? &_culling : nullptr;
+        _currentShader->shadowOcclusion = _occlusionValid ? &_shadowOcclusion : nullptr;
         _currentShader->genDepthMap(scene.directionalLights[0], camera, scene.models);
     }
+    _frameUniforms.useShadow = _options->useShadow;
+    _currentShader->updateFrameUniforms(_frameUniforms);
+    bindFrameUniforms();
+
+    //the compute shader culls the models and copies against the camera and the depth of the last frame
+    if (gpuCulling != nullptr && _options->displayFacet)
+    {
+        gpuCulling->cull(camera->getFrustum(), true);
+        _currentShader->renderBatches(scene.models);
+    }
+
+    //the meshes of the models and copies are queued and drawn sorted by state once all are in
+    _currentShader->renderQueue = _options->renderQueue ? &_renderQueue : nullptr;
+    _renderQueue.reset(camera->zfar);
 
     //render model
-    for (const auto& model : scene.models)
+    for (size_t i = 0; i < scene.models.size(); i++)
     {
-        if (model.display == false)
+        const AssimpModel& model = scene.models[i];
+        if (model.display == false || (_options->frustumCulling && !_cameraVisibility.isModelVisible(i)))
             continue;
 
         if (_options->displayFacet)
         {
-            _currentShader->renderFacet(model);
+            if (gpuCulling == nullptr)
+                _currentShader->renderFacet(model, _options->frustumCulling ? _cameraVisibility.getMeshes(i) : nullptr);
         }
         else break;
 
@@ -81,12 +134,25 @@ void Renderer::forwardShading(unique_ptr<PerspectiveCamera>& camera, const Scene
             renderNormal(model);
         }
     }
+    //render the placed copies, grouped by model
+    if (_options->displayFacet && gpuCulling == nullptr)
+    {
+        _currentShader->renderObjects(scene.models, _objectVisibility);
+    }
+    _renderQueue.submit(_options->multiDraw);
     //render light
     renderLight(scene.directionalLights[0]);
 
     //render background
     _currentShader->renderBackground();
 
+    //the depth of this frame culls the next one
+    if (gpuCulling != nullptr)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        gpuCulling->updateDepthPyramid(screenWidth, screenHeight, camera->getProjectionMatrix() * camera->getViewMatrix());
+    }
+
     //set wire option
     if (_options->wire)
     {
@@ -105,10 +171,10 @@ void Renderer::forwardShading(unique_ptr<PerspectiveCamera>& camera, const Scene
 void Renderer::deferredShading(unique_ptr<PerspectiveCamera>& camera, const Scene& scene)
 {
     //update camera
-    _deferredShader->use();
-    _deferredShader->setUniformMat4("projection", camera->getProjectionMatrix());
-    _deferredShader->setUniformMat4("view", camera->getViewMatrix());
-    _deferredShader->unuse();
+    bindCameraView(camera);
+    _cameraFrustum = camera->getFrustum();
+    _cameraPosition = camera->transform.position;
+    _cameraFovy = camera->fovy;
 
     _gBuffer.reset(new GBuffer());
 
@@ -121,16 +187,40 @@ void Renderer::deferredShading(unique_ptr<PerspectiveCamera>& camera, const Scen
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    for (const auto& model : scene.models)
+    cullScene(camera, scene);
+    GpuCulling* gpuCulling = updateGpuCulling(scene);
+    if (gpuCulling != nullptr && _options->displayFacet)
     {
-        if (model.display == false)
-            continue;
+        gpuCulling->cull(_cameraFrustum, true);
+        renderGbufferBatches(scene);
+    }
+    else
+    {
+        _renderQueue.reset(camera->zfar);
+        for (size_t i = 0; i < scene.models.size(); i++)
+        {
+            const AssimpModel& model = scene.models[i];
+            if (model.display == false || (_options->frustumCulling && !_cameraVisibility.isModelVisible(i)))
+                continue;
 
+            if (_options->displayFacet)
+            {
+                renderGbuffer(model, _options->frustumCulling ? _cameraVisibility.getMeshes(i) : nullptr);
+            }
+
+        }
         if (_options->displayFacet)
         {
-            renderGbuffer(model);
+            renderGbufferObjects(scene);
         }
+        _renderQueue.submit(_options->multiDraw);
+    }
 
+    //the depth of this frame culls the next one
+    if (gpuCulling != nullptr)
+    {
+        _gBuffer->BindForReading();
+        gpuCulling->updateDepthPyramid(screenWidth, screenHeight, camera->getProjectionMatrix() * camera->getViewMatrix());
     }
     
     //bind current drawing framebuffer to default framebuffer
@@ -140,6 +230,10 @@ void Renderer::deferredShading(unique_ptr<PerspectiveCamera>& camera, const Scen
     {
         renderGbufferToScreen();
     }
+    else if (_options->dShaderType == DeferredShaderType::ClusteredLighting)
+    {
+        renderDeferredLighting(camera, scene);
+    }
 }
 
 void Renderer::updateCamera(unique_ptr<PerspectiveCamera>& camera)
@@ -147,6 +241,7 @@ void Renderer::updateCamera(unique_ptr<PerspectiveCamera>& camera)
     auto console_logger = spdlogManagement::getConsoleLogHandle();
 
     _currentShader->updateCamera(camera);    
+    bindCameraView(camera);
     console_logger->info("Pos = {} {} {}, Aspect = {}, fovy = {}, zfar = {}, znear = {}", camera->transform.position.x, camera->transform.position.y, camera->transform.position.z,
         camera->aspect, camera->fovy, camera->zfar, camera->znear);
 
@@ -163,7 +258,23 @@ void Renderer::updateCamera(unique_ptr<PerspectiveCamera>& camera)
 
 void Renderer::updateDirectionalLight(const DirectionalLight&light)
 {
-    _currentShader->updateLight(light);
+    _frameUniforms.dLight = getLightUniforms(light);
+}
+
+void Renderer::bindCameraView(unique_ptr<PerspectiveCamera>& camera)
+{
+    ViewUniforms view = {};
+    view.projection = camera->getProjectionMatrix();
+    view.view = camera->getViewMatrix();
+    view.viewPos = camera->transform.position;
+    _cameraView = _uniformRing.push(view);
+    UniformRing::bind(kViewBlockBinding, _cameraView);
+}
+
+void Renderer::bindFrameUniforms()
+{
+    UniformRing::bind(kFrameBlockBinding, _uniformRing.push(_frameUniforms));
+    UniformRing::bind(kViewBlockBinding, _cameraView);
 }
 
 
@@ -175,13 +286,22 @@ void Renderer::initShaders(const std::string& shaderBasePath)
     const std::string csmVertShaderRelPath = "/csm/csm.vert";
     const std::string csmFragShaderRelPath = "/csm/csm.frag";
 
+    //the scene shaders include the declarations of the uniform blocks
+    registerUniformBlocks();
+
     _phongShader.reset(new PhongShader(screenWidth, screenHeight, shaderBasePath,phongVertShaderRelPath, phongFragShaderRelPath));
+    _forwardPlusShader.reset(new PhongShader(screenWidth, screenHeight, shaderBasePath, phongVertShaderRelPath, "/phong/phongClustered.frag"));
     _csmShader.reset(new CSMShader(screenWidth, screenHeight, shaderBasePath,csmVertShaderRelPath, csmFragShaderRelPath));
+    _phongShader->uniformRing = &_uniformRing;
+    _forwardPlusShader->uniformRing = &_uniformRing;
+    _csmShader->uniformRing = &_uniformRing;
 
     initPerShader(_flatShader, shaderBasePath, "flat", false);
     initPerShader(_normalShader, shaderBasePath, "normal", true);
     initPerShader(_deferredShader, shaderBasePath, "gbufferGen", false);
-    //initPerShader(_deferredLightShader, shaderBasePath, "deferred", false);
+    if (GpuCulling::isSupported())
+        _gpuCulling = std::make_unique<GpuCulling>(shaderBasePath);
+    initPerShader(_deferredLightShader, shaderBasePath, "deferred", false);
 }
 
 void Renderer::initPerShader(std::shared_ptr<GLSLProgram> &shader,const std::string shader_path, const std::string shader_name, bool use_geometry)
@@ -196,6 +316,7 @@ void Renderer::initPerShader(std::shared_ptr<GLSLProgram> &shader,const std::str
     shader->attachFragmentShaderFromFile(FragShaderRelPath);
     if(use_geometry) shader->attachGeometryShaderFromFile(GeomShaderRelPath);
     shader->link();
+    bindUniformBlocks(*shader);
 }
 
 void Renderer::initBackground()
@@ -224,19 +345,87 @@ void Renderer::initBackground()
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glBindVertexArray(0);
+
+    glGenVertexArrays(1, &_screenVAO);
 }
 
 
+void Renderer::cullScene(unique_ptr<PerspectiveCamera>& camera, const Scene& scene)
+{
+    RenderStats& stats = RenderStats::getFrame();
+    //the objects are flat boxes in one array, culled without the model boxes or the bvh
+    const Frustum frustum = camera->getFrustum();
+    stats.visibleObjects = scene.objects.cull(_options->frustumCulling ? &frustum : nullptr, _objectVisibility);
+    _occlusionValid = false;
+    if (!_options->frustumCulling)
+    {
+        for (const auto& model : scene.models)
+        {
+            if (model.display == false)
+                continue;
+            stats.visibleModels++;
+            stats.visibleMeshes += model.meshes.size();
+        }
+        return;
+    }
+
+    //transforms may change every frame, the shadow passes reuse these boxes.
+    //the bvh is refit by the owner of the scene, it is stale while models are added or removed
+    _culling.setBvh(_options->bvhCulling && scene.bvh.isValid() ? &scene.bvh : nullptr);
+    _culling.update(scene.models, scene.graph);
+    _culling.cull(frustum, _cameraVisibility);
+
+    //what the frustum left is tested against the occluders, the buffer keeps the aspect of the screen
+    _occlusionValid = _options->occlusionCulling;
+    if (_occlusionValid)
+    {
+        _occlusion.resize(kOcclusionWidth, kOcclusionWidth * screenHeight / std::max(screenWidth, 1));
+        const glm::mat4 viewProjection = camera->getProjectionMatrix() * camera->getViewMatrix();
+        stats.occluderTriangles = _occlusion.render(scene.models, scene.graph, &scene.objects, &_objectVisibility, viewProjection);
+        stats.occluded = _occlusion.cull(scene.models, scene.graph, _cameraVisibility);
+        stats.occluded += _occlusion.cull(scene.objects, _objectVisibility);
+        stats.visibleObjects = _objectVisibility.objects.size();
+    }
+    stats.visibleModels = _cameraVisibility.visibleModels;
+    stats.visibleMeshes = _cameraVisibility.visibleMeshes;
+}
+
+GpuCulling* Renderer::updateGpuCulling(const Scene& scene)
+{
+    if (_gpuCulling == nullptr)
+        return nullptr;
+    if (!_options->gpuCulling)
+    {
+        //the pyramid would be stale when the culling is turned on again
+        _gpuCulling->invalidateDepthPyramid();
+        return nullptr;
+    }
+    _gpuCulling->update(scene.models, scene.graph, scene.objects);
+    return _gpuCulling.get();
+}
+
+void Renderer::updateLightClusters(unique_ptr<PerspectiveCamera>& camera, const Scene& scene)
+{
+    _lightClusters.build(scene.pointLights, scene.spotLights, camera->getViewMatrix(), camera->getProjectionMatrix(),
+        camera->znear, camera->zfar);
+    _lightClusters.upload();
+    RenderStats& stats = RenderStats::getFrame();
+    stats.lights = _lightClusters.getLightCount();
+    stats.lightIndices = _lightClusters.getIndexCount();
+}
+
 void Renderer::renderNormal(const AssimpModel& model)
 {
     _normalShader->use();
-    _normalShader->setUniformMat4("model", model.transform.getLocalMatrix());
 
-    for (const auto& mesh : model.meshes)
+    for (size_t m = 0; m < model.meshes.size(); m++)
     {
+        const Mesh& mesh = model.meshes[m];
+        _normalShader->setUniformMat4("model", model.getMeshMatrix(*_graph, m));
+        _normalShader->setUniformBool("packedVertex", mesh.isPacked());
         // draw mesh
         glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
+        mesh.drawLod(0);
         glBindVertexArray(0);
     }
 
@@ -342,69 +531,188 @@ void Renderer::renderGbufferToScreen()
     }
 }
 
-void Renderer::renderGbuffer(const AssimpModel& model)
+void Renderer::renderDeferredLighting(unique_ptr<PerspectiveCamera>& camera, const Scene& scene)
 {
-    for (const auto& mesh : model.meshes) {
-        _deferredShader->use();
-        _deferredShader->setUniformMat4("model", model.transform.getLocalMatrix());
+    updateLightClusters(camera, scene);
 
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    _deferredLightShader->use();
+    _deferredLightShader->setUniformInt("gPosition", 0);
+    _deferredLightShader->setUniformInt("gDiffuse", 1);
+    _deferredLightShader->setUniformInt("gNormal", 2);
+    _deferredLightShader->setUniformInt("gDepth", 3);
+    _gBuffer->BindTextures();
+
+    //without a directional light the clusters light the scene alone
+    DirectionalLight light;
+    light.intensity = 0.0f;
+    if (!scene.directionalLights.empty())
+        light = scene.directionalLights[0];
+    _frameUniforms.dLight = getLightUniforms(light);
+    _frameUniforms.useShadow = false;
+    bindFrameUniforms();
+    _lightClusters.bind(*_deferredLightShader, screenWidth, screenHeight);
+
+    glBindVertexArray(_screenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    _deferredLightShader->unuse();
+}
 
-        const PhongMaterial* material = static_cast<PhongMaterial*>(model.facetMaterial.get());
+void Renderer::renderGbuffer(const AssimpModel& model, const uint8_t* visibleMeshes)
+{
+    const float pixelsPerUnit = model.getPixelsPerUnit(model.getWorldMatrix(*_graph), _cameraPosition, _cameraFovy, static_cast<float>(screenHeight));
+    const PhongMaterial& material = *static_cast<const PhongMaterial*>(model.facetMaterial.get());
+    for (size_t m = 0; m < model.meshes.size(); m++)
+    {
+        if (visibleMeshes && !visibleMeshes[m])
+            continue;
+        addGbufferMesh(model, m, model.getMeshMatrix(*_graph, m), material, pixelsPerUnit);
+    }
+}
 
-        _deferredShader->setUniformVec3("material.diffuse", material->kd);
+void Renderer::renderGbufferObjects(const Scene& scene)
+{
+    for (uint32_t object : _objectVisibility.objects)
+    {
+        const AssimpModel& model = scene.models[scene.objects.getModel(object)];
+        const glm::mat4& matrix = scene.objects.getMatrix(object);
+        const float pixelsPerUnit = model.getPixelsPerUnit(matrix, _cameraPosition, _cameraFovy, static_cast<float>(screenHeight));
+        const PhongMaterial& material = scene.objects.getMaterial(object, model);
+        for (size_t m = 0; m < model.meshes.size(); m++)
+        {
+            addGbufferMesh(model, m, matrix * model.meshMatrices[m], material, pixelsPerUnit);
+        }
+    }
+}
 
-        bool use_texture_kd = false;
-        bool use_texture_ks = false;
-        bool use_texture_normal = false;
+void Renderer::renderGbufferBatches(const Scene& scene)
+{
+    const std::vector<GpuCulling::Batch>& batches = _gpuCulling->getBatches();
+    _deferredShader->use();
+    _deferredShader->setUniformBool("gpuDriven", true);
+    for (_gpuBatch = 0; _gpuBatch < batches.size(); _gpuBatch++)
+    {
+        const GpuCulling::Batch& batch = batches[_gpuBatch];
+        renderGbufferMesh(scene.models[batch.model], batch.mesh, glm::mat4(1.0f), *batch.material, 0.0f);
+    }
+    _gpuBatch = Shader::kNoBatch;
+    _deferredShader->use();
+    _deferredShader->setUniformBool("gpuDriven", false);
+    _deferredShader->unuse();
+    RenderStats::getFrame().gpuDraws += _gpuCulling->getDrawCount();
+}
 
-        for (unsigned int i = 0; i < mesh.textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i + 1); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = mesh.textures[i].type;
-            if (name == "texture_diffuse")
-            {
-                number = std::to_string(diffuseNr++);
-                use_texture_kd = true;
-                // now set the sampler to the correct texture unit
-                _deferredShader->setUniformInt((name + number).c_str(), i + 1);
-            }
-            else if (name == "texture_normal")
-            {
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-                use_texture_normal = true;
-                // now set the sampler to the correct texture unit
-                _deferredShader->setUniformInt((name + number).c_str(), i + 1);
-            }
-            else if (name == "texture_specular")
-            {
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-                use_texture_ks = true;
-                _deferredShader->setUniformInt((name + number).c_str(), i + 1);
-            }
+void Renderer::renderGbufferMesh(const AssimpModel& model, size_t m, const glm::mat4& meshMatrix, const PhongMaterial& material, float pixelsPerUnit)
+{
+    RenderQueue::draw(*this, model.meshes[m], material, meshMatrix, pixelsPerUnit);
+}
 
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
-        }
+void Renderer::addGbufferMesh(const AssimpModel& model, size_t m, const glm::mat4& meshMatrix, const PhongMaterial& material, float pixelsPerUnit)
+{
+    if (!_options->renderQueue)
+    {
+        renderGbufferMesh(model, m, meshMatrix, material, pixelsPerUnit);
+        return;
+    }
+    const Mesh& mesh = model.meshes[m];
+    const glm::vec3 center = meshMatrix * glm::vec4(0.5f * (mesh.box.min + mesh.box.max), 1.0f);
+    _renderQueue.add(*this, mesh, material, meshMatrix, pixelsPerUnit, glm::length(center - _cameraPosition));
+}
 
-        _deferredShader->setUniformBool("use_texture_kd", use_texture_kd);
-        _deferredShader->setUniformBool("use_texture_ks", use_texture_ks);
-        _deferredShader->setUniformBool("use_texture_normal", _options->useNormalMap && use_texture_normal);
+void Renderer::beginPass()
+{
+    _deferredShader->use();
+}
 
+void Renderer::setMaterial(const PhongMaterial& material)
+{
+    _drawUniforms.material = getMaterialUniforms(material);
+}
 
-        // draw mesh
-        glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+void Renderer::setTextures(const Mesh& mesh)
+{
+    unsigned int diffuseNr = 1;
+    unsigned int specularNr = 1;
+    unsigned int normalNr = 1;
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    bool use_texture_kd = false;
+    bool use_texture_ks = false;
+    bool use_texture_normal = false;
 
-        _deferredShader->unuse();
+    for (unsigned int i = 0; i < mesh.textures.size(); i++)
+    {
+        // retrieve texture number (the N in diffuse_textureN)
+        string scratch;
+        const string& name = mesh.textures[i].type;
+        if (name == "texture_diffuse")
+        {
+            use_texture_kd = true;
+            // now set the sampler to the texture unit it is bound to
+            _deferredShader->setUniformInt(getSamplerUniform(name, diffuseNr++, scratch), i + 1);
+        }
+        else if (name == "texture_normal")
+        {
+            use_texture_normal = true;
+            _deferredShader->setUniformInt(getSamplerUniform(name, normalNr++, scratch), i + 1);
+        }
+        else if (name == "texture_specular")
+        {
+            use_texture_ks = true;
+            _deferredShader->setUniformInt(getSamplerUniform(name, specularNr++, scratch), i + 1);
+        }
     }
+
+    _drawUniforms.useTextureKd = use_texture_kd;
+    _drawUniforms.useTextureKs = use_texture_ks;
+    _drawUniforms.useTextureNormal = _options->useNormalMap && use_texture_normal;
+}
+
+void Renderer::setVertexArray(const Mesh& mesh)
+{
+    _drawUniforms.packedVertex = mesh.isPacked();
+}
+
+void Renderer::drawItem(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit)
+{
+    _drawUniforms.model = matrix;
+    UniformRing::bind(kDrawBlockBinding, _uniformRing.push(_drawUniforms));
+
+    // draw mesh, meshlets only cull LOD0
+    const size_t level = _options->adaptiveLod ? mesh.selectLod(pixelsPerUnit, _options->lodErrorPixels) : 0;
+    if (_gpuBatch != Shader::kNoBatch)
+        _gpuCulling->drawBatch(_gpuBatch);
+    else if (_options->meshletCulling && level == 0)
+        RenderStats::getFrame().triangles += mesh.drawVisible(_cameraFrustum, matrix, _cameraPosition,
+            _occlusionValid ? &_occlusion.getBuffer() : nullptr, _occlusion.getViewProjection());
+    else
+        RenderStats::getFrame().triangles += mesh.drawLod(level);
+}
+
+void Renderer::addCommands(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit, uint32_t drawId,
+    std::vector<DrawElementsIndirectCommand>& commands)
+{
+    // meshlets only cull LOD0
+    const size_t level = _options->adaptiveLod ? mesh.selectLod(pixelsPerUnit, _options->lodErrorPixels) : 0;
+    if (_options->meshletCulling && level == 0)
+        RenderStats::getFrame().triangles += mesh.addVisibleCommands(_cameraFrustum, matrix, _cameraPosition, drawId,
+            commands, _occlusionValid ? &_occlusion.getBuffer() : nullptr, _occlusion.getViewProjection());
+    else
+        RenderStats::getFrame().triangles += mesh.addLodCommand(level, drawId, commands);
+}
+
+void Renderer::drawCommands(const IndirectDraws& draws, size_t batch)
+{
+    // the matrices come with the draws, the rest of the draw block is shared by the run
+    _drawUniforms.model = glm::mat4(1.0f);
+    UniformRing::bind(kDrawBlockBinding, _uniformRing.push(_drawUniforms));
+    _deferredShader->setUniformBool("gpuDriven", true);
+    draws.drawBatch(batch);
+    _deferredShader->setUniformBool("gpuDriven", false);
+}
+
+void Renderer::endPass()
+{
+    _deferredShader->unuse();
 }
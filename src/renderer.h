@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -11,6 +12,7 @@
 #include "base/light.h"
 #include "base/texture.h"
 #include "base/uniform_buffer.h"
+#include "base/uniform_ring.h"
 #include "base/vertex.h"
 #include "base/vertex_array.h"
 #include "base/vertex_buffer.h"
@@ -21,8 +23,13 @@
 #include "ui_options.h"
 #include "shader.h"
 #include "gbuffer.h"
+#include "gpu_culling.h"
+#include "light_clusters.h"
+#include "render_queue.h"
+#include "uniform_blocks.h"
 
-class Renderer
+//the renderer is the pass of the gbuffer in its render queue
+class Renderer : private RenderPass
 {
 public:
 
@@ -47,6 +54,7 @@ private:
     //main forward shader
     std::shared_ptr<PhongShader> _phongShader;  
     std::shared_ptr<CSMShader> _csmShader;
+    std::shared_ptr<PhongShader> _forwardPlusShader;
 
     //deferred shader
     std::shared_ptr<GLSLProgram> _deferredShader;
@@ -59,10 +67,50 @@ private:
     //plane render
     GLuint planeVAO;
     GLuint planeVBO;
+    //no attributes, the lighting pass draws one triangle over the screen from gl_VertexID
+    GLuint _screenVAO = 0;
 
     //gbuffer
     std::unique_ptr<GBuffer> _gBuffer;
 
+    //camera of the current frame, for meshlet culling and lod selection in the gbuffer pass
+    Frustum _cameraFrustum;
+    glm::vec3 _cameraPosition = glm::vec3(0.0f);
+    float _cameraFovy = glm::radians(45.0f);
+
+    //world matrices of the scene of the current frame, updated by its owner before render
+    const SceneGraph* _graph = nullptr;
+
+    //world boxes of the scene and what the camera sees of them
+    SceneCulling _culling;
+    Visibility _cameraVisibility;
+    ObjectVisibility _objectVisibility;
+
+    //occluders rasterized on the CPU for the camera and for every shadow map
+    OcclusionCulling _occlusion;
+    OcclusionCulling _shadowOcclusion;
+    //the camera buffer holds the occluders of this frame
+    bool _occlusionValid = false;
+
+    //culls and submits the models and copies on the GPU, null without compute shaders
+    std::unique_ptr<GpuCulling> _gpuCulling;
+    //batch of _gpuCulling that renderGbufferMesh submits inside renderGbufferBatches
+    size_t _gpuBatch = Shader::kNoBatch;
+
+    //point and spot lights of the scene binned into view clusters, for Forward+ and the deferred lighting
+    LightClusters _lightClusters;
+
+    //draws of the models and copies in the main view, sorted by state
+    RenderQueue _renderQueue;
+
+    //uniform blocks of the frame, the views and the draws, written to the ring and bound by range
+    UniformRing _uniformRing;
+    FrameUniforms _frameUniforms = {};
+    //view block of the camera, bound again after the shadow passes bound theirs
+    UniformRing::Range _cameraView;
+    //draw block of the gbuffer pass, the stages fill it and drawItem pushes it
+    DrawUniforms _drawUniforms = {};
+
     //uiOptions
     std::shared_ptr<UIOptions> _options;
 
@@ -74,12 +122,36 @@ private:
     void initPerShader(std::shared_ptr<GLSLProgram> &shader, const std::string shader_path, const std::string shader_name, bool use_geometry);
     void initBackground();
     void updateCamera(unique_ptr<PerspectiveCamera>& camera);
+    //pushes the view block of camera and binds it for every program
+    void bindCameraView(unique_ptr<PerspectiveCamera>& camera);
+    //pushes _frameUniforms and binds it with the view block of the camera
+    void bindFrameUniforms();
     void updateDirectionalLight(const DirectionalLight& light);
     void renderLight(const DirectionalLight& pointlight);
     void renderNormal(const AssimpModel& model);
+    void cullScene(unique_ptr<PerspectiveCamera>& camera, const Scene& scene);
+    GpuCulling* updateGpuCulling(const Scene& scene);
+    void updateLightClusters(unique_ptr<PerspectiveCamera>& camera, const Scene& scene);
 
     void renderGbufferToScreen();
-    void renderGbuffer(const AssimpModel& model);
+    void renderDeferredLighting(unique_ptr<PerspectiveCamera>& camera, const Scene& scene);
+    void renderGbuffer(const AssimpModel& model, const uint8_t* visibleMeshes);
+    void renderGbufferObjects(const Scene& scene);
+    void renderGbufferBatches(const Scene& scene);
+    void renderGbufferMesh(const AssimpModel& model, size_t m, const glm::mat4& meshMatrix, const PhongMaterial& material, float pixelsPerUnit);
+    //queues mesh m of model to the render queue, or draws it with renderGbufferMesh if the queue is off
+    void addGbufferMesh(const AssimpModel& model, size_t m, const glm::mat4& meshMatrix, const PhongMaterial& material, float pixelsPerUnit);
+
+    //stages of the gbuffer pass with _deferredShader
+    void beginPass() override;
+    void setMaterial(const PhongMaterial& material) override;
+    void setTextures(const Mesh& mesh) override;
+    void setVertexArray(const Mesh& mesh) override;
+    void drawItem(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit) override;
+    void addCommands(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit, uint32_t drawId,
+        std::vector<DrawElementsIndirectCommand>& commands) override;
+    void drawCommands(const IndirectDraws& draws, size_t batch) override;
+    void endPass() override;
 
     void forwardShading(unique_ptr<PerspectiveCamera>& _camera, const Scene& scene);
 
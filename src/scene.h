@@ -1,8 +1,14 @@
 #pragma once
+#include <cmath>
+#include <random>
+
 #include "material.h"
 
 #include "base/light.h"
+#include "base/scene_graph.h"
 #include "model.h"
+#include "scene_bvh.h"
+#include "scene_objects.h"
 #include "base/bounding_box.h"
 class Scene
 {
@@ -19,12 +25,97 @@ public:
     // models
     std::vector<AssimpModel> models;
 
+    // world matrices of the model roots and their imported nodes, the passes read them from here
+    SceneGraph graph;
+
+    // hierarchy over the meshes of models, see update
+    SceneBvh bvh;
+
+    // placed copies of models, drawn after the models themselves. not in the graph nor the bvh
+    SceneObjects objects;
+
     void addToScene(AssimpModel& model) {
         box += model.box;
+        addToGraph(model);
+        graph.update();
         models.push_back(std::move(model));
+        bvh.invalidate();
         updateDirectionalLight();
     }
 
+    // drops a model, textures no other model uses are freed with it
+    void removeFromScene(size_t index) {
+        models.erase(models.begin() + index);
+        objects.removeModel(static_cast<uint32_t>(index));
+        bvh.invalidate();
+        box = BoundingBox();
+        graph.clear();
+        for (auto& model : models)
+        {
+            box += model.box;
+            addToGraph(model);
+        }
+        graph.update();
+        updateDirectionalLight();
+    }
+
+    // copies the model transforms into the graph and updates the world matrices of the changed ones,
+    // then refits the bvh (or rebuilds it after models were added or removed) and updates the moved objects.
+    // once per frame before rendering, the culling only uses the bvh while it is valid
+    void update()
+    {
+        for (const auto& model : models)
+        {
+            graph.setLocalMatrix(model.sceneNode, model.transform.getLocalMatrix());
+        }
+        graph.update();
+        bvh.update(models, graph);
+        objects.update(models);
+    }
+
+    // adds count objects of models[model] with random positions and headings on a disc around the model,
+    // spaced by the size of its box
+    void scatterObjects(size_t model, size_t count)
+    {
+        const AssimpModel& source = models[model];
+        const float spacing = 1.5f * glm::length(source.box.max - source.box.min) * source.transform.scale.x;
+        const float radius = spacing * std::sqrt(static_cast<float>(objects.size() + count));
+        std::mt19937 random(static_cast<unsigned int>(objects.size()));
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (size_t i = 0; i < count; i++)
+        {
+            Transform transform = source.transform;
+            const float angle = 6.2832f * unit(random);
+            const float distance = radius * std::sqrt(unit(random));
+            transform.position += distance * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+            transform.rotation = glm::angleAxis(6.2832f * unit(random), glm::vec3(0.0f, 1.0f, 0.0f)) * transform.rotation;
+            objects.add(static_cast<uint32_t>(model), transform);
+        }
+    }
+
+    // closest displayed model under the ray, as of the last update. the caller owns the per frame update,
+    // nothing is hit between adding or removing models and the next update
+    bool pick(const Ray& ray, RayHit& hit)
+    {
+        return bvh.raycast(models, ray, hit);
+    }
+
+    // displayed models within the range of a point light, as of the last update like pick
+    void getLitModels(const PointLight& light, std::vector<size_t>& lit) const
+    {
+        bvh.getModelsInSphere(light.position, light.getRange(), lit);
+    }
+
+    // the root of the model below the scene, then its imported nodes in order
+    void addToGraph(AssimpModel& model)
+    {
+        model.sceneNode = graph.addNode(SceneGraph::kNoParent, model.transform.getLocalMatrix());
+        for (const auto& node : model.nodes)
+        {
+            graph.addNode(node.parent == SceneGraph::kNoParent ? model.sceneNode : model.sceneNode + 1 + node.parent, node.transform);
+        }
+    }
+
     void updateDirectionalLight()
     {
         for (auto& l : directionalLights) 
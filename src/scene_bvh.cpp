@@ -0,0 +1,199 @@
+#include "scene_bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+// position of a vertex of the CPU side geometry of a mesh
+const glm::vec3& getPosition(const Mesh& mesh, unsigned int vertex)
+{
+    return mesh.positions.empty() ? mesh.vertices[vertex].Position : mesh.positions[vertex];
+}
+
+// triangles of LOD0 the mesh keeps on the CPU, 0 for MeshCpuData::None
+size_t getTriangleCount(const Mesh& mesh)
+{
+    if (mesh.positions.empty() && mesh.vertices.empty())
+        return 0;
+    return std::min<size_t>(mesh.indices.size(), mesh.indexCount) / 3;
+}
+}
+
+void SceneBvh::update(const std::vector<AssimpModel>& models, const SceneGraph& graph)
+{
+    bool changedModels = !_valid || models.size() != _displayed.size();
+    for (size_t i = 0; i < models.size() && !changedModels; i++)
+    {
+        changedModels = models[i].meshes.size() != _meshOffsets[i + 1] - _meshOffsets[i];
+    }
+    if (changedModels)
+    {
+        rebuild(models, graph);
+        return;
+    }
+
+    _changed.clear();
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        const AssimpModel& model = models[i];
+        _displayed[i] = model.display ? 1 : 0;
+        for (uint32_t m = _meshOffsets[i]; m < _meshOffsets[i + 1]; m++)
+        {
+            const glm::mat4& meshMatrix = model.getMeshMatrix(graph, m - _meshOffsets[i]);
+            if (meshMatrix == _matrices[m])
+                continue;
+            _matrices[m] = meshMatrix;
+            _boxes[m] = getWorldBox(model.meshes[m - _meshOffsets[i]].box, meshMatrix);
+            _changed.push_back(m);
+        }
+    }
+    if (_changed.empty())
+        return;
+
+    _bvh.refit(_boxes, _changed);
+    if (_bvh.getCost() > kRebuildCost * _bvh.getBuildCost())
+        _bvh.build(_boxes);
+}
+
+void SceneBvh::rebuild(const std::vector<AssimpModel>& models, const SceneGraph& graph)
+{
+    _boxes.clear();
+    _meshModels.clear();
+    _meshOffsets.clear();
+    _matrices.clear();
+    _displayed.clear();
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        const AssimpModel& model = models[i];
+        _meshOffsets.push_back(static_cast<uint32_t>(_boxes.size()));
+        _displayed.push_back(model.display ? 1 : 0);
+        for (size_t m = 0; m < model.meshes.size(); m++)
+        {
+            const glm::mat4& meshMatrix = model.getMeshMatrix(graph, m);
+            _boxes.push_back(getWorldBox(model.meshes[m].box, meshMatrix));
+            _matrices.push_back(meshMatrix);
+            _meshModels.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    _meshOffsets.push_back(static_cast<uint32_t>(_boxes.size()));
+
+    _bvh.build(_boxes);
+    // the triangle trees are in model space, but the meshes may be others now
+    _triangleBvhs.clear();
+    _triangleBvhs.resize(_boxes.size());
+    _valid = true;
+}
+
+void SceneBvh::cull(const Frustum& frustum, Visibility& visibility) const
+{
+    visibility.models.assign(_displayed.size(), 0);
+    visibility.meshes.assign(_boxes.size(), 0);
+    visibility.meshOffsets = _meshOffsets;
+    visibility.visibleModels = 0;
+    visibility.visibleMeshes = 0;
+
+    _bvh.cull(frustum, [&](uint32_t mesh) {
+        const uint32_t model = _meshModels[mesh];
+        if (!_displayed[model])
+            return;
+        visibility.meshes[mesh] = 1;
+        visibility.visibleMeshes++;
+        if (!visibility.models[model])
+        {
+            visibility.models[model] = 1;
+            visibility.visibleModels++;
+        }
+    });
+}
+
+bool SceneBvh::raycast(const std::vector<AssimpModel>& models, const Ray& ray, RayHit& hit)
+{
+    // the mesh indices of an invalidated tree may point past the models that are left
+    if (!_valid)
+        return false;
+    float tMax = std::numeric_limits<float>::max();
+    const bool found = _bvh.raycast(ray, tMax, [&](uint32_t meshIndex, float& t) {
+        const uint32_t model = _meshModels[meshIndex];
+        if (!_displayed[model])
+            return;
+
+        const size_t localMesh = meshIndex - _meshOffsets[model];
+        const Mesh& mesh = models[model].meshes[localMesh];
+        const Ray localRay = ray.transform(glm::inverse(_matrices[meshIndex]));
+        const Bvh* triangles = getTriangleBvh(mesh, meshIndex);
+        if (triangles == nullptr)
+        {
+            float tEnter;
+            if (localRay.intersect(mesh.box, t, tEnter) && tEnter < t)
+            {
+                t = tEnter;
+                hit.model = model, hit.mesh = localMesh, hit.triangle = RayHit::kNoTriangle;
+            }
+            return;
+        }
+
+        triangles->raycast(localRay, t, [&](uint32_t triangle, float& tTriangle) {
+            const unsigned int* index = mesh.indices.data() + 3 * triangle;
+            float tHit;
+            if (localRay.intersect(getPosition(mesh, index[0]), getPosition(mesh, index[1]), getPosition(mesh, index[2]), tTriangle, tHit))
+            {
+                tTriangle = tHit;
+                hit.model = model, hit.mesh = localMesh, hit.triangle = triangle;
+            }
+        });
+    });
+
+    if (found)
+    {
+        hit.distance = tMax;
+        hit.position = ray.getPoint(tMax);
+    }
+    return found;
+}
+
+void SceneBvh::getModelsInSphere(const glm::vec3& center, float radius, std::vector<size_t>& models) const
+{
+    models.clear();
+    if (!_valid)
+        return;
+    _bvh.overlap(center, radius, [&](uint32_t mesh) {
+        const uint32_t model = _meshModels[mesh];
+        if (_displayed[model])
+            models.push_back(model);
+    });
+    std::sort(models.begin(), models.end());
+    models.erase(std::unique(models.begin(), models.end()), models.end());
+}
+
+const Bvh* SceneBvh::getTriangleBvh(const Mesh& mesh, size_t meshIndex)
+{
+    if (_triangleBvhs[meshIndex])
+        return _triangleBvhs[meshIndex].get();
+
+    const size_t triangleCount = getTriangleCount(mesh);
+    if (triangleCount == 0)
+        return nullptr;
+
+    std::vector<BoundingBox> boxes(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            boxes[i] += getPosition(mesh, mesh.indices[3 * i + k]);
+        }
+    }
+    _triangleBvhs[meshIndex] = std::make_unique<Bvh>();
+    _triangleBvhs[meshIndex]->build(boxes);
+    return _triangleBvhs[meshIndex].get();
+}
+
+BoundingBox SceneBvh::getWorldBox(const BoundingBox& box, const glm::mat4& modelMatrix)
+{
+    glm::vec3 center, extent;
+    Frustum::transformBox(box, modelMatrix, center, extent);
+    BoundingBox world;
+    world.min = center - extent;
+    world.max = center + extent;
+    return world;
+}
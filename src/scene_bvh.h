@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/bvh.h"
+#include "base/frustum.h"
+#include "base/ray.h"
+#include "base/scene_graph.h"
+#include "model.h"
+#include "scene_culling.h"
+
+// the closest surface a ray hits in the scene
+struct RayHit
+{
+    static constexpr uint32_t kNoTriangle = ~0u;
+
+    size_t model = 0;
+    // index into AssimpModel::meshes
+    size_t mesh = 0;
+    // first index of the triangle is 3 * triangle, kNoTriangle if the mesh keeps no CPU geometry and its box was hit
+    uint32_t triangle = kNoTriangle;
+    // in units of the ray direction
+    float distance = 0.0f;
+    glm::vec3 position = glm::vec3(0.0f);
+};
+
+// two level bounding volume hierarchy of a scene: a Bvh over the world boxes of all meshes, refit when
+// model transforms change and rebuilt when models come or go, plus a Bvh over the triangles of every mesh
+// in model space, built the first time a ray reaches the mesh
+class SceneBvh
+{
+public:
+    // refits the meshes whose world matrix in graph changed since the last update,
+    // rebuilds if the models changed or the refits made the tree too slow
+    void update(const std::vector<AssimpModel>& models, const SceneGraph& graph);
+
+    // the next update rebuilds, for scenes whose models were added, removed or reordered
+    void invalidate() { _valid = false; }
+
+    // false from invalidate to the next update
+    bool isValid() const { return _valid; }
+
+    // same result as SceneCulling::cull, hidden models are never visible
+    void cull(const Frustum& frustum, Visibility& visibility) const;
+
+    // closest hit of the ray with the displayed models of the last update, none while the tree is invalid. the
+    // triangles of meshes that keep CPU geometry (MeshCpuData Full or Positions) are tested, the boxes of the other
+    // meshes stand in for them
+    bool raycast(const std::vector<AssimpModel>& models, const Ray& ray, RayHit& hit);
+
+    // displayed models with a mesh box overlapping the sphere, e.g. the range of a point light. sorted, empty
+    // while the tree is invalid
+    void getModelsInSphere(const glm::vec3& center, float radius, std::vector<size_t>& models) const;
+
+    size_t getModelCount() const { return _displayed.size(); }
+
+    size_t getMeshCount() const { return _boxes.size(); }
+
+    const Bvh& getBvh() const { return _bvh; }
+
+private:
+    // rebuild once refits made the expected query cost this much worse than right after a build
+    static constexpr float kRebuildCost = 1.5f;
+
+    Bvh _bvh;
+    // world box of every mesh, the primitives of _bvh
+    std::vector<BoundingBox> _boxes;
+    // model of every mesh
+    std::vector<uint32_t> _meshModels;
+    // the meshes of model i start at _meshOffsets[i]
+    std::vector<uint32_t> _meshOffsets;
+    // world matrix of every mesh at the last update
+    std::vector<glm::mat4> _matrices;
+    std::vector<uint8_t> _displayed;
+    std::vector<uint32_t> _changed;
+    std::vector<std::unique_ptr<Bvh>> _triangleBvhs;
+    bool _valid = false;
+
+    void rebuild(const std::vector<AssimpModel>& models, const SceneGraph& graph);
+
+    // null if the mesh keeps no triangles
+    const Bvh* getTriangleBvh(const Mesh& mesh, size_t meshIndex);
+
+    static BoundingBox getWorldBox(const BoundingBox& box, const glm::mat4& modelMatrix);
+};
@@ -0,0 +1,56 @@
+#include "scene_culling.h"
+#include "scene_bvh.h"
+
+void SceneCulling::update(const std::vector<AssimpModel>& models, const SceneGraph& graph)
+{
+    if (_bvh != nullptr)
+        return;
+
+    _modelBoxes.clear();
+    _meshBoxes.clear();
+    _meshOffsets.clear();
+    _displayed.clear();
+    _modelBoxes.reserve(models.size());
+
+    for (const auto& model : models)
+    {
+        _modelBoxes.push_back(model.box, model.getWorldMatrix(graph));
+        _meshOffsets.push_back(static_cast<uint32_t>(_meshBoxes.size()));
+        _displayed.push_back(model.display ? 1 : 0);
+        for (size_t m = 0; m < model.meshes.size(); m++)
+        {
+            _meshBoxes.push_back(model.meshes[m].box, model.getMeshMatrix(graph, m));
+        }
+    }
+    _meshOffsets.push_back(static_cast<uint32_t>(_meshBoxes.size()));
+}
+
+void SceneCulling::cull(const Frustum& frustum, Visibility& visibility) const
+{
+    if (_bvh != nullptr)
+    {
+        _bvh->cull(frustum, visibility);
+        return;
+    }
+
+    const size_t modelCount = _modelBoxes.size();
+    visibility.models.resize(modelCount);
+    visibility.meshes.assign(_meshBoxes.size(), 0);
+    visibility.meshOffsets = _meshOffsets;
+    visibility.visibleModels = 0;
+    visibility.visibleMeshes = 0;
+
+    _modelBoxes.cull(frustum, visibility.models.data());
+    for (size_t i = 0; i < modelCount; i++)
+    {
+        if (!_displayed[i])
+            visibility.models[i] = 0;
+        if (!visibility.models[i])
+            continue;
+
+        const size_t first = _meshOffsets[i];
+        const size_t count = _meshOffsets[i + 1] - first;
+        visibility.visibleMeshes += _meshBoxes.cull(frustum, first, count, visibility.meshes.data() + first);
+        visibility.visibleModels++;
+    }
+}
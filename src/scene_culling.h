@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/frustum.h"
+#include "base/frustum_culling.h"
+#include "base/scene_graph.h"
+#include "model.h"
+
+// which models and meshes of a scene one view sees
+struct Visibility
+{
+    // one flag per model
+    std::vector<uint8_t> models;
+    // one flag per mesh, the meshes of model i start at meshOffsets[i]
+    std::vector<uint8_t> meshes;
+    std::vector<uint32_t> meshOffsets;
+    size_t visibleModels = 0;
+    size_t visibleMeshes = 0;
+
+    bool isModelVisible(size_t model) const { return models[model] != 0; }
+
+    // flags of the meshes of a model, indexed like AssimpModel::meshes
+    const uint8_t* getMeshes(size_t model) const { return meshes.data() + meshOffsets[model]; }
+};
+
+class SceneBvh;
+
+// world space boxes of the models of a scene and of their meshes, culled per view with CullingBoxes.
+// the meshes of a model are only tested if the model box is visible.
+// with a SceneBvh set, the culling walks its hierarchy instead and update does nothing
+class SceneCulling
+{
+public:
+    // recomputes the world boxes from the world matrices in graph, once per frame after graph is updated
+    void update(const std::vector<AssimpModel>& models, const SceneGraph& graph);
+
+    // culls the boxes of the last update against frustum. hidden models (display false) are never visible
+    void cull(const Frustum& frustum, Visibility& visibility) const;
+
+    // bvh has to be updated for the models culled, null goes back to the flat boxes
+    void setBvh(const SceneBvh* bvh) { _bvh = bvh; }
+
+    size_t getModelCount() const { return _modelBoxes.size(); }
+
+    size_t getMeshCount() const { return _meshBoxes.size(); }
+
+private:
+    CullingBoxes _modelBoxes;
+    CullingBoxes _meshBoxes;
+    std::vector<uint32_t> _meshOffsets;
+    std::vector<uint8_t> _displayed;
+    const SceneBvh* _bvh = nullptr;
+};
@@ -0,0 +1,163 @@
+#include "scene_objects.h"
+
+#include <algorithm>
+
+uint32_t SceneObjects::add(uint32_t model, const Transform& transform, uint32_t material)
+{
+    const uint32_t object = static_cast<uint32_t>(_models.size());
+    _transforms.push_back(transform);
+    _matrices.push_back(transform.getLocalMatrix());
+    _bounds.push_back(glm::vec3(0.0f), glm::vec3(0.0f));
+    _flags.push_back(kDisplayed);
+    _models.push_back(model);
+    _materials.push_back(material);
+    if (model >= _modelObjects.size())
+        _modelObjects.resize(model + 1, 0);
+    _modelObjects[model]++;
+    markDirty(object);
+    return object;
+}
+
+void SceneObjects::remove(uint32_t object)
+{
+    _modelObjects[_models[object]]--;
+    const uint32_t last = static_cast<uint32_t>(_models.size() - 1);
+    if (object != last)
+    {
+        _transforms[object] = _transforms[last];
+        _matrices[object] = _matrices[last];
+        _bounds.set(object, _bounds.getCenter(last), _bounds.getExtent(last));
+        _flags[object] = _flags[last] & ~kDirty;
+        _models[object] = _models[last];
+        _materials[object] = _materials[last];
+        // the entry of last in _dirty is skipped by the next update, the moved object is listed anew
+        if (_flags[last] & kDirty)
+            markDirty(object);
+    }
+    _transforms.pop_back();
+    _matrices.pop_back();
+    _bounds.pop_back();
+    _flags.pop_back();
+    _models.pop_back();
+    _materials.pop_back();
+}
+
+void SceneObjects::removeModel(uint32_t model)
+{
+    for (size_t i = _models.size(); i-- > 0;)
+    {
+        if (_models[i] == model)
+            remove(static_cast<uint32_t>(i));
+    }
+    for (auto& m : _models)
+    {
+        if (m > model)
+            m--;
+    }
+    if (model < _modelObjects.size())
+        _modelObjects.erase(_modelObjects.begin() + model);
+}
+
+void SceneObjects::clear()
+{
+    _transforms.clear();
+    _matrices.clear();
+    _bounds.clear();
+    _flags.clear();
+    _models.clear();
+    _materials.clear();
+    _dirty.clear();
+    _modelObjects.clear();
+}
+
+uint32_t SceneObjects::addMaterial(const PhongMaterial& material)
+{
+    _materialTable.push_back(material);
+    return static_cast<uint32_t>(_materialTable.size() - 1);
+}
+
+void SceneObjects::setTransform(uint32_t object, const Transform& transform)
+{
+    _transforms[object] = transform;
+    markDirty(object);
+}
+
+void SceneObjects::setDisplayed(uint32_t object, bool displayed)
+{
+    _flags[object] = displayed ? _flags[object] | kDisplayed : _flags[object] & ~kDisplayed;
+}
+
+const PhongMaterial& SceneObjects::getMaterial(uint32_t object, const AssimpModel& model) const
+{
+    const uint32_t material = _materials[object];
+    if (material == kModelMaterial)
+        return *static_cast<const PhongMaterial*>(model.facetMaterial.get());
+    return _materialTable[material];
+}
+
+size_t SceneObjects::update(const std::vector<AssimpModel>& models)
+{
+    _modelBoxes.resize(models.size());
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        _modelBoxes[i] = models[i].box;
+    }
+    return update(_modelBoxes);
+}
+
+size_t SceneObjects::update(const std::vector<BoundingBox>& modelBoxes)
+{
+    size_t updated = 0;
+    const size_t count = _models.size();
+    for (uint32_t object : _dirty)
+    {
+        if (object >= count || !(_flags[object] & kDirty))
+            continue;
+        _flags[object] &= ~kDirty;
+        _matrices[object] = _transforms[object].getLocalMatrix();
+        glm::vec3 center, extent;
+        Frustum::transformBox(modelBoxes[_models[object]], _matrices[object], center, extent);
+        _bounds.set(object, center, extent);
+        updated++;
+    }
+    _dirty.clear();
+    return updated;
+}
+
+size_t SceneObjects::cull(const Frustum* frustum, ObjectVisibility& visibility) const
+{
+    const size_t count = _models.size();
+    visibility.flags.resize(count);
+    if (frustum != nullptr)
+        _bounds.cull(*frustum, visibility.flags.data());
+    else
+        std::fill(visibility.flags.begin(), visibility.flags.end(), 1);
+
+    // counting sort by model: few models, many objects
+    std::vector<uint32_t>& offsets = visibility.modelOffsets;
+    offsets.assign(_modelObjects.size() + 1, 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        visibility.flags[i] &= _flags[i] & kDisplayed;
+        offsets[_models[i] + 1] += visibility.flags[i];
+    }
+    for (size_t m = 1; m < offsets.size(); m++)
+    {
+        offsets[m] += offsets[m - 1];
+    }
+    visibility.objects.resize(offsets.back());
+    for (size_t i = 0; i < count; i++)
+    {
+        if (visibility.flags[i])
+            visibility.objects[offsets[_models[i]]++] = static_cast<uint32_t>(i);
+    }
+    return visibility.objects.size();
+}
+
+void SceneObjects::markDirty(uint32_t object)
+{
+    if (_flags[object] & kDirty)
+        return;
+    _flags[object] |= kDirty;
+    _dirty.push_back(object);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/bounding_box.h"
+#include "base/frustum.h"
+#include "base/frustum_culling.h"
+#include "base/transform.h"
+#include "material.h"
+#include "model.h"
+
+// which objects of a SceneObjects one view sees
+struct ObjectVisibility
+{
+    // one flag per object
+    std::vector<uint8_t> flags;
+    // the visible objects, grouped by model so that the meshes of a model are drawn back to back
+    std::vector<uint32_t> objects;
+    // scratch of the grouping, one counter per model
+    std::vector<uint32_t> modelOffsets;
+};
+
+// placed copies of the models of a scene, stored as parallel arrays indexed by object: transform, world
+// matrix, world bounds, flags, the model whose meshes the object draws and its material. the models are
+// the shared assets, an object only refers to one by index, so tens of thousands of copies of a few
+// models stay cheap to update, cull and submit
+class SceneObjects
+{
+public:
+    // the object is drawn with the facet material of its model
+    static constexpr uint32_t kModelMaterial = ~0u;
+
+    // appends an object drawing the meshes of models[model], returns its index
+    uint32_t add(uint32_t model, const Transform& transform, uint32_t material = kModelMaterial);
+
+    // the last object takes the index of the removed one
+    void remove(uint32_t object);
+
+    // removes the objects of models[model] and renumbers the references to the models after it,
+    // for when the model is erased from the scene
+    void removeModel(uint32_t model);
+
+    void clear();
+
+    // returns the index to pass to add
+    uint32_t addMaterial(const PhongMaterial& material);
+
+    size_t size() const { return _models.size(); }
+
+    // number of objects drawing models[model]
+    size_t getObjectCount(uint32_t model) const { return model < _modelObjects.size() ? _modelObjects[model] : 0; }
+
+    const Transform& getTransform(uint32_t object) const { return _transforms[object]; }
+
+    // the world matrix and bounds follow at the next update
+    void setTransform(uint32_t object, const Transform& transform);
+
+    bool isDisplayed(uint32_t object) const { return (_flags[object] & kDisplayed) != 0; }
+
+    void setDisplayed(uint32_t object, bool displayed);
+
+    uint32_t getModel(uint32_t object) const { return _models[object]; }
+
+    // valid after the update that followed the last setTransform
+    const glm::mat4& getMatrix(uint32_t object) const { return _matrices[object]; }
+
+    const PhongMaterial& getMaterial(uint32_t object, const AssimpModel& model) const;
+
+    // index passed to add, kModelMaterial for the material of the model
+    uint32_t getMaterialIndex(uint32_t object) const { return _materials[object]; }
+
+    // world bounds as center and half extent, valid like getMatrix
+    glm::vec3 getCenter(uint32_t object) const { return _bounds.getCenter(object); }
+
+    glm::vec3 getExtent(uint32_t object) const { return _bounds.getExtent(object); }
+
+    // recomputes the world matrices and bounds of the objects moved since the last update,
+    // once per frame. returns the number of objects updated
+    size_t update(const std::vector<AssimpModel>& models);
+
+    // same with the boxes of the models in their root space, for callers without GL models
+    size_t update(const std::vector<BoundingBox>& modelBoxes);
+
+    // flags the displayed objects whose bounds intersect frustum and lists them grouped by model.
+    // a null frustum lists every displayed object. returns the number of visible objects
+    size_t cull(const Frustum* frustum, ObjectVisibility& visibility) const;
+
+private:
+    static constexpr uint8_t kDisplayed = 1;
+    static constexpr uint8_t kDirty = 2;
+
+    std::vector<Transform> _transforms;
+    std::vector<glm::mat4> _matrices;
+    CullingBoxes _bounds;
+    std::vector<uint8_t> _flags;
+    std::vector<uint32_t> _models;
+    std::vector<uint32_t> _materials;
+
+    // objects moved since the last update. removals may leave indices that are past the end or not dirty
+    std::vector<uint32_t> _dirty;
+    // number of objects of every model
+    std::vector<uint32_t> _modelObjects;
+    std::vector<PhongMaterial> _materialTable;
+    std::vector<BoundingBox> _modelBoxes;
+
+    void markDirty(uint32_t object);
+};
@@ -1,80 +1,235 @@
 #include "shader.h"
 
-void PhongShader::renderFacet(const AssimpModel& model)
+void Shader::renderFacet(const AssimpModel& model, const uint8_t* visibleMeshes)
 {
-    for (const auto& mesh : model.meshes) {
-        // bind appropriate textures
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
-
-        const PhongMaterial* material = static_cast<PhongMaterial*>(model.facetMaterial.get());
-        _shader->use();
-        _shader->setUniformVec3("material.ambient", material->ka);
-        _shader->setUniformVec3("material.diffuse", material->kd);
-        _shader->setUniformVec3("material.specular", material->ks);
-        _shader->setUniformFloat("material.shininess", material->ns);
-
-        _shader->setUniformMat4("model", model.transform.getLocalMatrix());
-        _shader->setUniformMat4("lightSpaceMatrix", lightSpaceMatrix);
-
-        bool use_texture_kd = false;
-        bool use_texture_ks = false;
-        bool use_texture_normal = false;
-        bool use_texture_height = false;
-
-        for (unsigned int i = 0; i < mesh.textures.size(); i++)
+    const float pixelsPerUnit = model.getPixelsPerUnit(model.getWorldMatrix(*graph), cameraPosition, cameraFovy, static_cast<float>(screenHeight));
+    const PhongMaterial& material = *static_cast<const PhongMaterial*>(model.facetMaterial.get());
+    for (size_t m = 0; m < model.meshes.size(); m++)
+    {
+        if (visibleMeshes && !visibleMeshes[m])
+            continue;
+        addMesh(model, m, model.getMeshMatrix(*graph, m), material, pixelsPerUnit);
+    }
+}
+
+void Shader::renderObjects(const std::vector<AssimpModel>& models, const ObjectVisibility& visibility)
+{
+    for (uint32_t object : visibility.objects)
+    {
+        const AssimpModel& model = models[objects->getModel(object)];
+        const glm::mat4& matrix = objects->getMatrix(object);
+        const float pixelsPerUnit = model.getPixelsPerUnit(matrix, cameraPosition, cameraFovy, static_cast<float>(screenHeight));
+        const PhongMaterial& material = objects->getMaterial(object, model);
+        for (size_t m = 0; m < model.meshes.size(); m++)
         {
-            glActiveTexture(GL_TEXTURE0 + i + 1); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = mesh.textures[i].type;
-            if (name == "texture_diffuse")
-            {
-                number = std::to_string(diffuseNr++);
-                use_texture_kd = true;
-            }
-            else if (name == "texture_specular")
-            {
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-                use_texture_ks = true;
-            }
-            else if (name == "texture_normal")
-            {
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-                use_texture_normal = true;
-            }
-            else if (name == "texture_height")
-            {
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-                use_texture_height = true;
-            }
+            addMesh(model, m, matrix * model.meshMatrices[m], material, pixelsPerUnit);
+        }
+    }
+}
 
-            // now set the sampler to the correct texture unit
-            _shader->setUniformInt((name + number).c_str(), i + 1);
+void Shader::renderBatches(const std::vector<AssimpModel>& models)
+{
+    const std::vector<GpuCulling::Batch>& batches = gpuCulling->getBatches();
+    _shader->use();
+    _shader->setUniformBool("gpuDriven", true);
+    for (gpuBatch = 0; gpuBatch < batches.size(); gpuBatch++)
+    {
+        const GpuCulling::Batch& batch = batches[gpuBatch];
+        renderMesh(models[batch.model], batch.mesh, glm::mat4(1.0f), *batch.material, 0.0f);
+    }
+    gpuBatch = kNoBatch;
+    _shader->use();
+    _shader->setUniformBool("gpuDriven", false);
+    _shader->unuse();
+    RenderStats::getFrame().gpuDraws += gpuCulling->getDrawCount();
+}
+
+bool Shader::renderGpuShadowCasters(const std::vector<AssimpModel>& models, const glm::mat4& lightSpaceMatrix)
+{
+    if (gpuCulling == nullptr)
+        return false;
+    //the batches of a vertex array are drawn together, which needs every command in its slot
+    gpuCulling->cull(Frustum::fromShadowMatrix(lightSpaceMatrix), false, !_options->multiDraw);
+    _shadowShader->use();
+    _shadowShader->setUniformBool("gpuDriven", true);
+    //the draw block is unused but has to be bound
+    bindShadowDraw(glm::mat4(1.0f));
+    if (_options->multiDraw)
+    {
+        countShadowDraw(0, gpuCulling->drawRuns());
+    }
+    else
+    {
+        const std::vector<GpuCulling::Batch>& batches = gpuCulling->getBatches();
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            glBindVertexArray(models[batches[i].model].meshes[batches[i].mesh].VAO);
+            gpuCulling->drawBatch(i);
+            countShadowDraw(0);
+        }
+        glBindVertexArray(0);
+    }
+    _shadowShader->setUniformBool("gpuDriven", false);
+    RenderStats::getFrame().gpuDraws += gpuCulling->getDrawCount();
+    return true;
+}
 
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+void Shader::renderShadowObjects(const std::vector<AssimpModel>& models, const glm::mat4& lightSpaceMatrix, float texelsPerUnit)
+{
+    if (objects == nullptr || objects->size() == 0)
+        return;
+    const Frustum lightVolume = Frustum::fromShadowMatrix(lightSpaceMatrix);
+    objects->cull(culling != nullptr ? &lightVolume : nullptr, shadowObjects);
+    //the occluders were rasterized for this light by cullShadowCasters
+    if (culling != nullptr && shadowOcclusion != nullptr)
+        RenderStats::getFrame().shadowOccluded += shadowOcclusion->cull(*objects, shadowObjects);
+    for (uint32_t object : shadowObjects.objects)
+    {
+        const AssimpModel& model = models[objects->getModel(object)];
+        const glm::mat4& matrix = objects->getMatrix(object);
+        const float pixelsPerUnit = model.getPixelsPerUnit(matrix, cameraPosition, cameraFovy, static_cast<float>(screenHeight));
+        for (size_t m = 0; m < model.meshes.size(); m++)
+        {
+            const Mesh& mesh = model.meshes[m];
+            addShadowCaster(mesh, matrix * model.meshMatrices[m], selectShadowLod(mesh, pixelsPerUnit, texelsPerUnit));
         }
+    }
+}
 
-        _shader->setUniformBool("use_texture_kd", use_texture_kd);
-        _shader->setUniformBool("use_texture_ks", use_texture_ks);
-        _shader->setUniformBool("use_texture_normal", _options->useNormalMap && use_texture_normal);
+void Shader::drawShadowCasters()
+{
+    if (shadowDraws.getDrawCount() > 0)
+    {
+        shadowDraws.upload();
+        _shadowShader->setUniformBool("gpuDriven", true);
+        //the draw block is unused but has to be bound
+        bindShadowDraw(glm::mat4(1.0f));
+        countShadowDraw(0, shadowDraws.draw());
+        _shadowShader->setUniformBool("gpuDriven", false);
+    }
+    shadowDraws.reset();
+}
 
-        _shader->setUniformBool("use_shadow", _options->useShadow);
-        if(_options->useShadow) _shader->setUniformInt("shadowMap", 0);
+void Shader::renderMesh(const AssimpModel& model, size_t m, const glm::mat4& meshMatrix, const PhongMaterial& material, float pixelsPerUnit)
+{
+    RenderQueue::draw(*this, model.meshes[m], material, meshMatrix, pixelsPerUnit);
+}
 
-        // draw mesh
-        glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+void Shader::addMesh(const AssimpModel& model, size_t m, const glm::mat4& meshMatrix, const PhongMaterial& material, float pixelsPerUnit)
+{
+    if (renderQueue == nullptr)
+    {
+        renderMesh(model, m, meshMatrix, material, pixelsPerUnit);
+        return;
+    }
+    const Mesh& mesh = model.meshes[m];
+    const glm::vec3 center = meshMatrix * glm::vec4(0.5f * (mesh.box.min + mesh.box.max), 1.0f);
+    renderQueue->add(*this, mesh, material, meshMatrix, pixelsPerUnit, glm::length(center - cameraPosition));
+}
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+void Shader::setMaterial(const PhongMaterial& material)
+{
+    drawUniforms.material = getMaterialUniforms(material);
+}
+
+void Shader::setTextures(const Mesh& mesh)
+{
+    unsigned int diffuseNr = 1;
+    unsigned int specularNr = 1;
+    unsigned int normalNr = 1;
+    unsigned int heightNr = 1;
 
-        _shader->unuse();
+    bool use_texture_kd = false;
+    bool use_texture_ks = false;
+    bool use_texture_normal = false;
+
+    for (unsigned int i = 0; i < mesh.textures.size(); i++)
+    {
+        // retrieve texture number (the N in diffuse_textureN)
+        unsigned int number = 0;
+        const string& name = mesh.textures[i].type;
+        if (name == "texture_diffuse")
+        {
+            number = diffuseNr++;
+            use_texture_kd = true;
+        }
+        else if (name == "texture_specular")
+        {
+            number = specularNr++;
+            use_texture_ks = true;
+        }
+        else if (name == "texture_normal")
+        {
+            number = normalNr++;
+            use_texture_normal = true;
+        }
+        else if (name == "texture_height")
+        {
+            number = heightNr++;
+        }
+
+        // now set the sampler to the texture unit it is bound to
+        string scratch;
+        _shader->setUniformInt(getSamplerUniform(name, number, scratch), i + 1);
     }
+
+    drawUniforms.useTextureKd = use_texture_kd;
+    drawUniforms.useTextureKs = use_texture_ks;
+    drawUniforms.useTextureNormal = _options->useNormalMap && use_texture_normal;
+}
+
+void Shader::setVertexArray(const Mesh& mesh)
+{
+    drawUniforms.packedVertex = mesh.isPacked();
+}
+
+void Shader::drawItem(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit)
+{
+    drawUniforms.model = matrix;
+    UniformRing::bind(kDrawBlockBinding, uniformRing->push(drawUniforms));
+    // meshlets only cull LOD0
+    drawMesh(mesh, matrix, pixelsPerUnit);
+}
+
+void Shader::addCommands(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit, uint32_t drawId,
+    std::vector<DrawElementsIndirectCommand>& commands)
+{
+    // meshlets only cull LOD0
+    const size_t level = selectLod(mesh, pixelsPerUnit);
+    size_t triangles = 0;
+    if (_options->meshletCulling && level == 0 && occlusion != nullptr)
+        triangles = mesh.addVisibleCommands(cameraFrustum, matrix, cameraPosition, drawId, commands, &occlusion->getBuffer(), occlusion->getViewProjection());
+    else if (_options->meshletCulling && level == 0)
+        triangles = mesh.addVisibleCommands(cameraFrustum, matrix, cameraPosition, drawId, commands);
+    else
+        triangles = mesh.addLodCommand(level, drawId, commands);
+    RenderStats::getFrame().triangles += triangles;
+}
+
+void Shader::drawCommands(const IndirectDraws& draws, size_t batch)
+{
+    // the matrices come with the draws, the rest of the draw block is shared by the run
+    drawUniforms.model = glm::mat4(1.0f);
+    UniformRing::bind(kDrawBlockBinding, uniformRing->push(drawUniforms));
+    _shader->setUniformBool("gpuDriven", true);
+    draws.drawBatch(batch);
+    _shader->setUniformBool("gpuDriven", false);
+}
+
+void Shader::endPass()
+{
+    _shader->unuse();
+}
+
+void PhongShader::beginPass()
+{
+    _shader->use();
+    if(_options->useShadow) _shader->setUniformInt("shadowMap", 0);
+}
+
+void PhongShader::updateFrameUniforms(FrameUniforms& frame) const
+{
+    frame.lightSpaceMatrix = lightSpaceMatrix;
 }
 void PhongShader::renderBackground()
 {
@@ -85,20 +240,12 @@ void PhongShader::renderBackground()
     material.kd = glm::vec3(0.5f, 0.5f, 0.5f);
     material.ks = glm::vec3(0.0f, 0.0f, 0.0f);
 
-    glm::mat4 model = glm::mat4(1.0f);
+    DrawUniforms draw = {};
+    draw.model = glm::mat4(1.0f);
+    draw.material = getMaterialUniforms(material);
     _shader->use();
-    _shader->setUniformMat4("model", model);
-
-    _shader->setUniformVec3("material.ambient", material.ka);
-    _shader->setUniformVec3("material.diffuse", material.kd);
-    _shader->setUniformVec3("material.specular", material.ks);
-    _shader->setUniformFloat("material.shininess", material.ns);
+    UniformRing::bind(kDrawBlockBinding, uniformRing->push(draw));
 
-    _shader->setUniformBool("use_texture_kd", false);
-    _shader->setUniformBool("use_texture_ks", false);
-    _shader->setUniformBool("use_texture_normal", false);
-
-    _shader->setUniformBool("use_shadow", _options->useShadow);
     _shader->setUniformInt("shadowMap", 0);
     glBindVertexArray(planeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -157,36 +304,45 @@ void PhongShader::genDepthMap(const DirectionalLight& l, std::unique_ptr<Perspec
 
     // render scene from light's point of view
     _shadowShader->use();
-    _shadowShader->setUniformMat4("lightSpaceMatrix", lightSpaceMatrix);
+    bindShadowView(lightSpaceMatrix);
+    const float texelsPerUnit = getShadowTexelsPerUnit(lightSpaceMatrix, SHADOW_WIDTH);
 
     glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
     glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
     glClear(GL_DEPTH_BUFFER_BIT);
+    RenderStats::getFrame().shadowMaps.emplace_back();
+    //the casters toward the light outside the volume are culled with it open, their depth is clamped to the near plane
+    glEnable(GL_DEPTH_CLAMP);
 
     //render scene from light perspective
     //render models
-    if (_options->displayFacet)
+    if (_options->displayFacet && !renderGpuShadowCasters(models, lightSpaceMatrix))
     {
-        for (const auto& model : models)
+        const bool culled = cullShadowCasters(models, lightSpaceMatrix);
+        for (size_t i = 0; i < models.size(); i++)
         {
-            if (model.display == false)
+            const AssimpModel& model = models[i];
+            if (model.display == false || (culled && !shadowVisibility.isModelVisible(i)))
                 continue;
-            _shadowShader->setUniformMat4("model", model.transform.getLocalMatrix());
-            for (const auto& mesh : model.meshes)
+            const float pixelsPerUnit = model.getPixelsPerUnit(model.getWorldMatrix(*graph), _camera->transform.position, _camera->fovy, static_cast<float>(screenHeight));
+            for (size_t m = 0; m < model.meshes.size(); m++)
             {
-
-                // draw mesh
-                glBindVertexArray(mesh.VAO);
-                glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
-                glBindVertexArray(0);
+                const Mesh& mesh = model.meshes[m];
+                if (culled && !shadowVisibility.getMeshes(i)[m])
+                    continue;
+                addShadowCaster(mesh, model.getMeshMatrix(*graph, m), selectShadowLod(mesh, pixelsPerUnit, texelsPerUnit));
             }
         }
+        renderShadowObjects(models, lightSpaceMatrix, texelsPerUnit);
+        drawShadowCasters();
     }
     //render background
-    _shadowShader->setUniformMat4("model", glm::mat4(1.0f));
+    bindShadowDraw(glm::mat4(1.0f));
     glBindVertexArray(planeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
+    countShadowDraw(2);
+    glDisable(GL_DEPTH_CLAMP);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -196,91 +352,49 @@ void PhongShader::genDepthMap(const DirectionalLight& l, std::unique_ptr<Perspec
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-void CSMShader::renderFacet(const AssimpModel& model)
+void CSMShader::renderFacet(const AssimpModel& model, const uint8_t* visibleMeshes)
 {
     if (_options->useShadow && _options->CSMDebug)
     {
         this->renderDubugInfo();
         return;
     }
+    Shader::renderFacet(model, visibleMeshes);
+}
 
-    for (const auto& mesh : model.meshes) {
-        // bind appropriate textures
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
-
-        const PhongMaterial* material = static_cast<PhongMaterial*>(model.facetMaterial.get());
-        _shader->use();
-        _shader->setUniformVec3("material.ambient", material->ka);
-        _shader->setUniformVec3("material.diffuse", material->kd);
-        _shader->setUniformVec3("material.specular", material->ks);
-        _shader->setUniformFloat("material.shininess", material->ns);
-        _shader->setUniformBool("LayerVisulization", _options->CSMLayerVisulization);
-        _shader->setUniformMat4("model", model.transform.getLocalMatrix());
-
-        for (int i = 0; i < lightspace_matrics.size(); i++) {
-            _shader->setUniformMat4("lightSpaceMatrices[" + std::to_string(i) + "]", lightspace_matrics[i]);
-            if (i < shadowCascadeLevels.size()) _shader->setUniformFloat("cascadePlaneDistances[" + std::to_string(i) + "]", shadowCascadeLevels[i]);
-        }
-        _shader->setUniformInt("cascadeCount", shadowCascadeLevels.size());
-
-        bool use_texture_kd = false;
-        bool use_texture_ks = false;
-        bool use_texture_normal = false;
-        bool use_texture_height = false;
-
-        for (unsigned int i = 0; i < mesh.textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i + 1); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = mesh.textures[i].type;
-            if (name == "texture_diffuse")
-            {
-                number = std::to_string(diffuseNr++);
-                use_texture_kd = true;
-            }
-            else if (name == "texture_specular")
-            {
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-                use_texture_ks = true;
-            }
-            else if (name == "texture_normal")
-            {
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-                use_texture_normal = true;
-            }
-            else if (name == "texture_height")
-            {
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-                use_texture_height = true;
-            }
-
-            // now set the sampler to the correct texture unit
-            _shader->setUniformInt((name + number).c_str(), i + 1);
-
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
-        }
-
-        _shader->setUniformBool("use_texture_kd", use_texture_kd);
-        _shader->setUniformBool("use_texture_ks", use_texture_ks);
-        _shader->setUniformBool("use_texture_normal", _options->useNormalMap && use_texture_normal);
-
-        _shader->setUniformInt("shadowMap", 0);
+void CSMShader::renderObjects(const std::vector<AssimpModel>& models, const ObjectVisibility& visibility)
+{
+    // the debug view shows the shadow maps instead of the scene
+    if (_options->useShadow && _options->CSMDebug)
+        return;
+    Shader::renderObjects(models, visibility);
+}
 
-        // draw mesh
-        glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+void CSMShader::renderBatches(const std::vector<AssimpModel>& models)
+{
+    if (_options->useShadow && _options->CSMDebug)
+    {
+        this->renderDubugInfo();
+        return;
+    }
+    Shader::renderBatches(models);
+}
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+void CSMShader::beginPass()
+{
+    _shader->use();
+    _shader->setUniformInt("shadowMap", 0);
+}
 
-        _shader->unuse();
-    }
+void CSMShader::updateFrameUniforms(FrameUniforms& frame) const
+{
+    frame.layerVisualization = _options->CSMLayerVisulization;
+    const size_t count = std::min<size_t>(lightspace_matrics.size(), kMaxCascades);
+    std::copy(lightspace_matrics.begin(), lightspace_matrics.begin() + count, frame.lightSpaceMatrices);
+    const size_t levels = std::min(shadowCascadeLevels.size(), count);
+    for (size_t i = 0; i < levels; i++)
+        frame.cascadePlaneDistances[i] = glm::vec4(shadowCascadeLevels[i], 0.0f, 0.0f, 0.0f);
+    frame.cascadeCount = static_cast<int32_t>(levels);
 }
 void CSMShader::renderBackground()
 {
@@ -291,27 +405,14 @@ void CSMShader::renderBackground()
     material.kd = glm::vec3(0.5f, 0.5f, 0.5f);
     material.ks = glm::vec3(0.0f, 0.0f, 0.0f);
 
-    glm::mat4 model = glm::mat4(1.0f);
+    DrawUniforms draw = {};
+    draw.model = glm::mat4(1.0f);
+    draw.material = getMaterialUniforms(material);
     _shader->use();
-    _shader->setUniformMat4("model", model);
-
-    _shader->setUniformVec3("material.ambient", material.ka);
-    _shader->setUniformVec3("material.diffuse", material.kd);
-    _shader->setUniformVec3("material.specular", material.ks);
-    _shader->setUniformFloat("material.shininess", material.ns);
-
-    _shader->setUniformBool("use_texture_kd", false);
-    _shader->setUniformBool("use_texture_ks", false);
-    _shader->setUniformBool("use_texture_normal", false);
+    UniformRing::bind(kDrawBlockBinding, uniformRing->push(draw));
 
     _shader->setUniformInt("shadowMap", 0);
 
-    for (int i = 0; i < lightspace_matrics.size(); i++) {
-        _shader->setUniformMat4("lightSpaceMatrices[" + std::to_string(i) + "]", lightspace_matrics[i]);
-        if (i < shadowCascadeLevels.size()) _shader->setUniformFloat("cascadePlaneDistances[" + std::to_string(i) + "]", shadowCascadeLevels[i]);
-    }
-    _shader->setUniformInt("cascadeCount", shadowCascadeLevels.size());
-
     glBindVertexArray(planeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
@@ -351,6 +452,8 @@ void CSMShader::genDepthMap(const DirectionalLight& l, std::unique_ptr<Perspecti
     glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    //the casters toward the light outside a cascade are culled with it open, their depth is clamped to the near plane
+    glEnable(GL_DEPTH_CLAMP);
     for (int i = 0; i < lightspace_matrics.size(); i++) {
         //Bind depth map to frame buffer
         glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
@@ -362,38 +465,47 @@ void CSMShader::genDepthMap(const DirectionalLight& l, std::unique_ptr<Perspecti
         //render depth of scene to texture (from light's perspective)
 
         glm::mat4 lightSpaceMatrix = lightspace_matrics[i];
+        // farther cascades cover more of the scene with the same texels and get coarser levels
+        const float texelsPerUnit = getShadowTexelsPerUnit(lightSpaceMatrix, SHADOW_WIDTH);
 
         // render scene from light's point of view
         _shadowShader->use();
-        _shadowShader->setUniformMat4("lightSpaceMatrix", lightSpaceMatrix);
+        bindShadowView(lightSpaceMatrix);
 
         glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
         glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
         glClear(GL_DEPTH_BUFFER_BIT);
+        RenderStats::getFrame().shadowMaps.emplace_back();
 
         //render scene from light perspective
         //render models
-        if (_options->displayFacet)
+        if (_options->displayFacet && !renderGpuShadowCasters(models, lightSpaceMatrix))
         {
-            for (const auto& model : models)
+            const bool culled = cullShadowCasters(models, lightSpaceMatrix);
+            for (size_t m = 0; m < models.size(); m++)
             {
-                if (model.display == false)
+                const AssimpModel& model = models[m];
+                if (model.display == false || (culled && !shadowVisibility.isModelVisible(m)))
                     continue;
-                _shadowShader->setUniformMat4("model", model.transform.getLocalMatrix());
-                for (const auto& mesh : model.meshes)
+                const float pixelsPerUnit = model.getPixelsPerUnit(model.getWorldMatrix(*graph), _camera->transform.position, _camera->fovy, static_cast<float>(screenHeight));
+                const uint8_t* visibleMeshes = culled ? shadowVisibility.getMeshes(m) : nullptr;
+                for (size_t j = 0; j < model.meshes.size(); j++)
                 {
-                    // draw mesh
-                    glBindVertexArray(mesh.VAO);
-                    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
-                    glBindVertexArray(0);
+                    const Mesh& mesh = model.meshes[j];
+                    if (visibleMeshes && !visibleMeshes[j])
+                        continue;
+                    addShadowCaster(mesh, model.getMeshMatrix(*graph, j), selectShadowLod(mesh, pixelsPerUnit, texelsPerUnit));
                 }
             }
+            renderShadowObjects(models, lightSpaceMatrix, texelsPerUnit);
+            drawShadowCasters();
         }
         //render background
-        _shadowShader->setUniformMat4("model", glm::mat4(1.0f));
+        bindShadowDraw(glm::mat4(1.0f));
         glBindVertexArray(planeVAO);
         glDrawArrays(GL_TRIANGLES, 0, 6);
         glBindVertexArray(0);
+        countShadowDraw(2);
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         _shadowShader->unuse();
@@ -402,7 +514,7 @@ void CSMShader::genDepthMap(const DirectionalLight& l, std::unique_ptr<Perspecti
         //reset view port
         glViewport(0, 0, screenWidth, screenHeight);
     }
-
+    glDisable(GL_DEPTH_CLAMP);
 }
 
 glm::mat4 CSMShader::getLightSpaceMatrix(const float nearPlane, const float farPlane, std::unique_ptr<PerspectiveCamera>& _camera, const DirectionalLight& l)
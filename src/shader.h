@@ -4,7 +4,15 @@
 #include "model.h"
 #include "base/camera.h"
 #include "base/light.h"
-class Shader
+#include "render_stats.h"
+#include "scene_culling.h"
+#include "scene_objects.h"
+#include "occlusion_culling.h"
+#include "gpu_culling.h"
+#include "render_queue.h"
+#include "uniform_blocks.h"
+#include "base/uniform_ring.h"
+class Shader : public RenderPass
 {
 public:
 	std::unique_ptr<GLSLProgram> _shader;
@@ -17,6 +25,40 @@ public:
 
 	std::shared_ptr<UIOptions> _options;
 
+	//camera of the current frame, for meshlet culling
+	Frustum cameraFrustum;
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+	//vertical field of view of the current frame, for lod selection
+	float cameraFovy = glm::radians(45.0f);
+
+	//world matrices of the scene, updated for the current frame
+	const SceneGraph* graph = nullptr;
+	//world boxes of the scene for culling the shadow casters, null if frustum culling is off
+	const SceneCulling* culling = nullptr;
+	//casters inside the light volume, reused between frames
+	Visibility shadowVisibility;
+	//placed copies of the models, drawn after them. null if the scene has none
+	const SceneObjects* objects = nullptr;
+	//copies inside the light volume, reused between frames
+	ObjectVisibility shadowObjects;
+	//occluders of the camera for the meshlets, null if occlusion culling is off
+	const OcclusionCulling* occlusion = nullptr;
+	//rasterizes the occluders of every shadow pass, null if occlusion culling is off
+	OcclusionCulling* shadowOcclusion = nullptr;
+	//draws of the models and copies culled on the GPU, null if GPU culling is off
+	GpuCulling* gpuCulling = nullptr;
+	//batch of gpuCulling that drawMesh submits inside renderBatches
+	static constexpr size_t kNoBatch = ~size_t(0);
+	size_t gpuBatch = kNoBatch;
+	//collects the meshes of renderFacet and renderObjects for the renderer to sort and submit, null draws them at once
+	RenderQueue* renderQueue = nullptr;
+	//ring the draw blocks are pushed to, owned by the renderer. it binds the frame and view blocks of the main view
+	UniformRing* uniformRing = nullptr;
+	//draw block of the pass, the stages fill it and drawItem pushes it
+	DrawUniforms drawUniforms = {};
+	//casters of the shadow map being rendered, one multi draw per vertex array, see addShadowCaster
+	IndirectDraws shadowDraws;
+
 	Shader(int width, int height, const std::string& shaderBasePath, const std::string vs_path, const std::string fs_path, const std::string gs_path = std::string(""))
 	{
 		screenWidth = width;
@@ -31,6 +73,7 @@ public:
 		_shader->attachFragmentShaderFromFile(FragShaderRelPath);
 		if(!gs_path.empty()) _shader->attachGeometryShaderFromFile(GeomShaderRelPath);
 		_shader->link();
+		bindUniformBlocks(*_shader);
 	}
 
 	void setBackgroundVAOVBO(GLuint vao, GLuint vbo)
@@ -43,35 +86,145 @@ public:
 		screenHeight = height, screenWidth = width;
 	}
 
-	virtual void updateLight(const DirectionalLight& light)
+	//the shadow maps of the frame in the frame block, after genDepthMap
+	virtual void updateFrameUniforms(FrameUniforms& /*frame*/) const {}
+	//the camera itself is in the view block the renderer binds
+	virtual void updateCamera(unique_ptr<PerspectiveCamera>& camera)
 	{
-		const std::string lightStr = "dLight";
-		_shader->use();
-		_shader->setUniformVec3(lightStr + ".direction", light.direction);
-		_shader->setUniformVec3(lightStr + ".ambient", light.color);
-		_shader->setUniformVec3(lightStr + ".diffuse", light.color);
-		_shader->setUniformVec3(lightStr + ".specular", light.color);
-		_shader->setUniformFloat(lightStr + ".intensity", light.intensity);
-		_shader->unuse();
+		cameraFrustum = camera->getFrustum();
+		cameraPosition = camera->transform.position;
+		cameraFovy = camera->fovy;
 	}
-	virtual void updateCamera(unique_ptr<PerspectiveCamera>& camera)
+	//level of detail of a mesh in the main view, pixelsPerUnit from AssimpModel::getPixelsPerUnit
+	size_t selectLod(const Mesh& mesh, float pixelsPerUnit) const
+	{
+		return _options->adaptiveLod ? mesh.selectLod(pixelsPerUnit, _options->lodErrorPixels) : 0;
+	}
+	//level of detail of a shadow caster. the error is measured in the coarser of view pixels and shadow map
+	//texels and may be shadowLodScale times larger than in the main view
+	size_t selectShadowLod(const Mesh& mesh, float pixelsPerUnit, float texelsPerUnit) const
 	{
-		_shader->use();
-		_shader->setUniformMat4("projection", camera->getProjectionMatrix());
-		_shader->setUniformMat4("view", camera->getViewMatrix());
-		_shader->setUniformVec3("viewPos", camera->transform.position);
-		_shader->unuse();
+		if (!_options->adaptiveLod)
+			return 0;
+		return mesh.selectLod(std::min(pixelsPerUnit, texelsPerUnit), _options->lodErrorPixels * _options->shadowLodScale);
+	}
+	//texels per world unit of a shadow map rendered with an orthographic lightSpaceMatrix
+	static float getShadowTexelsPerUnit(const glm::mat4& lightSpaceMatrix, GLuint shadowWidth)
+	{
+		const glm::vec3 row = glm::vec3(lightSpaceMatrix[0][0], lightSpaceMatrix[1][0], lightSpaceMatrix[2][0]);
+		return 0.5f * shadowWidth * glm::length(row);
 	}
 	virtual void setRenderOptions(const UIOptions& options)
 	{
 		_options = std::make_shared<UIOptions>(options);
 	}
-	virtual void renderFacet(const AssimpModel& model) = 0;
+	//draws mesh m of model at meshMatrix with material through every stage of the pass, the lod from pixelsPerUnit of the model
+	virtual void renderMesh(const AssimpModel& model, size_t m, const glm::mat4& meshMatrix, const PhongMaterial& material, float pixelsPerUnit);
+	//queues mesh m of model to renderQueue, or draws it with renderMesh without one
+	void addMesh(const AssimpModel& model, size_t m, const glm::mat4& meshMatrix, const PhongMaterial& material, float pixelsPerUnit);
+	//the stages of renderMesh and of the render queue, beginPass is the one of the shader
+	void setMaterial(const PhongMaterial& material) override;
+	void setTextures(const Mesh& mesh) override;
+	void setVertexArray(const Mesh& mesh) override;
+	void drawItem(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit) override;
+	void addCommands(const Mesh& mesh, const glm::mat4& matrix, float pixelsPerUnit, uint32_t drawId,
+		std::vector<DrawElementsIndirectCommand>& commands) override;
+	void drawCommands(const IndirectDraws& draws, size_t batch) override;
+	void endPass() override;
+	//visibleMeshes flags the meshes to draw, indexed like model.meshes. null draws all of them
+	virtual void renderFacet(const AssimpModel& model, const uint8_t* visibleMeshes = nullptr);
+	//draws the visible objects, every mesh of their model
+	virtual void renderObjects(const std::vector<AssimpModel>& models, const ObjectVisibility& visibility);
+	//draws every batch of gpuCulling through renderMesh, after GpuCulling::cull
+	virtual void renderBatches(const std::vector<AssimpModel>& models);
 	virtual void renderBackground() = 0;
 	virtual void genDepthMap(const DirectionalLight& l, std::unique_ptr<PerspectiveCamera>& _camera, const std::vector<AssimpModel>& models){} //default gen no shadow map
 	virtual void deleteBuffer(){}
+
+	//culls the shadow casters against the volume of lightSpaceMatrix, open toward the light, and the occluders
+	//seen from the light, false if culling is off. a caster hidden from the light adds no texel the occluders do not cover already
+	bool cullShadowCasters(const std::vector<AssimpModel>& models, const glm::mat4& lightSpaceMatrix)
+	{
+		if (culling == nullptr)
+			return false;
+		culling->cull(Frustum::fromShadowMatrix(lightSpaceMatrix), shadowVisibility);
+		if (shadowOcclusion != nullptr)
+		{
+			shadowOcclusion->render(models, *graph, objects, nullptr, lightSpaceMatrix);
+			RenderStats::getFrame().shadowOccluded += shadowOcclusion->cull(models, *graph, shadowVisibility);
+		}
+		return true;
+	}
+	//binds the view block of the shadow map of lightSpaceMatrix for _shadowShader
+	void bindShadowView(const glm::mat4& lightSpaceMatrix)
+	{
+		ViewUniforms view = {};
+		view.projection = lightSpaceMatrix;
+		view.view = glm::mat4(1.0f);
+		UniformRing::bind(kViewBlockBinding, uniformRing->push(view));
+	}
+	//binds the draw block of a shadow caster at matrix for _shadowShader
+	void bindShadowDraw(const glm::mat4& matrix)
+	{
+		DrawUniforms draw = {};
+		draw.model = matrix;
+		UniformRing::bind(kDrawBlockBinding, uniformRing->push(draw));
+	}
+	//counts draw calls of triangles into the shadow map being rendered, the last of RenderStats::shadowMaps
+	static void countShadowDraw(size_t triangles, size_t draws = 1)
+	{
+		RenderStats& stats = RenderStats::getFrame();
+		stats.shadowTriangles += triangles;
+		stats.shadowMaps.back().draws += draws;
+		stats.shadowMaps.back().triangles += triangles;
+	}
+	//draws level of mesh at matrix into the shadow map being rendered with _shadowShader in use, or adds it to
+	//shadowDraws for drawShadowCasters with multiDraw
+	void addShadowCaster(const Mesh& mesh, const glm::mat4& matrix, size_t level)
+	{
+		if (_options->multiDraw)
+		{
+			countShadowDraw(shadowDraws.addLod(mesh, matrix, level), 0);
+			return;
+		}
+		bindShadowDraw(matrix);
+		glBindVertexArray(mesh.VAO);
+		countShadowDraw(mesh.drawLod(level));
+		glBindVertexArray(0);
+	}
+	//submits the casters of shadowDraws and empties it, _shadowShader in use
+	void drawShadowCasters();
+	//draws the meshlets of LOD0 the camera sees, the VAO of mesh has to be bound. returns the triangles drawn
+	size_t drawVisibleMeshlets(const Mesh& mesh, const glm::mat4& meshMatrix) const
+	{
+		if (occlusion == nullptr)
+			return mesh.drawVisible(cameraFrustum, meshMatrix, cameraPosition);
+		return mesh.drawVisible(cameraFrustum, meshMatrix, cameraPosition, &occlusion->getBuffer(), occlusion->getViewProjection());
+	}
+	//draws the level of mesh for pixelsPerUnit, or the visible meshlets of LOD0, or the culled draws of gpuBatch.
+	//the VAO of mesh has to be bound and _shader in use
+	void drawMesh(const Mesh& mesh, const glm::mat4& meshMatrix, float pixelsPerUnit)
+	{
+		if (gpuBatch != kNoBatch)
+		{
+			gpuCulling->drawBatch(gpuBatch);
+			return;
+		}
+		const size_t level = selectLod(mesh, pixelsPerUnit);
+		if (_options->meshletCulling && level == 0)
+			RenderStats::getFrame().triangles += drawVisibleMeshlets(mesh, meshMatrix);
+		else
+			RenderStats::getFrame().triangles += mesh.drawLod(level);
+	}
+	//culls the draws of gpuCulling against the volume of lightSpaceMatrix and draws them with _shadowShader in use,
+	//false if GPU culling is off. the shadows draw LOD0, the levels are chosen per draw on the CPU only
+	bool renderGpuShadowCasters(const std::vector<AssimpModel>& models, const glm::mat4& lightSpaceMatrix);
+	//draws the objects inside the volume of lightSpaceMatrix (all displayed ones if culling is off) with _shadowShader,
+	//through addShadowCaster
+	void renderShadowObjects(const std::vector<AssimpModel>& models, const glm::mat4& lightSpaceMatrix, float texelsPerUnit);
 };
 
+
 class PhongShader : public Shader
 {
 public:
@@ -80,7 +233,10 @@ public:
 	{
 		initShadowShader(shaderBasePath);
 	}
-	virtual void renderFacet(const AssimpModel& model);
+	//the shadow map
+	void beginPass() override;
+	//lightSpaceMatrix
+	void updateFrameUniforms(FrameUniforms& frame) const override;
 	virtual void renderBackground();
 	~PhongShader()
 	{
@@ -96,6 +252,7 @@ public:
 		_shadowShader->attachVertexShaderFromFile(shadowVertShaderRelPath);
 		_shadowShader->attachFragmentShaderFromFile(shadowFragShaderRelPath);
 		_shadowShader->link();
+		bindUniformBlocks(*_shadowShader);
 	}
 
 	//depth map resolution
@@ -146,6 +303,7 @@ public:
 		_shadowShader->attachVertexShaderFromFile(shadowVertShaderRelPath);
 		_shadowShader->attachFragmentShaderFromFile(shadowFragShaderRelPath);
 		_shadowShader->link();
+		bindUniformBlocks(*_shadowShader);
 	}
 
 	void initOtherShader(const std::string& shaderBasePath)
@@ -167,7 +325,14 @@ public:
 		initShadowShader(shaderBasePath);
 		initOtherShader(shaderBasePath);
 	}
-	virtual void renderFacet(const AssimpModel& model);
+	//the debug view draws the shadow maps in place of the models
+	virtual void renderFacet(const AssimpModel& model, const uint8_t* visibleMeshes = nullptr);
+	virtual void renderObjects(const std::vector<AssimpModel>& models, const ObjectVisibility& visibility);
+	virtual void renderBatches(const std::vector<AssimpModel>& models);
+	//the shadow map array
+	void beginPass() override;
+	//the cascades
+	void updateFrameUniforms(FrameUniforms& frame) const override;
 	virtual void renderBackground();
 	virtual void deleteBuffer()
 	{
@@ -66,10 +66,37 @@ void UI::SceneManagementGUI(Scene& scene, unique_ptr<PerspectiveCamera>& camera)
     {
         if (ImGui::BeginTabItem("Models"))
         {
+            //show picked model
+            if (picked_model >= 0)
+            {
+                if (picked_hit.triangle != RayHit::kNoTriangle)
+                    ImGui::Text("Picked: model %d, mesh %zu, triangle %u", picked_model, picked_hit.mesh, picked_hit.triangle);
+                else
+                    ImGui::Text("Picked: model %d, mesh %zu (bounds)", picked_model, picked_hit.mesh);
+                ImGui::Separator();
+            }
+
             //show model property
+            int removed = -1;
             for (int i = 0; i < scene.models.size(); i++) {
+                if (picked_changed && i == picked_model)
+                    ImGui::SetNextItemOpen(true);
                 if (ImGui::TreeNode(("model " + std::to_string(i)).c_str()))
                 {
+                    if (ImGui::Button("Remove"))
+                    {
+                        removed = i;
+                    }
+                    //copies share the meshes and textures of the model
+                    ImGui::SameLine();
+                    if (ImGui::Button("Scatter 1000 copies"))
+                    {
+                        scene.scatterObjects(i, 1000);
+                    }
+                    ImGui::Text("Copies: %zu", scene.objects.getObjectCount(i));
+                    //only meshes with positions on the CPU are rasterized
+                    ImGui::Checkbox("Occluder", &scene.models[i].occluder);
+
                     ImVec4 temp;
                     glm::vec3* t = nullptr;
                     t = &scene.models[i].transform.position;
@@ -90,6 +117,26 @@ void UI::SceneManagementGUI(Scene& scene, unique_ptr<PerspectiveCamera>& camera)
                     ImGui::TreePop();
                 }
             }
+            picked_changed = false;
+            if (removed >= 0)
+            {
+                scene.removeFromScene(removed);
+                if (removed == picked_model)
+                    clearPicked();
+                else if (removed < picked_model)
+                    picked_model--;
+            }
+
+            //show shared texture memory
+            const TextureCache& textures = TextureCache::getGlobal();
+            ImGui::Separator();
+            ImGui::Text("Textures: %zu resident, %.1f MB", textures.getTextureCount(),
+                textures.getResidentBytes() / (1024.0 * 1024.0));
+            ImGui::Text("Texture cache: %zu hits, %zu misses", textures.getHitCount(), textures.getMissCount());
+            //show the vertex and index megabuffers the meshes share
+            const GeometryPool& geometry = GeometryPool::getGlobal();
+            ImGui::Text("Geometry: %zu meshes, %.1f of %.1f MB", geometry.getRangeCount(),
+                geometry.getUsedBytes() / (1024.0 * 1024.0), geometry.getCapacityBytes() / (1024.0 * 1024.0));
             ImGui::EndTabItem();
         }
         if (ImGui::BeginTabItem("Cameras"))
@@ -172,6 +219,10 @@ void UI::SceneManagementGUI(Scene& scene, unique_ptr<PerspectiveCamera>& camera)
                     ImGui::SliderFloat("Constant", (float*)&scene.pointLights[i].kc, 0.001f, 1.0f);
                     ImGui::SliderFloat("Linear", (float*)&scene.pointLights[i].kl, 0.001f, 1.0f);
                     ImGui::SliderFloat("Quadratic", (float*)&scene.pointLights[i].kq, 0.001f, 1.0f);
+
+                    std::vector<size_t> lit;
+                    scene.getLitModels(scene.pointLights[i], lit);
+                    ImGui::Text("Range %.1f, lit models: %zu", scene.pointLights[i].getRange(), lit.size());
                     ImGui::Separator();
 
                     ImGui::TreePop();
@@ -399,6 +450,60 @@ void UI::SceneOptionGUI(Scene& scene, UIOptions& options)
         ImGui::SetCursorPosX(IG_RT_W - 400);
         ImGui::Checkbox("Use", &options.useNormalMap);
 
+        ImGui::Text("Meshlet Culling: ");
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(IG_RT_W - 400);
+        ImGui::Checkbox("Cull", &options.meshletCulling);
+
+        ImGui::Text("Frustum Culling: ");
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(IG_RT_W - 400);
+        ImGui::Checkbox("Enable##frustum", &options.frustumCulling);
+        if (options.frustumCulling)
+        {
+            ImGui::SameLine();
+            ImGui::Checkbox("BVH", &options.bvhCulling);
+            ImGui::SameLine();
+            ImGui::Checkbox("Occlusion", &options.occlusionCulling);
+        }
+
+        ImGui::Text("GPU Culling: ");
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(IG_RT_W - 400);
+        ImGui::Checkbox("Enable##gpu", &options.gpuCulling);
+
+        ImGui::Text("Render Queue: ");
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(IG_RT_W - 400);
+        ImGui::Checkbox("Sort##queue", &options.renderQueue);
+        ImGui::SameLine();
+        ImGui::Checkbox("Multi Draw", &options.multiDraw);
+
+        ImGui::Text("Level of Detail: ");
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(IG_RT_W - 400);
+        ImGui::Checkbox("Adaptive", &options.adaptiveLod);
+        if (options.adaptiveLod)
+        {
+            ImGui::SliderFloat("Error (px)", &options.lodErrorPixels, 0.25f, 16.0f);
+            ImGui::SliderFloat("Shadow Error Scale", &options.shadowLodScale, 1.0f, 16.0f);
+        }
+        const RenderStats& stats = RenderStats::getFrame();
+        ImGui::Text("Triangles: %zu view, %zu shadow", stats.triangles, stats.shadowTriangles);
+        for (size_t i = 0; i < stats.shadowMaps.size(); i++)
+            ImGui::Text("  Shadow map %zu: %zu draws, %zu triangles", i, stats.shadowMaps[i].draws, stats.shadowMaps[i].triangles);
+        ImGui::Text("Visible: %zu models, %zu meshes, %zu objects", stats.visibleModels, stats.visibleMeshes, stats.visibleObjects);
+        if (options.frustumCulling && options.occlusionCulling)
+            ImGui::Text("Occluded: %zu view, %zu shadow, %zu occluder triangles", stats.occluded, stats.shadowOccluded, stats.occluderTriangles);
+        if (options.gpuCulling)
+            ImGui::Text("GPU draws: %zu before culling", stats.gpuDraws);
+        ImGui::Text("Binds: %zu programs, %zu textures, %zu vertex arrays", stats.programBinds, stats.textureBinds, stats.vertexArrayBinds);
+        if (options.renderQueue && options.multiDraw)
+            ImGui::Text("Multi draws: %zu", stats.multiDraws);
+        ImGui::Text("Uniform blocks: %.1f KB", stats.uniformBytes / 1024.0f);
+        if (stats.lights > 0)
+            ImGui::Text("Lights: %zu clustered, %zu in cluster lists", stats.lights, stats.lightIndices);
+
         ImGui::Text("Log Level: ");
         ImGui::SameLine();
         ImGui::SetCursorPosX(IG_RT_W - 400);
@@ -449,6 +554,10 @@ void UI::SceneOptionGUI(Scene& scene, UIOptions& options)
             if (ImGui::RadioButton("CSM", options.fShaderType == ForwardShaderType::CSM)) {
                 options.fShaderType = ForwardShaderType::CSM;
             }
+            ImGui::SameLine();
+            if (ImGui::RadioButton("Forward+", options.fShaderType == ForwardShaderType::ForwardPlus)) {
+                options.fShaderType = ForwardShaderType::ForwardPlus;
+            }
             ImGui::Text("Shadow: ");
             ImGui::SameLine();
             ImGui::SetCursorPosX(IG_RT_W - 400);
@@ -472,6 +581,10 @@ void UI::SceneOptionGUI(Scene& scene, UIOptions& options)
             if (ImGui::RadioButton("displayGbuffer", options.dShaderType == DeferredShaderType::GBufferDisplay)) {
                 options.dShaderType = DeferredShaderType::GBufferDisplay;
             }
+            ImGui::SameLine();
+            if (ImGui::RadioButton("clusteredLighting", options.dShaderType == DeferredShaderType::ClusteredLighting)) {
+                options.dShaderType = DeferredShaderType::ClusteredLighting;
+            }
 
             if (options.dShaderType == DeferredShaderType::GBufferDisplay)
             {
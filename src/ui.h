@@ -4,6 +4,7 @@
 #include <imgui_impl_opengl3.h>
 
 #include "ui_options.h"
+#include "render_stats.h"
 #include "model.h"
 #include "scene.h"
 #include "base/camera.h"
@@ -38,6 +39,24 @@ public:
     bool show_body    = true;
     bool show_option  = true;
 
+    // model picked in the viewport, -1 for none
+    int picked_model = -1;
+    RayHit picked_hit;
+    // the tree node of the picked model opens once
+    bool picked_changed = false;
+
+    void setPicked(const RayHit& hit)
+    {
+        picked_model = static_cast<int>(hit.model);
+        picked_hit = hit;
+        picked_changed = true;
+    }
+
+    void clearPicked()
+    {
+        picked_model = -1;
+    }
+
     bool wantCaptureMouse() const;
 
     void SceneManagementGUI(Scene &scene, unique_ptr<PerspectiveCamera>& camera);
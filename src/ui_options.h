@@ -7,11 +7,15 @@ enum class RenderType {
 
 enum class ForwardShaderType {
     Phong,
-    CSM
+    CSM,
+    // phong with the point and spot lights of the scene, culled per cluster
+    ForwardPlus
 };
 
 enum class DeferredShaderType {
     GBufferDisplay,
+    // lights the gbuffer with the directional light and the point and spot lights culled per cluster
+    ClusteredLighting,
 };
 
 enum class GbufferDisplayType {
@@ -37,6 +41,27 @@ struct UIOptions
     bool CSMDebug = false;
     bool CSMLayerVisulization = false;
     bool displayNormal = false;
+    bool meshletCulling = true;
+    // skip models and meshes whose world box is outside the camera or light volume
+    bool frustumCulling = true;
+    // walk the bounding volume hierarchy of the scene instead of testing every box
+    bool bvhCulling = true;
+    // rasterize the occluder models on the CPU and skip what is behind them, needs frustum culling
+    bool occlusionCulling = true;
+    // cull the draws in a compute shader against the frustum and the depth of the last frame and submit the
+    // survivors with indirect multi draws, in place of the culling and the levels of detail on the CPU
+    bool gpuCulling = false;
+    // queue the draws of the main view and submit them sorted by program, textures, material and vertex array
+    bool renderQueue = true;
+    // submit the draws of a run of the render queue, and the shadow casters of a vertex format, with one indirect
+    // multi draw instead of one draw call each
+    bool multiDraw = true;
+    // pick a level of detail per model and frame from its projected size, LOD0 otherwise
+    bool adaptiveLod = true;
+    // screen space error a level of detail may have, in pixels
+    float lodErrorPixels = 1.0f;
+    // shadow casters may have this many times the error of the main view
+    float shadowLodScale = 4.0f;
 
     LogLevel logLevel = LogLevel::WARNING;
     RenderType renderType = RenderType::FORAWRD;
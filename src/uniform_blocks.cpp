@@ -0,0 +1,34 @@
+#include "uniform_blocks.h"
+
+#include <stdexcept>
+
+namespace
+{
+struct BlockBinding
+{
+    const GlslType* block;
+    GLuint binding;
+};
+
+constexpr BlockBinding kBlockBindings[] = {
+    { &kFrameBlock, kFrameBlockBinding }, { &kViewBlock, kViewBlockBinding }, { &kDrawBlock, kDrawBlockBinding } };
+} // namespace
+
+void registerUniformBlocks()
+{
+    GLSLProgram::setShaderInclude("uniform_blocks.glsl",
+        declareGlslBlocks({ &kFrameBlock, &kViewBlock, &kDrawBlock }, BlockLayout::Std140, "uniform"));
+}
+
+void bindUniformBlocks(const GLSLProgram& program)
+{
+    for (const BlockBinding& block : kBlockBindings)
+    {
+        if (program.getUniformBlockIndex(block.block->name) == -1)
+            continue;
+        const std::string error = checkUniformBlock(program, *block.block, BlockLayout::Std140);
+        if (!error.empty())
+            throw std::runtime_error("uniform block layout differs: " + error);
+        program.setUniformBlockBinding(block.block->name, block.binding);
+    }
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "base/block_layout.h"
+#include "base/glsl_program.h"
+#include "base/light.h"
+#include "material.h"
+
+// std140 uniform blocks of the scene shaders and their bindings. the blocks of a frame are pushed to the
+// UniformRing of the renderer and bound once for every program, the draw block once per draw with its range.
+// the shaders get the GLSL declarations generated from the member lists below with #include "uniform_blocks.glsl"
+
+// uniform block bindings, apart from the shader storage bindings
+constexpr GLuint kFrameBlockBinding = 0;
+constexpr GLuint kViewBlockBinding = 1;
+constexpr GLuint kDrawBlockBinding = 2;
+
+// cascades the CSM shaders declare, see CSMShader
+constexpr int kMaxCascades = 16;
+
+// DirectionalLight of the shaders
+struct LightUniforms
+{
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float intensity;
+};
+
+// Material of the shaders
+struct MaterialUniforms
+{
+    glm::vec3 ambient;
+    float pad0;
+    glm::vec3 diffuse;
+    float pad1;
+    glm::vec3 specular;
+    float shininess;
+};
+
+// FrameBlock: the light and the shadow maps, once per frame
+struct FrameUniforms
+{
+    LightUniforms dLight;
+    // the shadow map of PhongShader
+    glm::mat4 lightSpaceMatrix;
+    // the cascades of CSMShader, a float array has a stride of 16 bytes in std140, the distance is in x
+    glm::mat4 lightSpaceMatrices[kMaxCascades];
+    glm::vec4 cascadePlaneDistances[kMaxCascades];
+    int32_t cascadeCount;
+    uint32_t useShadow;
+    uint32_t layerVisualization;
+    uint32_t pad0;
+};
+
+// ViewBlock: the camera, or the light of a shadow map with its matrix as projection
+struct ViewUniforms
+{
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    float pad0;
+};
+
+// DrawBlock: the model matrix, the material and the flags of a draw
+struct DrawUniforms
+{
+    glm::mat4 model;
+    MaterialUniforms material;
+    uint32_t useTextureKd;
+    uint32_t useTextureKs;
+    uint32_t useTextureNormal;
+    uint32_t packedVertex;
+};
+
+// the GLSL members of the structs above, in the order of the C++ members
+inline constexpr GlslMember kLightMembers[] = {
+    {&kGlslVec3, "direction", 0, offsetof(LightUniforms, direction), sizeof(LightUniforms::direction)},
+    {&kGlslVec3, "ambient", 0, offsetof(LightUniforms, ambient), sizeof(LightUniforms::ambient)},
+    {&kGlslVec3, "diffuse", 0, offsetof(LightUniforms, diffuse), sizeof(LightUniforms::diffuse)},
+    {&kGlslVec3, "specular", 0, offsetof(LightUniforms, specular), sizeof(LightUniforms::specular)},
+    {&kGlslFloat, "intensity", 0, offsetof(LightUniforms, intensity), sizeof(LightUniforms::intensity)},
+};
+inline constexpr GlslType kLightType = makeGlslStruct("DirectionalLight", kLightMembers);
+
+inline constexpr GlslMember kMaterialMembers[] = {
+    {&kGlslVec3, "ambient", 0, offsetof(MaterialUniforms, ambient), sizeof(MaterialUniforms::ambient)},
+    {&kGlslVec3, "diffuse", 0, offsetof(MaterialUniforms, diffuse), sizeof(MaterialUniforms::diffuse)},
+    {&kGlslVec3, "specular", 0, offsetof(MaterialUniforms, specular), sizeof(MaterialUniforms::specular)},
+    {&kGlslFloat, "shininess", 0, offsetof(MaterialUniforms, shininess), sizeof(MaterialUniforms::shininess)},
+};
+inline constexpr GlslType kMaterialType = makeGlslStruct("Material", kMaterialMembers);
+
+// the distances are floats, whose std140 array stride of 16 bytes is the one of the glm::vec4 mirror
+inline constexpr GlslMember kFrameMembers[] = {
+    {&kLightType, "dLight", 0, offsetof(FrameUniforms, dLight), sizeof(FrameUniforms::dLight)},
+    {&kGlslMat4, "lightSpaceMatrix", 0, offsetof(FrameUniforms, lightSpaceMatrix), sizeof(FrameUniforms::lightSpaceMatrix)},
+    {&kGlslMat4, "lightSpaceMatrices", kMaxCascades, offsetof(FrameUniforms, lightSpaceMatrices), sizeof(FrameUniforms::lightSpaceMatrices)},
+    {&kGlslFloat, "cascadePlaneDistances", kMaxCascades, offsetof(FrameUniforms, cascadePlaneDistances), sizeof(FrameUniforms::cascadePlaneDistances)},
+    {&kGlslInt, "cascadeCount", 0, offsetof(FrameUniforms, cascadeCount), sizeof(FrameUniforms::cascadeCount)},
+    {&kGlslBool, "use_shadow", 0, offsetof(FrameUniforms, useShadow), sizeof(FrameUniforms::useShadow)},
+    {&kGlslBool, "LayerVisulization", 0, offsetof(FrameUniforms, layerVisualization), sizeof(FrameUniforms::layerVisualization)},
+};
+inline constexpr GlslType kFrameBlock = makeGlslStruct("FrameBlock", kFrameMembers);
+
+inline constexpr GlslMember kViewMembers[] = {
+    {&kGlslMat4, "projection", 0, offsetof(ViewUniforms, projection), sizeof(ViewUniforms::projection)},
+    {&kGlslMat4, "view", 0, offsetof(ViewUniforms, view), sizeof(ViewUniforms::view)},
+    {&kGlslVec3, "viewPos", 0, offsetof(ViewUniforms, viewPos), sizeof(ViewUniforms::viewPos)},
+};
+inline constexpr GlslType kViewBlock = makeGlslStruct("ViewBlock", kViewMembers);
+
+inline constexpr GlslMember kDrawMembers[] = {
+    {&kGlslMat4, "model", 0, offsetof(DrawUniforms, model), sizeof(DrawUniforms::model)},
+    {&kMaterialType, "material", 0, offsetof(DrawUniforms, material), sizeof(DrawUniforms::material)},
+    {&kGlslBool, "use_texture_kd", 0, offsetof(DrawUniforms, useTextureKd), sizeof(DrawUniforms::useTextureKd)},
+    {&kGlslBool, "use_texture_ks", 0, offsetof(DrawUniforms, useTextureKs), sizeof(DrawUniforms::useTextureKs)},
+    {&kGlslBool, "use_texture_normal", 0, offsetof(DrawUniforms, useTextureNormal), sizeof(DrawUniforms::useTextureNormal)},
+    {&kGlslBool, "packedVertex", 0, offsetof(DrawUniforms, packedVertex), sizeof(DrawUniforms::packedVertex)},
+};
+inline constexpr GlslType kDrawBlock = makeGlslStruct("DrawBlock", kDrawMembers);
+
+static_assert(matchesLayout<LightUniforms>(kLightType, BlockLayout::Std140), "LightUniforms differs from std140");
+static_assert(matchesLayout<MaterialUniforms>(kMaterialType, BlockLayout::Std140), "MaterialUniforms differs from std140");
+static_assert(matchesLayout<FrameUniforms>(kFrameBlock, BlockLayout::Std140), "FrameUniforms differs from std140");
+static_assert(matchesLayout<ViewUniforms>(kViewBlock, BlockLayout::Std140), "ViewUniforms differs from std140");
+static_assert(matchesLayout<DrawUniforms>(kDrawBlock, BlockLayout::Std140), "DrawUniforms differs from std140");
+
+inline LightUniforms getLightUniforms(const DirectionalLight& light)
+{
+    LightUniforms uniforms = {};
+    uniforms.direction = light.direction;
+    uniforms.ambient = light.color;
+    uniforms.diffuse = light.color;
+    uniforms.specular = light.color;
+    uniforms.intensity = light.intensity;
+    return uniforms;
+}
+
+inline MaterialUniforms getMaterialUniforms(const PhongMaterial& material)
+{
+    MaterialUniforms uniforms = {};
+    uniforms.ambient = material.ka;
+    uniforms.diffuse = material.kd;
+    uniforms.specular = material.ks;
+    uniforms.shininess = material.ns;
+    return uniforms;
+}
+
+// declares the structs and blocks above as the shader include "uniform_blocks.glsl", before the shaders compile
+void registerUniformBlocks();
+
+// binds the blocks program declares to their bindings after link, and throws if the offsets the program
+// reports for them differ from the structs above
+void bindUniformBlocks(const GLSLProgram& program);
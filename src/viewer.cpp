@@ -1,4 +1,6 @@
 #include "viewer.h"
+#include "benchmark.h"
+#include "spdlogMgr.h"
 
 Viewer::Viewer(const Options& options)
     : Application(options)
@@ -26,9 +28,13 @@ Viewer::Viewer(const Options& options)
     // renderer
     _renderer.reset(new Renderer(getAssetFullPath("shader")));
 
-    // load asset
-    AssimpModel model(getAssetFullPath("model/cyborg/cyborg.obj"));
-    _scene->addToScene(model);
+    // model textures are block compressed on import if the context can sample BC1/BC3
+    ModelImport::compressTextures = ImageTexture2D::isCompressedFormatSupported(BCnFormat::BC1)
+        && ImageTexture2D::isCompressedFormatSupported(BCnFormat::BC3);
+
+    // load asset, the viewer renders while it streams in
+    _modelLoader.reset(new ModelLoader);
+    _pendingModels.push_back(_modelLoader->load(getAssetFullPath("model/cyborg/cyborg.obj"), MeshCpuData::Positions));
 
 }
 
@@ -36,6 +42,104 @@ Viewer::~Viewer()
 {
 }
 
+bool Viewer::runBenchmark(const std::string& name)
+{
+    if (benchmark::isContextFree(name))
+        return benchmark::runContextFree(name);
+    if (name == "mesh-cache")
+    {
+        benchmark::meshCacheLoad(getBenchmarkModelPaths(), 5);
+        return true;
+    }
+    if (name == "mesh-threads")
+    {
+        benchmark::meshConversionScaling(getBenchmarkModelPaths(), 10);
+        return true;
+    }
+    if (name == "texture-decode")
+    {
+        benchmark::textureDecode(getBenchmarkModelPaths(), 5);
+        return true;
+    }
+    if (name == "texture-sharing")
+    {
+        benchmark::textureSharing(getBenchmarkModelPaths(), 8);
+        return true;
+    }
+    if (name == "texture-compression")
+    {
+        benchmark::textureCompression(getBenchmarkModelPaths(), 3);
+        return true;
+    }
+    if (name == "mesh-optimize")
+    {
+        benchmark::meshOptimization(getBenchmarkModelPaths());
+        return true;
+    }
+    if (name == "meshlet-culling")
+    {
+        benchmark::meshletCulling(getBenchmarkModelPaths(), 16);
+        return true;
+    }
+    if (name == "lod-selection")
+    {
+        benchmark::lodSelection(*_renderer, getBenchmarkModelPaths(), _windowWidth, _windowHeight, 60);
+        return true;
+    }
+    if (name == "mesh-memory")
+    {
+        benchmark::meshMemory({ getAssetFullPath("model/nanosuit/nanosuit.obj") });
+        return true;
+    }
+    if (name == "async-load")
+    {
+        benchmark::asyncModelLoad(getBenchmarkModelPaths(), _uploadBudgetMs);
+        return true;
+    }
+    if (name == "scene-bvh")
+    {
+        benchmark::sceneBvh(getBenchmarkModelPaths(), 10000, 10000);
+        return true;
+    }
+    if (name == "gpu-culling")
+    {
+        return benchmark::gpuCulling(getAssetFullPath("shader"), getBenchmarkModelPaths(), 2500, 16);
+    }
+    if (name == "shadow-culling")
+    {
+        benchmark::shadowCulling(*_renderer, getBenchmarkModelPaths(), 500, _windowWidth, _windowHeight, 30);
+        return true;
+    }
+    if (name == "clustered-lighting")
+    {
+        benchmark::clusteredLighting(*_renderer, getBenchmarkModelPaths(), { 16, 64, 256, 1024, 4096 }, _windowWidth, _windowHeight, 30);
+        return true;
+    }
+    if (name == "uniform-update")
+    {
+        benchmark::uniformUpdate(getAssetFullPath("shader"), 5000, 60);
+        return true;
+    }
+    if (name == "render-queue")
+    {
+        benchmark::renderQueue(*_renderer, getBenchmarkModelPaths(), 500, _windowWidth, _windowHeight, 30);
+        return true;
+    }
+
+    std::cerr << "unknown benchmark " << name << std::endl;
+    return false;
+}
+
+std::vector<std::string> Viewer::getBenchmarkModelPaths() const
+{
+    return {
+        getAssetFullPath("model/cyborg/cyborg.obj"),
+        getAssetFullPath("model/nanosuit/nanosuit.obj"),
+        getAssetFullPath("model/planet/planet.obj"),
+        getAssetFullPath("model/rock/rock.obj"),
+    };
+}
+
 void Viewer::handleInput()
 {
     if (_input.keyboard.keyStates[GLFW_KEY_ESCAPE] != GLFW_RELEASE)
@@ -49,6 +153,18 @@ void Viewer::handleInput()
         _cameraController->update(_input, _deltaTime);
     }
 
+    //pick on release of a left click that did not rotate the camera
+    const glm::vec2 mousePosition(_input.mouse.move.xNow, _input.mouse.move.yNow);
+    if (_input.mouse.press.left && !_leftPressed)
+    {
+        _pressPosition = mousePosition;
+    }
+    else if (!_input.mouse.press.left && _leftPressed && mousePosition == _pressPosition && !_ui->wantCaptureMouse())
+    {
+        pickModel(mousePosition.x, mousePosition.y);
+    }
+    _leftPressed = _input.mouse.press.left;
+
     //handle wire mode
     if (_uiOptions->wire == false)
     {
@@ -66,6 +182,11 @@ void Viewer::handleInput()
 void Viewer::renderFrame()
 {
     showFpsInWindowTitle();
+
+    _modelLoader->update(_uploadBudgetMs);
+    addLoadedModels();
+    _scene->update();
+
     clearScreen();
 
     _renderer->setScreenSize(this->_windowHeight, this->_windowWidth);
@@ -74,6 +195,43 @@ void Viewer::renderFrame()
     _ui->render(_camera, *_uiOptions, *_scene);
 }
 
+void Viewer::addLoadedModels()
+{
+    auto it = _pendingModels.begin();
+    while (it != _pendingModels.end())
+    {
+        const auto& request = *it;
+        if (request->state == ModelLoader::Request::State::Loading)
+        {
+            ++it;
+            continue;
+        }
+
+        if (request->state == ModelLoader::Request::State::Ready)
+        {
+            _scene->addToScene(*request->model);
+        }
+        else
+        {
+            spdlogManagement::getConsoleLogHandle()->error("load {} failed", request->path);
+        }
+        it = _pendingModels.erase(it);
+    }
+}
+
+void Viewer::pickModel(float x, float y)
+{
+    RayHit hit;
+    if (!_scene->pick(_cameraController->getPickRay(x, y), hit))
+    {
+        _ui->clearPicked();
+        return;
+    }
+    _ui->setPicked(hit);
+    spdlogManagement::getConsoleLogHandle()->info("picked model {} mesh {} at {} {} {}", hit.model, hit.mesh,
+        hit.position.x, hit.position.y, hit.position.z);
+}
+
 void Viewer::clearScreen()
 {
     glClearColor(_clearColor.r, _clearColor.g, _clearColor.b, _clearColor.a);
@@ -9,6 +9,7 @@
 #include "base/light.h"
 
 #include "camera_controller.h"
+#include "model_loader.h"
 #include "renderer.h"
 #include "scene.h"
 #include "ui.h"
@@ -22,6 +23,9 @@ public:
 
     ~Viewer();
 
+    // runs the named benchmark instead of the interactive loop, returns false for unknown names and failed checks
+    bool runBenchmark(const std::string& name);
+
 private:
     // ui
     std::unique_ptr<UI>        _ui;
@@ -30,6 +34,9 @@ private:
     // camera
     std::unique_ptr<PerspectiveCamera> _camera;
     std::unique_ptr<CameraController>  _cameraController;
+    // a left click that does not move the mouse picks a model
+    bool _leftPressed = false;
+    glm::vec2 _pressPosition = glm::vec2(0.0f);
 
     // scene
     std::unique_ptr<Scene> _scene;
@@ -37,6 +44,12 @@ private:
     // renderer
     std::unique_ptr<Renderer> _renderer;
 
+    // asset loading
+    std::unique_ptr<ModelLoader> _modelLoader;
+    std::vector<std::shared_ptr<ModelLoader::Request>> _pendingModels;
+    // render thread time per frame that may go into GPU uploads of loading models
+    float _uploadBudgetMs = 4.0f;
+
 
 private:
     void handleInput() override;
@@ -44,4 +57,12 @@ private:
     void renderFrame() override;
 
     void clearScreen();
+
+    // moves models that finished loading into the scene
+    void addLoadedModels();
+
+    // selects the model under the window position in the ui
+    void pickModel(float x, float y);
+
+    std::vector<std::string> getBenchmarkModelPaths() const;
 };
\ No newline at end of file